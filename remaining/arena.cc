@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <vector>
+#include "arena.hh"
+#include "error.hh"
+
+// The arena of the innermost open block, or NULL.
+arena *ast_arena = NULL;
+
+// One arena per open block, innermost last. Arenas of closed blocks are kept
+// in the vector above ast_arena_depth so that their first blocks are reused.
+static vector<arena *> ast_arenas;
+static size_t ast_arena_depth = 0;
+
+std::atomic<long> arena::total_allocations(0);
+std::atomic<long> arena::total_bytes(0);
+
+/* Start out with no block at all, so that unused arenas cost nothing. */
+arena::arena()
+{
+    current = NULL;
+    free_pos = NULL;
+    free_end = NULL;
+    used = 0;
+    reserved = 0;
+}
+
+
+arena::~arena()
+{
+    while (current != NULL) {
+        block *next = current->next;
+        free(current);
+        current = next;
+    }
+}
+
+
+/* Allocate a new block and make it the current one. Whatever was left in
+   the old current block is wasted, which is fine since requests are small
+   compared to the block size. */
+void arena::new_block(size_t size)
+{
+    // Round the header up so the first allocation is aligned.
+    size_t header = (sizeof(block) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+
+    block *b = (block *) malloc(header + block_size);
+    if (b == NULL) {
+        fatal("arena::new_block: Out of memory");
+    }
+    b->next = current;
+    b->size = block_size;
+    current = b;
+    reserved += block_size;
+
+    free_pos = (char *) b + header;
+    free_end = free_pos + block_size;
+}
+
+
+/* Give back all blocks but the oldest one, and start allocating from the
+   beginning of that. */
+void arena::release()
+{
+    if (current == NULL) {
+        return;
+    }
+    while (current->next != NULL) {
+        block *next = current->next;
+        reserved -= current->size;
+        free(current);
+        current = next;
+    }
+
+    size_t header = (sizeof(block) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    free_pos = (char *) current + header;
+    free_end = free_pos + current->size;
+    used = 0;
+}
+
+
+/* Start allocating AST nodes from a fresh arena for a new block. */
+void open_ast_arena()
+{
+    if (ast_arena_depth == ast_arenas.size()) {
+        ast_arenas.push_back(new arena());
+    }
+    ast_arena = ast_arenas[ast_arena_depth++];
+}
+
+
+/* Free all nodes of the innermost block and go back to the enclosing one. */
+void close_ast_arena()
+{
+    assert(ast_arena_depth > 0);
+    ast_arenas[--ast_arena_depth]->release();
+    ast_arena = ast_arena_depth > 0 ? ast_arenas[ast_arena_depth - 1] : NULL;
+}
@@ -0,0 +1,103 @@
+#ifndef __ARENA_HH__
+#define __ARENA_HH__
+
+#include <stddef.h>
+#include <atomic>
+
+/* Size of each block an arena allocates from, unless a single request is
+   larger than this. */
+const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+/* A simple region allocator. Memory is carved out of large blocks by bumping
+   a pointer, and is only given back all at once by release() (or when the
+   arena itself is destroyed). Destructors of objects allocated in an arena
+   are never run, so only put things there whose memory is all they own.
+   Use it through the placement new below: new (some_arena) foo(...). */
+class arena
+{
+private:
+    // Header of each block. The memory handed out follows it.
+    struct block
+    {
+        block  *next;
+        size_t  size;
+    };
+
+    // The block we're currently allocating from. Older blocks follow.
+    block *current;
+
+    // Next free byte, and end of, the current block.
+    char *free_pos;
+    char *free_end;
+
+    // Bytes handed out and bytes reserved from the system, for statistics.
+    size_t used;
+    size_t reserved;
+
+    // Get a new block large enough for at least the argument size.
+    void new_block(size_t);
+
+public:
+    arena();
+    ~arena();
+
+    // Return suitably aligned memory for an object of the given size.
+    void *allocate(size_t size) {
+        size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (size > (size_t) (free_end - free_pos)) {
+            new_block(size);
+        }
+        void *p = free_pos;
+        free_pos += size;
+        used += size;
+        total_allocations++;
+        total_bytes += size;
+        return p;
+    }
+
+    // Free everything allocated so far. The first block is kept for reuse.
+    void release();
+
+    size_t bytes_used() { return used; }
+    size_t bytes_reserved() { return reserved; }
+
+    // Number and size of the allocations made from all arenas, for -T.
+    // Atomic, since the arenas of the symbol table and the AST are used
+    // from different threads with -j.
+    static std::atomic<long> total_allocations;
+    static std::atomic<long> total_bytes;
+
+    // Alignment of all allocations. Enough for any type we store.
+    static const size_t ALIGNMENT = 16;
+};
+
+inline void *operator new(size_t size, arena &a)
+{
+    return a.allocate(size);
+}
+
+// Only called if a constructor throws. The memory is reclaimed with the rest
+// of the arena.
+inline void operator delete(void *, arena &)
+{
+}
+
+/* AST nodes and position_information objects are allocated from the arena
+   of the block (procedure, function or program) currently being compiled.
+   The parser opens an arena when it opens a new scope, and closes it, which
+   frees every node in it at once, after the block has been through code
+   generation. Outside of any block they come from the ordinary heap. */
+extern arena *ast_arena;
+
+void open_ast_arena();
+void close_ast_arena();
+
+inline void *ast_allocate(size_t size)
+{
+    if (ast_arena != NULL) {
+        return ast_arena->allocate(size);
+    }
+    return ::operator new(size);
+}
+
+#endif
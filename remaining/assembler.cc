@@ -0,0 +1,1065 @@
+#include <elf.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assembler.hh"
+#include "error.hh"
+
+/*** This file contains the -E assembler. See assembler.hh for an
+     overview. ***/
+
+
+// The general registers, in encoding order.
+static const char *register_names[] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+
+// The condition codes, by the suffix of the jump.
+struct condition_code
+{
+    const char *suffix;
+    int code;
+};
+
+static const condition_code condition_codes[] = {
+    { "o", 0 }, { "no", 1 }, { "b", 2 }, { "c", 2 }, { "nae", 2 },
+    { "ae", 3 }, { "nb", 3 }, { "nc", 3 }, { "e", 4 }, { "z", 4 },
+    { "ne", 5 }, { "nz", 5 }, { "be", 6 }, { "na", 6 }, { "a", 7 },
+    { "nbe", 7 }, { "s", 8 }, { "ns", 9 }, { "p", 10 }, { "pe", 10 },
+    { "np", 11 }, { "po", 11 }, { "l", 12 }, { "nge", 12 }, { "ge", 13 },
+    { "nl", 13 }, { "le", 14 }, { "ng", 14 }, { "g", 15 }, { "nle", 15 },
+    { NULL, 0 }
+};
+
+
+static bool fits_int8(long value)
+{
+    return value >= -128 && value <= 127;
+}
+
+
+static bool fits_int32(long value)
+{
+    return value >= -2147483648L && value <= 2147483647L;
+}
+
+
+static const char *skip_space(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+
+static const char *trim_space(const char *begin, const char *end)
+{
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' ||
+                           end[-1] == '\r')) {
+        end--;
+    }
+    return end;
+}
+
+
+// Parse L<n> at p. Returns the label number, or -1.
+static long parse_label(const char *&p, const char *end)
+{
+    if (p + 1 >= end || *p != 'L' || p[1] < '0' || p[1] > '9') {
+        return -1;
+    }
+    long label = 0;
+    p++;
+    while (p < end && *p >= '0' && *p <= '9') {
+        label = label * 10 + *p++ - '0';
+    }
+    return label;
+}
+
+
+// Parse a general register name. Returns its number, or -1.
+static int parse_register(const char *begin, const char *end)
+{
+    long length = end - begin;
+    for (int i = 0; i < 16; i++) {
+        if ((long) strlen(register_names[i]) == length &&
+                strncmp(register_names[i], begin, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+// Parse a signed decimal number. Returns false if it isn't one.
+static bool parse_number(const char *begin, const char *end, long &value)
+{
+    string text(begin, end);
+    char *rest;
+    errno = 0;
+    value = strtol(text.c_str(), &rest, 0);
+    return !text.empty() && *rest == '\0' && errno == 0;
+}
+
+
+elf_assembler::elf_assembler()
+{
+    current = TEXT;
+}
+
+
+void elf_assembler::error(const char *msg)
+{
+    fatal(string("elf_assembler: ") + msg + " in \"" + line + "\"");
+}
+
+
+/* Split the output into lines. Only the end of a piece that doesn't end
+   with a newline is copied, the rest is assembled where it is. */
+void elf_assembler::assemble(const char *data, long length)
+{
+    const char *end = data + length;
+    const char *p = data;
+
+    if (!partial.empty()) {
+        const char *newline = (const char *) memchr(p, '\n', end - p);
+        if (newline == NULL) {
+            partial.append(p, end - p);
+            return;
+        }
+        partial.append(p, newline - p);
+        assemble_line(partial.data(), partial.data() + partial.length());
+        partial.clear();
+        p = newline + 1;
+    }
+
+    while (p < end) {
+        const char *newline = (const char *) memchr(p, '\n', end - p);
+        if (newline == NULL) {
+            partial.assign(p, end - p);
+            return;
+        }
+        assemble_line(p, newline);
+        p = newline + 1;
+    }
+}
+
+
+void elf_assembler::assemble_line(const char *begin, const char *end)
+{
+    const char *comment = (const char *) memchr(begin, '#', end - begin);
+    if (comment != NULL) {
+        end = comment;
+    }
+    const char *p = skip_space(begin, end);
+    end = trim_space(p, end);
+    if (p == end) {
+        return;
+    }
+    line.assign(p, end - p);
+
+    // A label definition.
+    if (*p == 'L') {
+        const char *q = p;
+        long label = parse_label(q, end);
+        if (label != -1 && q < end && *q == ':') {
+            section &s = sections[current];
+            label_definition definition = {
+                current, (long) s.code.size(), (long) s.branches.size()
+            };
+            if (!labels.insert(make_pair(label, definition)).second) {
+                error("label defined twice");
+            }
+            p = skip_space(q + 1, end);
+            if (p == end) {
+                return;
+            }
+        }
+    }
+
+    const char *mnemonic_end = p;
+    while (mnemonic_end < end && *mnemonic_end != ' ' &&
+            *mnemonic_end != '\t') {
+        mnemonic_end++;
+    }
+    string mnemonic(p, mnemonic_end);
+
+    if (mnemonic == ".section") {
+        if (string(skip_space(mnemonic_end, end), end) != ".rodata") {
+            error("unknown section");
+        }
+        current = RODATA;
+        return;
+    }
+
+    // Up to three operands, separated by commas.
+    operand ops[3];
+    int nr_ops = 0;
+    p = skip_space(mnemonic_end, end);
+    while (p < end) {
+        if (nr_ops == 3) {
+            error("too many operands");
+        }
+        const char *comma = (const char *) memchr(p, ',', end - p);
+        const char *op_end = comma != NULL ? comma : end;
+        if (!parse_operand(p, op_end, ops[nr_ops])) {
+            error("bad operand");
+        }
+        nr_ops++;
+        p = comma != NULL ? comma + 1 : end;
+    }
+
+    if (mnemonic[0] == '.') {
+        if (mnemonic == ".text" && nr_ops == 0) {
+            current = TEXT;
+        } else if (mnemonic == ".align" && nr_ops == 1 &&
+                   ops[0].type == OP_IMM) {
+            // Padding would have to be code in .text, and moves with the
+            // branches, so it is only done for data.
+            if (current != RODATA) {
+                error(".align outside .rodata");
+            }
+            while (sections[current].code.size() % ops[0].value != 0) {
+                byte(0);
+            }
+        } else if (mnemonic == ".quad" && nr_ops == 1 &&
+                   ops[0].type == OP_IMM) {
+            bytes(ops[0].value, 8);
+        } else if ((mnemonic == ".globl" || mnemonic == ".global") &&
+                   nr_ops == 1 && ops[0].type == OP_LABEL) {
+            exported.push_back(ops[0].reg);
+        } else {
+            error("unknown directive");
+        }
+        return;
+    }
+
+    if (current != TEXT) {
+        error("instruction outside .text");
+    }
+
+    const operand &a = ops[0];
+    const operand &b = ops[1];
+
+    if (nr_ops == 0) {
+        if (mnemonic == "ret") {
+            byte(0xc3);
+        } else if (mnemonic == "leave") {
+            byte(0xc9);
+        } else if (mnemonic == "cqo") {
+            byte(0x48);
+            byte(0x99);
+        } else if (mnemonic == "faddp") {
+            byte(0xde);
+            byte(0xc1);
+        } else if (mnemonic == "fsubp") {
+            byte(0xde);
+            byte(0xe9);
+        } else if (mnemonic == "fmulp") {
+            byte(0xde);
+            byte(0xc9);
+        } else if (mnemonic == "fdivp") {
+            byte(0xde);
+            byte(0xf9);
+        } else if (mnemonic == "fchs") {
+            byte(0xd9);
+            byte(0xe0);
+        } else if (mnemonic == "nop") {
+            byte(0x90);
+        } else {
+            error("unknown instruction");
+        }
+        return;
+    }
+
+    if (nr_ops == 1) {
+        if (mnemonic == "jmp") {
+            jump(-1, a);
+            return;
+        }
+        if (mnemonic[0] == 'j') {
+            for (int i = 0; condition_codes[i].suffix != NULL; i++) {
+                if (mnemonic.compare(1, string::npos,
+                                     condition_codes[i].suffix) == 0) {
+                    jump(condition_codes[i].code, a);
+                    return;
+                }
+            }
+        } else if (mnemonic == "call") {
+            call(a);
+            return;
+        } else if (mnemonic == "push") {
+            if (a.type == OP_REG) {
+                if (a.reg >= 8) {
+                    byte(0x41);
+                }
+                byte(0x50 + (a.reg & 7));
+            } else if (a.type == OP_IMM && fits_int8(a.value)) {
+                byte(0x6a);
+                bytes(a.value, 1);
+            } else if (a.type == OP_IMM && fits_int32(a.value)) {
+                byte(0x68);
+                bytes(a.value, 4);
+            } else if (a.type == OP_MEM) {
+                modrm(0, false, 0xff, 6, a);
+            } else {
+                error("bad operand");
+            }
+            return;
+        } else if (mnemonic == "pop" && a.type == OP_REG) {
+            if (a.reg >= 8) {
+                byte(0x41);
+            }
+            byte(0x58 + (a.reg & 7));
+            return;
+        } else if (mnemonic == "neg" &&
+                   (a.type == OP_REG || a.type == OP_MEM)) {
+            modrm(0, true, 0xf7, 3, a);
+            return;
+        } else if (mnemonic == "idiv" &&
+                   (a.type == OP_REG || a.type == OP_MEM)) {
+            modrm(0, true, 0xf7, 7, a);
+            return;
+        } else if (a.type == OP_MEM && mnemonic == "fld") {
+            modrm(0, false, 0xdd, 0, a);
+            return;
+        } else if (a.type == OP_MEM && mnemonic == "fild") {
+            modrm(0, false, 0xdf, 5, a);
+            return;
+        } else if (mnemonic == "fstp") {
+            if (a.type == OP_MEM) {
+                modrm(0, false, 0xdd, 3, a);
+            } else if (a.type == OP_ST) {
+                byte(0xdd);
+                byte(0xd8 + a.reg);
+            } else {
+                error("bad operand");
+            }
+            return;
+        }
+        error("unknown instruction");
+    }
+
+    if (nr_ops == 3) {
+        if (mnemonic == "imul" && a.type == OP_REG &&
+                (b.type == OP_REG || b.type == OP_MEM) &&
+                ops[2].type == OP_IMM) {
+            if (fits_int8(ops[2].value)) {
+                modrm(0, true, 0x6b, a.reg, b, 1, ops[2].value);
+            } else if (fits_int32(ops[2].value)) {
+                modrm(0, true, 0x69, a.reg, b, 4, ops[2].value);
+            } else {
+                error("immediate out of range");
+            }
+            return;
+        }
+        error("unknown instruction");
+    }
+
+    // Two operands.
+    static const char *arithmetic_names[] = {
+        "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp", NULL
+    };
+    for (int i = 0; arithmetic_names[i] != NULL; i++) {
+        if (mnemonic == arithmetic_names[i]) {
+            arithmetic(i, a, b);
+            return;
+        }
+    }
+
+    if (mnemonic == "mov") {
+        mov(a, b);
+    } else if (mnemonic == "lea" && a.type == OP_REG && b.type == OP_MEM) {
+        modrm(0, true, 0x8d, a.reg, b);
+    } else if (mnemonic == "imul" && a.type == OP_REG &&
+               (b.type == OP_REG || b.type == OP_MEM)) {
+        modrm(0, true, 0x0faf, a.reg, b);
+    } else if (mnemonic == "idiv" && a.type == OP_REG && a.reg == 0 &&
+               (b.type == OP_REG || b.type == OP_MEM)) {
+        // The two-operand form as writes for idiv rax, r/m.
+        modrm(0, true, 0xf7, 7, b);
+    } else if ((mnemonic == "shl" || mnemonic == "sal" || mnemonic == "shr" ||
+                mnemonic == "sar") &&
+               (a.type == OP_REG || a.type == OP_MEM) && b.type == OP_IMM) {
+        int n = mnemonic == "shr" ? 5 : mnemonic == "sar" ? 7 : 4;
+        if (b.value == 1) {
+            modrm(0, true, 0xd1, n, a);
+        } else {
+            modrm(0, true, 0xc1, n, a, 1, b.value);
+        }
+    } else if (mnemonic == "btc" && (a.type == OP_REG || a.type == OP_MEM) &&
+               b.type == OP_IMM) {
+        modrm(0, true, 0x0fba, 7, a, 1, b.value);
+    } else if (mnemonic == "fcomip" && a.type == OP_ST && a.reg == 0 &&
+               b.type == OP_ST) {
+        byte(0xdf);
+        byte(0xf0 + b.reg);
+    } else {
+        sse(mnemonic, a, b);
+    }
+}
+
+
+bool elf_assembler::parse_operand(const char *begin, const char *end,
+                                  operand &op)
+{
+    begin = skip_space(begin, end);
+    end = trim_space(begin, end);
+
+    op.type = OP_NONE;
+    op.reg = -1;
+    op.value = 0;
+    op.base = -1;
+    op.index = -1;
+    op.scale = 1;
+    op.rip_label = -1;
+
+    if (end - begin > 9 && strncmp(begin, "qword ptr", 9) == 0) {
+        begin = skip_space(begin + 9, end);
+        if (begin == end || *begin != '[') {
+            return false;
+        }
+    }
+    if (begin == end) {
+        return false;
+    }
+
+    if (*begin == '[') {
+        if (end[-1] != ']') {
+            return false;
+        }
+        op.type = OP_MEM;
+        const char *p = begin + 1;
+        const char *inner_end = end - 1;
+        bool rip = false;
+        bool negative = false;
+        while (p < inner_end) {
+            p = skip_space(p, inner_end);
+            const char *term_end = p;
+            while (term_end < inner_end && *term_end != '+' &&
+                    *term_end != '-') {
+                term_end++;
+            }
+            const char *term_last = trim_space(p, term_end);
+            const char *star = (const char *) memchr(p, '*', term_last - p);
+            long value;
+            if (p == term_last) {
+                return false;
+            } else if (star != NULL) {
+                int index = parse_register(p, trim_space(p, star));
+                long scale;
+                if (index == -1 || index == 4 || op.index != -1 || negative ||
+                        !parse_number(skip_space(star + 1, term_last),
+                                      term_last, scale) ||
+                        (scale != 1 && scale != 2 && scale != 4 &&
+                         scale != 8)) {
+                    return false;
+                }
+                op.index = index;
+                op.scale = scale;
+            } else if (term_last - p == 3 && strncmp(p, "rip", 3) == 0) {
+                rip = true;
+            } else if (*p == 'L') {
+                const char *q = p;
+                op.rip_label = parse_label(q, term_last);
+                if (op.rip_label == -1 || q != term_last || negative) {
+                    return false;
+                }
+            } else if (parse_number(p, term_last, value)) {
+                op.value += negative ? -value : value;
+            } else {
+                int reg = parse_register(p, term_last);
+                if (reg == -1 || negative) {
+                    return false;
+                }
+                if (op.base == -1) {
+                    op.base = reg;
+                } else if (op.index == -1 && reg != 4) {
+                    op.index = reg;
+                } else {
+                    return false;
+                }
+            }
+            if (term_end < inner_end) {
+                negative = *term_end == '-';
+                term_end++;
+            }
+            p = term_end;
+        }
+        if (rip != (op.rip_label != -1) ||
+                (rip && (op.base != -1 || op.index != -1 || op.value != 0)) ||
+                (!rip && op.base == -1)) {
+            return false;
+        }
+        return true;
+    }
+
+    if ((*begin >= '0' && *begin <= '9') || *begin == '-') {
+        op.type = OP_IMM;
+        return parse_number(begin, end, op.value);
+    }
+
+    if (*begin == 'L') {
+        const char *p = begin;
+        op.type = OP_LABEL;
+        op.reg = parse_label(p, end);
+        return op.reg != -1 && p == end;
+    }
+
+    if (end - begin == 5 && strncmp(begin, "ST(", 3) == 0 && end[-1] == ')' &&
+            begin[3] >= '0' && begin[3] <= '7') {
+        op.type = OP_ST;
+        op.reg = begin[3] - '0';
+        return true;
+    }
+
+    if (end - begin > 3 && strncmp(begin, "xmm", 3) == 0) {
+        long reg;
+        op.type = OP_XMM;
+        if (!parse_number(begin + 3, end, reg) || reg < 0 || reg > 15) {
+            return false;
+        }
+        op.reg = reg;
+        return true;
+    }
+
+    op.type = OP_REG;
+    op.reg = parse_register(begin, end);
+    return op.reg != -1;
+}
+
+
+void elf_assembler::byte(int b)
+{
+    sections[current].code.push_back(b);
+}
+
+
+/* Little endian. */
+void elf_assembler::bytes(long value, int n)
+{
+    for (int i = 0; i < n; i++) {
+        byte(value & 0xff);
+        value >>= 8;
+    }
+}
+
+
+void elf_assembler::modrm(int prefix, bool w, int opcode, int reg,
+                          const operand &rm, int imm_size, long imm)
+{
+    if (rm.type != OP_MEM && rm.type != OP_REG && rm.type != OP_XMM) {
+        error("bad operand");
+    }
+
+    if (prefix != 0) {
+        byte(prefix);
+    }
+    int rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0);
+    if (rm.type == OP_MEM) {
+        if (rm.index >= 8) {
+            rex |= 2;
+        }
+        if (rm.base >= 8) {
+            rex |= 1;
+        }
+    } else if (rm.reg >= 8) {
+        rex |= 1;
+    }
+    if (rex != 0x40) {
+        byte(rex);
+    }
+    if (opcode > 0xff) {
+        byte(opcode >> 8);
+    }
+    byte(opcode & 0xff);
+
+    reg &= 7;
+    if (rm.type != OP_MEM) {
+        byte(0xc0 | reg << 3 | (rm.reg & 7));
+    } else if (rm.rip_label != -1) {
+        section &s = sections[current];
+        byte(reg << 3 | 5);
+        fixup f = {
+            (long) s.code.size(), (long) s.branches.size(), rm.rip_label,
+            imm_size, false
+        };
+        s.fixups.push_back(f);
+        bytes(0, 4);
+    } else {
+        // rbp and r13 as base always need a displacement, and rsp and r12
+        // as base always need a SIB byte.
+        int mod;
+        if (rm.value == 0 && (rm.base & 7) != 5) {
+            mod = 0;
+        } else if (fits_int8(rm.value)) {
+            mod = 1;
+        } else if (fits_int32(rm.value)) {
+            mod = 2;
+        } else {
+            error("displacement out of range");
+        }
+        if (rm.index != -1 || (rm.base & 7) == 4) {
+            int scale = rm.scale == 8 ? 3 : rm.scale == 4 ? 2 :
+                rm.scale == 2 ? 1 : 0;
+            int index = rm.index == -1 ? 4 : rm.index & 7;
+            byte(mod << 6 | reg << 3 | 4);
+            byte(scale << 6 | index << 3 | (rm.base & 7));
+        } else {
+            byte(mod << 6 | reg << 3 | (rm.base & 7));
+        }
+        if (mod == 1) {
+            bytes(rm.value, 1);
+        } else if (mod == 2) {
+            bytes(rm.value, 4);
+        }
+    }
+
+    if (imm_size > 0) {
+        bytes(imm, imm_size);
+    }
+}
+
+
+/* add, or, adc, sbb, and, sub, xor and cmp, by their number in the opcode
+   map. */
+void elf_assembler::arithmetic(int n, const operand &dest,
+                               const operand &src)
+{
+    if ((dest.type == OP_REG || dest.type == OP_MEM) && src.type == OP_REG) {
+        modrm(0, true, n * 8 + 1, src.reg, dest);
+    } else if (dest.type == OP_REG && src.type == OP_MEM) {
+        modrm(0, true, n * 8 + 3, dest.reg, src);
+    } else if ((dest.type == OP_REG || dest.type == OP_MEM) &&
+               src.type == OP_IMM) {
+        if (fits_int8(src.value)) {
+            modrm(0, true, 0x83, n, dest, 1, src.value);
+        } else if (!fits_int32(src.value)) {
+            error("immediate out of range");
+        } else if (dest.type == OP_REG && dest.reg == 0) {
+            byte(0x48);
+            byte(n * 8 + 5);
+            bytes(src.value, 4);
+        } else {
+            modrm(0, true, 0x81, n, dest, 4, src.value);
+        }
+    } else {
+        error("bad operands");
+    }
+}
+
+
+void elf_assembler::mov(const operand &dest, const operand &src)
+{
+    if ((dest.type == OP_REG || dest.type == OP_MEM) && src.type == OP_REG) {
+        modrm(0, true, 0x89, src.reg, dest);
+    } else if (dest.type == OP_REG && src.type == OP_MEM) {
+        modrm(0, true, 0x8b, dest.reg, src);
+    } else if ((dest.type == OP_REG || dest.type == OP_MEM) &&
+               src.type == OP_IMM && fits_int32(src.value)) {
+        modrm(0, true, 0xc7, 0, dest, 4, src.value);
+    } else if (dest.type == OP_REG && src.type == OP_IMM) {
+        // movabs.
+        byte(dest.reg >= 8 ? 0x49 : 0x48);
+        byte(0xb8 + (dest.reg & 7));
+        bytes(src.value, 8);
+    } else {
+        error("bad operands");
+    }
+}
+
+
+void elf_assembler::sse(const string &mnemonic, const operand &dest,
+                        const operand &src)
+{
+    bool src_rm = src.type == OP_XMM || src.type == OP_MEM;
+
+    if (mnemonic == "movsd") {
+        if (dest.type == OP_XMM && src_rm) {
+            modrm(0xf2, false, 0x0f10, dest.reg, src);
+        } else if (dest.type == OP_MEM && src.type == OP_XMM) {
+            modrm(0xf2, false, 0x0f11, src.reg, dest);
+        } else {
+            error("bad operands");
+        }
+    } else if (mnemonic == "movq") {
+        if (dest.type == OP_XMM && src.type == OP_REG) {
+            modrm(0x66, true, 0x0f6e, dest.reg, src);
+        } else if (dest.type == OP_REG && src.type == OP_XMM) {
+            modrm(0x66, true, 0x0f7e, src.reg, dest);
+        } else if (dest.type == OP_XMM && src_rm) {
+            modrm(0xf3, false, 0x0f7e, dest.reg, src);
+        } else if (dest.type == OP_MEM && src.type == OP_XMM) {
+            modrm(0x66, false, 0x0fd6, src.reg, dest);
+        } else {
+            error("bad operands");
+        }
+    } else if (dest.type == OP_XMM && src_rm &&
+               (mnemonic == "addsd" || mnemonic == "mulsd" ||
+                mnemonic == "subsd" || mnemonic == "divsd")) {
+        int opcode = mnemonic == "addsd" ? 0x58 : mnemonic == "mulsd" ? 0x59 :
+            mnemonic == "subsd" ? 0x5c : 0x5e;
+        modrm(0xf2, false, 0x0f00 | opcode, dest.reg, src);
+    } else if (mnemonic == "movdqa" || mnemonic == "movapd") {
+        int opcode = mnemonic == "movdqa" ? 0x0f6f : 0x0f28;
+        if (dest.type == OP_XMM && src_rm) {
+            modrm(0x66, false, opcode, dest.reg, src);
+        } else if (dest.type == OP_MEM && src.type == OP_XMM) {
+            modrm(0x66, false, opcode + (opcode == 0x0f6f ? 0x10 : 1),
+                  src.reg, dest);
+        } else {
+            error("bad operands");
+        }
+    } else if (dest.type == OP_XMM && src_rm &&
+               (mnemonic == "paddq" || mnemonic == "psubq" ||
+                mnemonic == "addpd" || mnemonic == "subpd" ||
+                mnemonic == "mulpd" || mnemonic == "divpd" ||
+                mnemonic == "punpcklqdq" || mnemonic == "punpckhqdq")) {
+        int opcode = mnemonic == "paddq" ? 0xd4 : mnemonic == "psubq" ? 0xfb :
+            mnemonic == "addpd" ? 0x58 : mnemonic == "subpd" ? 0x5c :
+            mnemonic == "mulpd" ? 0x59 : mnemonic == "divpd" ? 0x5e :
+            mnemonic == "punpcklqdq" ? 0x6c : 0x6d;
+        modrm(0x66, false, 0x0f00 | opcode, dest.reg, src);
+    } else if (mnemonic == "ucomisd" && dest.type == OP_XMM && src_rm) {
+        modrm(0x66, false, 0x0f2e, dest.reg, src);
+    } else if (mnemonic == "cvtsi2sd" && dest.type == OP_XMM &&
+               (src.type == OP_REG || src.type == OP_MEM)) {
+        modrm(0xf2, true, 0x0f2a, dest.reg, src);
+    } else if (mnemonic == "cvttsd2si" && dest.type == OP_REG && src_rm) {
+        modrm(0xf2, true, 0x0f2c, dest.reg, src);
+    } else {
+        error("unknown instruction");
+    }
+}
+
+
+/* The jump is only recorded here, its bytes are written once its size is
+   known. */
+void elf_assembler::jump(int condition, const operand &target)
+{
+    if (target.type != OP_LABEL) {
+        error("jump to something other than a label");
+    }
+    section &s = sections[current];
+    branch b = { (long) s.code.size(), target.reg, condition, 2, 0 };
+    s.branches.push_back(b);
+}
+
+
+void elf_assembler::call(const operand &target)
+{
+    if (target.type != OP_LABEL) {
+        error("call to something other than a label");
+    }
+    section &s = sections[current];
+    byte(0xe8);
+    fixup f = {
+        (long) s.code.size(), (long) s.branches.size(), target.reg, 0, true
+    };
+    s.fixups.push_back(f);
+    bytes(0, 4);
+}
+
+
+long elf_assembler::offset(section_type s, long pos, long branches)
+{
+    if (branches == 0) {
+        return pos;
+    }
+    const branch &b = sections[s].branches[branches - 1];
+    return pos - b.pos + b.offset + b.size;
+}
+
+
+/* Branches only ever grow, so this ends. A branch to a label outside its
+   section or not defined at all is made near at once, since it needs a
+   relocation. */
+void elf_assembler::relax()
+{
+    for (int s = 0; s < NR_SECTIONS; s++) {
+        vector<branch> &branches = sections[s].branches;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            long shift = 0;
+            for (unsigned long i = 0; i < branches.size(); i++) {
+                branches[i].offset = branches[i].pos + shift;
+                shift += branches[i].size;
+            }
+            for (unsigned long i = 0; i < branches.size(); i++) {
+                branch &b = branches[i];
+                if (b.size != 2) {
+                    continue;
+                }
+                unordered_map<long, label_definition>::iterator target =
+                    labels.find(b.label);
+                bool near = target == labels.end() ||
+                    target->second.section != s;
+                if (!near) {
+                    long to = offset((section_type) s, target->second.pos,
+                                     target->second.branches);
+                    near = !fits_int8(to - (b.offset + 2));
+                }
+                if (near) {
+                    b.size = b.condition == -1 ? 5 : 6;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+
+/* The ELF file is laid out as the header, the contents of the sections and
+   then the section headers. The local symbols are the two section symbols,
+   which the relocations of references to .rodata are made against, and the
+   global ones are the exported and undefined labels. */
+void elf_assembler::write_object(const string &file_name)
+{
+    if (!partial.empty()) {
+        assemble_line(partial.data(), partial.data() + partial.length());
+        partial.clear();
+    }
+    line.clear();
+
+    relax();
+
+    enum {
+        SEC_NULL, SEC_TEXT, SEC_RODATA, SEC_RELA, SEC_SYMTAB, SEC_STRTAB,
+        SEC_SHSTRTAB, SEC_NOTE, NR_ELF_SECTIONS
+    };
+    static const char *section_names[NR_ELF_SECTIONS] = {
+        "", ".text", ".rodata", ".rela.text", ".symtab", ".strtab",
+        ".shstrtab", ".note.GNU-stack"
+    };
+
+    // The global symbols, by label.
+    vector<Elf64_Sym> symbols(SEC_RODATA + 1);
+    memset(&symbols[0], 0, symbols.size() * sizeof(Elf64_Sym));
+    for (int s = SEC_TEXT; s <= SEC_RODATA; s++) {
+        symbols[s].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+        symbols[s].st_shndx = s;
+    }
+    string strtab(1, '\0');
+    unordered_map<long, long> global_symbols;
+
+    // Make a global symbol for a label, once.
+    struct {
+        vector<Elf64_Sym> &symbols;
+        string &strtab;
+        unordered_map<long, long> &global_symbols;
+        long get(long label) {
+            unordered_map<long, long>::iterator i = global_symbols.find(label);
+            if (i != global_symbols.end()) {
+                return i->second;
+            }
+            Elf64_Sym sym;
+            memset(&sym, 0, sizeof(sym));
+            sym.st_name = strtab.length();
+            sym.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+            sym.st_shndx = SHN_UNDEF;
+            strtab += "L" + to_string(label);
+            strtab += '\0';
+            symbols.push_back(sym);
+            global_symbols[label] = symbols.size() - 1;
+            return symbols.size() - 1;
+        }
+    } global = { symbols, strtab, global_symbols };
+
+    for (unsigned long i = 0; i < exported.size(); i++) {
+        unordered_map<long, label_definition>::iterator target =
+            labels.find(exported[i]);
+        if (target == labels.end()) {
+            fatal("elf_assembler: exported label L" + to_string(exported[i]) +
+                  " not defined");
+        }
+        Elf64_Sym &sym = symbols[global.get(exported[i])];
+        sym.st_shndx = target->second.section == TEXT ? SEC_TEXT : SEC_RODATA;
+        sym.st_value = offset(target->second.section, target->second.pos,
+                              target->second.branches);
+    }
+
+    // Write the branches into the code, and resolve or relocate the fixups.
+    vector<Elf64_Rela> relocations;
+    vector<unsigned char> contents[NR_SECTIONS];
+    for (int s = 0; s < NR_SECTIONS; s++) {
+        section &sec = sections[s];
+        vector<unsigned char> &out = contents[s];
+        if (!sec.fixups.empty() && s != TEXT) {
+            fatal("elf_assembler: relocation outside .text");
+        }
+
+        for (unsigned long i = 0; i < sec.fixups.size(); i++) {
+            fixup &f = sec.fixups[i];
+            long at = offset((section_type) s, f.pos, f.branches);
+            unordered_map<long, label_definition>::iterator target =
+                labels.find(f.label);
+            if (target != labels.end() && target->second.section == s) {
+                long to = offset((section_type) s, target->second.pos,
+                                 target->second.branches);
+                long disp = to - (at + 4 + f.tail);
+                for (int j = 0; j < 4; j++) {
+                    sec.code[f.pos + j] = (disp >> (8 * j)) & 0xff;
+                }
+                continue;
+            }
+            Elf64_Rela rela;
+            rela.r_offset = at;
+            if (target != labels.end()) {
+                rela.r_info = ELF64_R_INFO(target->second.section == TEXT ?
+                                           SEC_TEXT : SEC_RODATA,
+                                           R_X86_64_PC32);
+                rela.r_addend = offset(target->second.section,
+                                       target->second.pos,
+                                       target->second.branches) - 4 - f.tail;
+            } else {
+                rela.r_info = ELF64_R_INFO(global.get(f.label),
+                                           f.call ? R_X86_64_PLT32 :
+                                           R_X86_64_PC32);
+                rela.r_addend = -4 - f.tail;
+            }
+            relocations.push_back(rela);
+        }
+
+        long copied = 0;
+        out.reserve(sec.code.size() + 6 * sec.branches.size());
+        for (unsigned long i = 0; i < sec.branches.size(); i++) {
+            branch &b = sec.branches[i];
+            out.insert(out.end(), sec.code.begin() + copied,
+                       sec.code.begin() + b.pos);
+            copied = b.pos;
+
+            unordered_map<long, label_definition>::iterator target =
+                labels.find(b.label);
+            long disp = 0;
+            if (b.size == 2) {
+                out.push_back(b.condition == -1 ? 0xeb : 0x70 + b.condition);
+            } else if (b.condition == -1) {
+                out.push_back(0xe9);
+            } else {
+                out.push_back(0x0f);
+                out.push_back(0x80 + b.condition);
+            }
+            if (target != labels.end() && target->second.section == s) {
+                disp = offset((section_type) s, target->second.pos,
+                              target->second.branches) - (b.offset + b.size);
+            } else {
+                if (s != TEXT) {
+                    fatal("elf_assembler: relocation outside .text");
+                }
+                Elf64_Rela rela;
+                rela.r_offset = b.offset + b.size - 4;
+                if (target != labels.end()) {
+                    rela.r_info = ELF64_R_INFO(SEC_RODATA, R_X86_64_PC32);
+                    rela.r_addend = offset(target->second.section,
+                                           target->second.pos,
+                                           target->second.branches) - 4;
+                } else {
+                    rela.r_info = ELF64_R_INFO(global.get(b.label),
+                                               R_X86_64_PLT32);
+                    rela.r_addend = -4;
+                }
+                relocations.push_back(rela);
+            }
+            for (int j = 0; j < (b.size == 2 ? 1 : 4); j++) {
+                out.push_back((disp >> (8 * j)) & 0xff);
+            }
+        }
+        out.insert(out.end(), sec.code.begin() + copied, sec.code.end());
+    }
+
+    string shstrtab(1, '\0');
+    Elf64_Shdr headers[NR_ELF_SECTIONS];
+    memset(headers, 0, sizeof(headers));
+    for (int i = 1; i < NR_ELF_SECTIONS; i++) {
+        headers[i].sh_name = shstrtab.length();
+        shstrtab += section_names[i];
+        shstrtab += '\0';
+    }
+
+    // The section contents, in order.
+    string file(sizeof(Elf64_Ehdr), '\0');
+    struct {
+        Elf64_Shdr *headers;
+        string &file;
+        void add(int i, const void *data, long size, long align) {
+            while (file.length() % align != 0) {
+                file += '\0';
+            }
+            headers[i].sh_offset = file.length();
+            headers[i].sh_size = size;
+            headers[i].sh_addralign = align;
+            file.append((const char *) data, size);
+        }
+    } add_section = { headers, file };
+
+    headers[SEC_TEXT].sh_type = SHT_PROGBITS;
+    headers[SEC_TEXT].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    add_section.add(SEC_TEXT, contents[TEXT].data(), contents[TEXT].size(), 1);
+
+    headers[SEC_RODATA].sh_type = SHT_PROGBITS;
+    headers[SEC_RODATA].sh_flags = SHF_ALLOC;
+    add_section.add(SEC_RODATA, contents[RODATA].data(),
+                    contents[RODATA].size(), 8);
+
+    headers[SEC_RELA].sh_type = SHT_RELA;
+    headers[SEC_RELA].sh_flags = SHF_INFO_LINK;
+    headers[SEC_RELA].sh_link = SEC_SYMTAB;
+    headers[SEC_RELA].sh_info = SEC_TEXT;
+    headers[SEC_RELA].sh_entsize = sizeof(Elf64_Rela);
+    add_section.add(SEC_RELA, relocations.data(),
+                    relocations.size() * sizeof(Elf64_Rela), 8);
+
+    headers[SEC_SYMTAB].sh_type = SHT_SYMTAB;
+    headers[SEC_SYMTAB].sh_link = SEC_STRTAB;
+    headers[SEC_SYMTAB].sh_info = SEC_RODATA + 1;
+    headers[SEC_SYMTAB].sh_entsize = sizeof(Elf64_Sym);
+    add_section.add(SEC_SYMTAB, symbols.data(),
+                    symbols.size() * sizeof(Elf64_Sym), 8);
+
+    headers[SEC_STRTAB].sh_type = SHT_STRTAB;
+    add_section.add(SEC_STRTAB, strtab.data(), strtab.length(), 1);
+
+    headers[SEC_SHSTRTAB].sh_type = SHT_STRTAB;
+    add_section.add(SEC_SHSTRTAB, shstrtab.data(), shstrtab.length(), 1);
+
+    headers[SEC_NOTE].sh_type = SHT_PROGBITS;
+    add_section.add(SEC_NOTE, "", 0, 1);
+
+    while (file.length() % 8 != 0) {
+        file += '\0';
+    }
+    long section_headers = file.length();
+    file.append((const char *) headers, sizeof(headers));
+
+    Elf64_Ehdr header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = section_headers;
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = NR_ELF_SECTIONS;
+    header.e_shstrndx = SEC_SHSTRTAB;
+    file.replace(0, sizeof(header), (const char *) &header, sizeof(header));
+
+    FILE *f = fopen(file_name.c_str(), "w");
+    if (f == NULL) {
+        perror(file_name.c_str());
+        fatal("elf_assembler: could not create the object file");
+    }
+    if (fwrite(file.data(), 1, file.length(), f) != file.length() ||
+            fclose(f) != 0) {
+        fatal("elf_assembler: could not write the object file");
+    }
+}
@@ -0,0 +1,161 @@
+#ifndef __ASSEMBLER_HH__
+#define __ASSEMBLER_HH__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+
+/*** With -E, the code generator's output is encoded into x86-64 machine
+     code in the compiler itself and written as a relocatable ELF object,
+     instead of being written to d.out for the diesel script to run through
+     as. The instructions still come from the same stream the code
+     generator always writes to, so every instruction it can choose is
+     covered by both paths, but nothing goes through a file or another
+     process on the way.
+
+     Only what the code generator writes is understood: Intel syntax
+     without prefixes, 64-bit general registers, xmm and x87 registers,
+     qword memory operands, and the .text, .section .rodata, .align, .quad
+     and .globl directives. Anything else is a fatal error, since it means
+     that the code generator and the assembler have gone out of step.
+
+     The labels L<n> are resolved internally. Jumps are first assumed to
+     be short, and made near wherever the target turns out to be out of
+     reach, until nothing changes. That gives the same code as as. Calls to
+     labels that are not defined here, ie, the ones in diesel_glue.s, and
+     the labels exported with .globl become global symbols, so the object
+     can be linked with the glue and the run-time system. ***/
+
+
+class elf_assembler
+{
+private:
+    enum section_type { TEXT, RODATA, NR_SECTIONS };
+
+    // An operand of an instruction.
+    enum operand_type { OP_NONE, OP_REG, OP_XMM, OP_ST, OP_IMM, OP_LABEL,
+                        OP_MEM };
+    struct operand
+    {
+        operand_type type;
+
+        // The register number for OP_REG, OP_XMM and OP_ST, or the label
+        // number for OP_LABEL.
+        long reg;
+
+        // For OP_IMM, and the displacement of OP_MEM.
+        long value;
+
+        // The parts of an OP_MEM, -1 if not used. If rip_label isn't -1,
+        // the operand is [rip+L<rip_label>].
+        int base;
+        int index;
+        int scale;
+        long rip_label;
+    };
+
+    // A jump to a label, which is either short or near. The jump is not in
+    // the code of its section, but comes right before the byte at pos.
+    struct branch
+    {
+        long pos;
+        long label;
+
+        // -1 for jmp, else the condition code.
+        int condition;
+
+        // 2 for a short jump, 5 or 6 for a near jump.
+        int size;
+
+        // The final offset of the jump in its section.
+        long offset;
+    };
+
+    // A 32-bit PC-relative field in the code of a section, that refers to a
+    // label. tail is the number of bytes of the instruction after the
+    // field, since the displacement is counted from the end of it.
+    struct fixup
+    {
+        long pos;
+        long branches;
+        long label;
+        int tail;
+        bool call;
+    };
+
+    struct label_definition
+    {
+        section_type section;
+
+        // Position in the code, and the number of branches before it.
+        long pos;
+        long branches;
+    };
+
+    struct section
+    {
+        vector<unsigned char> code;
+        vector<branch> branches;
+        vector<fixup> fixups;
+    };
+
+    section sections[NR_SECTIONS];
+    section_type current;
+
+    unordered_map<long, label_definition> labels;
+    vector<long> exported;
+
+    // The end of the last line passed to assemble(), if it wasn't complete.
+    string partial;
+
+    // The line being assembled, for error messages.
+    string line;
+
+    // Parse and encode a single line.
+    void assemble_line(const char *, const char *);
+
+    // Parse an operand. Returns false if it isn't one.
+    bool parse_operand(const char *, const char *, operand &);
+
+    // Add bytes to the current section.
+    void byte(int);
+    void bytes(long, int);
+
+    // Encode an instruction with a ModRM byte, with an optional mandatory
+    // prefix (0 for none), REX.W, a one or two byte opcode (0x0f first),
+    // the reg field, the r/m operand and an immediate of imm_size bytes.
+    void modrm(int prefix, bool w, int opcode, int reg, const operand &rm,
+               int imm_size = 0, long imm = 0);
+
+    // Encode the instructions, by mnemonic.
+    void arithmetic(int, const operand &, const operand &);
+    void mov(const operand &, const operand &);
+    void sse(const string &, const operand &, const operand &);
+    void jump(int, const operand &);
+    void call(const operand &);
+
+    // Final offset of a position in the code of a section.
+    long offset(section_type, long pos, long branches);
+
+    // Settle the sizes of all branches.
+    void relax();
+
+    // Fatal error for the line being assembled.
+    void error(const char *);
+
+public:
+    elf_assembler();
+
+    // Assemble a piece of the code generator's output. It doesn't have to
+    // end with a complete line.
+    void assemble(const char *, long);
+
+    // Resolve the labels and write the object file.
+    void write_object(const string &);
+};
+
+
+#endif
@@ -6,7 +6,7 @@
  *******************************************************/
 
 int ast_node::indent_level = 0;
-bool ast_node::branches[10000];
+vector<bool> ast_node::branches(1);
 
 /* The superclass ast_node. */
 ast_node::ast_node(position_information *p) :
@@ -105,63 +105,45 @@ ast_elsif::ast_elsif(position_information *p,
 /* The ast_expr_list class. Currently only used for parameter lists. */
 ast_expr_list::ast_expr_list(position_information *p,
                              ast_expression *l) :
-    ast_node(p),
-    last_expr(l)
+    ast_node(p)
 {
     tag = AST_EXPR_LIST;
-    preceding = NULL;
+    exprs.push_back(l);
 }
 
-ast_expr_list::ast_expr_list(position_information *p,
-                             ast_expression *l,
-                             ast_expr_list *prev) :
-    ast_node(p),
-    last_expr(l),
-    preceding(prev)
+void ast_expr_list::append(ast_expression *l)
 {
-    tag = AST_EXPR_LIST;
+    exprs.push_back(l);
 }
 
 
 /* The ast_stmt_list class. */
 ast_stmt_list::ast_stmt_list(position_information *p,
                              ast_statement *h) :
-    ast_node(p),
-    last_stmt(h)
+    ast_node(p)
 {
     tag = AST_STMT_LIST;
-    preceding = NULL;
+    stmts.push_back(h);
 }
 
-ast_stmt_list::ast_stmt_list(position_information *p,
-                             ast_statement *h,
-                             ast_stmt_list *t) :
-    ast_node(p),
-    last_stmt(h),
-    preceding(t)
+void ast_stmt_list::append(ast_statement *h)
 {
-    tag = AST_STMT_LIST;
+    stmts.push_back(h);
 }
 
 
 /* The ast_elsif_list class. */
 ast_elsif_list::ast_elsif_list(position_information *p,
                                ast_elsif *h) :
-    ast_node(p),
-    last_elsif(h)
+    ast_node(p)
 {
     tag = AST_ELSIF_LIST;
-    preceding = NULL;
+    elsifs.push_back(h);
 }
 
-ast_elsif_list::ast_elsif_list(position_information *p,
-                               ast_elsif *h,
-                               ast_elsif_list *t) :
-    ast_node(p),
-    last_elsif(h),
-    preceding(t)
+void ast_elsif_list::append(ast_elsif *h)
 {
-    tag = AST_ELSIF_LIST;
+    elsifs.push_back(h);
 }
 
 
@@ -443,6 +425,31 @@ ast_cast::ast_cast(position_information *p,
 }
 
 
+/* The ast_common class. See optimize.cc. */
+ast_common::ast_common(position_information *p,
+                       ast_expression *e,
+                       int n) :
+    ast_expression(p, e->type),
+    expr(e),
+    first(NULL),
+    temp(NULL_SYM),
+    nr(n)
+{
+    tag = AST_COMMON;
+}
+
+ast_common::ast_common(position_information *p,
+                       ast_common *f) :
+    ast_expression(p, f->type),
+    expr(NULL),
+    first(f),
+    temp(NULL_SYM),
+    nr(f->nr)
+{
+    tag = AST_COMMON;
+}
+
+
 /* The ast_functionhead class. */
 ast_functionhead::ast_functionhead(position_information *p,
                                    sym_index s) :
@@ -510,6 +517,9 @@ void ast_node::indent(ostream &o)
 void ast_node::indent_more()
 {
     indent_level += 2;
+    if (branches.size() <= (unsigned long) indent_level) {
+        branches.resize(indent_level + 1);
+    }
 }
 
 void ast_node::indent_less()
@@ -595,43 +605,71 @@ void ast_elsif::print(ostream &o)
 }
 
 
+/* The lists are printed as if they still were chains of list nodes, each
+   with the preceding part of the list and its last element as children.
+   The chain is opened down to the first element, and then closed with an
+   element at each level, so that a long list doesn't recurse. */
 void ast_expr_list::print(ostream &o)
 {
-    o << "Expression list (preceding, last_expr)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_expr << endl;
-    end_child(o);
-    last_child(o);
-    o << last_expr;
-    // o << preceding;
-    end_child(o);
+    print_prefix(o, exprs.size());
+}
+
+void ast_expr_list::print_prefix(ostream &o, long n)
+{
+    for (long i = n; i > 0; i--) {
+        o << "Expression list (preceding, last_expr)\n";
+        begin_child(o);
+    }
+    o << (ast_node *)NULL;
+    for (long i = 0; i < n; i++) {
+        o << endl;
+        end_child(o);
+        last_child(o);
+        o << exprs[i];
+        end_child(o);
+    }
 }
 
 void ast_stmt_list::print(ostream &o)
 {
-    o << "Statement list (preceding, last_stmt)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_stmt << endl;
-    end_child(o);
-    last_child(o);
-    // o << preceding;
-    o << last_stmt;
-    end_child(o);
+    print_prefix(o, stmts.size());
+}
+
+void ast_stmt_list::print_prefix(ostream &o, long n)
+{
+    for (long i = n; i > 0; i--) {
+        o << "Statement list (preceding, last_stmt)\n";
+        begin_child(o);
+    }
+    o << (ast_node *)NULL;
+    for (long i = 0; i < n; i++) {
+        o << endl;
+        end_child(o);
+        last_child(o);
+        o << stmts[i];
+        end_child(o);
+    }
 }
 
 void ast_elsif_list::print(ostream &o)
 {
-    o << "Elsif list (preceding, last_elsif)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_elsif << endl;
-    end_child(o);
-    last_child(o);
-    // o << preceding;
-    o << last_elsif;
-    end_child(o);
+    print_prefix(o, elsifs.size());
+}
+
+void ast_elsif_list::print_prefix(ostream &o, long n)
+{
+    for (long i = n; i > 0; i--) {
+        o << "Elsif list (preceding, last_elsif)\n";
+        begin_child(o);
+    }
+    o << (ast_node *)NULL;
+    for (long i = 0; i < n; i++) {
+        o << endl;
+        end_child(o);
+        last_child(o);
+        o << elsifs[i];
+        end_child(o);
+    }
 }
 
 
@@ -827,6 +865,21 @@ void ast_cast::print(ostream &o)
 }
 
 
+void ast_common::print(ostream &o)
+{
+    if (first != NULL) {
+        o << "Common " << nr << " (reused) ["
+          << short_symbols << sym_tab->get_symbol(type) << long_symbols << "]";
+        return;
+    }
+    o << "Common " << nr << " (expr) ["
+      << short_symbols << sym_tab->get_symbol(type) << long_symbols << "]\n";
+    last_child(o);
+    o << expr;
+    end_child(o);
+}
+
+
 void ast_functionhead::print(ostream &o)
 {
     o << "Function head (" << short_symbols << sym_tab->get_symbol(sym_p)
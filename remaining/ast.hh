@@ -81,6 +81,8 @@ AST_NODE
      |
      +- AST_CAST
      |
+     +- AST_COMMON
+     |
      +- AST_PARAMETER
 */
 
@@ -126,7 +128,8 @@ enum ast_node_types {
     AST_FUNCTIONHEAD,
     AST_PROCEDUREHEAD,
     AST_PARAMETER,
-    AST_CAST
+    AST_CAST,
+    AST_COMMON
 };
 typedef enum ast_node_types ast_node_type;
 
@@ -152,15 +155,63 @@ class quad_list;
 
 
 
+/*** A growable array of AST node pointers, used by the list nodes. It is
+     allocated the same way as the nodes themselves, so that it goes away
+     together with them when the block's arena is released. Growing it
+     leaves the old elements behind in the arena, which is at most as much
+     again. ***/
+
+template<class T> class ast_array
+{
+private:
+    T **elements;
+    long count;
+    long capacity;
+
+public:
+    ast_array()
+    {
+        elements = NULL;
+        count = 0;
+        capacity = 0;
+    }
+
+    void push_back(T *element)
+    {
+        if (count == capacity) {
+            capacity = capacity == 0 ? 4 : capacity * 2;
+            T **grown = (T **) ast_allocate(capacity * sizeof(T *));
+            for (long i = 0; i < count; i++) {
+                grown[i] = elements[i];
+            }
+            elements = grown;
+        }
+        elements[count++] = element;
+    }
+
+    long size() const
+    {
+        return count;
+    }
+
+    T *&operator[](long i)
+    {
+        return elements[i];
+    }
+};
+
+
+
 /*** Abstract classes ***/
 
 /* Base class for all ast nodes. */
 class ast_node
 {
 protected:
-    // Used for AST printing.
+    // Used for AST printing. The lists print as deep chains, so there may
+    // be any number of levels.
     static int indent_level;
-    static bool branches[10000];
+    static vector<bool> branches;
 
     // All these methods are concerned with printing the AST.
     void indent(ostream &);
@@ -190,6 +241,11 @@ public:
     // Constructor.
     ast_node(position_information *);
 
+    // All nodes live in the current block's AST arena, see arena.hh. They
+    // are never deleted one by one.
+    static void *operator new(size_t size) { return ast_allocate(size); }
+    static void operator delete(void *) { }
+
     // Perform type checking. See semantic.cc for the method bodies.
     // Note that it's an error to call type_check in this class. It should
     // only be called in the concrete AST nodes, see below.
@@ -250,6 +306,13 @@ public:
 
     virtual sym_index generate_quads(quad_list &) = 0;
 
+    // Generate quads that jump to the label if the value of the expression
+    // is true (non-zero) when the bool is true, or false when it is false,
+    // and fall through otherwise. Used for the conditions of if, elsif and
+    // while statements. This version computes the value and tests it;
+    // relations and logical operators branch directly instead.
+    virtual void generate_jumps(quad_list &, long, bool);
+
     // Used for safe downcasting. We could provide a mechanism to safely
     // downcast ALL ast nodes... But these ones are the only ones we'll need
     // in this lab course. They will be used during AST optimization.
@@ -403,29 +466,29 @@ public:
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 
-    virtual void generate_quads_and_jump(quad_list &, int);
+    virtual void generate_quads_and_jump(quad_list &, long);
 };
 
 
 
 /* Contains a list of expressions. Currently only used for parameter lists.
-   Note: The parameters will be stored in reverse order! This is due to how the
-         grammar is written, it's easiest this way. */
+   The expressions are kept in one array, in the order they were written. */
 class ast_expr_list : public ast_node
 {
 protected:
     virtual void print(ostream &);
-public:
-    // Points to the last (last added) expression in the list.
-    ast_expression *last_expr;
 
-    // Points to a list of the preceding expressions.
-    ast_expr_list *preceding;
+    // Print the first n expressions as a (preceding, last_expr) chain.
+    void print_prefix(ostream &, long);
+public:
+    // The expressions in the list.
+    ast_array<ast_expression> exprs;
 
-    // Constructors.
+    // Constructor.
     ast_expr_list(position_information *, ast_expression *);
 
-    ast_expr_list(position_information *, ast_expression *, ast_expr_list *);
+    // Add an expression at the end of the list.
+    void append(ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -443,22 +506,24 @@ public:
 
 
 
-/* Contains a list of statements. */
+/* Contains a list of statements, kept in one array in order, so that the
+   passes over it can loop rather than recurse once per statement. */
 class ast_stmt_list : public ast_node
 {
 protected:
     virtual void print(ostream &);
-public:
-    // Points to the last statement in the list.
-    ast_statement *last_stmt;
 
-    // Points to a list of the preceding statements.
-    ast_stmt_list *preceding;
+    // Print the first n statements as a (preceding, last_stmt) chain.
+    void print_prefix(ostream &, long);
+public:
+    // The statements in the list.
+    ast_array<ast_statement> stmts;
 
-    // Constructors.
+    // Constructor.
     ast_stmt_list(position_information *, ast_statement *);
 
-    ast_stmt_list(position_information *, ast_statement *, ast_stmt_list *);
+    // Add a statement at the end of the list.
+    void append(ast_statement *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -472,22 +537,23 @@ public:
 
 
 
-/* Contains a list of elsif clauses. */
+/* Contains a list of elsif clauses, kept in one array in order. */
 class ast_elsif_list : public ast_node
 {
 protected:
     virtual void print(ostream &);
-public:
-    // Points to the last elsif clause in the list.
-    ast_elsif *last_elsif;
 
-    // Points to a list of the preceding elsif clauses.
-    ast_elsif_list *preceding;
+    // Print the first n clauses as a (preceding, last_elsif) chain.
+    void print_prefix(ostream &, long);
+public:
+    // The elsif clauses in the list.
+    ast_array<ast_elsif> elsifs;
 
-    // Constructors.
+    // Constructor.
     ast_elsif_list(position_information *, ast_elsif *);
 
-    ast_elsif_list(position_information *, ast_elsif *, ast_elsif_list *);
+    // Add a clause at the end of the list.
+    void append(ast_elsif *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -498,7 +564,7 @@ public:
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 
-    virtual void generate_quads_and_jump(quad_list &, int);
+    virtual void generate_quads_and_jump(quad_list &, long);
 };
 
 
@@ -773,6 +839,7 @@ public:
 
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
+    virtual void generate_jumps(quad_list &, long, bool);
 };
 
 
@@ -860,6 +927,41 @@ public:
 
 
 
+/* A common subexpression, made by the AST optimizer when the same
+   expression is computed more than once in a basic block. The first
+   occurrence is wrapped in a node with first == NULL, which remembers the
+   temp its value ends up in. The later ones are replaced by nodes pointing
+   to the first one, which just return that temp. */
+class ast_common : public ast_expression
+{
+protected:
+    virtual void print(ostream &);
+public:
+    // The expression, for the first occurrence. NULL for the others.
+    ast_expression *expr;
+
+    // The first occurrence, for the others. NULL for the first one.
+    ast_common *first;
+
+    // Where the first occurrence left its value. Set by generate_quads().
+    sym_index temp;
+
+    // Number shown by the AST printout, to tell the expressions apart.
+    int nr;
+
+    // Constructors. First occurrence and later ones.
+    ast_common(position_information *, ast_expression *, int);
+    ast_common(position_information *, ast_common *);
+
+    // AST optimization.
+    virtual void optimize();
+
+    // Quad generation.
+    virtual sym_index generate_quads(quad_list &);
+};
+
+
+
 /*** Classes derived from ast_binaryrelation ***/
 
 /* Equality operator. a = b. */
@@ -879,6 +981,7 @@ public:
 
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
+    virtual void generate_jumps(quad_list &, long, bool);
 };
 
 
@@ -899,6 +1002,7 @@ public:
 
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
+    virtual void generate_jumps(quad_list &, long, bool);
 };
 
 
@@ -919,6 +1023,7 @@ public:
 
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
+    virtual void generate_jumps(quad_list &, long, bool);
 };
 
 
@@ -939,6 +1044,7 @@ public:
 
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
+    virtual void generate_jumps(quad_list &, long, bool);
 };
 
 
@@ -1013,6 +1119,7 @@ public:
 
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
+    virtual void generate_jumps(quad_list &, long, bool);
 
     // Safe downcasts.
     virtual ast_or *get_ast_binaryoperation() {
@@ -1038,6 +1145,7 @@ public:
 
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
+    virtual void generate_jumps(quad_list &, long, bool);
 
     // Safe downcasts.
     virtual ast_and *get_ast_binaryoperation() {
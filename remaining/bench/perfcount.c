@@ -0,0 +1,107 @@
+/* perfcount.c - count cycles and instructions of a command.
+   usage: perfcount <outfile> <command> [args...]
+
+   Runs the command, and when it is done writes a line with its user mode
+   cycles, instructions and wall time in seconds to <outfile>. The counts
+   are taken with perf_event_open(2), so that no perf tool is needed. If
+   the kernel doesn't allow that, they are written as "-". The exit status
+   is that of the command. Used by the runbench script. */
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static int open_counter(pid_t pid, unsigned long config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+static void print_count(FILE *out, int fd)
+{
+    long long count;
+
+    if (fd == -1 || read(fd, &count, sizeof(count)) != sizeof(count)) {
+        fprintf(out, "- ");
+    } else {
+        fprintf(out, "%lld ", count);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int go[2];
+    pid_t pid;
+    int status;
+    int cycles, instructions;
+    struct timespec start, end;
+    FILE *out;
+    char c = 0;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: perfcount <outfile> <command> [args...]\n");
+        return 1;
+    }
+
+    /* The child waits for the counters to be attached before it execs,
+       so that only the command itself is counted. */
+    if (pipe(go) == -1) {
+        perror("pipe");
+        return 1;
+    }
+    pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        close(go[1]);
+        if (read(go[0], &c, 1) != 1) {
+            _exit(127);
+        }
+        close(go[0]);
+        execvp(argv[2], argv + 2);
+        perror(argv[2]);
+        _exit(127);
+    }
+    close(go[0]);
+
+    cycles = open_counter(pid, PERF_COUNT_HW_CPU_CYCLES);
+    instructions = open_counter(pid, PERF_COUNT_HW_INSTRUCTIONS);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (write(go[1], &c, 1) != 1) {
+        kill(pid, SIGKILL);
+    }
+    close(go[1]);
+    waitpid(pid, &status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    out = fopen(argv[1], "w");
+    if (out == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    print_count(out, cycles);
+    print_count(out, instructions);
+    fprintf(out, "%.6f\n", (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec) / 1e9);
+    fclose(out);
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
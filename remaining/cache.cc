@@ -0,0 +1,557 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.hh"
+#include "codegen.hh"
+#include "inliner.hh"
+#include "pipeline.hh"
+
+/*** This file contains the -C block cache. See cache.hh for an
+     overview. ***/
+
+// Defined in main.cc.
+extern char *cache_directory;
+extern bool assembler;
+extern bool assembler_trace;
+extern bool print_quads;
+extern bool print_flow_graph;
+extern bool typecheck;
+extern bool optimize;
+extern bool optimize_quads;
+extern bool inline_calls;
+extern bool vectorize_loops;
+extern bool register_allocation;
+extern bool register_parameters;
+extern bool sse_floats;
+extern bool elf_output;
+extern bool profile;
+
+// Defined in codegen.cc.
+extern code_generator *code_gen;
+
+block_cache *code_cache = new block_cache();
+
+// The first line of a cache file, followed by the number of labels, whether
+// the inliner kept the block and the length of its key. The key comes next,
+// and then the code.
+static const char *CACHE_HEADER = "# diesel block cache 2: ";
+
+
+/* Two 64-bit FNV-1a hashes with different starting values, as hex. This
+   only names the file, and different keys may still get the same name, so
+   the file has the key in it too. */
+static string key_hash(const string &key)
+{
+    unsigned long h1 = 14695981039346656037UL;
+    unsigned long h2 = 0x9e3779b97f4a7c15UL;
+    for (unsigned long i = 0; i < key.length(); i++) {
+        h1 = (h1 ^ (unsigned char) key[i]) * 1099511628211UL;
+        h2 = (h2 ^ (unsigned char) key[i]) * 1099511628211UL;
+    }
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016lx%016lx", h1, h2);
+    return hex;
+}
+
+
+block_cache::block_cache()
+{
+    generator = NULL;
+    hits = 0;
+    misses = 0;
+    stored = 0;
+}
+
+
+/* Only the code is cached, so there has to be code, and nothing else that
+   is printed along with it. */
+bool block_cache::active()
+{
+    return cache_directory != NULL && assembler && !assembler_trace &&
+        !print_quads && !print_flow_graph && !profile;
+}
+
+
+/* The tags are written out, and so are the constants, the types of the
+   expressions, and the symbols, which are numbered in the order they are
+   first seen, so the key doesn't depend on where in the symbol table they
+   are. refs gets the symbols in that order. */
+void block_cache::node_key(ast_node *node, string &key,
+                           map<sym_index, long> &numbers,
+                           vector<sym_index> &refs,
+                           map<ast_common *, long> &commons)
+{
+    if (node == NULL) {
+        key += " -";
+        return;
+    }
+
+    key += " (" + to_string(node->tag);
+    switch (node->tag) {
+    case AST_STMT_LIST: {
+        ast_stmt_list *list = static_cast<ast_stmt_list *>(node);
+        for (long i = 0; i < list->stmts.size(); i++) {
+            node_key(list->stmts[i], key, numbers, refs, commons);
+        }
+        break;
+    }
+    case AST_EXPR_LIST: {
+        ast_expr_list *list = static_cast<ast_expr_list *>(node);
+        for (long i = 0; i < list->exprs.size(); i++) {
+            node_key(list->exprs[i], key, numbers, refs, commons);
+        }
+        break;
+    }
+    case AST_ELSIF_LIST: {
+        ast_elsif_list *list = static_cast<ast_elsif_list *>(node);
+        for (long i = 0; i < list->elsifs.size(); i++) {
+            node_key(list->elsifs[i], key, numbers, refs, commons);
+        }
+        break;
+    }
+    case AST_ELSIF: {
+        ast_elsif *elsif = static_cast<ast_elsif *>(node);
+        node_key(elsif->condition, key, numbers, refs, commons);
+        node_key(elsif->body, key, numbers, refs, commons);
+        break;
+    }
+    case AST_PROCEDURECALL: {
+        ast_procedurecall *call = static_cast<ast_procedurecall *>(node);
+        node_key(call->id, key, numbers, refs, commons);
+        node_key(call->parameter_list, key, numbers, refs, commons);
+        break;
+    }
+    case AST_ASSIGN: {
+        ast_assign *assign = static_cast<ast_assign *>(node);
+        node_key(assign->lhs, key, numbers, refs, commons);
+        node_key(assign->rhs, key, numbers, refs, commons);
+        break;
+    }
+    case AST_WHILE: {
+        ast_while *loop = static_cast<ast_while *>(node);
+        node_key(loop->condition, key, numbers, refs, commons);
+        node_key(loop->body, key, numbers, refs, commons);
+        break;
+    }
+    case AST_IF: {
+        ast_if *test = static_cast<ast_if *>(node);
+        node_key(test->condition, key, numbers, refs, commons);
+        node_key(test->body, key, numbers, refs, commons);
+        node_key(test->elsif_list, key, numbers, refs, commons);
+        node_key(test->else_body, key, numbers, refs, commons);
+        break;
+    }
+    case AST_RETURN:
+        node_key(static_cast<ast_return *>(node)->value, key, numbers, refs,
+                 commons);
+        break;
+    default: {
+        // The rest are expressions.
+        ast_expression *expr = static_cast<ast_expression *>(node);
+        key += " t" + to_string(expr->type);
+        switch (node->tag) {
+        case AST_ID: {
+            sym_index sym_p = expr->get_ast_id()->sym_p;
+            map<sym_index, long>::iterator number = numbers.find(sym_p);
+            if (number == numbers.end()) {
+                number = numbers.insert(make_pair(sym_p, refs.size())).first;
+                refs.push_back(sym_p);
+            }
+            key += " s" + to_string(number->second);
+            break;
+        }
+        case AST_INDEXED: {
+            ast_indexed *indexed = static_cast<ast_indexed *>(node);
+            node_key(indexed->id, key, numbers, refs, commons);
+            node_key(indexed->index, key, numbers, refs, commons);
+            break;
+        }
+        case AST_INTEGER:
+            key += " i" + to_string(expr->get_ast_integer()->value);
+            break;
+        case AST_REAL:
+            key += " r" + to_string(sym_tab->ieee(expr->get_ast_real()->value));
+            break;
+        case AST_FUNCTIONCALL: {
+            ast_functioncall *call = static_cast<ast_functioncall *>(node);
+            node_key(call->id, key, numbers, refs, commons);
+            node_key(call->parameter_list, key, numbers, refs, commons);
+            break;
+        }
+        case AST_UMINUS:
+            node_key(static_cast<ast_uminus *>(node)->expr, key, numbers, refs,
+                     commons);
+            break;
+        case AST_NOT:
+            node_key(static_cast<ast_not *>(node)->expr, key, numbers, refs,
+                     commons);
+            break;
+        case AST_CAST:
+            node_key(static_cast<ast_cast *>(node)->expr, key, numbers, refs,
+                     commons);
+            break;
+        case AST_COMMON: {
+            ast_common *common = static_cast<ast_common *>(node);
+            if (common->first != NULL) {
+                key += " c" + to_string(commons[common->first]);
+                break;
+            }
+            long nr = commons.size();
+            commons[common] = nr;
+            key += " c" + to_string(nr);
+            node_key(common->expr, key, numbers, refs, commons);
+            break;
+        }
+        case AST_BINARYRELATION:  // ast_equal
+        case AST_EQUAL:
+        case AST_NOTEQUAL:
+        case AST_LESSTHAN:
+        case AST_GREATERTHAN: {
+            ast_binaryrelation *rel = static_cast<ast_binaryrelation *>(node);
+            node_key(rel->left, key, numbers, refs, commons);
+            node_key(rel->right, key, numbers, refs, commons);
+            break;
+        }
+        case AST_ADD:
+        case AST_SUB:
+        case AST_OR:
+        case AST_AND:
+        case AST_MULT:
+        case AST_DIVIDE:
+        case AST_IDIV:
+        case AST_MOD: {
+            ast_binaryoperation *bin_op =
+                static_cast<ast_binaryoperation *>(node);
+            node_key(bin_op->left, key, numbers, refs, commons);
+            node_key(bin_op->right, key, numbers, refs, commons);
+            break;
+        }
+        default:
+            fatal("block_cache::node_key(): unknown AST node " +
+                  to_string(node->tag));
+        }
+        break;
+    }
+    }
+    key += ")";
+}
+
+
+/* Everything about a symbol that the code of a block using it can depend
+   on. The activation record size of a block is left out, since it grows
+   with the temps of the block, and is only used by the block itself. */
+void block_cache::symbol_key(sym_index sym_p, string &key)
+{
+    symbol *sym = sym_tab->get_symbol(sym_p);
+    key += " (" + to_string(sym->tag) + " " +
+        string(sym_tab->pool_lookup(sym->id).str) + " t" +
+        to_string(sym->type) + " l" + to_string(sym->level);
+
+    // Only the symbols in activation records have an offset.
+    if (sym->tag == SYM_VAR || sym->tag == SYM_ARRAY ||
+            sym->tag == SYM_PARAM) {
+        key += " o" + to_string(sym->offset);
+    }
+
+    parameter_symbol *param = NULL;
+    switch (sym->tag) {
+    case SYM_CONST: {
+        constant_symbol *con = sym->get_constant_symbol();
+        if (con->type == real_type) {
+            key += " r" + to_string(sym_tab->ieee(con->const_value.rval));
+        } else {
+            key += " i" + to_string(con->const_value.ival);
+        }
+        break;
+    }
+    case SYM_ARRAY: {
+        array_symbol *arr = sym->get_array_symbol();
+        key += " a" + to_string(arr->array_cardinality) + " " +
+            to_string(arr->index_type);
+        break;
+    }
+    case SYM_PARAM: {
+        parameter_symbol *par = sym->get_parameter_symbol();
+        key += " p" + to_string(par->size) + " " + to_string(par->arg_reg);
+        break;
+    }
+    case SYM_PROC: {
+        procedure_symbol *proc = sym->get_procedure_symbol();
+        key += " L" + to_string(proc->label_nr);
+        param = proc->last_parameter;
+        break;
+    }
+    case SYM_FUNC: {
+        function_symbol *func = sym->get_function_symbol();
+        key += " L" + to_string(func->label_nr);
+        param = func->last_parameter;
+        break;
+    }
+    default:
+        break;
+    }
+
+    for (; param != NULL; param = param->preceding) {
+        symbol_key(param->sym_p, key);
+    }
+    key += ")";
+}
+
+
+/* Only the labels before any comment are renumbered, since a comment may
+   hold a name that looks like one. */
+string block_cache::relative_labels(const string &code, long first_label)
+{
+    string result;
+    result.reserve(code.length());
+    unsigned long copied = 0;
+    unsigned long at = 0;
+    while ((at = code.find_first_of("L#", at)) != string::npos) {
+        if (code[at] == '#') {
+            at = code.find('\n', at);
+            if (at == string::npos) {
+                break;
+            }
+            continue;
+        }
+        unsigned long end = at + 1;
+        long label = 0;
+        while (end < code.length() && isdigit(code[end])) {
+            label = label * 10 + code[end++] - '0';
+        }
+        if (end > at + 1 && label >= first_label &&
+                (at == 0 || !isalnum(code[at - 1]))) {
+            result.append(code, copied, at - copied);
+            result += "L@" + to_string(label - first_label);
+            copied = end;
+        }
+        at = end;
+    }
+    result.append(code, copied, string::npos);
+    return result;
+}
+
+
+string block_cache::absolute_labels(const string &code, long first_label)
+{
+    string result;
+    result.reserve(code.length());
+    unsigned long copied = 0;
+    for (;;) {
+        unsigned long at = code.find("L@", copied);
+        if (at == string::npos) {
+            break;
+        }
+        result.append(code, copied, at - copied);
+        unsigned long end = at + 2;
+        long label = 0;
+        while (end < code.length() && isdigit(code[end])) {
+            label = label * 10 + code[end++] - '0';
+        }
+        result += "L" + to_string(first_label + label);
+        copied = end;
+    }
+    result.append(code, copied, string::npos);
+    return result;
+}
+
+
+void block_cache::write_code(sym_index block, const string &code)
+{
+    if (pipeline->active()) {
+        pipeline->submit_code(block, code);
+        return;
+    }
+    code_gen->write_assembler(code);
+    if (sym_tab->get_symbol(block)->level == 0) {
+        code_gen->print_statistics();
+    }
+}
+
+
+bool block_cache::replay(sym_index block, ast_stmt_list *body)
+{
+    if (!active()) {
+        return false;
+    }
+
+    // The flags that change the code, and the compiler itself, go first in
+    // every key.
+    if (build_key.empty()) {
+        mkdir(cache_directory, 0777);
+        struct stat binary;
+        if (stat("/proc/self/exe", &binary) == -1) {
+            binary.st_size = 0;
+            binary.st_mtime = 0;
+        }
+        build_key = "diesel " + to_string(binary.st_size) + " " +
+            to_string(binary.st_mtime) + " " + to_string(typecheck) +
+            to_string(optimize) + to_string(optimize_quads) +
+            to_string(inline_calls) + to_string(vectorize_loops) +
+            to_string(register_allocation) +
+            to_string(register_parameters) + to_string(sse_floats) +
+            to_string(elf_output) + to_string(pipeline->active()) + "\n";
+    }
+
+    string key = build_key;
+    map<sym_index, long> numbers;
+    vector<sym_index> refs;
+    map<ast_common *, long> commons;
+    sym_index env = block;
+    symbol *env_sym = sym_tab->get_symbol(env);
+    symbol_key(env, key);
+    if (env_sym->tag == SYM_PROC) {
+        key += " a" + to_string(env_sym->get_procedure_symbol()->ar_size);
+    } else if (env_sym->tag == SYM_FUNC) {
+        key += " a" + to_string(env_sym->get_function_symbol()->ar_size);
+    }
+    key += "\n";
+    node_key(body, key, numbers, refs, commons);
+    for (unsigned long i = 0; i < refs.size(); i++) {
+        key += "\n";
+        symbol_key(refs[i], key);
+        map<sym_index, string>::iterator callee = block_keys.find(refs[i]);
+        if (optimize_quads && inline_calls && callee != block_keys.end() &&
+                refs[i] != block) {
+            key += " " + callee->second;
+        }
+    }
+    string hash = key_hash(key);
+    block_keys[block] = hash;
+
+    pending_block &p = pending[block];
+    p.file_name = string(cache_directory) + "/" + hash + ".s";
+    p.first_label = sym_tab->get_label_nr();
+    p.found = false;
+    p.kept = false;
+    p.key = key;
+    p.code.clear();
+
+    // Read the file in one go, if it is there.
+    int fd = open(p.file_name.c_str(), O_RDONLY);
+    if (fd != -1) {
+        char data[65536];
+        ssize_t done;
+        while ((done = read(fd, data, sizeof(data))) > 0 ||
+               (done == -1 && errno == EINTR)) {
+            if (done > 0) {
+                p.code.append(data, done);
+            }
+        }
+        close(fd);
+        unsigned long header = strlen(CACHE_HEADER);
+        unsigned long newline = p.code.find('\n');
+        p.found = done == 0 && newline != string::npos &&
+            p.code.compare(0, header, CACHE_HEADER) == 0;
+        if (p.found) {
+            char *rest;
+            p.labels = strtol(p.code.c_str() + header, &rest, 10);
+            p.kept = strtol(rest, &rest, 10) != 0;
+            unsigned long length = strtoul(rest, NULL, 10);
+            // A file made for another key is a miss, which overwrites it.
+            p.found = length == key.length() &&
+                p.code.compare(newline + 1, length, key) == 0;
+            if (p.found) {
+                p.code = absolute_labels(p.code.substr(newline + 1 + length),
+                                         p.first_label);
+            }
+        }
+    }
+
+    if (!p.found) {
+        misses++;
+        return false;
+    }
+    hits++;
+    if (p.kept) {
+        return false;
+    }
+
+    sym_tab->set_label_nr(p.first_label + p.labels);
+    write_code(block, p.code);
+    pending.erase(block);
+    return true;
+}
+
+
+void block_cache::generate_assembler(sym_index block, quad_list *q)
+{
+    symbol *env = sym_tab->get_symbol(block);
+    map<sym_index, pending_block>::iterator p = pending.find(block);
+    if (p == pending.end()) {
+        code_gen->generate_assembler(q, env);
+        return;
+    }
+
+    if (p->second.found) {
+        sym_tab->set_label_nr(p->second.first_label + p->second.labels);
+        write_code(block, p->second.code);
+        pending.erase(p);
+        return;
+    }
+
+    if (generator == NULL) {
+        generator = new code_generator(&generated);
+    }
+    generator->generate_assembler(q, env);
+    write_code(block, generated);
+    store(block, generated, sym_tab->get_label_nr());
+    generated.clear();
+}
+
+
+const string *block_cache::found_code(sym_index block)
+{
+    map<sym_index, pending_block>::iterator p = pending.find(block);
+    if (p == pending.end() || !p->second.found) {
+        return NULL;
+    }
+    return &p->second.code;
+}
+
+
+/* The file is written under another name first and then renamed, so that
+   another compiler never reads half of it. */
+void block_cache::store(sym_index block, const string &code, long end_label)
+{
+    map<sym_index, pending_block>::iterator p = pending.find(block);
+    if (p == pending.end()) {
+        return;
+    }
+
+    string temp_name = p->second.file_name + "." + to_string(getpid());
+    FILE *file = fopen(temp_name.c_str(), "w");
+    if (file != NULL) {
+        string text = CACHE_HEADER +
+            to_string(end_label - p->second.first_label) + " " +
+            to_string(inliner->has_kept(block)) + " " +
+            to_string(p->second.key.length()) + "\n" + p->second.key +
+            relative_labels(code, p->second.first_label);
+        bool written = fwrite(text.data(), 1, text.length(), file) ==
+            text.length();
+        if (fclose(file) == 0 && written &&
+                rename(temp_name.c_str(), p->second.file_name.c_str()) == 0) {
+            stored++;
+        } else {
+            unlink(temp_name.c_str());
+        }
+    }
+    pending.erase(p);
+}
+
+
+void block_cache::print_statistics()
+{
+    if (cache_directory != NULL) {
+        cerr << "Block cache: " << hits << " hits, " << misses
+             << " misses, " << stored << " blocks stored in "
+             << cache_directory << "." << endl;
+    }
+}
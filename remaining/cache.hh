@@ -0,0 +1,129 @@
+#ifndef __CACHE_HH__
+#define __CACHE_HH__
+
+#include <map>
+#include <string>
+
+#include "ast.hh"
+#include "quads.hh"
+#include "symtab.hh"
+
+using namespace std;
+
+
+/*** With -C dir, the assembler code of each block is kept in a file in the
+     directory, named by a hash of its key, which is everything the code
+     depends on: the optimized AST of the block, what the symbols it refers
+     to look like, ie, their types, levels, offsets, label numbers and
+     parameters, the block's own symbol, the flags and the compiler itself.
+     When the same block comes along again, its quads are never generated
+     and the code is taken from the file instead. The file has the whole key
+     in it, which has to match, so that two keys with the same hash never
+     get each other's code.
+
+     The labels a block makes for itself are all numbered from the label
+     counter as it was when the block's quads were about to be generated,
+     so they are stored relative to that and renumbered when the code is
+     used again, and the counter is moved on by as many as the block made.
+     The labels of other blocks are in the key, through the symbols.
+
+     With -O, the inliner needs the quads of the blocks it keeps, so the
+     file also tells whether the block was kept, and if it was, its quads
+     are still generated and optimized when its code is found. Only the
+     code generation is skipped for it. A block is
+     compiled with the bodies of its callees inlined as they were when it
+     was cached, so with -O the keys of the blocks a block calls are also
+     part of its own key.
+
+     The cache is not used when anything more than the code would be
+     printed for a block, ie, with -q, -g and -t. Nor is it with -P, where
+     the code of a block counts into the records of the blocks inlined in
+     it, at labels that aren't in its key. ***/
+
+
+class block_cache;
+class code_generator;
+
+// Defined in cache.cc.
+extern block_cache *code_cache;
+
+
+class block_cache
+{
+private:
+    // A block whose quads are about to be generated.
+    struct pending_block
+    {
+        // The file its code is in, and its key, which the file has to
+        // have as well.
+        string file_name;
+        string key;
+
+        // The label counter before its quads were generated.
+        long first_label;
+
+        // Its code, if it was found, the number of labels it made, and
+        // whether the inliner kept it.
+        bool found;
+        string code;
+        long labels;
+        bool kept;
+    };
+
+    map<sym_index, pending_block> pending;
+
+    // The keys of the blocks seen so far.
+    map<sym_index, string> block_keys;
+
+    // The code generator used for the blocks that are to be cached.
+    string generated;
+    code_generator *generator;
+
+    // Statistics.
+    long hits;
+    long misses;
+    long stored;
+
+    // What the flags and the compiler binary look like, for the keys.
+    string build_key;
+
+    // Build the key of a block.
+    void node_key(ast_node *, string &, map<sym_index, long> &,
+                  vector<sym_index> &, map<ast_common *, long> &);
+    void symbol_key(sym_index, string &);
+
+    // Label numbers from the block's first label on are written as L@n in
+    // the files, n counting from that label.
+    string relative_labels(const string &, long first_label);
+    string absolute_labels(const string &, long first_label);
+
+    // Write the code of a block to the output, or hand it to the pipeline.
+    void write_code(sym_index, const string &);
+
+public:
+    block_cache();
+
+    // Returns true if -C was given and the cache can be used.
+    bool active();
+
+    // These are the interface to parser.y. Look up a block before its
+    // quads are generated. Returns true if there was nothing left to do
+    // for it, because its code was found and has been written out.
+    bool replay(sym_index, ast_stmt_list *);
+
+    // Generate the code of a block whose quads were generated, or use the
+    // code found for it, and store it if it wasn't found.
+    void generate_assembler(sym_index, quad_list *);
+
+    // With -j, the code of a block from the cache, if it was found.
+    const string *found_code(sym_index);
+
+    // Store the code of a block, once it is known how far the labels went.
+    void store(sym_index, const string &, long end_label);
+
+    // Print the hits and misses, for -k.
+    void print_statistics();
+};
+
+
+#endif
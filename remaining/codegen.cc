@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
-#include <fstream>
+#include <set>
+#include <sstream>
 #include <stdio.h>
 #include <string.h>
 
@@ -12,34 +14,248 @@ using namespace std;
 
 // Defined in main.cc.
 extern bool assembler_trace;
+extern bool optimize_quads;
+extern bool register_allocation;
+extern bool register_parameters;
+extern bool sse_floats;
+extern bool emit_statistics;
+extern bool elf_output;
+extern bool profile;
+
+/* The registers the allocator hands out, in order of preference. They are
+ all treated as callee-saved: a block saves the ones it uses in its prologue,
+ and diesel_glue.s saves the ones the C library may clobber. */
+static const register_type allocatable[] = { RBX, R12, R13, R14, R15, RSI,
+		RDI, R8, R9, R10, R11 };
+static const int NR_ALLOCATABLE = sizeof(allocatable) / sizeof(allocatable[0]);
+
+/* The general registers the first integer parameters are passed in with -R.
+ Reals go in xmm0 and up. The allocator doesn't hand these out then, since
+ the argument registers of a call are loaded while the values it keeps in
+ registers are still live. */
+static const register_type argument_regs[REGISTER_PARAMETERS] = { RDI, RSI,
+		R8, R9 };
+
+/* Returns true if a register is kept for passing arguments. */
+static bool argument_register(register_type r) {
+	if (!register_parameters) {
+		return false;
+	}
+	for (int k = 0; k < REGISTER_PARAMETERS; k++) {
+		if (argument_regs[k] == r) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* The last parameter of a procedure or function, or NULL. */
+static parameter_symbol *last_parameter(symbol *sym) {
+	if (sym->tag == SYM_FUNC) {
+		return sym->get_function_symbol()->last_parameter;
+	} else if (sym->tag == SYM_PROC) {
+		return sym->get_procedure_symbol()->last_parameter;
+	}
+	return NULL;
+}
+
+/* The number of parameters of a procedure or function that are passed in
+ registers. These are always the first ones. */
+static long register_parameter_count(symbol *sym) {
+	long count = 0;
+	for (parameter_symbol *param = last_parameter(sym); param != NULL;
+			param = param->preceding) {
+		if (param->arg_reg != -1) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/* Upper limit on the loop nesting depth that the use weights account for. */
+static const int MAX_WEIGHT_DEPTH = 4;
+
+/* The range of quads over which a symbol needs its value, together with
+ how much it would gain from being in a register. */
+struct live_interval {
+	sym_index sym;
+	long start;
+	long end;
+	long weight;
+	int reg;
+};
+
+static bool by_start(const live_interval *a, const live_interval *b) {
+	return a->start < b->start;
+}
 
 // Used in parser.y. Ideally the filename should be parametrized, but it's not
 // _that_ important...
 code_generator *code_gen = new code_generator("d.out");
 
 // Constructor.
-code_generator::code_generator(const string object_file_name) {
-	out.open(object_file_name);
+code_generator::code_generator(const string object_file_name) :
+		buffer(object_file_name), out(&buffer) {
+	init_registers();
+}
+
+code_generator::code_generator(string *sink) :
+		buffer(sink), out(&buffer) {
+	init_registers();
+}
+
+void code_generator::init_registers() {
 
 	reg[RAX] = "rax";
 	reg[RCX] = "rcx";
 	reg[RDX] = "rdx";
+	reg[RBX] = "rbx";
+	reg[RSI] = "rsi";
+	reg[RDI] = "rdi";
+	reg[R8] = "r8";
+	reg[R9] = "r9";
+	reg[R10] = "r10";
+	reg[R11] = "r11";
+	reg[R12] = "r12";
+	reg[R13] = "r13";
+	reg[R14] = "r14";
+	reg[R15] = "r15";
+	reg[RBP] = "rbp";
 }
 
 /* Destructor. */
 code_generator::~code_generator() {
-	// Make sure we close the outfile before exiting the compiler.
-	out << flush;
-	out.close();
+	// Make sure we write out everything before exiting the compiler.
+	buffer.write_out();
 }
 
 /* This method is called from parser.y when code generation is to start.
  The argument is a quad_list representing the body of the procedure, and
  the symbol for the environment for which code is being generated. */
 void code_generator::generate_assembler(quad_list *q, symbol *env) {
+	env_level = env->level + 1;
+	env_sym = env;
+	find_literals(q);
+	allocate_registers(q);
+	find_tail_calls(q);
+	find_arguments(q);
+	find_profile_records(q);
 	prologue(env);
 	expand(q);
 	epilogue(env);
+	literals();
+	profile_data();
+
+	// The code for a block is written to the file in one go. The main
+	// program is the last block.
+	buffer.write_out();
+	if (env->level == 0 && !buffer.writes_to_string()) {
+		print_statistics();
+	}
+}
+
+/* With -j, the blocks are generated in other threads, and written out here
+   in the order the parser handed them over. */
+void code_generator::write_assembler(const string &code) {
+	buffer.write_out(code);
+}
+
+/* With -E, this writes the object file once all blocks are done. */
+void code_generator::finish(const string &object_file) {
+	buffer.write_object(object_file);
+}
+
+void code_generator::print_statistics() {
+	if (emit_statistics) {
+		cerr << "Assembler output: " << buffer.get_bytes_written()
+				<< " bytes in " << buffer.get_writes() << " writes, "
+				<< buffer.get_flush_requests() << " flushes deferred." << endl;
+	}
+}
+
+/* This method writes out the real constants used by the block just
+ generated, if any, and empties the literal pool. */
+void code_generator::literals() {
+	if (literal_pool.empty()) {
+		return;
+	}
+	out << "\t" << ".section" << "\t" << ".rodata" << endl;
+	out << "\t" << ".align" << "\t" << STACK_WIDTH << endl;
+	map<long, long>::iterator it;
+	for (it = literal_pool.begin(); it != literal_pool.end(); it++) {
+		out << "L" << it->second << ":" << "\t" << ".quad" << "\t"
+				<< it->first << endl;
+	}
+	out << "\t" << ".text" << endl;
+	literal_pool.clear();
+}
+
+/* This method finds the counter records of -P that the block itself made.
+ The counters of the blocks inlined into it are in the records of those
+ blocks, and only counted here. */
+void code_generator::find_profile_records(quad_list *q_list) {
+	profile_records.clear();
+	profile_label = -1;
+	for (long i = 0; i < q_list->size(); i++) {
+		quadruple &quad = (*q_list)[i];
+		if ((quad.op_code != q_profcall && quad.op_code != q_profloop) ||
+				sym_tab->get_symbol(quad.sym2) != env_sym) {
+			continue;
+		}
+		if (quad.op_code == q_profcall) {
+			profile_label = quad.int1;
+			profile_records.insert(profile_records.begin(), quad);
+		} else {
+			profile_records.push_back(quad);
+		}
+	}
+}
+
+/* This method writes out the counter records of a block, in a section of
+ their own, which the linker gathers from all blocks between the symbols
+ __start_diesel_profile and __stop_diesel_profile for diesel_rts.c to find.
+ Each record is the kind, 1 for a block and 2 for a loop, the count, the
+ cycles, the source line, the length of the name and the name, eight
+ characters to a quad. Only the record of the block itself has a name. Its
+ loops follow it, and are told apart by their lines. */
+void code_generator::profile_data() {
+	if (profile_records.empty()) {
+		return;
+	}
+	out << "\t" << ".section" << "\t" << "diesel_profile, \"aw\"" << endl;
+	out << "\t" << ".align" << "\t" << STACK_WIDTH << endl;
+	for (unsigned int i = 0; i < profile_records.size(); i++) {
+		quadruple &quad = profile_records[i];
+		string name;
+		if (quad.op_code == q_profcall) {
+			pool_view id = sym_tab->pool_lookup(env_sym->id);
+			name.assign(id.str, id.len);
+		}
+		out << "L" << quad.int1 << ":" << "\t" << ".quad" << "\t"
+				<< (quad.op_code == q_profcall ? 1 : 2) << endl;
+		out << "\t" << ".quad" << "\t" << 0 << endl;
+		out << "\t" << ".quad" << "\t" << 0 << endl;
+		out << "\t" << ".quad" << "\t" << quad.int3 << endl;
+		out << "\t" << ".quad" << "\t" << name.size() << endl;
+		for (unsigned int k = 0; k < name.size(); k += STACK_WIDTH) {
+			unsigned long chars = 0;
+			for (unsigned int j = 0; j < STACK_WIDTH && k + j < name.size();
+					j++) {
+				chars |= (unsigned long) (unsigned char) name[k + j]
+						<< (8 * j);
+			}
+			out << "\t" << ".quad" << "\t" << (long) chars << endl;
+		}
+	}
+	out << "\t" << ".text" << endl;
+}
+
+/* This method reads the time stamp counter into rax, for -P. It comes in
+ two halves, in edx and eax. */
+void code_generator::read_time_stamp() {
+	out << "\t\t" << "rdtsc" << endl;
+	out << "\t\t" << "shl" << "\t" << "rdx, 32" << endl;
+	out << "\t\t" << "or" << "\t" << "rax, rdx" << endl;
 }
 
 /* This method aligns a frame size on an 8-byte boundary. Used by prologue().
@@ -48,11 +264,294 @@ int code_generator::align(int frame_size) {
 	return ((frame_size + 7) / 8) * 8;
 }
 
+/* Returns true if a symbol can be kept in a register in the block at the
+ given level. Only variables, parameters and temps of the block itself
+ qualify, since arrays and outer variables must stay in memory where other
+ activation records can see them. */
+bool code_generator::register_candidate(sym_index sym_p, block_level level) {
+	if (sym_p == NULL_SYM) {
+		return false;
+	}
+	symbol *sym = sym_tab->get_symbol(sym_p);
+	return (sym->tag == SYM_VAR || sym->tag == SYM_PARAM) &&
+			sym->level == level;
+}
+
+/* Add the symbols of a quad that are read or written by the FPU. Those must
+ stay in memory, since the FPU can't load from a general register. Real
+ values that are only copied around go through general registers, and
+ temps holding reals aren't always typed as such, so this looks at the
+ quads rather than at the types. */
+static void add_fpu_syms(quadruple &quad, set<sym_index> &fpu_syms) {
+	switch (quad.op_code) {
+	case q_ruminus:
+	case q_rplus:
+	case q_rminus:
+	case q_rmult:
+	case q_rdivide:
+		fpu_syms.insert(quad.sym3);
+		// Fall through.
+	case q_req:
+	case q_rne:
+	case q_rlt:
+	case q_rgt:
+		fpu_syms.insert(quad.sym1);
+		fpu_syms.insert(quad.sym2);
+		break;
+	case q_rjeq:
+	case q_rjne:
+	case q_rjlt:
+	case q_rjle:
+	case q_rjgt:
+	case q_rjge:
+		fpu_syms.insert(quad.sym2);
+		fpu_syms.insert(quad.sym3);
+		break;
+	case q_itor:
+		fpu_syms.insert(quad.sym3);
+		break;
+	default:
+		break;
+	}
+}
+
+/* This method decides which symbols of a block live in registers, using a
+ linear scan over live intervals. A temp lives from the quad computing it to
+ its last use, extended to the end of every loop it is live across.
+ Variables and parameters live through the whole block. When the registers
+ run out, the interval with the lowest weight, which counts uses and
+ multiplies by ten for each loop around them, has to stay in memory. The
+ registers left over cache display entries of outer frames. */
+void code_generator::allocate_registers(quad_list *q_list) {
+	sym_reg.clear();
+	display_reg.clear();
+	saved_regs.clear();
+	reg_vars.clear();
+	if (!register_allocation) {
+		return;
+	}
+
+	long nr_quads = q_list->size();
+
+	// Find the loops, ie, jumps backwards to a label.
+	map<long, long> label_quad;
+	for (long i = 0; i < nr_quads; i++) {
+		if ((*q_list)[i].op_code == q_labl) {
+			label_quad[(*q_list)[i].int1] = i;
+		}
+	}
+	vector<pair<long, long> > loops;
+	for (long i = 0; i < nr_quads; i++) {
+		quadruple &quad = (*q_list)[i];
+		if (!quad.ends_block()) {
+			continue;
+		}
+		map<long, long>::iterator l = label_quad.find(quad.int1);
+		if (l != label_quad.end() && l->second < i) {
+			loops.push_back(make_pair(l->second, i));
+		}
+	}
+
+	// SSE2 code moves reals between general and xmm registers instead.
+	set<sym_index> fpu_syms;
+	if (!sse_floats) {
+		for (long i = 0; i < nr_quads; i++) {
+			add_fpu_syms((*q_list)[i], fpu_syms);
+		}
+	}
+
+	// Build the intervals, and count the accesses to outer frames.
+	map<sym_index, live_interval> intervals;
+	map<int, long> frame_uses;
+	for (long i = 0; i < nr_quads; i++) {
+		quadruple &quad = (*q_list)[i];
+		sym_index *slots[2];
+		int nr_uses = quad.use_slots(slots);
+		sym_index def = quad.defined_sym();
+
+		long weight = 1;
+		int depth = 0;
+		for (unsigned int k = 0; k < loops.size(); k++) {
+			if (loops[k].first <= i && i <= loops[k].second &&
+					depth < MAX_WEIGHT_DEPTH) {
+				weight *= 10;
+				depth++;
+			}
+		}
+
+		for (int k = 0; k <= nr_uses; k++) {
+			sym_index sym_p = k < nr_uses ? *slots[k] : def;
+			if (!register_candidate(sym_p, env_level) ||
+					fpu_syms.find(sym_p) != fpu_syms.end() ||
+					literal_temps.find(sym_p) != literal_temps.end()) {
+				continue;
+			}
+			map<sym_index, live_interval>::iterator it = intervals.find(sym_p);
+			if (it == intervals.end()) {
+				live_interval interval;
+				interval.sym = sym_p;
+				// A temp read before it is written, or a variable, has a
+				// value from the start.
+				bool from_start = k < nr_uses || !sym_tab->is_temp_var(sym_p);
+				interval.start = from_start ? 0 : i;
+				interval.end = sym_tab->is_temp_var(sym_p) ? i : nr_quads;
+				interval.weight = 0;
+				interval.reg = -1;
+				it = intervals.insert(make_pair(sym_p, interval)).first;
+			}
+			it->second.end = max(it->second.end, i);
+			it->second.weight += weight;
+		}
+
+		sym_index refs[4] = { NULL_SYM, NULL_SYM, def, NULL_SYM };
+		for (int k = 0; k < nr_uses; k++) {
+			refs[k] = *slots[k];
+		}
+		if (quad.op_code == q_lindex || quad.op_code == q_rrindex ||
+				quad.op_code == q_irindex || quad.op_code == q_valign ||
+				quad.op_code == q_vload || quad.op_code == q_vstore) {
+			refs[3] = quad.sym1;
+		}
+		for (int k = 0; k < 4; k++) {
+			if (refs[k] == NULL_SYM) {
+				continue;
+			}
+			symbol *sym = sym_tab->get_symbol(refs[k]);
+			if ((sym->tag == SYM_VAR || sym->tag == SYM_PARAM ||
+					sym->tag == SYM_ARRAY) && sym->level != env_level) {
+				frame_uses[sym->level] += weight;
+			}
+		}
+	}
+
+	// A temp that is live at the top of a loop is live all through it.
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		map<sym_index, live_interval>::iterator it;
+		for (it = intervals.begin(); it != intervals.end(); it++) {
+			for (unsigned int k = 0; k < loops.size(); k++) {
+				live_interval &interval = it->second;
+				if (interval.start < loops[k].first &&
+						interval.end >= loops[k].first &&
+						interval.end < loops[k].second) {
+					interval.end = loops[k].second;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	vector<live_interval *> sorted;
+	map<sym_index, live_interval>::iterator it;
+	for (it = intervals.begin(); it != intervals.end(); it++) {
+		sorted.push_back(&it->second);
+	}
+	stable_sort(sorted.begin(), sorted.end(), by_start);
+
+	// The scan itself.
+	vector<live_interval *> active;
+	bool in_use[NR_REGISTERS] = { false };
+	for (unsigned int i = 0; i < sorted.size(); i++) {
+		live_interval *current = sorted[i];
+
+		for (unsigned int k = 0; k < active.size();) {
+			if (active[k]->end < current->start) {
+				in_use[active[k]->reg] = false;
+				active.erase(active.begin() + k);
+			} else {
+				k++;
+			}
+		}
+
+		for (int k = 0; k < NR_ALLOCATABLE; k++) {
+			if (!in_use[allocatable[k]] && !argument_register(allocatable[k])) {
+				current->reg = allocatable[k];
+				break;
+			}
+		}
+
+		if (current->reg == -1) {
+			unsigned int victim = 0;
+			for (unsigned int k = 1; k < active.size(); k++) {
+				if (active[k]->weight < active[victim]->weight) {
+					victim = k;
+				}
+			}
+			if (active.empty() || active[victim]->weight >= current->weight) {
+				continue;
+			}
+			current->reg = active[victim]->reg;
+			active[victim]->reg = -1;
+			active.erase(active.begin() + victim);
+		}
+
+		in_use[current->reg] = true;
+		active.push_back(current);
+	}
+
+	bool used[NR_REGISTERS] = { false };
+	for (it = intervals.begin(); it != intervals.end(); it++) {
+		if (it->second.reg == -1) {
+			continue;
+		}
+		sym_reg[it->first] = (register_type) it->second.reg;
+		used[it->second.reg] = true;
+		if (!sym_tab->is_temp_var(it->first)) {
+			reg_vars.push_back(it->first);
+		}
+	}
+
+	// Outer frames used more than once get their display entry cached in
+	// one of the registers left over, the most used first.
+	vector<pair<long, int> > frames;
+	map<int, long>::iterator f;
+	for (f = frame_uses.begin(); f != frame_uses.end(); f++) {
+		if (f->second > 1) {
+			frames.push_back(make_pair(-f->second, f->first));
+		}
+	}
+	sort(frames.begin(), frames.end());
+	int next = 0;
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		while (next < NR_ALLOCATABLE && (used[allocatable[next]] ||
+				argument_register(allocatable[next]))) {
+			next++;
+		}
+		if (next == NR_ALLOCATABLE) {
+			break;
+		}
+		display_reg[frames[i].second] = allocatable[next];
+		used[allocatable[next]] = true;
+	}
+
+	for (int k = 0; k < NR_ALLOCATABLE; k++) {
+		if (used[allocatable[k]]) {
+			saved_regs.push_back(allocatable[k]);
+		}
+	}
+}
+
+/* Store the register-held variables and parameters to memory, before a
+ call to a procedure that may access them through its display. */
+void code_generator::spill_reg_vars() {
+	for (unsigned int i = 0; i < reg_vars.size(); i++) {
+		store_memory(sym_reg[reg_vars[i]], reg_vars[i]);
+	}
+}
+
+/* Load them back again after the call, which may have changed them. */
+void code_generator::reload_reg_vars() {
+	for (unsigned int i = 0; i < reg_vars.size(); i++) {
+		fetch_memory(reg_vars[i], sym_reg[reg_vars[i]]);
+	}
+}
+
 /* This method generates assembler code for initialisating a procedure or
  function. */
 void code_generator::prologue(symbol *new_env) {
 	int ar_size;
-	int label_nr;
+	long label_nr;
 	// Used to count parameters.
 	parameter_symbol *last_arg;
 	int lvl;
@@ -78,6 +577,11 @@ void code_generator::prologue(symbol *new_env) {
 		return;
 	}
 
+	// With -E, the glue calls the main program through a global symbol.
+	if (elf_output && lvl == 0) {
+		out << "\t" << ".globl" << "\t" << "L" << label_nr << endl;
+	}
+
 	/* Print out the label number (a SYM_PROC/ SYM_FUNC attribute) */
 	out << "L" << label_nr << ":" << "\t\t\t" << "# " <<
 	/* Print out the function/procedure name */
@@ -108,7 +612,255 @@ void code_generator::prologue(symbol *new_env) {
 	//set this frames upper stack pointer to next frames lower stack pointer
 	out << "\t\t" << "mov" << "\t" << "rbp, rcx" << endl;
 	//set the size of the stack for the next frame
-	out << "\t\t" << "sub" << "\t" << "rsp, " << ar_size << endl;
+	if (profile_label == -1) {
+		out << "\t\t" << "sub" << "\t" << "rsp, " << ar_size << endl;
+	} else {
+		// Count the call, and note the time stamp counter below the
+		// variables. rax and rdx carry no parameters.
+		profile_slot = (lvl + 2) * STACK_WIDTH + ar_size;
+		out << "\t\t" << "sub" << "\t" << "rsp, " << ar_size + STACK_WIDTH
+				<< endl;
+		out << "\t\t" << "add" << "\t" << "qword ptr [rip+L" << profile_label
+				<< "+" << STACK_WIDTH << "], 1" << endl;
+		read_time_stamp();
+		out << "\t\t" << "mov" << "\t" << "[rbp-" << profile_slot << "], rax"
+				<< endl;
+	}
+
+	//save the registers this block uses, and load the display entries and
+	//parameters kept in them
+	for (unsigned int i = 0; i < saved_regs.size(); i++) {
+		out << "\t\t" << "push" << "\t" << reg[saved_regs[i]] << endl;
+	}
+	map<int, register_type>::iterator d;
+	for (d = display_reg.begin(); d != display_reg.end(); d++) {
+		out << "\t\t" << "mov" << "\t" << reg[d->second] << ", " << "[rbp-"
+				<< d->first * STACK_WIDTH << "]" << endl;
+	}
+
+	// A call of the block to itself in tail position comes back here with
+	// new arguments.
+	if (self_label != -1) {
+		out << "L" << self_label << ":" << endl;
+	}
+
+	// Parameters passed in registers are moved to the register they were
+	// allocated, or else to their home in the activation record.
+	for (parameter_symbol *param = last_arg; param != NULL;
+			param = param->preceding) {
+		if (param->arg_reg == -1) {
+			continue;
+		}
+		sym_index sym_p = param->sym_p;
+		map<sym_index, register_type>::iterator r = sym_reg.find(sym_p);
+		string dest = r != sym_reg.end() ? reg[r->second] :
+				memory_operand(sym_p);
+		if (param->type == real_type) {
+			out << "\t\t" << (r != sym_reg.end() ? "movq" : "movsd") << "\t"
+					<< dest << ", " << "xmm" << param->arg_reg << endl;
+		} else {
+			out << "\t\t" << "mov" << "\t" << dest << ", "
+					<< reg[argument_regs[param->arg_reg]] << endl;
+		}
+	}
+	for (unsigned int i = 0; i < reg_vars.size(); i++) {
+		if (sym_tab->get_symbol_tag(reg_vars[i]) == SYM_PARAM &&
+				sym_tab->get_symbol(reg_vars[i])->get_parameter_symbol()->arg_reg
+						== -1) {
+			fetch_memory(reg_vars[i], sym_reg[reg_vars[i]]);
+		}
+	}
+
+	if (assembler_trace && !(sym_reg.empty() && display_reg.empty())) {
+		out << "\t" << "# REGISTERS:";
+		for (d = display_reg.begin(); d != display_reg.end(); d++) {
+			out << " " << "display[" << d->first << "]=" << reg[d->second];
+		}
+		map<sym_index, register_type>::iterator it;
+		for (it = sym_reg.begin(); it != sym_reg.end(); it++) {
+			out << " " << sym_tab->pool_lookup(sym_tab->get_symbol_id(it->first))
+					<< "=" << reg[it->second];
+		}
+		out << endl;
+	}
+}
+
+/* This method finds the calls that nothing but a return follows: calls at
+ the end of the block, and calls whose result is returned right away. With
+ -O, these are made by jumping to the callee in the frame of the block. The
+ callee then gets its arguments where the block got its own, so it can't
+ take more of them, and it can't be declared in the block, since the frame
+ it would look at is gone by then. */
+void code_generator::find_tail_calls(quad_list *q_list) {
+	tail_calls.clear();
+	self_label = -1;
+	// With -P, the epilogue has to run for each call that was counted.
+	if (!optimize_quads || profile) {
+		return;
+	}
+
+	long nr_params = 0;
+	for (parameter_symbol *param = last_parameter(env_sym); param != NULL;
+			param = param->preceding) {
+		nr_params++;
+	}
+
+	long nr_quads = q_list->size();
+	for (long i = 0; i < nr_quads; i++) {
+		quadruple &call = (*q_list)[i];
+		if (call.op_code != q_call || call.sym1 == trunc_function) {
+			continue;
+		}
+		symbol *callee = sym_tab->get_symbol(call.sym1);
+		if (callee->level >= env_level || call.int2 > nr_params) {
+			continue;
+		}
+
+		long j = i + 1;
+		while (j < nr_quads && (*q_list)[j].op_code == q_labl) {
+			j++;
+		}
+		bool at_end = j == nr_quads || ((*q_list)[j].op_code == q_jmp &&
+				(*q_list)[j].int1 == q_list->last_label);
+		bool returned = j < nr_quads && call.sym3 != NULL_SYM &&
+				((*q_list)[j].op_code == q_ireturn ||
+				 (*q_list)[j].op_code == q_rreturn) &&
+				(*q_list)[j].sym2 == call.sym3;
+		if (!at_end && !returned) {
+			continue;
+		}
+
+		tail_calls.insert(i);
+		if (callee == env_sym && self_label == -1) {
+			self_label = sym_tab->get_next_label();
+		}
+	}
+}
+
+/* This method decides how the arguments of the calls of a block get to
+ their registers with -R. An argument is moved straight to its register by
+ its q_param, unless there is a call between that and the call it belongs
+ to, or, for a real, a quad using an xmm register. Otherwise it is pushed
+ like the stack arguments, and loaded in its register right before the
+ call. Since the arguments are pushed last first, and the first ones are
+ the ones passed in registers, those are then on top of the stack. */
+void code_generator::find_arguments(quad_list *q_list) {
+	register_args.clear();
+	stacked_args.clear();
+	if (!register_parameters) {
+		return;
+	}
+
+	for (long i = 0; i < q_list->size(); i++) {
+		quadruple &call = (*q_list)[i];
+		if (call.op_code != q_call) {
+			continue;
+		}
+		symbol *callee = sym_tab->get_symbol(call.sym1);
+		if (register_parameter_count(callee) == 0) {
+			continue;
+		}
+		vector<parameter_symbol *> params;
+		for (parameter_symbol *param = last_parameter(callee); param != NULL;
+				param = param->preceding) {
+			params.insert(params.begin(), param);
+		}
+
+		// Go backwards from the call to its own q_param quads, skipping the
+		// ones of the calls made to compute its arguments. The first of
+		// them found belongs to the first parameter.
+		unsigned int k = 0;
+		long skip = 0;
+		bool clobbered = false;
+		bool xmm_clobbered = false;
+		for (long j = i - 1; j >= 0 && k < params.size() &&
+				params[k]->arg_reg != -1; j--) {
+			quadruple &quad = (*q_list)[j];
+			if (quad.op_code == q_param && skip == 0) {
+				bool real = params[k]->type == real_type;
+				if (clobbered || (real && xmm_clobbered)) {
+					stacked_args[i].push_back(params[k]);
+				} else {
+					register_args[j] = params[k];
+				}
+				k++;
+			} else if (quad.op_code == q_param) {
+				skip--;
+			} else if (quad.op_code == q_call) {
+				skip += quad.int2;
+				clobbered = true;
+			}
+			set<sym_index> fpu_syms;
+			add_fpu_syms(quad, fpu_syms);
+			if (!fpu_syms.empty()) {
+				xmm_clobbered = true;
+			}
+		}
+	}
+}
+
+/* This method loads the register arguments of a call that were pushed, and
+ removes them from the stack. */
+void code_generator::load_arguments(long call) {
+	map<long, vector<parameter_symbol *> >::iterator a = stacked_args.find(call);
+	if (a == stacked_args.end()) {
+		return;
+	}
+	vector<parameter_symbol *> &params = a->second;
+	for (unsigned int k = 0; k < params.size(); k++) {
+		if (params[k]->type == real_type) {
+			out << "\t\t" << "movsd" << "\t" << "xmm" << params[k]->arg_reg
+					<< ", qword ptr [rsp+" << k * STACK_WIDTH << "]" << endl;
+		} else {
+			out << "\t\t" << "mov" << "\t"
+					<< reg[argument_regs[params[k]->arg_reg]] << ", [rsp+"
+					<< k * STACK_WIDTH << "]" << endl;
+		}
+	}
+	out << "\t\t" << "add" << "\t" << "rsp, " << params.size() * STACK_WIDTH
+			<< endl;
+}
+
+/* This method generates a call in tail position. The arguments are copied
+ over the ones the block got, and then a block calling itself starts over
+ at the top of its body, after the prologue. Any other callee is jumped to
+ after taking down the frame of the block, so that it returns straight to
+ the block's caller, which removes the arguments it pushed, as usual. */
+void code_generator::tail_call(quadruple *q) {
+	symbol *sym = sym_tab->get_symbol(q->sym1);
+	long label_nr;
+	if (sym->tag == SYM_FUNC) {
+		label_nr = sym->get_function_symbol()->label_nr;
+	} else {
+		label_nr = sym->get_procedure_symbol()->label_nr;
+	}
+
+	// The first argument on the stack was pushed last, and the block's own
+	// first stack parameter is right above its return address. The
+	// arguments are below the frame, so copying from the top down never
+	// overwrites one that is still to be copied. The ones passed in
+	// registers are already there.
+	long nr_stacked = q->sym2 - register_parameter_count(sym);
+	for (long k = nr_stacked - 1; k >= 0; k--) {
+		out << "\t\t" << "mov" << "\t" << "rax, [rsp+" << k * STACK_WIDTH
+				<< "]" << endl;
+		out << "\t\t" << "mov" << "\t" << "[rbp+" << (k + 2) * STACK_WIDTH
+				<< "], rax" << endl;
+	}
+	out << "\t\t" << "add" << "\t" << "rsp, " << nr_stacked * STACK_WIDTH << endl;
+
+	if (sym == env_sym) {
+		out << "\t\t" << "jmp" << "\t" << "L" << self_label << "\t # "
+				<< sym_tab->pool_lookup(sym->id) << endl;
+		return;
+	}
+
+	for (int i = saved_regs.size() - 1; i >= 0; i--) {
+		out << "\t\t" << "pop" << "\t" << reg[saved_regs[i]] << endl;
+	}
+	out << "\t\t" << "leave" << endl;
+	out << "\t\t" << "jmp" << "\t" << "L" << label_nr << "\t # "
+			<< sym_tab->pool_lookup(sym->id) << endl;
 }
 
 /* This method generates assembler code for leaving a procedure or function. */
@@ -118,10 +870,24 @@ void code_generator::epilogue(symbol *old_env) {
 				<< long_symbols << ")" << endl;
 	}
 
+	// Add the cycles spent in the block to its record, keeping a result in
+	// rax.
+	if (profile_label != -1) {
+		out << "\t\t" << "mov" << "\t" << "rcx, rax" << endl;
+		read_time_stamp();
+		out << "\t\t" << "sub" << "\t" << "rax, [rbp-" << profile_slot << "]"
+				<< endl;
+		out << "\t\t" << "add" << "\t" << "[rip+L" << profile_label << "+"
+				<< 2 * STACK_WIDTH << "], rax" << endl;
+		out << "\t\t" << "mov" << "\t" << "rax, rcx" << endl;
+	}
+
+	for (int i = saved_regs.size() - 1; i >= 0; i--) {
+		out << "\t\t" << "pop" << "\t" << reg[saved_regs[i]] << endl;
+	}
+
 	out << "\t\t" << "leave" << endl;
 	out << "\t\t" << "ret" << endl;
-
-	out << flush;
 }
 
 /* This function finds the display register level and offset for a variable,
@@ -129,7 +895,10 @@ void code_generator::epilogue(symbol *old_env) {
 void code_generator::find(sym_index sym_p, int *level, int *offset) {
 	symbol *sym = sym_tab->get_symbol(sym_p);
 	*level = sym->level;
-	if (sym->tag == SYM_VAR || sym->tag == SYM_ARRAY) {
+	// A parameter passed in a register has its home among the variables.
+	if (sym->tag == SYM_VAR || sym->tag == SYM_ARRAY ||
+			(sym->tag == SYM_PARAM &&
+			 sym->get_parameter_symbol()->arg_reg != -1)) {
 		*offset = -((*level + 1) * STACK_WIDTH + sym->offset);
 	} else if (sym->tag == SYM_PARAM) {
 		*offset = STACK_WIDTH + sym->offset + sym->get_parameter_symbol()->size;
@@ -137,16 +906,273 @@ void code_generator::find(sym_index sym_p, int *level, int *offset) {
 }
 
 /*
- * Generates code for getting the address of a frame for the specified scope level.
+ * Generates code for getting the address of a frame for the specified scope
+ * level, and returns the register holding it. The current frame is rbp
+ * itself, and outer frames may have their display entry cached in a
+ * register. Otherwise the entry is loaded into rcx.
  */
-void code_generator::frame_address(int level, const register_type dest) {
-	out << "\t\t" << "mov" << "\t" << reg[dest] << ", " << "[rbp-"
+register_type code_generator::frame_address(int level) {
+	if (level == env_level) {
+		return RBP;
+	}
+	map<int, register_type>::iterator r = display_reg.find(level);
+	if (r != display_reg.end()) {
+		return r->second;
+	}
+	out << "\t\t" << "mov" << "\t" << reg[RCX] << ", " << "[rbp-"
 			<< level * STACK_WIDTH << "]" << endl;
+	return RCX;
 }
 
 /* This function fetches the value of a variable or a constant into a
  register. */
 void code_generator::fetch(sym_index sym_p, register_type dest) {
+	map<sym_index, register_type>::iterator r = sym_reg.find(sym_p);
+	if (r != sym_reg.end()) {
+		out << "\t\t" << "mov" << "\t" << reg[dest] << ", " << reg[r->second]
+				<< endl;
+		return;
+	}
+	map<sym_index, long>::iterator l = literal_temps.find(sym_p);
+	if (l != literal_temps.end()) {
+		out << "\t\t" << "mov" << "\t" << reg[dest] << ", " << l->second
+				<< endl;
+		return;
+	}
+	fetch_memory(sym_p, dest);
+}
+
+/* Returns true if a value fits in the sign-extended 32-bit immediate field
+ that most instructions have. */
+static bool fits_immediate(long value) {
+	return value >= -2147483648L && value <= 2147483647L;
+}
+
+/* Returns k if value is two to the power of k, for k from 1 up to 31, and
+ zero otherwise. */
+static int power_of_two(long value) {
+	for (int k = 1; k < 32; k++) {
+		if (value == (1L << k)) {
+			return k;
+		}
+	}
+	return 0;
+}
+
+/* This method finds the temps that are assigned only once, by a q_iload.
+ Since every use of a temp comes after the quad computing it, such a temp
+ always holds the loaded value. */
+void code_generator::find_literals(quad_list *q_list) {
+	map<sym_index, int> defs;
+	literal_temps.clear();
+	for (long i = 0; i < q_list->size(); i++) {
+		quadruple &quad = (*q_list)[i];
+		sym_index def = quad.defined_sym();
+		if (!sym_tab->is_temp_var(def)) {
+			continue;
+		}
+		if (++defs[def] == 1 && quad.op_code == q_iload) {
+			literal_temps[def] = quad.int1;
+		} else {
+			literal_temps.erase(def);
+		}
+	}
+}
+
+/* Returns true if a symbol is an integer constant or a literal temp, and
+ sets value to its value. */
+bool code_generator::immediate(sym_index sym_p, long *value) {
+	map<sym_index, long>::iterator l = literal_temps.find(sym_p);
+	if (l != literal_temps.end()) {
+		*value = l->second;
+		return true;
+	}
+	symbol *sym = sym_tab->get_symbol(sym_p);
+	if (sym->tag == SYM_CONST && sym->type == integer_type) {
+		*value = sym->get_constant_symbol()->const_value.ival;
+		return true;
+	}
+	return false;
+}
+
+/* This method returns the memory operand of a variable or parameter,
+ loading the address of its frame first if needed. */
+string code_generator::memory_operand(sym_index sym_p) {
+	int level, offset;
+	find(sym_p, &level, &offset);
+	register_type base = frame_address(level);
+
+	ostringstream result;
+	result << "qword ptr [" << reg[base];
+	if (offset >= 0) {
+		result << "+";
+	}
+	result << offset << "]";
+	return result.str();
+}
+
+/* This method returns the cheapest operand that holds the value of a
+ symbol: an immediate for known values, the register of a register-held
+ symbol, or else the memory operand. Anything else is fetched into RCX. */
+string code_generator::operand(sym_index sym_p) {
+	long value;
+	if (immediate(sym_p, &value) && fits_immediate(value)) {
+		ostringstream result;
+		result << value;
+		return result.str();
+	}
+	map<sym_index, register_type>::iterator r = sym_reg.find(sym_p);
+	if (r != sym_reg.end()) {
+		return reg[r->second];
+	}
+	symbol *sym = sym_tab->get_symbol(sym_p);
+	if ((sym->tag == SYM_VAR || sym->tag == SYM_PARAM) &&
+			literal_temps.find(sym_p) == literal_temps.end()) {
+		return memory_operand(sym_p);
+	}
+	fetch(sym_p, RCX);
+	return reg[RCX];
+}
+
+/* This method stores a known value into a variable, without going through
+ a register when possible. */
+void code_generator::store_immediate(long value, sym_index sym_p) {
+	map<sym_index, register_type>::iterator r = sym_reg.find(sym_p);
+	if (r != sym_reg.end()) {
+		out << "\t\t" << "mov" << "\t" << reg[r->second] << ", " << value
+				<< endl;
+	} else if (fits_immediate(value)) {
+		string dest = memory_operand(sym_p);
+		out << "\t\t" << "mov" << "\t" << dest << ", " << value << endl;
+	} else {
+		out << "\t\t" << "mov" << "\t" << "rax, " << value << endl;
+		store(RAX, sym_p);
+	}
+}
+
+/* This method returns the memory operand of an array element. */
+string code_generator::element_operand(sym_index array, sym_index index) {
+	return "qword ptr " + element_address(array, index, 0);
+}
+
+/* This method returns the address of the element skip elements after the
+ one at an index, in brackets. Elements are stored downwards from the
+ array's address, so a variable index is negated in RDX and then scaled by
+ the addressing mode. */
+string code_generator::element_address(sym_index array, sym_index index,
+		long skip) {
+	int level, offset;
+	find(array, &level, &offset);
+	offset -= skip * STACK_WIDTH;
+
+	long value;
+	if (immediate(index, &value) &&
+			fits_immediate(offset - value * STACK_WIDTH)) {
+		register_type base = frame_address(level);
+		ostringstream result;
+		result << "[" << reg[base];
+		if (offset - value * STACK_WIDTH >= 0) {
+			result << "+";
+		}
+		result << offset - value * STACK_WIDTH << "]";
+		return result.str();
+	}
+
+	fetch(index, RDX);
+	out << "\t\t" << "neg" << "\t" << "rdx" << endl;
+	register_type base = frame_address(level);
+	ostringstream result;
+	result << "[" << reg[base] << "+" << reg[RDX] << "*" << STACK_WIDTH;
+	if (offset >= 0) {
+		result << "+";
+	}
+	result << offset << "]";
+	return result.str();
+}
+
+/* This method generates int3 := int1 <op> int2 for the packed xmm
+ arithmetic of the vector loops, copying int1 to int3 first if they
+ differ. The vectorizer only makes int3 one of the arguments in the sums,
+ where it is int1. */
+void code_generator::vector_arithmetic(quadruple *q) {
+	const char *op;
+	bool reals = true;
+	switch (q->op_code) {
+	case q_viplus:
+		op = "paddq";
+		reals = false;
+		break;
+	case q_viminus:
+		op = "psubq";
+		reals = false;
+		break;
+	case q_vrplus:
+		op = "addpd";
+		break;
+	case q_vrminus:
+		op = "subpd";
+		break;
+	case q_vrmult:
+		op = "mulpd";
+		break;
+	default:
+		op = "divpd";
+		break;
+	}
+	if (q->int1 != q->int3) {
+		out << "\t\t" << (reals ? "movapd" : "movdqa") << "\t" << "xmm"
+				<< q->int3 << ", xmm" << q->int1 << endl;
+	}
+	out << "\t\t" << op << "\t" << "xmm" << q->int3 << ", xmm" << q->int2
+			<< endl;
+}
+
+/* This method generates sym3 := sym1 <op> sym2 for add, sub and imul, with
+ sym2 as an immediate or register operand where possible. */
+void code_generator::integer_arithmetic(const char *op, quadruple *q) {
+	sym_index left = q->sym1;
+	sym_index right = q->sym2;
+	long value;
+
+	// Put a known operand on the right, where it can be an immediate.
+	if (strcmp(op, "sub") != 0 && immediate(left, &value) &&
+			!immediate(right, &value)) {
+		left = q->sym2;
+		right = q->sym1;
+	}
+
+	fetch(left, RAX);
+	if (strcmp(op, "imul") == 0 && immediate(right, &value) &&
+			fits_immediate(value)) {
+		// The immediate form of imul has three operands.
+		out << "\t\t" << op << "\t" << "rax, rax, " << value << endl;
+	} else {
+		string source = operand(right);
+		out << "\t\t" << op << "\t" << "rax, " << source << endl;
+	}
+	store(RAX, q->sym3);
+}
+
+/* This method generates signed division (or modulo, if modulo is set) of
+ RAX by two to the power of k, with the result in RAX. Negative numbers are
+ biased by 2^k - 1 first, so that the shift rounds towards zero like idiv
+ does. The modulo's sign follows the dividend's, also like idiv. */
+void code_generator::divide_by_power(int k, bool modulo) {
+	out << "\t\t" << "mov" << "\t" << "rcx, rax" << endl;
+	out << "\t\t" << "sar" << "\t" << "rcx, 63" << endl;
+	out << "\t\t" << "shr" << "\t" << "rcx, " << 64 - k << endl;
+	out << "\t\t" << "add" << "\t" << "rax, rcx" << endl;
+	if (modulo) {
+		out << "\t\t" << "and" << "\t" << "rax, " << (1L << k) - 1 << endl;
+		out << "\t\t" << "sub" << "\t" << "rax, rcx" << endl;
+	} else {
+		out << "\t\t" << "sar" << "\t" << "rax, " << k << endl;
+	}
+}
+
+/* This function fetches the value of a variable or a constant from memory,
+ even if it has a register. */
+void code_generator::fetch_memory(sym_index sym_p, register_type dest) {
 
 	//get symbol
 	symbol* s = sym_tab->get_symbol(sym_p);
@@ -163,14 +1189,14 @@ void code_generator::fetch(sym_index sym_p, register_type dest) {
 		// find the level and the offset
 		find(sym_p, &level, &offset);
 		// load the adress of the frame into the rcx
-		frame_address(level, RCX);
+		register_type base = frame_address(level);
 
 		//load the value into the register
 		if (offset >= 0) {
-			out << "\t\t" << "mov" << "\t" << reg[dest] << ", [" << reg[RCX]
+			out << "\t\t" << "mov" << "\t" << reg[dest] << ", [" << reg[base]
 					<< "+" << offset << "]" << endl;
 		} else {
-			out << "\t\t" << "mov" << "\t" << reg[dest] << ", [" << "rcx"
+			out << "\t\t" << "mov" << "\t" << reg[dest] << ", [" << reg[base]
 					<< offset << "]" << endl;
 		}
 	}
@@ -182,16 +1208,16 @@ void code_generator::fetch_float(sym_index sym_p) {
 
 	//get symbol
 	find(sym_p, &level, &offset);
-	frame_address(level, RCX);
+	register_type base = frame_address(level);
 	symbol* sym = sym_tab->get_symbol(sym_p);
 
 	//normal load floating point
 	if (sym->tag == SYM_PARAM || sym->tag == SYM_ARRAY || sym->tag == SYM_VAR) {
 		if (offset >= 0) {
-			out << "\t\t" << "fld" << "\t" << "qword ptr [" << reg[RCX] << "+"
+			out << "\t\t" << "fld" << "\t" << "qword ptr [" << reg[base] << "+"
 					<< offset << "]\n";
 		} else {
-			out << "\t\t" << "fld" << "\t" << "qword ptr [" << reg[RCX]
+			out << "\t\t" << "fld" << "\t" << "qword ptr [" << reg[base]
 					<< offset << "]\n";
 		}
 	} else if (sym->tag == SYM_CONST) {
@@ -210,20 +1236,115 @@ void code_generator::fetch_float(sym_index sym_p) {
 	}
 }
 
+/* This function loads a real into xmm0 or xmm1. Constants are read from
+ the literal pool. */
+void code_generator::fetch_sse(sym_index sym_p, int xmm) {
+	symbol *sym = sym_tab->get_symbol(sym_p);
+
+	if (sym->tag == SYM_CONST) {
+		long value = sym_tab->ieee(sym->get_constant_symbol()->const_value.rval);
+		map<long, long>::iterator it = literal_pool.find(value);
+		if (it == literal_pool.end()) {
+			it = literal_pool.insert(make_pair(value,
+					sym_tab->get_next_label())).first;
+		}
+		out << "\t\t" << "movsd" << "\t" << "xmm" << xmm << ", "
+				<< "qword ptr [rip+L" << it->second << "]" << endl;
+		return;
+	}
+
+	map<sym_index, register_type>::iterator r = sym_reg.find(sym_p);
+	if (r != sym_reg.end()) {
+		out << "\t\t" << "movq" << "\t" << "xmm" << xmm << ", "
+				<< reg[r->second] << endl;
+		return;
+	}
+
+	int level, offset;
+	find(sym_p, &level, &offset);
+	register_type base = frame_address(level);
+	if (offset >= 0) {
+		out << "\t\t" << "movsd" << "\t" << "xmm" << xmm << ", "
+				<< "qword ptr [" << reg[base] << "+" << offset << "]" << endl;
+	} else {
+		out << "\t\t" << "movsd" << "\t" << "xmm" << xmm << ", "
+				<< "qword ptr [" << reg[base] << offset << "]" << endl;
+	}
+}
+
+/* This function stores xmm0 or xmm1 into a real variable. */
+void code_generator::store_sse(int xmm, sym_index sym_p) {
+	map<sym_index, register_type>::iterator r = sym_reg.find(sym_p);
+	if (r != sym_reg.end()) {
+		out << "\t\t" << "movq" << "\t" << reg[r->second] << ", " << "xmm"
+				<< xmm << endl;
+		return;
+	}
+
+	int level, offset;
+	find(sym_p, &level, &offset);
+	register_type base = frame_address(level);
+	if (offset >= 0) {
+		out << "\t\t" << "movsd" << "\t" << "qword ptr [" << reg[base] << "+"
+				<< offset << "], " << "xmm" << xmm << endl;
+	} else {
+		out << "\t\t" << "movsd" << "\t" << "qword ptr [" << reg[base]
+				<< offset << "], " << "xmm" << xmm << endl;
+	}
+}
+
+/* Generate sym3 := sym1 <op> sym2 for reals with SSE2. */
+void code_generator::sse_arithmetic(const char *op, quadruple *q) {
+	fetch_sse(q->sym1, 0);
+	fetch_sse(q->sym2, 1);
+	out << "\t\t" << op << "\t" << "xmm0, xmm1" << endl;
+	store_sse(0, q->sym3);
+}
+
+/* Compare the reals a and b. Both fcomip and ucomisd set the flags like an
+ unsigned compare of a with b, also when the compare is unordered. */
+void code_generator::float_compare(sym_index a, sym_index b) {
+	if (sse_floats) {
+		fetch_sse(a, 0);
+		fetch_sse(b, 1);
+		out << "\t\t" << "ucomisd" << "\t" << "xmm0, xmm1" << endl;
+		return;
+	}
+
+	// We need to push in reverse order for this to work
+	fetch_float(b);
+	fetch_float(a);
+	out << "\t\t" << "fcomip" << "\t" << "ST(0), ST(1)" << endl;
+	// Clear the stack
+	out << "\t\t" << "fstp" << "\t" << "ST(0)" << endl;
+}
+
 /* This function stores the value of a register into a variable. */
 void code_generator::store(register_type src, sym_index sym_p) {
+	map<sym_index, register_type>::iterator r = sym_reg.find(sym_p);
+	if (r != sym_reg.end()) {
+		out << "\t\t" << "mov" << "\t" << reg[r->second] << ", " << reg[src]
+				<< endl;
+		return;
+	}
+	store_memory(src, sym_p);
+}
+
+/* This function stores the value of a register into the memory location of
+ a variable, even if it has a register. */
+void code_generator::store_memory(register_type src, sym_index sym_p) {
 	int level, offset;
 
 	find(sym_p, &level, &offset);
-	frame_address(level, RCX);
+	register_type base = frame_address(level);
 
 	if (offset >= 0) {
-		out << "\t\t" << "mov" << "\t" << "[" << reg[RCX] << "+" << offset
+		out << "\t\t" << "mov" << "\t" << "[" << reg[base] << "+" << offset
 				<< "], " << reg[src] << endl;
 	}
 
 	else {
-		out << "\t\t" << "mov" << "\t" << "[" << reg[RCX] << offset << "], "
+		out << "\t\t" << "mov" << "\t" << "[" << reg[base] << offset << "], "
 				<< reg[src] << endl;
 	}
 
@@ -233,34 +1354,51 @@ void code_generator::store_float(sym_index sym_p) {
 	int offset = 0;
 	int level = 0;
 	find(sym_p, &level, &offset);
-	frame_address(level, RCX);
+	register_type base = frame_address(level);
 	//normal Store Floating Point Value
 	if (offset >= 0) {
-		out << "\t\t" << "fstp" << "\t" << "qword ptr [" << reg[RCX] << "+"
+		out << "\t\t" << "fstp" << "\t" << "qword ptr [" << reg[base] << "+"
 				<< offset << "]\n";
 	}
 
 	else {
-		out << "\t\t" << "fstp" << "\t" << "qword ptr [" << reg[RCX] << offset
+		out << "\t\t" << "fstp" << "\t" << "qword ptr [" << reg[base] << offset
 				<< "]\n";
 	}
 
 }
 
-/* This function fetches the base address of an array. */
-void code_generator::array_address(sym_index sym_p, register_type dest) {
-	//get the symbol
-	symbol* sym = sym_tab->get_symbol(sym_p);
-	int level = 0;
-	int offset = 0;
-	//find level and offset
-	find(sym_p, &level, &offset);
-	//get the address of the frame
-	frame_address(level, RCX);
-	out << "\t\t" << "sub" << "\t" << reg[RCX] << ", "
-			<< ((sym->level + 1) * STACK_WIDTH + sym->offset) << "\n";
-
-	out << "\t\t" << "mov" << "\t" << reg[dest] << ", " << reg[RCX] << "\n";
+/* Return the jump to use after the compare in a compare-and-branch quad.
+ Integer compares are signed, while fcomip sets the flags like an unsigned
+ compare. */
+const char *code_generator::branch_instruction(quad_op_type op) {
+	switch (op) {
+	case q_ijeq:
+	case q_rjeq:
+		return "je";
+	case q_ijne:
+	case q_rjne:
+		return "jne";
+	case q_ijlt:
+		return "jl";
+	case q_ijle:
+		return "jle";
+	case q_ijgt:
+		return "jg";
+	case q_ijge:
+		return "jge";
+	case q_rjlt:
+		return "jb";
+	case q_rjle:
+		return "jbe";
+	case q_rjgt:
+		return "ja";
+	case q_rjge:
+		return "jae";
+	default:
+		fatal("code_generator::branch_instruction(): not a branch quad");
+		return NULL;
+	}
 }
 
 /* This method expands a quad_list into assembler code, quad for quad. */
@@ -268,9 +1406,9 @@ void code_generator::expand(quad_list *q_list) {
 	long quad_nr = 0;       // Just to make debug output easier to read.
 
 // We use this iterator to loop through the quad list.
-	quad_list_iterator *ql_iterator = new quad_list_iterator(q_list);
+	quad_list_iterator ql_iterator(q_list);
 
-	quadruple *q = ql_iterator->get_current();  // This is the head of the list.
+	quadruple *q = ql_iterator.get_current();  // This is the head of the list.
 
 	while (q != NULL) {
 		quad_nr++;
@@ -292,13 +1430,16 @@ void code_generator::expand(quad_list *q_list) {
 		switch (q->op_code) {
 		case q_rload:
 		case q_iload:
-			out << "\t\t" << "mov" << "\t" << "rax, " << q->int1 << endl;
-			store(RAX, q->sym3);
+			if (literal_temps.find(q->sym3) != literal_temps.end()) {
+				// The uses get the value as an immediate instead.
+				break;
+			}
+			store_immediate(q->int1, q->sym3);
 			break;
 
 		case q_inot: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
 			fetch(q->sym1, RAX);
 			out << "\t\t" << "cmp" << "\t" << "rax, 0" << endl;
@@ -315,6 +1456,13 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_ruminus:
+			if (sse_floats) {
+				// Flip the sign bit, which is what fchs does too.
+				fetch(q->sym1, RAX);
+				out << "\t\t" << "btc" << "\t" << "rax, 63" << endl;
+				store(RAX, q->sym3);
+				break;
+			}
 			fetch_float(q->sym1);
 			out << "\t\t" << "fchs" << endl;
 			store_float(q->sym3);
@@ -327,6 +1475,10 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 
 		case q_rplus:
+			if (sse_floats) {
+				sse_arithmetic("addsd", q);
+				break;
+			}
 			fetch_float(q->sym1);
 			fetch_float(q->sym2);
 			out << "\t\t" << "faddp" << endl;
@@ -334,13 +1486,14 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 
 		case q_iplus:
-			fetch(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "add" << "\t" << "rax, rcx" << endl;
-			store(RAX, q->sym3);
+			integer_arithmetic("add", q);
 			break;
 
 		case q_rminus:
+			if (sse_floats) {
+				sse_arithmetic("subsd", q);
+				break;
+			}
 			fetch_float(q->sym1);
 			fetch_float(q->sym2);
 			out << "\t\t" << "fsubp" << endl;
@@ -348,15 +1501,12 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 
 		case q_iminus:
-			fetch(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "sub" << "\t" << "rax, rcx" << endl;
-			store(RAX, q->sym3);
+			integer_arithmetic("sub", q);
 			break;
 
 		case q_ior: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
 			fetch(q->sym1, RAX);
 			out << "\t\t" << "cmp" << "\t" << "rax, 0" << endl;
@@ -376,8 +1526,8 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_iand: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
 			fetch(q->sym1, RAX);
 			out << "\t\t" << "cmp" << "\t" << "rax, 0" << endl;
@@ -397,51 +1547,83 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_rmult:
+			if (sse_floats) {
+				sse_arithmetic("mulsd", q);
+				break;
+			}
 			fetch_float(q->sym1);
 			fetch_float(q->sym2);
 			out << "\t\t" << "fmulp" << endl;
 			store_float(q->sym3);
 			break;
 
-		case q_imult:
-			fetch(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "imul" << "\t" << "rax, rcx" << endl;
-			store(RAX, q->sym3);
+		case q_imult: {
+			// Multiplication by a power of two is a shift.
+			long value;
+			sym_index other = NULL_SYM;
+			if (immediate(q->sym2, &value) && power_of_two(value) != 0) {
+				other = q->sym1;
+			} else if (immediate(q->sym1, &value) && power_of_two(value) != 0) {
+				other = q->sym2;
+			}
+			if (other != NULL_SYM) {
+				fetch(other, RAX);
+				out << "\t\t" << "shl" << "\t" << "rax, " << power_of_two(value)
+						<< endl;
+				store(RAX, q->sym3);
+				break;
+			}
+			integer_arithmetic("imul", q);
 			break;
+		}
 
 		case q_rdivide:
+			if (sse_floats) {
+				sse_arithmetic("divsd", q);
+				break;
+			}
 			fetch_float(q->sym1);
 			fetch_float(q->sym2);
 			out << "\t\t" << "fdivp" << endl;
 			store_float(q->sym3);
 			break;
 
-		case q_idivide:
+		case q_idivide: {
+			long value;
+			if (immediate(q->sym2, &value) && power_of_two(value) != 0) {
+				fetch(q->sym1, RAX);
+				divide_by_power(power_of_two(value), false);
+				store(RAX, q->sym3);
+				break;
+			}
 			fetch(q->sym1, RAX);
 			fetch(q->sym2, RCX);
 			out << "\t\t" << "cqo" << endl;
 			out << "\t\t" << "idiv" << "\t" << "rax, rcx" << endl;
 			store(RAX, q->sym3);
 			break;
-
-		case q_imod:
+		}
+		case q_imod: {
+			long value;
+			if (immediate(q->sym2, &value) && power_of_two(value) != 0) {
+				fetch(q->sym1, RAX);
+				divide_by_power(power_of_two(value), true);
+				store(RAX, q->sym3);
+				break;
+			}
 			fetch(q->sym1, RAX);
 			fetch(q->sym2, RCX);
 			out << "\t\t" << "cqo" << endl;
 			out << "\t\t" << "idiv" << "\t" << "rax, rcx" << endl;
 			store(RDX, q->sym3);
 			break;
+		}
 
 		case q_req: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
-			fetch_float(q->sym1);
-			fetch_float(q->sym2);
-			out << "\t\t" << "fcomip" << "\t" << "ST(0), ST(1)" << endl;
-			// Clear the stack
-			out << "\t\t" << "fstp" << "\t" << "ST(0)" << endl;
+			float_compare(q->sym2, q->sym1);
 			out << "\t\t" << "je" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -455,12 +1637,12 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_ieq: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
 			fetch(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "cmp" << "\t" << "rax, rcx" << endl;
+			string source = operand(q->sym2);
+			out << "\t\t" << "cmp" << "\t" << "rax, " << source << endl;
 			out << "\t\t" << "je" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -474,14 +1656,10 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_rne: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
-			fetch_float(q->sym1);
-			fetch_float(q->sym2);
-			out << "\t\t" << "fcomip" << "\t" << "ST(0), ST(1)" << endl;
-			// Clear the stack
-			out << "\t\t" << "fstp" << "\t" << "ST(0)" << endl;
+			float_compare(q->sym2, q->sym1);
 			out << "\t\t" << "jne" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -495,12 +1673,12 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_ine: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
 			fetch(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "cmp" << "\t" << "rax, rcx" << endl;
+			string source = operand(q->sym2);
+			out << "\t\t" << "cmp" << "\t" << "rax, " << source << endl;
 			out << "\t\t" << "jne" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -514,15 +1692,10 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_rlt: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
-			// We need to push in reverse order for this to work
-			fetch_float(q->sym2);
-			fetch_float(q->sym1);
-			out << "\t\t" << "fcomip" << "\t" << "ST(0), ST(1)" << endl;
-			// Clear the stack
-			out << "\t\t" << "fstp" << "\t" << "ST(0)" << endl;
+			float_compare(q->sym1, q->sym2);
 			out << "\t\t" << "jb" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -536,12 +1709,12 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_ilt: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
 			fetch(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "cmp" << "\t" << "rax, rcx" << endl;
+			string source = operand(q->sym2);
+			out << "\t\t" << "cmp" << "\t" << "rax, " << source << endl;
 			out << "\t\t" << "jl" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -555,15 +1728,10 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_rgt: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
-			// We need to push in reverse order for this to work
-			fetch_float(q->sym2);
-			fetch_float(q->sym1);
-			out << "\t\t" << "fcomip" << "\t" << "ST(0), ST(1)" << endl;
-			// Clear the stack
-			out << "\t\t" << "fstp" << "\t" << "ST(0)" << endl;
+			float_compare(q->sym1, q->sym2);
 			out << "\t\t" << "ja" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -577,12 +1745,12 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_igt: {
-			int label = sym_tab->get_next_label();
-			int label2 = sym_tab->get_next_label();
+			long label = sym_tab->get_next_label();
+			long label2 = sym_tab->get_next_label();
 
 			fetch(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "cmp" << "\t" << "rax, rcx" << endl;
+			string source = operand(q->sym2);
+			out << "\t\t" << "cmp" << "\t" << "rax, " << source << endl;
 			out << "\t\t" << "jg" << "\t" << "L" << label << endl;
 			// False branch
 			out << "\t\t" << "mov" << "\t" << "rax, 0" << endl;
@@ -596,71 +1764,161 @@ void code_generator::expand(quad_list *q_list) {
 			break;
 		}
 		case q_rstore:
-		case q_istore:
-			fetch(q->sym1, RAX);
-			fetch(q->sym3, RCX);
-			out << "\t\t" << "mov" << "\t" << "[rcx], rax" << endl;
+		case q_istore: {
+			// Store straight from an immediate or register if possible.
+			long value;
+			string source = reg[RAX];
+			map<sym_index, register_type>::iterator r = sym_reg.find(q->sym1);
+			if (immediate(q->sym1, &value) && fits_immediate(value)) {
+				source = operand(q->sym1);
+			} else if (r != sym_reg.end()) {
+				source = reg[r->second];
+			} else {
+				fetch(q->sym1, RAX);
+			}
+			r = sym_reg.find(q->sym3);
+			register_type address = RCX;
+			if (r != sym_reg.end()) {
+				address = r->second;
+			} else {
+				fetch(q->sym3, RCX);
+			}
+			out << "\t\t" << "mov" << "\t" << "qword ptr [" << reg[address]
+					<< "], " << source << endl;
 			break;
-
+		}
 		case q_rassign:
-		case q_iassign:
-			fetch(q->sym1, RAX);
-			store(RAX, q->sym3);
+		case q_iassign: {
+			long value;
+			map<sym_index, register_type>::iterator r = sym_reg.find(q->sym3);
+			if (immediate(q->sym1, &value)) {
+				store_immediate(value, q->sym3);
+			} else if (r != sym_reg.end()) {
+				string source = operand(q->sym1);
+				out << "\t\t" << "mov" << "\t" << reg[r->second] << ", "
+						<< source << endl;
+			} else {
+				fetch(q->sym1, RAX);
+				store(RAX, q->sym3);
+			}
 			break;
-
-		case q_param:
-			fetch(q->sym1, RAX);
-			out << "\t\t" << "push" << "\t" << "rax" << endl;
+		}
+		case q_param: {
+			map<long, parameter_symbol *>::iterator a =
+					register_args.find(ql_iterator.get_index());
+			if (a == register_args.end()) {
+				string source = operand(q->sym1);
+				out << "\t\t" << "push" << "\t" << source << endl;
+			} else if (a->second->type == real_type) {
+				fetch(q->sym1, RAX);
+				out << "\t\t" << "movq" << "\t" << "xmm" << a->second->arg_reg
+						<< ", rax" << endl;
+			} else {
+				string source = operand(q->sym1);
+				out << "\t\t" << "mov" << "\t"
+						<< reg[argument_regs[a->second->arg_reg]] << ", " << source
+						<< endl;
+			}
 			break;
+		}
 
 		case q_call: {
+			load_arguments(ql_iterator.get_index());
+			if (tail_calls.find(ql_iterator.get_index()) != tail_calls.end()) {
+				tail_call(q);
+				break;
+			}
 			symbol *sym = sym_tab->get_symbol(q->sym1);
+			// A procedure declared in this block can see our variables.
+			bool nested = sym->level == env_level;
+
+			if (nested) {
+				spill_reg_vars();
+			}
 
 			if (sym->tag == SYM_PROC) {
 				procedure_symbol *p_sym = sym->get_procedure_symbol();
 				out << "\t\t" << "call" << "\t" << "L" << p_sym->label_nr
 						<< "\t # " << sym_tab->pool_lookup(p_sym->id) << endl;
+				if (nested) {
+					reload_reg_vars();
+				}
+			} else if (q->sym1 == trunc_function && sse_floats) {
+				// The argument is on top of the stack.
+				out << "\t\t" << "cvttsd2si" << "\t" << "rax, qword ptr [rsp]"
+						<< endl;
+				store(RAX, q->sym3);
 			} else if (sym->tag == SYM_FUNC) {
 				function_symbol *f_sym = sym->get_function_symbol();
 				out << "\t\t" << "call" << "\t" << "L" << f_sym->label_nr
 						<< "\t # " << sym_tab->pool_lookup(f_sym->id) << endl;
-				store(RAX, q->sym3);
+				if (nested) {
+					reload_reg_vars();
+				}
+				// A real result comes back in xmm0 when the parameters come
+				// in registers.
+				if (sym->type == real_type && register_parameters &&
+						sym->level > 0) {
+					store_sse(0, q->sym3);
+				} else {
+					store(RAX, q->sym3);
+				}
 			}
-			out << "\t\t" << "add" << "\t" << "rsp, " << q->sym2 * STACK_WIDTH
+			out << "\t\t" << "add" << "\t" << "rsp, "
+					<< (q->sym2 - register_parameter_count(sym)) * STACK_WIDTH
 					<< endl;
 			break;
 		}
 		case q_rreturn:
 		case q_ireturn:
 			fetch(q->sym2, RAX);
+			if (q->op_code == q_rreturn && register_parameters) {
+				out << "\t\t" << "movq" << "\t" << "xmm0, rax" << endl;
+			}
 			out << "\t\t" << "jmp" << "\t" << "L" << q->int1 << endl;
 			break;
 
-		case q_lindex:
-			array_address(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "imul" << "\t" << "rcx, " << STACK_WIDTH << endl;
-			out << "\t\t" << "sub" << "\t" << "rax, rcx" << endl;
+		case q_lindex: {
+			string element = element_operand(q->sym1, q->sym2);
+			out << "\t\t" << "lea" << "\t" << "rax, " << element << endl;
 			store(RAX, q->sym3);
 			break;
-
+		}
 		case q_rrindex:
-		case q_irindex:
-			array_address(q->sym1, RAX);
-			fetch(q->sym2, RCX);
-			out << "\t\t" << "imul" << "\t" << "rcx, " << STACK_WIDTH << endl;
-			out << "\t\t" << "sub" << "\t" << "rax, rcx" << endl;
-			out << "\t\t" << "mov" << "\t" << "rax, [rax]" << endl;
+		case q_irindex: {
+			string element = element_operand(q->sym1, q->sym2);
+			out << "\t\t" << "mov" << "\t" << "rax, " << element << endl;
 			store(RAX, q->sym3);
 			break;
+		}
 
 		case q_itor: {
 			block_level level;      // Current scope level.
 			int offset;      // Offset within current activation record.
 
+			if (sse_floats) {
+				fetch(q->sym1, RAX);
+				out << "\t\t" << "cvtsi2sd" << "\t" << "xmm0, rax" << endl;
+				store_sse(0, q->sym3);
+				break;
+			}
+
+			long value;
+			if (sym_reg.find(q->sym1) != sym_reg.end() ||
+					immediate(q->sym1, &value)) {
+				// fild can only load from memory.
+				string source = operand(q->sym1);
+				out << "\t\t" << "push" << "\t" << source << endl;
+				out << "\t\t" << "fild" << "\t" << "qword ptr [rsp]" << endl;
+				out << "\t\t" << "add" << "\t" << "rsp, " << STACK_WIDTH
+						<< endl;
+				store_float(q->sym3);
+				break;
+			}
+
 			find(q->sym1, &level, &offset);
-			frame_address(level, RCX);
-			out << "\t\t" << "fild" << "\t" << "qword ptr [rcx";
+			register_type base = frame_address(level);
+			out << "\t\t" << "fild" << "\t" << "qword ptr [" << reg[base];
 			if (offset >= 0) {
 				out << "+" << offset;
 			} else {
@@ -675,16 +1933,103 @@ void code_generator::expand(quad_list *q_list) {
 			out << "\t\t" << "jmp" << "\t" << "L" << q->int1 << endl;
 			break;
 
-		case q_jmpf:
-			fetch(q->sym2, RAX);
-			out << "\t\t" << "cmp" << "\t" << "rax, 0" << endl;
+		case q_jmpf: {
+			long value;
+			if (immediate(q->sym2, &value)) {
+				if (value == 0) {
+					out << "\t\t" << "jmp" << "\t" << "L" << q->int1 << endl;
+				}
+				break;
+			}
+			string source = operand(q->sym2);
+			out << "\t\t" << "cmp" << "\t" << source << ", 0" << endl;
 			out << "\t\t" << "je" << "\t" << "L" << q->int1 << endl;
 			break;
+		}
 
 		case q_labl:
 			// We handled this one above already.
 			break;
 
+		case q_ijeq:
+		case q_ijne:
+		case q_ijlt:
+		case q_ijle:
+		case q_ijgt:
+		case q_ijge: {
+			fetch(q->sym2, RAX);
+			string source = operand(q->sym3);
+			out << "\t\t" << "cmp" << "\t" << "rax, " << source << endl;
+			out << "\t\t" << branch_instruction(q->op_code) << "\t" << "L"
+					<< q->int1 << endl;
+			break;
+		}
+
+		case q_rjeq:
+		case q_rjne:
+		case q_rjlt:
+		case q_rjle:
+		case q_rjgt:
+		case q_rjge:
+			float_compare(q->sym2, q->sym3);
+			out << "\t\t" << branch_instruction(q->op_code) << "\t" << "L"
+					<< q->int1 << endl;
+			break;
+
+		case q_valign: {
+			// Arrays grow downward, so the pair at i starts at i + 1.
+			string pair = element_address(q->sym1, q->sym2, 1);
+			out << "\t\t" << "lea" << "\t" << "rax, " << pair << endl;
+			out << "\t\t" << "and" << "\t" << "rax, 15" << endl;
+			store(RAX, q->sym3);
+			break;
+		}
+		case q_vload:
+		case q_vstore: {
+			string pair = element_address(q->sym1, q->sym2, 1);
+			const char *move = sym_tab->get_symbol(q->sym1)->type == real_type
+					? "movapd" : "movdqa";
+			out << "\t\t" << move << "\t";
+			if (q->op_code == q_vload) {
+				out << "xmm" << q->int3 << ", " << pair << endl;
+			} else {
+				out << pair << ", " << "xmm" << q->int3 << endl;
+			}
+			break;
+		}
+		case q_vsplat:
+			fetch(q->sym1, RAX);
+			out << "\t\t" << "movq" << "\t" << "xmm" << q->int3 << ", rax"
+					<< endl;
+			out << "\t\t" << "punpcklqdq" << "\t" << "xmm" << q->int3
+					<< ", xmm" << q->int3 << endl;
+			break;
+		case q_viplus:
+		case q_viminus:
+		case q_vrplus:
+		case q_vrminus:
+		case q_vrmult:
+		case q_vrdivide:
+			vector_arithmetic(q);
+			break;
+		case q_visum:
+			out << "\t\t" << "movq" << "\t" << "rax, xmm" << q->int1 << endl;
+			out << "\t\t" << "punpckhqdq" << "\t" << "xmm" << q->int1
+					<< ", xmm" << q->int1 << endl;
+			out << "\t\t" << "movq" << "\t" << "rcx, xmm" << q->int1 << endl;
+			out << "\t\t" << "add" << "\t" << "rax, rcx" << endl;
+			store(RAX, q->sym3);
+			break;
+
+		case q_profcall:
+		case q_profloop:
+			// The prologue counts the calls of the block itself.
+			if (q->op_code == q_profloop || q->int1 != profile_label) {
+				out << "\t\t" << "add" << "\t" << "qword ptr [rip+L" << q->int1
+						<< "+" << STACK_WIDTH << "], 1" << endl;
+			}
+			break;
+
 		case q_nop:
 			// q_nop quads should never be generated.
 			fatal("code_generator::expand(): q_nop quadruple produced.");
@@ -692,9 +2037,6 @@ void code_generator::expand(quad_list *q_list) {
 		}
 
 		// Get the next quad from the list.
-		q = ql_iterator->get_next();
+		q = ql_iterator.get_next();
 	}
-
-// Flush the generated code to file.
-	out << flush;
 }
@@ -1,16 +1,26 @@
 #ifndef __CODEGEN_HH__
 #define __CODEGEN_HH__
 
-#include <fstream>
+#include <ostream>
+#include <map>
+#include <set>
+#include <vector>
 
+#include "emit.hh"
 #include "quads.hh"
 #include "symtab.hh"
 
 using namespace std;
 
 
-/* These are the registers we will be using. */
-enum register_type { RAX, RCX, RDX };
+/* These are the registers we will be using. RAX, RCX and RDX are scratch
+   registers for expanding a single quad, RBP is the frame of the current
+   block, and the rest are handed out by the register allocator. */
+enum register_type { RAX, RCX, RDX, RBX, RSI, RDI, R8, R9, R10, R11, R12,
+                     R13, R14, R15, RBP };
+
+// Number of registers in register_type.
+const int NR_REGISTERS = 15;
 
 
 // Maximum number of formal parameters allowed.
@@ -24,10 +34,80 @@ class code_generator
 {
 private:
     // Register array.
-    string reg[3];
+    string reg[NR_REGISTERS];
+
+    // Set up the register names.
+    void init_registers();
+
+    // Level of the block being generated.
+    block_level env_level;
+
+    // The register each allocated symbol of the current block lives in.
+    map<sym_index, register_type> sym_reg;
+
+    // The registers handed out in the current block, which the prologue
+    // saves and the epilogue restores.
+    vector<register_type> saved_regs;
+
+    // Temps that only ever hold the value of a single q_iload. That quad is
+    // dropped, and the value is used as an immediate instead.
+    map<sym_index, long> literal_temps;
+
+    // Find the literal temps of a block.
+    void find_literals(quad_list *);
+
+    // The registers holding display entries of outer levels.
+    map<int, register_type> display_reg;
+
+    // The variables and parameters among the allocated symbols, which have
+    // to be in memory whenever a nested procedure might look at them.
+    vector<sym_index> reg_vars;
+
+    // Decide which symbols of a block get registers.
+    void allocate_registers(quad_list *);
+
+    // Returns true if a symbol may be kept in a register in a block.
+    bool register_candidate(sym_index, block_level);
 
-    // Output file stream.
-    ofstream out;
+    // Copy register-held variables to and from their home in memory.
+    void spill_reg_vars();
+    void reload_reg_vars();
+
+    // The block being generated.
+    symbol *env_sym;
+
+    // The calls of the current block that are in tail position and can
+    // reuse its frame, by index in the quad list, and the label in the
+    // prologue that a call of the block to itself jumps to, or -1.
+    set<long> tail_calls;
+    long self_label;
+
+    // Find the tail calls of a block.
+    void find_tail_calls(quad_list *);
+
+    // Generate a tail call in place of a q_call.
+    void tail_call(quadruple *);
+
+    // With -R, the q_param quads that move their argument straight to the
+    // register it is passed in, by index in the quad list, and for each
+    // call, the parameters passed in registers whose arguments were pushed
+    // anyway, first parameter first.
+    map<long, parameter_symbol *> register_args;
+    map<long, vector<parameter_symbol *> > stacked_args;
+
+    // Find out how the arguments of each call are passed.
+    void find_arguments(quad_list *);
+
+    // Load the pushed register arguments of the call at the given index.
+    void load_arguments(long);
+
+    // Output file buffer, and the stream writing to it.
+    emit_buffer buffer;
+    ostream out;
+
+    // The real constants used by SSE2 code in the current block, each with
+    // its label number.
+    map<long, long> literal_pool;
 
     // Align a stack frame.
     int  align(int);
@@ -38,6 +118,26 @@ private:
     // Leave env.
     void epilogue(symbol *);
 
+    // Write out the literal pool of a block.
+    void literals();
+
+    // With -P, the counter records of the current block, in the order they
+    // are written out, the one of its q_profcall first. The prologue counts
+    // the call into that one, and keeps the time stamp counter in the frame
+    // at rbp-profile_slot, for the epilogue to add what was spent since.
+    vector<quadruple> profile_records;
+    long profile_label;
+    int profile_slot;
+
+    // Find the records of a block.
+    void find_profile_records(quad_list *);
+
+    // Write out the records of a block.
+    void profile_data();
+
+    // Read the time stamp counter into rax.
+    void read_time_stamp();
+
     // Quadlist -> assembler.
     void expand(quad_list *q);
 
@@ -47,6 +147,42 @@ private:
     // memory -> register.
     void fetch(sym_index, const register_type);
 
+    // Same as fetch() and store(), but always use the memory location even
+    // if the symbol has been allocated a register.
+    void fetch_memory(sym_index, const register_type);
+    void store_memory(const register_type, sym_index);
+
+    // Returns true if the integer value of a symbol is known, and sets it.
+    bool immediate(sym_index, long *);
+
+    // The memory operand of a variable or parameter.
+    string memory_operand(sym_index);
+
+    // An operand holding the value of a symbol, for use as the source of an
+    // instruction: an immediate, a register or a memory operand. May use
+    // RCX.
+    string operand(sym_index);
+
+    // value -> register or memory.
+    void store_immediate(long, sym_index);
+
+    // The operand of an element of an array, with the index in a symbol.
+    // May use RCX and RDX.
+    string element_operand(sym_index, sym_index);
+
+    // The address in brackets of the element a number of elements after
+    // the one at an index. May use RCX and RDX.
+    string element_address(sym_index, sym_index, long);
+
+    // Generate sym3 := sym1 <op> sym2 with a two-operand instruction.
+    void integer_arithmetic(const char *, quadruple *);
+
+    // Generate the packed arithmetic of a vector quad.
+    void vector_arithmetic(quadruple *);
+
+    // Generate signed division or modulo by two to the power of k.
+    void divide_by_power(int, bool);
+
     // memory -> FPU.
     void fetch_float(sym_index);
 
@@ -56,20 +192,46 @@ private:
     // FPU -> memory.
     void store_float(sym_index);
 
-    // Get array base address.
-    void array_address(sym_index, const register_type);
+    // memory/register -> xmm register, and back.
+    void fetch_sse(sym_index, int);
+    void store_sse(int, sym_index);
+
+    // Real arithmetic on sym1 and sym2 into sym3 with an SSE2 instruction.
+    void sse_arithmetic(const char *, quadruple *);
+
+    // Compare two reals, setting the flags like an unsigned compare.
+    void float_compare(sym_index, sym_index);
 
     // Get frame base address.
-    void frame_address(int level, const register_type);
+    register_type frame_address(int level);
+
+    // Conditional jump instruction for a compare-and-branch quad.
+    const char *branch_instruction(quad_op_type);
 public:
     // Constructor. Arg = filename of assembler outfile.
     code_generator(const string);
 
+    // Constructor for a generator that writes to a string, for -j.
+    code_generator(string *);
+
     // Destructor.
     ~code_generator();
 
      // Interface.
     void generate_assembler(quad_list *, symbol *env);
+
+    // Write out the code of a block generated by another code_generator.
+    void write_assembler(const string &);
+
+    // Write out everything, and with -E the object file.
+    void finish(const string &object_file);
+
+    // Print the -v statistics, once the main program has been written.
+    void print_statistics();
+
+    // Output written so far, for the -T statistics.
+    long get_instructions() { return buffer.get_instructions(); }
+    long get_bytes_written() { return buffer.get_bytes_written(); }
 };
 
 #endif
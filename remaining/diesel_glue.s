@@ -10,6 +10,8 @@
 
 .align    8
 .global   main
+# Global too, for linking with the object files the compiler writes with -E.
+.global   L0, L1, L2
 
 main: # this is where the process starts
 
@@ -22,6 +24,10 @@ main: # this is where the process starts
     fnstcw word ptr [rbp-8]
     or word ptr [rbp-8], 3072 # from FE_TOWARDZERO
     fldcw word ptr [rbp-8]
+    # The same goes for SSE2 code, so that reals behave the same with -S.
+    stmxcsr dword ptr [rbp-8]
+    or dword ptr [rbp-8], 24576 # rounding control bits of MXCSR
+    ldmxcsr dword ptr [rbp-8]
     leave
 
     enter 0, 0
@@ -31,23 +37,57 @@ main: # this is where the process starts
     mov rax, 0
     ret
 
+# DIESEL code may keep values in any register but rax, rcx and rdx, so the
+# ones the C calling convention lets a function clobber are saved around the
+# calls. The stack is also aligned the way the C code expects it.
+
 L0: # read function
     # Return value is in RAX
-    call    getchar
+    push rbp
+    mov rbp, rsp
+    push rsi
+    push rdi
+    push r8
+    push r9
+    push r10
+    push r11
+    and rsp, -16
+    call    mygetchar    # in diesel_rts.o
+    lea rsp, [rbp-48]
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rdi
+    pop rsi
+    pop rbp
     ret
 
 L1: # write procedure
-    mov rdi, qword ptr [rsp+8]
+    push rbp
+    mov rbp, rsp
+    push rsi
+    push rdi
+    push r8
+    push r9
+    push r10
+    push r11
+    mov rdi, qword ptr [rbp+16]
+    and rsp, -16
     call    myputchar    # in diesel_rts.o
+    lea rsp, [rbp-48]
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rdi
+    pop rsi
+    pop rbp
     ret
 
 L2: # trunc function
     # This very cryptic instruction
-    # ConVerTs with Truncation a Signed Double TO a Signed Integer
-    # cvttsd2si rax, [rsp+8]
-    enter 8, 0
-    fld qword ptr [rbp+16]
-    fistp qword ptr [rbp-8]
-    mov rax, qword ptr [rbp-8]
-    leave
+    # ConVerTs with Truncation a Signed Double TO a Signed Integer.
+    # Code compiled with -S does this inline instead of calling L2.
+    cvttsd2si rax, [rsp+8]
     ret
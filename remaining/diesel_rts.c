@@ -1,8 +1,128 @@
 /* diesel_rts.c */
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 // Compile with gcc -c diesel_rts.c -o diesel_rts.o -Wall -m64
 
+/* The read and write routines in diesel_glue.s end up here. Output is
+   collected in a buffer and written when it is full, before the program
+   blocks reading input, and at exit. Input is read a buffer at a time,
+   which from a terminal means a line at a time. Setting the environment
+   variable DIESEL_UNBUFFERED makes every character be written right away,
+   for interactive programs that print prompts without reading. */
+
+#define OUTPUT_BUFFER_SIZE 65536
+#define INPUT_BUFFER_SIZE 65536
+
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+static int output_pos = 0;
+
+static char input_buffer[INPUT_BUFFER_SIZE];
+static int input_pos = 0;
+static int input_length = 0;
+
+// -1 until the first character is read or written.
+static int unbuffered = -1;
+
+static void flush_output(void) {
+    char *p = output_buffer;
+    while (output_pos > 0) {
+        ssize_t done = write(1, p, output_pos);
+        if (done == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        p += done;
+        output_pos -= done;
+    }
+    output_pos = 0;
+}
+
+static void start_io(void) {
+    unbuffered = getenv("DIESEL_UNBUFFERED") != NULL;
+    atexit(flush_output);
+}
+
 void myputchar(int ch) {
-    putc(ch, stdout);
-    fflush(stdout);
+    if (unbuffered == -1) {
+        start_io();
+    }
+    output_buffer[output_pos++] = ch;
+    if (unbuffered || output_pos == OUTPUT_BUFFER_SIZE) {
+        flush_output();
+    }
+}
+
+// Returns -1 at end of file, like getchar.
+int mygetchar(void) {
+    if (unbuffered == -1) {
+        start_io();
+    }
+    if (input_pos == input_length) {
+        flush_output();
+        ssize_t done;
+        do {
+            done = read(0, input_buffer, INPUT_BUFFER_SIZE);
+        } while (done == -1 && errno == EINTR);
+        if (done <= 0) {
+            return -1;
+        }
+        input_pos = 0;
+        input_length = done;
+    }
+    return (unsigned char) input_buffer[input_pos++];
+}
+
+/* A program compiled with -P keeps a record for each block and while loop
+   in the section diesel_profile, which the linker puts between these two
+   symbols. They are weak, so that they are null for programs without it.
+   Each record is the kind, 1 for a block and 2 for a loop, the count of
+   calls or rounds, the cycles spent in the calls, the source line, and the
+   length of the name followed by the name, eight characters to a quad. The
+   loops of a block follow its own record. The cycles include those of the
+   blocks called, but not of the ones inlined with -O, whose calls are only
+   counted. At exit, the records are printed to stderr, or to the file
+   named by the environment variable DIESEL_PROFILE. */
+
+extern long __start_diesel_profile[] __attribute__((weak));
+extern long __stop_diesel_profile[] __attribute__((weak));
+
+#define PROFILE_BLOCK 1
+
+static void dump_profile(void) {
+    FILE *out = stderr;
+    const char *file = getenv("DIESEL_PROFILE");
+    if (file != NULL && (out = fopen(file, "w")) == NULL) {
+        perror(file);
+        return;
+    }
+
+    fprintf(out, "%12s %16s %6s  %s\n", "count", "cycles", "line", "block");
+    long *record = __start_diesel_profile;
+    while (record < __stop_diesel_profile) {
+        long length = record[4];
+        if (record[0] == PROFILE_BLOCK) {
+            fprintf(out, "%12ld %16ld %6ld  %.*s\n", record[1], record[2],
+                    record[3], (int) length, (const char *) &record[5]);
+        } else {
+            fprintf(out, "%12ld %16s %6ld    while\n", record[1], "",
+                    record[3]);
+        }
+        record += 5 + (length + 7) / 8;
+    }
+
+    if (out != stderr) {
+        fclose(out);
+    }
+}
+
+static void start_profile(void) __attribute__((constructor));
+
+static void start_profile(void) {
+    if (&__start_diesel_profile[0] != &__stop_diesel_profile[0]) {
+        atexit(dump_profile);
+    }
 }
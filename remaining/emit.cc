@@ -0,0 +1,180 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "assembler.hh"
+#include "error.hh"
+#include "emit.hh"
+
+// Defined in main.cc.
+extern bool direct_output;
+extern bool elf_output;
+
+
+emit_buffer::emit_buffer(const string file_name)
+{
+    buffer = new char[EMIT_BUFFER_SIZE];
+    setp(buffer, buffer + EMIT_BUFFER_SIZE);
+
+    fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) {
+        perror(file_name.c_str());
+    }
+    file = NULL;
+    sink = NULL;
+    object = NULL;
+
+    bytes_written = 0;
+    writes = 0;
+    flush_requests = 0;
+    instructions = 0;
+    line_tabs = 0;
+}
+
+
+emit_buffer::emit_buffer(string *s)
+{
+    buffer = new char[EMIT_BUFFER_SIZE];
+    setp(buffer, buffer + EMIT_BUFFER_SIZE);
+
+    fd = -1;
+    file = NULL;
+    sink = s;
+    object = NULL;
+
+    bytes_written = 0;
+    writes = 0;
+    flush_requests = 0;
+    instructions = 0;
+    line_tabs = 0;
+}
+
+
+emit_buffer::~emit_buffer()
+{
+    write_out();
+    if (file != NULL) {
+        fclose(file);
+    } else if (fd != -1) {
+        close(fd);
+    }
+    delete object;
+    delete[] buffer;
+}
+
+
+/* Write a number of bytes to the output file. Whether to go through stdio
+   or the assembler is decided on the first write, since the constructor
+   runs before the command line options have been parsed. */
+void emit_buffer::write_bytes(const char *data, long length)
+{
+    if (length == 0 || (fd == -1 && sink == NULL)) {
+        return;
+    }
+
+    writes++;
+    bytes_written += length;
+    count_instructions(data, length);
+
+    if (sink != NULL) {
+        sink->append(data, length);
+        return;
+    }
+
+    if (elf_output) {
+        if (object == NULL) {
+            object = new elf_assembler();
+        }
+        object->assemble(data, length);
+        return;
+    }
+
+    if (!direct_output) {
+        if (file == NULL) {
+            file = fdopen(fd, "w");
+            if (file == NULL) {
+                fatal("emit_buffer: could not open the output file");
+            }
+        }
+        if ((long) fwrite(data, 1, length, file) != length ||
+                fflush(file) != 0) {
+            fatal("emit_buffer: could not write the output file");
+        }
+        return;
+    }
+
+    while (length > 0) {
+        ssize_t done = write(fd, data, length);
+        if (done == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fatal("emit_buffer: could not write the output file");
+        }
+        data += done;
+        length -= done;
+    }
+}
+
+
+/* Lines may be split between two writes, so the state of the last line is
+   kept in line_tabs. */
+void emit_buffer::count_instructions(const char *data, long length)
+{
+    for (long i = 0; i < length; i++) {
+        if (data[i] == '\n') {
+            line_tabs = 0;
+        } else if (line_tabs == -1) {
+            continue;
+        } else if (data[i] == '\t' && ++line_tabs == 2) {
+            instructions++;
+            line_tabs = -1;
+        } else if (data[i] != '\t') {
+            line_tabs = -1;
+        }
+    }
+}
+
+
+/* Write out the whole buffer and start over. */
+void emit_buffer::write_out()
+{
+    write_bytes(pbase(), pptr() - pbase());
+    setp(buffer, buffer + EMIT_BUFFER_SIZE);
+}
+
+
+void emit_buffer::write_out(const string &s)
+{
+    write_out();
+    write_bytes(s.data(), s.length());
+}
+
+
+void emit_buffer::write_object(const string &file_name)
+{
+    write_out();
+    if (object != NULL) {
+        object->write_object(file_name);
+    }
+}
+
+
+/* The buffer is full. Write it out, and then put c in the fresh buffer. */
+emit_buffer::int_type emit_buffer::overflow(int_type c)
+{
+    write_out();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+
+/* A flush of the stream doesn't write anything, we do that per block. */
+int emit_buffer::sync()
+{
+    flush_requests++;
+    return 0;
+}
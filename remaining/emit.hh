@@ -0,0 +1,90 @@
+#ifndef __EMIT_HH__
+#define __EMIT_HH__
+
+#include <stdio.h>
+#include <streambuf>
+#include <string>
+
+using namespace std;
+
+class elf_assembler;
+
+/* Size of the buffer the assembler output is collected in. */
+const long EMIT_BUFFER_SIZE = 1024 * 1024;
+
+/* Stream buffer for the assembler output. Everything written to it is kept
+   in memory until write_out() is called, which the code generator does once
+   per block, or until the buffer fills up. Flushes of the stream, such as
+   the ones done by endl, are only counted and otherwise ignored. The file
+   is written through stdio, or straight to its file descriptor if the -w
+   flag was given. With -j, the blocks generated in other threads are
+   written to strings instead, and then to the file in order. With -E,
+   the output goes to the assembler in assembler.cc instead of the file. */
+class emit_buffer : public streambuf
+{
+private:
+    char *buffer;
+
+    // The file descriptor of the output file, and the stdio stream on top
+    // of it, which is only opened when not writing to the fd directly.
+    int fd;
+    FILE *file;
+
+    // The string written to instead of a file, or NULL.
+    string *sink;
+
+    // The assembler the output goes to with -E, or NULL.
+    elf_assembler *object;
+
+    // Statistics.
+    long bytes_written;
+    long writes;
+    long flush_requests;
+    long instructions;
+
+    // Number of tabs seen at the start of the current output line, or -1
+    // once something else has been seen on it.
+    int line_tabs;
+
+    // Count the instructions in a piece of output. Instruction lines are
+    // the ones that start with two tabs.
+    void count_instructions(const char *, long);
+
+    // Write a number of bytes from the buffer to the file.
+    void write_bytes(const char *, long);
+
+protected:
+    // Called when the buffer is full.
+    virtual int_type overflow(int_type);
+
+    // Called when the stream is flushed.
+    virtual int sync();
+
+public:
+    // Constructor. Arg = name of the file to create.
+    emit_buffer(const string);
+
+    // Constructor for a buffer that writes to a string.
+    emit_buffer(string *);
+
+    ~emit_buffer();
+
+    // Write everything buffered so far to the file.
+    void write_out();
+
+    // Write out the buffer and a piece of output that was generated
+    // elsewhere.
+    void write_out(const string &);
+
+    // Write out the buffer and, with -E, the object file.
+    void write_object(const string &);
+
+    bool writes_to_string() { return sink != NULL; }
+
+    long get_bytes_written() { return bytes_written; }
+    long get_writes() { return writes; }
+    long get_flush_requests() { return flush_requests; }
+    long get_instructions() { return instructions; }
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <sstream>
 #include <ostream>
+#include "arena.hh"
 
 using namespace std;
 
@@ -35,6 +36,10 @@ public:
     int get_line();
 
     int get_column();
+
+    // Positions live in the current block's AST arena, see arena.hh.
+    static void *operator new(size_t size) { return ast_allocate(size); }
+    static void operator delete(void *) { }
 };
 
 
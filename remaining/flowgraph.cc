@@ -0,0 +1,634 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include "symtab.hh"
+#include "flowgraph.hh"
+
+/*** This file contains the control flow graph and the dataflow problems.
+     See flowgraph.hh for how they fit together. ***/
+
+
+/* Returns true for the quads that compute a value from their arguments,
+   and would compute the same value again as long as the arguments don't
+   change. The array reads are left out, since stores change them. */
+static bool is_expression(quad_op_type op)
+{
+    switch (op) {
+    case q_inot:
+    case q_ruminus:
+    case q_iuminus:
+    case q_rplus:
+    case q_iplus:
+    case q_rminus:
+    case q_iminus:
+    case q_ior:
+    case q_iand:
+    case q_rmult:
+    case q_imult:
+    case q_rdivide:
+    case q_idivide:
+    case q_imod:
+    case q_req:
+    case q_ieq:
+    case q_rne:
+    case q_ine:
+    case q_rlt:
+    case q_ilt:
+    case q_rgt:
+    case q_igt:
+    case q_lindex:
+    case q_itor:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/* Returns true if a symbol in an argument slot is a variable, ie, neither
+   missing nor a constant. */
+static bool is_variable(sym_index sym_p)
+{
+    return sym_p != NULL_SYM && sym_tab->get_symbol_tag(sym_p) != SYM_CONST;
+}
+
+
+
+bit_set::bit_set(long size) :
+    words((size + 63) / 64, 0),
+    bits(size)
+{
+}
+
+
+void bit_set::fill()
+{
+    for (unsigned long i = 0; i < words.size(); i++) {
+        words[i] = ~0UL;
+    }
+    if (bits % 64 != 0) {
+        words.back() = (1UL << (bits % 64)) - 1;
+    }
+}
+
+
+void bit_set::clear()
+{
+    for (unsigned long i = 0; i < words.size(); i++) {
+        words[i] = 0;
+    }
+}
+
+
+bool bit_set::unite(const bit_set &other)
+{
+    unsigned long added = 0;
+    for (unsigned long i = 0; i < words.size(); i++) {
+        added |= other.words[i] & ~words[i];
+        words[i] |= other.words[i];
+    }
+    return added != 0;
+}
+
+
+void bit_set::intersect(const bit_set &other)
+{
+    for (unsigned long i = 0; i < words.size(); i++) {
+        words[i] &= other.words[i];
+    }
+}
+
+
+void bit_set::subtract(const bit_set &other)
+{
+    for (unsigned long i = 0; i < words.size(); i++) {
+        words[i] &= ~other.words[i];
+    }
+}
+
+
+bool bit_set::operator==(const bit_set &other) const
+{
+    return words == other.words;
+}
+
+
+long bit_set::next(long i) const
+{
+    if (i >= bits) {
+        return -1;
+    }
+    unsigned long w = i / 64;
+    unsigned long word = words[w] & (~0UL << (i % 64));
+    while (word == 0) {
+        if (++w == words.size()) {
+            return -1;
+        }
+        word = words[w];
+    }
+    return w * 64 + __builtin_ctzl(word);
+}
+
+
+
+/* Split a quad list into basic blocks and link them up. */
+flow_graph::flow_graph(quad_list *q_list) :
+    q(q_list),
+    quad_block(q_list->size()),
+    found_global_temps(false)
+{
+    // Find the blocks, and where each label is.
+    unordered_map<long, long> label_block;
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        bool leader = i == 0 || (*q)[i - 1].ends_block() ||
+            (quad.op_code == q_labl && (*q)[i - 1].op_code != q_labl);
+        if (leader) {
+            basic_block block;
+            block.first = i;
+            block.exits = false;
+            blocks.push_back(block);
+        }
+        blocks.back().last = i;
+        quad_block[i] = blocks.size() - 1;
+        if (quad.op_code == q_labl) {
+            label_block[quad.int1] = blocks.size() - 1;
+        }
+    }
+
+    // Link each block to where its last quad may go.
+    for (long b = 0; b < (long)blocks.size(); b++) {
+        quadruple &last = (*q)[blocks[b].last];
+        bool falls_through = true;
+        long target = -1;
+        if (last.ends_block()) {
+            unordered_map<long, long>::iterator l =
+                label_block.find(last.int1);
+            if (l != label_block.end()) {
+                target = l->second;
+            }
+            falls_through = last.op_code != q_jmp &&
+                last.op_code != q_ireturn && last.op_code != q_rreturn;
+        }
+        long next = b + 1 < (long)blocks.size() ? b + 1 : -1;
+        if (falls_through && next != -1) {
+            blocks[b].successors.push_back(next);
+        }
+        if (target != -1 && !(falls_through && target == next)) {
+            blocks[b].successors.push_back(target);
+        }
+        blocks[b].exits = (last.ends_block() && target == -1) ||
+            (falls_through && next == -1);
+        for (unsigned long s = 0; s < blocks[b].successors.size(); s++) {
+            blocks[blocks[b].successors[s]].predecessors.push_back(b);
+        }
+    }
+
+    find_order();
+}
+
+
+/* A temp is global if it is read in a block before it has been assigned
+   there, or assigned in more than one. */
+void flow_graph::find_global_temps()
+{
+    unordered_map<sym_index, long> assigned_in;
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        long b = quad_block[i];
+        sym_index *slots[2];
+        int n = quad.use_slots(slots);
+        for (int k = 0; k < n; k++) {
+            sym_index t = *slots[k];
+            if (!sym_tab->is_temp_var(t)) {
+                continue;
+            }
+            unordered_map<sym_index, long>::iterator a = assigned_in.find(t);
+            if (a == assigned_in.end() || a->second != b) {
+                global_temps.insert(t);
+            }
+        }
+        sym_index d = quad.defined_sym();
+        if (!sym_tab->is_temp_var(d)) {
+            continue;
+        }
+        unordered_map<sym_index, long>::iterator a = assigned_in.find(d);
+        if (a != assigned_in.end() && a->second != b) {
+            global_temps.insert(d);
+        }
+        assigned_in[d] = b;
+    }
+    found_global_temps = true;
+}
+
+
+/* A depth first search, without recursion, since there may be thousands
+   of blocks in a row. */
+void flow_graph::find_order()
+{
+    order.clear();
+    reached.assign(blocks.size(), false);
+    if (blocks.empty()) {
+        return;
+    }
+
+    vector<bool> visited(blocks.size(), false);
+    vector<pair<long, unsigned long> > stack;
+    stack.push_back(make_pair(0L, 0UL));
+    visited[0] = true;
+    while (!stack.empty()) {
+        long b = stack.back().first;
+        unsigned long s = stack.back().second++;
+        if (s < blocks[b].successors.size()) {
+            long next = blocks[b].successors[s];
+            if (!visited[next]) {
+                visited[next] = true;
+                stack.push_back(make_pair(next, 0UL));
+            }
+        } else {
+            order.push_back(b);
+            stack.pop_back();
+        }
+    }
+    reverse(order.begin(), order.end());
+
+    for (unsigned long i = 0; i < order.size(); i++) {
+        reached[order[i]] = true;
+    }
+}
+
+
+bool flow_graph::reachable(long block)
+{
+    return reached[block];
+}
+
+
+bool flow_graph::is_global_name(sym_index sym_p)
+{
+    if (!found_global_temps) {
+        find_global_temps();
+    }
+    return !sym_tab->is_temp_var(sym_p) ||
+        global_temps.find(sym_p) != global_temps.end();
+}
+
+
+/* Print the symbols of the facts in a set of live variables. */
+static void print_symbols(ostream &o, const bit_set &set,
+                          const vector<sym_index> &symbols)
+{
+    for (long i = set.next(0); i != -1; i = set.next(i + 1)) {
+        o << " " << sym_tab->get_symbol(symbols[i]);
+    }
+    o << endl;
+}
+
+
+void flow_graph::print(ostream &o)
+{
+    live_variables live(this);
+
+    o << short_symbols;
+    for (unsigned long b = 0; b < blocks.size(); b++) {
+        basic_block &block = blocks[b];
+        o << "Basic block " << b << ": quads " << block.first + 1 << "-"
+          << block.last + 1;
+        if (!reachable(b)) {
+            o << ", unreachable" << endl;
+        } else {
+            o << ", from";
+            if (b == 0) {
+                o << " entry";
+            }
+            for (unsigned long p = 0; p < block.predecessors.size(); p++) {
+                o << " " << block.predecessors[p];
+            }
+            o << ", to";
+            for (unsigned long s = 0; s < block.successors.size(); s++) {
+                o << " " << block.successors[s];
+            }
+            if (block.exits) {
+                o << " exit";
+            }
+            o << endl;
+            o << "    live in:";
+            print_symbols(o, live.live_in(b), live.symbols);
+        }
+        for (long i = block.first; i <= block.last; i++) {
+            o << setw(5) << i + 1 << &(*q)[i] << endl;
+        }
+        if (reachable(b)) {
+            o << "    live out:";
+            print_symbols(o, live.live_out(b), live.symbols);
+        }
+    }
+    o << long_symbols;
+}
+
+
+
+dataflow_problem::dataflow_problem(flow_graph *g, bool fwd, bool all) :
+    graph(g),
+    forward(fwd),
+    all_paths(all),
+    facts(0)
+{
+}
+
+
+void dataflow_problem::make_sets()
+{
+    gen.assign(graph->blocks.size(), bit_set(facts));
+    kill.assign(graph->blocks.size(), bit_set(facts));
+    boundary = bit_set(facts);
+}
+
+
+/* Nothing a procedure calls can see further in than the procedure itself,
+   so that is as far as a call can reach. */
+const bit_set &dataflow_problem::called(sym_index proc)
+{
+    block_level level = sym_tab->get_symbol(proc)->level;
+    map<block_level, bit_set>::iterator c = called_sets.find(level);
+    if (c != called_sets.end()) {
+        return c->second;
+    }
+    bit_set &set = called_sets[level];
+    set = bit_set(facts);
+    for (long f = 0; f < facts; f++) {
+        if (fact_levels[f] != -1 && fact_levels[f] <= level) {
+            set.set(f);
+        }
+    }
+    return set;
+}
+
+
+/* The iterative solver. Every reachable block is visited once in order,
+   and after that only the ones that are downstream of a change. */
+void dataflow_problem::solve()
+{
+    long nr_blocks = graph->blocks.size();
+    in.assign(nr_blocks, bit_set(facts));
+    out.assign(nr_blocks, bit_set(facts));
+
+    vector<long> worklist(graph->order);
+    if (!forward) {
+        reverse(worklist.begin(), worklist.end());
+    }
+    if (all_paths) {
+        for (unsigned long i = 0; i < worklist.size(); i++) {
+            out[worklist[i]].fill();
+        }
+    }
+    vector<bool> queued(nr_blocks, false);
+    for (unsigned long i = 0; i < worklist.size(); i++) {
+        queued[worklist[i]] = true;
+    }
+
+    bit_set result(facts);
+    for (unsigned long next = 0; next < worklist.size(); next++) {
+        long b = worklist[next];
+        basic_block &block = graph->blocks[b];
+        queued[b] = false;
+
+        // Join the sets coming in from the neighbours upstream.
+        vector<long> &from = forward ? block.predecessors : block.successors;
+        bool first = true;
+        if (forward ? b == 0 : block.exits) {
+            in[b] = boundary;
+            first = false;
+        }
+        for (unsigned long i = 0; i < from.size(); i++) {
+            if (!graph->reachable(from[i])) {
+                continue;
+            }
+            if (first) {
+                in[b] = out[from[i]];
+                first = false;
+            } else if (all_paths) {
+                in[b].intersect(out[from[i]]);
+            } else {
+                in[b].unite(out[from[i]]);
+            }
+        }
+
+        result = in[b];
+        result.subtract(kill[b]);
+        result.unite(gen[b]);
+        if (result == out[b]) {
+            continue;
+        }
+        out[b] = result;
+
+        vector<long> &to = forward ? block.successors : block.predecessors;
+        for (unsigned long i = 0; i < to.size(); i++) {
+            if (graph->reachable(to[i]) && !queued[to[i]]) {
+                queued[to[i]] = true;
+                worklist.push_back(to[i]);
+            }
+        }
+    }
+}
+
+
+
+live_variables::live_variables(flow_graph *g) :
+    dataflow_problem(g, false, false)
+{
+    quad_list *q = graph->get_quads();
+
+    // Number the variables that can be live from one block to the next.
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        sym_index *slots[2];
+        int n = quad.use_slots(slots);
+        sym_index seen[3] = { NULL_SYM, NULL_SYM, quad.defined_sym() };
+        for (int k = 0; k < n; k++) {
+            seen[k] = *slots[k];
+        }
+        for (int k = 0; k < 3; k++) {
+            if (is_variable(seen[k]) && graph->is_global_name(seen[k]) &&
+                    numbers.find(seen[k]) == numbers.end()) {
+                numbers[seen[k]] = facts++;
+                symbols.push_back(seen[k]);
+                fact_levels.push_back(sym_tab->is_temp_var(seen[k]) ? -1 :
+                                      sym_tab->get_symbol(seen[k])->level);
+            }
+        }
+    }
+    make_sets();
+
+    for (long f = 0; f < facts; f++) {
+        if (fact_levels[f] != -1) {
+            boundary.set(f);
+        }
+    }
+
+    // A variable read in a block before it is assigned there is live into
+    // it, whatever happens after.
+    bit_set read(facts);
+    for (unsigned long b = 0; b < graph->blocks.size(); b++) {
+        basic_block &block = graph->blocks[b];
+        for (long i = block.first; i <= block.last; i++) {
+            quadruple &quad = (*q)[i];
+            sym_index *slots[2];
+            int n = quad.use_slots(slots);
+            for (int k = 0; k < n; k++) {
+                unordered_map<sym_index, long>::iterator f =
+                    numbers.find(*slots[k]);
+                if (f != numbers.end() && !kill[b].test(f->second)) {
+                    gen[b].set(f->second);
+                }
+            }
+            if (quad.op_code == q_call) {
+                read = called(quad.sym1);
+                read.subtract(kill[b]);
+                gen[b].unite(read);
+            }
+            unordered_map<sym_index, long>::iterator f =
+                numbers.find(quad.defined_sym());
+            if (f != numbers.end()) {
+                kill[b].set(f->second);
+            }
+        }
+    }
+
+    solve();
+}
+
+
+bool live_variables::live_after(sym_index sym_p, long block)
+{
+    unordered_map<sym_index, long>::iterator f = numbers.find(sym_p);
+    if (f == numbers.end()) {
+        // Only seen in one block, so never live out of it.
+        return false;
+    }
+    return live_out(block).test(f->second);
+}
+
+
+
+reaching_definitions::reaching_definitions(flow_graph *g) :
+    dataflow_problem(g, true, false)
+{
+    quad_list *q = graph->get_quads();
+
+    // Number the assignments, and list the ones of each variable.
+    unordered_map<sym_index, vector<long> > definitions_of;
+    for (long i = 0; i < q->size(); i++) {
+        sym_index d = (*q)[i].defined_sym();
+        if (is_variable(d) && graph->is_global_name(d)) {
+            definitions_of[d].push_back(facts++);
+            definitions.push_back(i);
+        }
+    }
+    make_sets();
+
+    // An assignment reaches the end of its block if it is the last one of
+    // its variable there, and no other assignment of the variable does.
+    long f = 0;
+    unordered_map<sym_index, long> last;
+    for (unsigned long b = 0; b < graph->blocks.size(); b++) {
+        basic_block &block = graph->blocks[b];
+        last.clear();
+        for (; f < facts && definitions[f] <= block.last; f++) {
+            last[(*q)[definitions[f]].defined_sym()] = f;
+        }
+        unordered_map<sym_index, long>::iterator l;
+        for (l = last.begin(); l != last.end(); l++) {
+            vector<long> &all = definitions_of[l->first];
+            for (unsigned long i = 0; i < all.size(); i++) {
+                kill[b].set(all[i]);
+            }
+            gen[b].set(l->second);
+        }
+    }
+
+    solve();
+}
+
+
+
+available_expressions::available_expressions(flow_graph *g) :
+    dataflow_problem(g, true, true)
+{
+    quad_list *q = graph->get_quads();
+
+    // Number the expressions whose arguments may be the same in different
+    // blocks, and list the ones each variable is an argument of.
+    map<tuple<int, sym_index, sym_index>, long> numbers;
+    unordered_map<sym_index, vector<long> > arguments_of;
+    vector<long> fact_of(q->size(), -1);
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        if (!is_expression(quad.op_code)) {
+            continue;
+        }
+        sym_index *slots[2];
+        int n = quad.use_slots(slots);
+        sym_index args[2] = { quad.sym1, quad.sym2 };
+        bool global = true;
+        for (int k = 0; k < n; k++) {
+            global &= !is_variable(*slots[k]) ||
+                graph->is_global_name(*slots[k]);
+        }
+        if (!global) {
+            continue;
+        }
+        tuple<int, sym_index, sym_index> key(quad.op_code, args[0], args[1]);
+        map<tuple<int, sym_index, sym_index>, long>::iterator e =
+            numbers.find(key);
+        if (e != numbers.end()) {
+            fact_of[i] = e->second;
+            continue;
+        }
+        fact_of[i] = numbers[key] = facts;
+        expressions.push_back(i);
+        block_level outermost = -1;
+        for (int k = 0; k < 2; k++) {
+            if (!is_variable(args[k])) {
+                continue;
+            }
+            arguments_of[args[k]].push_back(facts);
+            block_level level = sym_tab->get_symbol(args[k])->level;
+            if (!sym_tab->is_temp_var(args[k]) &&
+                    (outermost == -1 || level < outermost)) {
+                outermost = level;
+            }
+        }
+        fact_levels.push_back(outermost);
+        facts++;
+    }
+    make_sets();
+
+    // An expression is available at the end of a block if it is computed
+    // there, and none of its arguments is assigned after that.
+    for (unsigned long b = 0; b < graph->blocks.size(); b++) {
+        basic_block &block = graph->blocks[b];
+        for (long i = block.first; i <= block.last; i++) {
+            quadruple &quad = (*q)[i];
+            if (fact_of[i] != -1) {
+                gen[b].set(fact_of[i]);
+            }
+            if (quad.op_code == q_call) {
+                gen[b].subtract(called(quad.sym1));
+                kill[b].unite(called(quad.sym1));
+            }
+            unordered_map<sym_index, vector<long> >::iterator a =
+                arguments_of.find(quad.defined_sym());
+            if (a == arguments_of.end()) {
+                continue;
+            }
+            for (unsigned long k = 0; k < a->second.size(); k++) {
+                gen[b].reset(a->second[k]);
+                kill[b].set(a->second[k]);
+            }
+        }
+    }
+
+    solve();
+}
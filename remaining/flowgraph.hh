@@ -0,0 +1,248 @@
+#ifndef __FLOWGRAPH_HH__
+#define __FLOWGRAPH_HH__
+
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "quads.hh"
+
+using namespace std;
+
+
+/*** This file contains the control flow graph of a quad list and a generic
+     dataflow solver over it, for the quad level passes to build on.
+
+     The quad list is split into basic blocks at every q_labl and after
+     every quad that may jump, ie, q_jmp, q_jmpf, the returns and the
+     compare-and-branch quads. A run of labels starts a single block. The
+     returns jump to the quad list's last label, at the end of the list, so
+     the graph is left by falling off the end of it, or by a jump to a
+     label that isn't in the list.
+
+     The solver handles the problems that can be written as
+         out = gen + (in - kill)
+     in either direction, with the sets of the neighbours joined by union
+     or intersection. The sets are bit sets with one bit per fact, so each
+     problem numbers its facts first. It goes over the blocks that can be
+     reached from the first one in reverse postorder, or postorder for the
+     backward problems, and then keeps a worklist of blocks whose
+     neighbours changed, which is a couple of rounds for the lists
+     do_quads() makes.
+
+     The bit sets of a problem take a bit per fact and block, so a temp
+     that is only seen in one basic block, and assigned there before it is
+     read, is left out of them, since it can't carry anything from one
+     block to another. That is nearly all temps. The first problems are
+     liveness, reaching definitions and available expressions. None of
+     them know what a call does to the variables that aren't temps, so a
+     call is taken to read all of those that the procedure or function
+     called can see, ie, the ones declared at its own level or further
+     out, but not to assign any. ***/
+
+
+/* A fixed size set of small integers, one bit each. */
+class bit_set
+{
+private:
+    vector<unsigned long> words;
+    long bits;
+
+public:
+    bit_set(long size = 0);
+
+    // The number of integers that fit, from 0 up.
+    long size() const { return bits; }
+
+    void set(long i)
+    {
+        words[i / 64] |= 1UL << (i % 64);
+    }
+
+    void reset(long i)
+    {
+        words[i / 64] &= ~(1UL << (i % 64));
+    }
+
+    bool test(long i) const
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    // Add all or none of the integers.
+    void fill();
+    void clear();
+
+    // Set operations. unite() returns true if anything was added.
+    bool unite(const bit_set &);
+    void intersect(const bit_set &);
+    void subtract(const bit_set &);
+
+    bool operator==(const bit_set &) const;
+
+    // The smallest integer from i on that is in the set, or -1.
+    long next(long i) const;
+};
+
+
+/* A basic block: the indices of its first and last quads, the indices of
+   the blocks it may go to and come from, and whether it may leave the
+   graph. */
+struct basic_block
+{
+    long first;
+    long last;
+    vector<long> successors;
+    vector<long> predecessors;
+    bool exits;
+};
+
+
+class flow_graph
+{
+private:
+    quad_list *q;
+
+    // The block each quad is in.
+    vector<long> quad_block;
+
+    // Whether each block can be reached, ie, is in order.
+    vector<bool> reached;
+
+    // The temps that may carry a value from one block to another. They
+    // are only found once a dataflow problem asks for them.
+    unordered_set<sym_index> global_temps;
+    bool found_global_temps;
+
+    // Fill in order, by a depth first search from the first block.
+    void find_order();
+
+    void find_global_temps();
+
+public:
+    vector<basic_block> blocks;
+
+    // The blocks that can be reached from the first one, in reverse
+    // postorder.
+    vector<long> order;
+
+    flow_graph(quad_list *);
+
+    quad_list *get_quads() { return q; }
+
+    long block_of(long quad) { return quad_block[quad]; }
+
+    bool reachable(long block);
+
+    // Returns false for the temps that are only seen in one block, and
+    // assigned in it before they are read.
+    bool is_global_name(sym_index);
+
+    // Print each block with its quads, numbered as with -q, and the
+    // variables live into it and out of it.
+    void print(ostream &);
+};
+
+
+/* A dataflow problem. The constructor of a subclass numbers the facts and
+   fills in gen, kill and boundary for the graph, then calls solve(), which
+   fills in in and out. Which of them is the block's entry is given by the
+   direction, so in is at the end of a block for the backward problems. */
+class dataflow_problem
+{
+protected:
+    flow_graph *graph;
+
+    // The direction, and the join: intersection if a fact has to hold on
+    // all paths, union if on any.
+    bool forward;
+    bool all_paths;
+
+    // The number of facts.
+    long facts;
+
+    vector<bit_set> gen;
+    vector<bit_set> kill;
+
+    // What goes into the first block, or into the blocks that leave the
+    // graph for the backward problems.
+    bit_set boundary;
+
+    // For each fact, the outermost level of the variables it is about that
+    // aren't temps, or -1 if it is only about temps.
+    vector<block_level> fact_levels;
+
+    // The sets that calls to procedures at each level may touch.
+    map<block_level, bit_set> called_sets;
+
+    // Size gen, kill and boundary for the graph once facts is known.
+    void make_sets();
+
+    // The facts about the variables a call to a procedure or function may
+    // read or assign.
+    const bit_set &called(sym_index);
+
+    void solve();
+
+public:
+    // For each block, the facts where it is entered and where it is left,
+    // in the direction of the problem. Both are empty for the blocks that
+    // can't be reached.
+    vector<bit_set> in;
+    vector<bit_set> out;
+
+    dataflow_problem(flow_graph *, bool forward, bool all_paths);
+    virtual ~dataflow_problem() {}
+};
+
+
+/* The variables that may be read before they are assigned again, where a
+   block is entered (live_in) and left (live_out). At the end of the graph,
+   all variables that aren't temps are taken to be live. */
+class live_variables : public dataflow_problem
+{
+private:
+    unordered_map<sym_index, long> numbers;
+
+public:
+    // The symbol of each fact.
+    vector<sym_index> symbols;
+
+    live_variables(flow_graph *);
+
+    bit_set &live_in(long block) { return out[block]; }
+    bit_set &live_out(long block) { return in[block]; }
+
+    // Returns true if a symbol is live out of a block.
+    bool live_after(sym_index, long block);
+};
+
+
+/* The assignments that may reach each block, by the index of their quad. */
+class reaching_definitions : public dataflow_problem
+{
+public:
+    // The quad index of each fact.
+    vector<long> definitions;
+
+    reaching_definitions(flow_graph *);
+};
+
+
+/* The values of the quads computing an operation on their arguments, that
+   have been computed before on every path to each block, and not had an
+   argument changed since. The facts are the distinct op codes and
+   argument pairs, the results don't matter. */
+class available_expressions : public dataflow_problem
+{
+public:
+    // The first quad computing each fact.
+    vector<long> expressions;
+
+    available_expressions(flow_graph *);
+};
+
+
+#endif
@@ -0,0 +1,251 @@
+#include <iostream>
+#include "symtab.hh"
+#include "inliner.hh"
+
+/*** This file contains the inliner. See inliner.hh for an overview. ***/
+
+// Defined in main.cc.
+extern bool print_quads;
+
+quad_inliner *inliner = new quad_inliner();
+
+
+quad_inliner::quad_inliner()
+{
+    total_inlined = 0;
+}
+
+
+/* A block can be inlined if it calls nothing but trunc(), which is the
+   same wherever it is called from, doesn't index any of its own arrays,
+   which have no temp to stand in for them, and isn't too large. */
+bool quad_inliner::can_inline(quad_list *q, block_level level)
+{
+    int size = 0;
+
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        switch (quad.op_code) {
+        case q_call:
+            if (quad.sym1 != trunc_function) {
+                return false;
+            }
+            break;
+        case q_lindex:
+        case q_irindex:
+        case q_rrindex:
+            if (sym_tab->get_symbol(quad.sym1)->level == level) {
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+        // The counters of -P don't make a block any less worth inlining.
+        if (quad.op_code != q_labl && quad.op_code != q_profcall &&
+                quad.op_code != q_profloop && ++size > INLINE_LIMIT) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* Keep a copy of a block that has just been compiled if it can be inlined.
+   With -j, this may run in another thread than the parser's, so the bodies
+   are only touched under the lock. */
+void quad_inliner::keep_block(sym_index block, quad_list *q)
+{
+    symbol *sym = sym_tab->get_symbol(block);
+    block_level level = sym->level + 1;
+    if (!can_inline(q, level)) {
+        return;
+    }
+
+    parameter_symbol *param;
+    if (sym->tag == SYM_FUNC) {
+        param = sym->get_function_symbol()->last_parameter;
+    } else if (sym->tag == SYM_PROC) {
+        param = sym->get_procedure_symbol()->last_parameter;
+    } else {
+        return;
+    }
+
+    inline_body body;
+    body.level = level;
+    for (long i = 0; i < q->size(); i++) {
+        body.quads.push_back((*q)[i]);
+    }
+
+    // The parameters are linked last to first.
+    for (; param != NULL; param = param->preceding) {
+        body.params.insert(body.params.begin(), param->sym_p);
+    }
+
+    lock_guard<mutex> lock(bodies_mutex);
+    bodies[block] = body;
+}
+
+
+bool quad_inliner::has_kept(sym_index block)
+{
+    lock_guard<mutex> lock(bodies_mutex);
+    return bodies.find(block) != bodies.end();
+}
+
+
+/* The arguments are pushed last first, each right after it has been
+   computed, so the q_param quads of a call are found by going backwards
+   from it. The arguments may contain calls of their own, with their own
+   q_param quads before them, which are skipped. */
+bool quad_inliner::find_params(quad_list *q, long call, long nr_params,
+                               vector<long> &params)
+{
+    long skip = 0;
+
+    params.clear();
+    for (long i = call - 1; i >= 0 && (long) params.size() < nr_params; i--) {
+        quadruple &quad = (*q)[i];
+        if (quad.op_code == q_call) {
+            skip += quad.int2;
+        } else if (quad.op_code == q_param) {
+            if (skip > 0) {
+                skip--;
+            } else {
+                params.push_back(i);
+            }
+        }
+    }
+
+    return (long) params.size() == nr_params;
+}
+
+
+/* Make a copy of a body for one call. The q_param quads of the call are
+   turned into assignments to the new parameter temps in place, and the
+   copy of the body is added to the quads that replace the q_call. */
+void quad_inliner::expand(const inline_body &body, quad_list *q,
+                          const vector<long> &params, sym_index result,
+                          vector<quadruple> &copy)
+{
+    map<sym_index, sym_index> syms;
+    map<long, long> labels;
+
+    for (unsigned int k = 0; k < body.params.size(); k++) {
+        sym_index param = body.params[k];
+        sym_index type = sym_tab->get_symbol_type(param);
+        sym_index temp = sym_tab->gen_temp_var(type);
+        syms[param] = temp;
+        quadruple &push = (*q)[params[k]];
+        push = quadruple(type == real_type ? q_rassign : q_iassign,
+                         push.sym1, NULL_SYM, temp);
+    }
+
+    for (unsigned int i = 0; i < body.quads.size(); i++) {
+        quadruple quad = body.quads[i];
+
+        // New labels for the copy.
+        if (quad.op_code == q_labl || quad.ends_block()) {
+            map<long, long>::iterator l = labels.find(quad.int1);
+            if (l == labels.end()) {
+                l = labels.insert(make_pair(quad.int1,
+                                            sym_tab->get_next_label())).first;
+            }
+            quad.int1 = l->second;
+        }
+
+        // New temps for everything of the block itself. Constants declared
+        // in it are the same wherever they are used.
+        sym_index *slots[3];
+        int n = quad.use_slots(slots);
+        if (quad.defined_sym() != NULL_SYM) {
+            slots[n++] = &quad.sym3;
+        }
+        for (int k = 0; k < n; k++) {
+            if (*slots[k] == NULL_SYM) {
+                continue;
+            }
+            symbol *sym = sym_tab->get_symbol(*slots[k]);
+            if (sym->level != body.level ||
+                    (sym->tag != SYM_VAR && sym->tag != SYM_PARAM)) {
+                continue;
+            }
+            map<sym_index, sym_index>::iterator s = syms.find(*slots[k]);
+            if (s == syms.end()) {
+                s = syms.insert(make_pair(*slots[k],
+                                          sym_tab->gen_temp_var(sym->type))).first;
+            }
+            *slots[k] = s->second;
+        }
+
+        // A return becomes an assignment of the result and a jump to the
+        // end of the copy.
+        if (quad.op_code == q_ireturn || quad.op_code == q_rreturn) {
+            if (result != NULL_SYM) {
+                copy.push_back(quadruple(quad.op_code == q_rreturn ? q_rassign
+                                                                   : q_iassign,
+                                         quad.sym2, NULL_SYM, result));
+            }
+            quad = quadruple(q_jmp, quad.int1, NULL_SYM, NULL_SYM);
+        }
+
+        copy.push_back(quad);
+    }
+}
+
+
+/* The inliner's interface method. All calls to kept blocks are expanded in
+   one pass. A copy contains no calls but to trunc(), so there is nothing
+   more to do in it afterwards. */
+void quad_inliner::do_inline(quad_list *q)
+{
+    do_inline(q, NULL);
+}
+
+
+/* With -j, the blocks compiled after the caller may have been kept already,
+   so the calls that may be expanded are given. */
+void quad_inliner::do_inline(quad_list *q, const set<sym_index> *callees)
+{
+    map<long, vector<quadruple> > inserts;
+    long inlined = 0;
+
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &call = (*q)[i];
+        if (call.op_code != q_call ||
+                (callees != NULL && callees->count(call.sym1) == 0)) {
+            continue;
+        }
+        inline_body body;
+        {
+            lock_guard<mutex> lock(bodies_mutex);
+            map<sym_index, inline_body>::iterator b = bodies.find(call.sym1);
+            if (b == bodies.end()) {
+                continue;
+            }
+            body = b->second;
+        }
+        vector<long> params;
+        if ((long) body.params.size() != call.int2 ||
+                !find_params(q, i, call.int2, params)) {
+            continue;
+        }
+        expand(body, q, params, call.sym3, inserts[i]);
+        call = quadruple(q_nop, NULL_SYM, NULL_SYM, NULL_SYM);
+        inlined++;
+    }
+
+    if (inlined == 0) {
+        return;
+    }
+    q->insert_quads(inserts);
+    q->remove_nops();
+
+    lock_guard<mutex> lock(bodies_mutex);
+    total_inlined += inlined;
+    if (print_quads) {
+        cout << "\nInliner: " << inlined << " calls inlined ("
+             << total_inlined << " so far)" << endl;
+    }
+}
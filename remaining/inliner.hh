@@ -0,0 +1,96 @@
+#ifndef __INLINER_HH__
+#define __INLINER_HH__
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "quads.hh"
+
+
+/*** This class replaces calls to small procedures and functions with copies
+     of their bodies. A body is kept when its block has been compiled, if it
+     is a leaf, ie, calls nothing but trunc(), and has no local arrays and at
+     most INLINE_LIMIT quads. Since a block is always compiled before the
+     ones that can call it, every call to such a block can then be expanded
+     in its callers' quads. Recursive blocks always call something, so they
+     are never kept. A caller whose calls have all been expanded may become
+     a leaf in turn.
+
+     In a copy of a body, the parameters, local variables and temps of the
+     block become new temps of the caller, and its labels new labels. The
+     q_param quads of the call assign the arguments to the parameter temps,
+     and a return assigns its value to the temp the q_call result went to
+     and jumps to the end of the copy. Variables of enclosing blocks are
+     left as they are, since the caller is nested in the same blocks as the
+     callee, or is the block it was declared in. With -P, a copy keeps the
+     counters of the body, so the calls expanded are still counted, in the
+     callee's record, but their cycles aren't. ***/
+
+
+/* Size limit for the blocks that are inlined, in quads, not counting
+   labels or the counters of -P. This is about the size of min, max, abs or
+   a swap of two variables, and keeps the copies from making the callers
+   much larger. */
+const int INLINE_LIMIT = 24;
+
+
+class quad_inliner;
+
+// Defined in inliner.cc.
+extern quad_inliner *inliner;
+
+
+class quad_inliner
+{
+private:
+    // What is kept of a block that may be inlined.
+    struct inline_body
+    {
+        // The quads of the block, after quad optimization if -O is given.
+        vector<quadruple> quads;
+
+        // The block level of its parameters, variables and temps.
+        block_level level;
+
+        // The parameters, first to last.
+        vector<sym_index> params;
+    };
+
+    // The kept blocks, by procedure or function symbol.
+    map<sym_index, inline_body> bodies;
+
+    // Guards the bodies and total_inlined, with -j.
+    mutex bodies_mutex;
+
+    // Returns true if a block is worth inlining, and can be.
+    bool can_inline(quad_list *, block_level);
+
+    // Find the q_param quads of the call at the given index, first
+    // parameter first. Returns false if they aren't all there.
+    bool find_params(quad_list *, long, long, vector<long> &);
+
+    // Add a copy of a body to the quads to insert for a call.
+    void expand(const inline_body &, quad_list *, const vector<long> &,
+                sym_index result, vector<quadruple> &);
+
+public:
+    // Number of calls expanded, summed over all blocks.
+    long total_inlined;
+
+    quad_inliner();
+
+    // These are the interface to parser.y. Expand the calls in the quads of
+    // a block before they are optimized, and keep the block afterwards if
+    // it is small enough.
+    void do_inline(quad_list *);
+    void do_inline(quad_list *, const set<sym_index> *);
+    void keep_block(sym_index, quad_list *);
+
+    // Returns true if a block was kept.
+    bool has_kept(sym_index);
+};
+
+
+#endif
@@ -5,7 +5,11 @@
 #include <unistd.h>
 
 #include "ast.hh"
+#include "cache.hh"
+#include "codegen.hh"
 #include "parser.hh"
+#include "pipeline.hh"
+#include "stats.hh"
 
 using namespace std;
 
@@ -14,26 +18,60 @@ extern bool yydebug;
 bool assembler_trace = false;
 bool print_ast = false;
 bool print_quads = false;
+bool print_flow_graph = false;
 bool typecheck = true;
 bool optimize = true;
+bool optimize_quads = false;
+bool inline_calls = true;
+bool vectorize_loops = true;
+bool register_allocation = false;
+bool register_parameters = false;
+bool sse_floats = false;
+bool emit_statistics = false;
+bool direct_output = false;
+bool elf_output = false;
+bool profile = false;
+bool phase_statistics = false;
 bool quads = true;
 bool assembler = true;
+int worker_threads = 0;
+char *cache_directory = NULL;
+bool cache_statistics = false;
+
+// Defined in codegen.cc.
+extern code_generator *code_gen;
 
 void usage(char *program_name)
 {
     cerr << "Usage:\n"
-         << program_name << " [-acdfpqsty] inputfile\n"
+         << program_name << " [-acdEfklnOpPqrRsStTvwy] [-C dir] [-j threads]\n"
+         << "    inputfile\n"
          << program_name << " [-h?]\n"
          << "Options:\n"
          << "  -h, -?            Shows this message.\n"
          << "  -a                Print AST (abstract syntax tree).\n"
          << "  -c                Disable type checking.\n"
+         << "  -C dir            Cache the assembler code of the blocks in dir.\n"
          << "  -d                Turn on parser debugging.\n"
+         << "  -E                Write an ELF object file d.o, not d.out.\n"
          << "  -f                Don't optimize.\n"
+         << "  -g                Print flow graphs with live variables.\n"
+         << "  -j threads        Run the back end of the blocks in threads.\n"
+         << "  -k                Print block cache hits and misses.\n"
+         << "  -l                Don't vectorize loops when optimizing quads.\n"
+         << "  -n                Don't inline calls when optimizing quads.\n"
+         << "  -O                Optimize quads.\n"
          << "  -p                Don't generate quads.\n"
+         << "  -P                Count calls, cycles and loop rounds.\n"
          << "  -q                Print quad lists.\n"
+         << "  -r                Allocate registers.\n"
+         << "  -R                Pass the first parameters in registers.\n"
          << "  -s                Don't generate assembler code.\n"
+         << "  -S                Use SSE2 instead of the x87 FPU for reals.\n"
          << "  -t                Include trace printouts in assembler code.\n"
+         << "  -T                Print time and memory statistics as JSON.\n"
+         << "  -v                Print assembler output statistics.\n"
+         << "  -w                Write assembler output without stdio.\n"
          << "  -y                Print symbol table.\n";
     exit(1);
 }
@@ -41,11 +79,11 @@ void usage(char *program_name)
 
 int main(int argc, char **argv)
 {
-    char options[] = "acdfpqstyh?";
+    char options[] = "acC:dEfgj:klnOpPqrRsStTvwyh?";
     int option;
     bool print_symtab = false;
 
-    extern  FILE *yyin;
+    extern void scan_input(FILE *);
 
     opterr = 0;
     optopt = '?';
@@ -61,31 +99,94 @@ int main(int argc, char **argv)
             cout << "No type checking will be performed.\n" << flush;
             typecheck = false;
             break;
+        case 'C':
+            cout << "Assembler code will be cached in " << optarg << ".\n"
+                 << flush;
+            cache_directory = optarg;
+            break;
         case 'd':
             cout << "Bison debugging turned on.\n" << flush;
             yydebug = true;
             break;
+        case 'E':
+            cout << "An ELF object file will be written.\n" << flush;
+            elf_output = true;
+            break;
         case 'f':
             cout << "No optimization will be done.\n" << flush;
             optimize = false;
             break;
+        case 'g':
+            cout << "A flow graph will be printed for each block.\n"
+                 << flush;
+            print_flow_graph = true;
+            break;
+        case 'j':
+            worker_threads = atoi(optarg);
+            if (worker_threads < 0) {
+                usage(argv[0]);
+            }
+            cout << "The back end will run in " << worker_threads
+                 << " threads.\n" << flush;
+            break;
+        case 'k':
+            cache_statistics = true;
+            break;
+        case 'l':
+            cout << "No loops will be vectorized.\n" << flush;
+            vectorize_loops = false;
+            break;
+        case 'n':
+            cout << "No calls will be inlined.\n" << flush;
+            inline_calls = false;
+            break;
+        case 'O':
+            cout << "Quads will be optimized.\n" << flush;
+            optimize_quads = true;
+            break;
         case 'p':
             cout << "No quads will be generated.\n" << flush;
             quads = false;
             break;
+        case 'P':
+            cout << "Procedures will be profiled.\n" << flush;
+            profile = true;
+            break;
         case 'q':
             cout << "A quad list will be printed for each block.\n"
                  << flush;
             print_quads = true;
             break;
+        case 'r':
+            cout << "Registers will be allocated.\n" << flush;
+            register_allocation = true;
+            break;
+        case 'R':
+            cout << "Parameters will be passed in registers.\n" << flush;
+            register_parameters = true;
+            break;
         case 's':
             cout << "No assembler code will be generated.\n" << flush;
             assembler = false;
             break;
+        case 'S':
+            cout << "Reals will use SSE2.\n" << flush;
+            sse_floats = true;
+            break;
         case 't':
             cout << "Assembler code will contain quad labels.\n" << flush;
             assembler_trace = true;
             break;
+        case 'T':
+            phase_statistics = true;
+            break;
+        case 'v':
+            emit_statistics = true;
+            break;
+        case 'w':
+            cout << "Assembler output will bypass stdio.\n" << flush;
+            direct_output = true;
+            break;
         case 'y':
             cout << "Symbol table will be printed after compilation.\n";
             print_symtab = true;
@@ -99,22 +200,45 @@ int main(int argc, char **argv)
         }
     }
 
+    // The trace printouts are only of use in the assembler code.
+    if (elf_output && assembler_trace) {
+        cout << "No ELF object file will be written with -t.\n" << flush;
+        elf_output = false;
+    }
+
+    // The ELF writer doesn't know the section the counters are kept in.
+    if (elf_output && profile) {
+        cout << "No ELF object file will be written with -P.\n" << flush;
+        elf_output = false;
+    }
+
     if (optind > argc || optind < argc - 1) {
         usage(argv[0]);
     } else if (optind == argc) {
-        yyin = stdin;
+        scan_input(stdin);
     } else {
-        yyin = fopen(argv[optind], "r");
-        if (yyin == NULL) {
+        FILE *input = fopen(argv[optind], "r");
+        if (input == NULL) {
             perror(argv[optind]);
             exit(1);
         }
+        scan_input(input);
+        fclose(input);
     }
 
     // Start the compilation. This is where all the magic is done.
     // This function resides in parser.cc, which is generated by bison from
     // parser.y.
+    compile_stats->start();
     yyparse();
+    pipeline->finish();
+    if (error_count == 0) {
+        code_gen->finish("d.o");
+    }
+    if (cache_statistics) {
+        code_cache->print_statistics();
+    }
+    compile_stats->finish();
 
     // If given the appropriate flag, prints the symbol table after the input
     // has been parsed.
@@ -1,15 +1,20 @@
 #include "optimize.hh"
 
-/*** This file contains all code pertaining to AST optimisation. It currently
-     implements a simple optimisation called "constant folding". Most of the
-     methods in this file are empty, or just relay optimize calls downward
-     in the AST. If a more powerful AST optimization scheme were to be
-     implemented, only methods in this file should need to be changed. ***/
+/*** This file contains all code pertaining to AST optimisation: constant
+     folding, algebraic simplification and common subexpression elimination.
+     See optimize.hh for an overview. Most of the optimize methods just relay
+     optimize calls downward in the AST. ***/
 
 
 ast_optimizer *optimizer = new ast_optimizer();
 
 
+ast_optimizer::ast_optimizer()
+{
+    common_nr = 0;
+}
+
+
 /* The optimizer's interface method. Starts a recursive optimize call down
    the AST nodes, searching for binary operators with constant children. */
 void ast_optimizer::do_optimize(ast_stmt_list *body)
@@ -82,23 +87,20 @@ void ast_binaryrelation::optimize()
 /* Optimize a statement list. */
 void ast_stmt_list::optimize()
 {
-    if (preceding != NULL) {
-        preceding->optimize();
-    }
-    if (last_stmt != NULL) {
-        last_stmt->optimize();
+    optimizer->forget_expressions();
+    for (long i = 0; i < stmts.size(); i++) {
+        stmts[i]->optimize();
+        optimizer->eliminate_common(stmts[i]);
     }
+    optimizer->forget_expressions();
 }
 
 
 /* Optimize a list of expressions. */
 void ast_expr_list::optimize()
 {
-    if (preceding != NULL) {
-        preceding->optimize();
-    }
-    if (last_expr != NULL) {
-        last_expr = optimizer->fold_constants(last_expr);
+    for (long i = 0; i < exprs.size(); i++) {
+        exprs[i] = optimizer->fold_constants(exprs[i]);
     }
 }
 
@@ -106,11 +108,8 @@ void ast_expr_list::optimize()
 /* Optimize an elsif list. */
 void ast_elsif_list::optimize()
 {
-    if (preceding != NULL) {
-        preceding->optimize();
-    }
-    if (last_elsif != NULL) {
-        last_elsif->optimize();
+    for (long i = 0; i < elsifs.size(); i++) {
+        elsifs[i]->optimize();
     }
 }
 
@@ -151,13 +150,11 @@ ast_expression *ast_optimizer::fold_constants(ast_expression *node)
 {
     node->optimize();
     if(is_binop(node)){
+      // Its optimize() has folded the operands already.
       ast_binaryoperation *bin_op = node->get_ast_binaryoperation();
 
-      bin_op->left = fold_constants(bin_op->left);
-      bin_op->right = fold_constants(bin_op->right);
-
       if (!(is_const(bin_op->left) && is_const(bin_op->right)))
-        return node;
+        return simplify(bin_op);
 
       if(bin_op->left->type == integer_type && bin_op->right->type == integer_type){
         long left_value;
@@ -231,6 +228,388 @@ ast_expression *ast_optimizer::fold_constants(ast_expression *node)
   return node;
 }
 
+long ast_optimizer::int_value(ast_expression *node)
+{
+    if (node->tag == AST_ID) {
+        return sym_tab->get_symbol(node->get_ast_id()->sym_p)
+               ->get_constant_symbol()->const_value.ival;
+    }
+    return node->get_ast_integer()->value;
+}
+
+double ast_optimizer::real_value(ast_expression *node)
+{
+    if (node->tag == AST_ID) {
+        return sym_tab->get_symbol(node->get_ast_id()->sym_p)
+               ->get_constant_symbol()->const_value.rval;
+    }
+    return node->get_ast_real()->value;
+}
+
+bool ast_optimizer::is_int_value(ast_expression *node, long value)
+{
+    return is_const(node) && node->type == integer_type &&
+           int_value(node) == value;
+}
+
+bool ast_optimizer::is_real_value(ast_expression *node, double value)
+{
+    return is_const(node) && node->type == real_type &&
+           real_value(node) == value;
+}
+
+
+/* Algebraic simplification of a binary operation that couldn't be folded.
+   Only identities that hold for all values are used, and an operand is
+   only thrown away if it contains no call. For reals that leaves x * 1,
+   x / 1 and x - 0, since x + 0 and x * 0 differ from x and 0 for -0 and
+   NaN. Integer constants in sums and products are moved together, which
+   is fine since integer arithmetic wraps around anyway. */
+ast_expression *ast_optimizer::simplify(ast_binaryoperation *bin_op)
+{
+    if (bin_op->type == real_type) {
+        if ((bin_op->tag == AST_MULT || bin_op->tag == AST_DIVIDE) &&
+                is_real_value(bin_op->right, 1.0)) {
+            return bin_op->left;
+        }
+        if (bin_op->tag == AST_MULT && is_real_value(bin_op->left, 1.0)) {
+            return bin_op->right;
+        }
+        if (bin_op->tag == AST_SUB && is_real_value(bin_op->right, 0.0)) {
+            return bin_op->left;
+        }
+        return bin_op;
+    }
+    if (bin_op->type != integer_type) {
+        return bin_op;
+    }
+
+    // Constants go to the right of + and *, so that only that side needs
+    // to be looked at below.
+    if ((bin_op->tag == AST_ADD || bin_op->tag == AST_MULT) &&
+            is_const(bin_op->left) && !is_const(bin_op->right)) {
+        ast_expression *tmp = bin_op->left;
+        bin_op->left = bin_op->right;
+        bin_op->right = tmp;
+    }
+
+    ast_expression *left = bin_op->left;
+    ast_expression *right = bin_op->right;
+
+    switch (bin_op->tag) {
+    case AST_ADD:
+        if (is_int_value(right, 0)) {
+            return left;
+        }
+        break;
+    case AST_SUB:
+        if (is_int_value(right, 0)) {
+            return left;
+        }
+        if (value_number(left) != -1 &&
+                value_number(left) == value_number(right)) {
+            return new ast_integer(bin_op->pos, 0);
+        }
+        break;
+    case AST_MULT:
+        if (is_int_value(right, 1)) {
+            return left;
+        }
+        if (is_int_value(right, 0) && value_number(left) != -1) {
+            return new ast_integer(bin_op->pos, 0);
+        }
+        break;
+    case AST_IDIV:
+        if (is_int_value(right, 1)) {
+            return left;
+        }
+        break;
+    case AST_MOD:
+        if (is_int_value(right, 1) && value_number(left) != -1) {
+            return new ast_integer(bin_op->pos, 0);
+        }
+        break;
+    default:
+        return bin_op;
+    }
+
+    if (!is_const(right) || right->type != integer_type) {
+        return bin_op;
+    }
+
+    // (x + c1) + c2 and the like become x + c, or x - c if c < 0.
+    if ((bin_op->tag == AST_ADD || bin_op->tag == AST_SUB) &&
+            (left->tag == AST_ADD || left->tag == AST_SUB)) {
+        ast_binaryoperation *inner = left->get_ast_binaryoperation();
+        if (is_const(inner->right)) {
+            long c = (bin_op->tag == AST_ADD ? 1 : -1) * int_value(right) +
+                     (inner->tag == AST_ADD ? 1 : -1) * int_value(inner->right);
+            ast_binaryoperation *sum;
+            if (c >= 0) {
+                sum = new ast_add(bin_op->pos, inner->left,
+                                  new ast_integer(bin_op->pos, c));
+            } else {
+                sum = new ast_sub(bin_op->pos, inner->left,
+                                  new ast_integer(bin_op->pos, -c));
+            }
+            sum->type = integer_type;
+            return simplify(sum);
+        }
+    }
+
+    // (x * c1) * c2 becomes x * c.
+    if (bin_op->tag == AST_MULT && left->tag == AST_MULT) {
+        ast_binaryoperation *inner = left->get_ast_binaryoperation();
+        if (is_const(inner->right)) {
+            ast_binaryoperation *product =
+                new ast_mult(bin_op->pos, inner->left,
+                             new ast_integer(bin_op->pos,
+                                             int_value(inner->right) *
+                                             int_value(right)));
+            product->type = integer_type;
+            return simplify(product);
+        }
+    }
+
+    return bin_op;
+}
+
+
+
+/*** Common subexpression elimination. ***/
+
+/* The key of a node is its tag and the numbers of its operands, or the
+   constant or symbol at a leaf. A variable or array also gets its version,
+   so that it reads as a different value after it has been assigned to. A
+   reused expression has the number of its first occurrence. */
+long ast_optimizer::value_number(ast_expression *node)
+{
+    unordered_map<ast_expression *, long>::iterator n = numbered.find(node);
+    if (n != numbered.end()) {
+        return n->second;
+    }
+
+    string key = to_string(node->tag);
+    long number = 0;
+
+    switch (node->tag) {
+    case AST_INTEGER:
+        key += " " + to_string(node->get_ast_integer()->value);
+        break;
+    case AST_REAL:
+        key += " " + to_string(sym_tab->ieee(node->get_ast_real()->value));
+        break;
+    case AST_ID: {
+        sym_index sym = node->get_ast_id()->sym_p;
+        key += " " + to_string(sym) + " " + to_string(versions[sym]);
+        break;
+    }
+    case AST_FUNCTIONCALL:
+        number = -1;
+        break;
+    case AST_COMMON: {
+        ast_common *common = static_cast<ast_common *>(node);
+        if (common->first != NULL) {
+            common = common->first;
+        }
+        number = value_number(common->expr);
+        numbered[node] = number;
+        return number;
+    }
+    case AST_INDEXED: {
+        ast_indexed *indexed = static_cast<ast_indexed *>(node);
+        sym_index sym = indexed->id->sym_p;
+        number = value_number(indexed->index);
+        key += " " + to_string(sym) + " " + to_string(versions[sym]) + " " +
+               to_string(number);
+        break;
+    }
+    case AST_CAST:
+        number = value_number(static_cast<ast_cast *>(node)->expr);
+        key += " " + to_string(number);
+        break;
+    case AST_UMINUS:
+        number = value_number(static_cast<ast_uminus *>(node)->expr);
+        key += " " + to_string(number);
+        break;
+    case AST_NOT:
+        number = value_number(static_cast<ast_not *>(node)->expr);
+        key += " " + to_string(number);
+        break;
+    case AST_EQUAL:
+    case AST_NOTEQUAL:
+    case AST_LESSTHAN:
+    case AST_GREATERTHAN: {
+        ast_binaryrelation *rel = static_cast<ast_binaryrelation *>(node);
+        long left = value_number(rel->left);
+        long right = value_number(rel->right);
+        number = (left == -1 || right == -1) ? -1 : 0;
+        key += " " + to_string(left) + " " + to_string(right);
+        break;
+    }
+    default:
+        if (is_binop(node)) {
+            ast_binaryoperation *bin_op = node->get_ast_binaryoperation();
+            long left = value_number(bin_op->left);
+            long right = value_number(bin_op->right);
+            number = (left == -1 || right == -1) ? -1 : 0;
+            key += " " + to_string(left) + " " + to_string(right);
+        } else {
+            number = -1;
+        }
+        break;
+    }
+
+    // A call somewhere below means it can't be reused.
+    if (number != -1) {
+        map<string, long>::iterator v = value_numbers.find(key);
+        if (v == value_numbers.end()) {
+            v = value_numbers.insert(make_pair(key,
+                                               (long)value_numbers.size()))
+                .first;
+        }
+        number = v->second;
+    }
+    numbered[node] = number;
+    return number;
+}
+
+
+/* Walk an expression in the order its quads are generated. An expression
+   that is already available replaces the whole subtree. Otherwise its
+   subexpressions are looked at first, and then the expression itself is
+   made available. Leaves are never worth reusing. */
+void ast_optimizer::eliminate_common(ast_expression **slot)
+{
+    ast_expression *node = *slot;
+
+    switch (node->tag) {
+    case AST_ID:
+    case AST_INTEGER:
+    case AST_REAL:
+    case AST_COMMON:
+        return;
+    case AST_FUNCTIONCALL: {
+        ast_expr_list *params =
+            static_cast<ast_functioncall *>(node)->parameter_list;
+        if (params != NULL) {
+            // The parameters are computed last to first, see quads.cc.
+            for (long i = params->exprs.size() - 1; i >= 0; i--) {
+                eliminate_common(&params->exprs[i]);
+            }
+        }
+        // The function may change any variable.
+        forget_expressions();
+        return;
+    }
+    default:
+        break;
+    }
+
+    long number = value_number(node);
+
+    if (number != -1) {
+        map<long, available_expr>::iterator a = available.find(number);
+        if (a != available.end()) {
+            if (a->second.common == NULL) {
+                ast_expression *original = *a->second.slot;
+                a->second.common = new ast_common(original->pos, original,
+                                                  ++common_nr);
+                *a->second.slot = a->second.common;
+            }
+            *slot = new ast_common(node->pos, a->second.common);
+            return;
+        }
+    }
+
+    switch (node->tag) {
+    case AST_INDEXED:
+        eliminate_common(&static_cast<ast_indexed *>(node)->index);
+        break;
+    case AST_CAST:
+        eliminate_common(&static_cast<ast_cast *>(node)->expr);
+        break;
+    case AST_UMINUS:
+        eliminate_common(&static_cast<ast_uminus *>(node)->expr);
+        break;
+    case AST_NOT:
+        eliminate_common(&static_cast<ast_not *>(node)->expr);
+        break;
+    case AST_EQUAL:
+    case AST_NOTEQUAL:
+    case AST_LESSTHAN:
+    case AST_GREATERTHAN:
+        eliminate_common(&static_cast<ast_binaryrelation *>(node)->left);
+        eliminate_common(&static_cast<ast_binaryrelation *>(node)->right);
+        break;
+    default:
+        if (is_binop(node)) {
+            eliminate_common(&node->get_ast_binaryoperation()->left);
+            eliminate_common(&node->get_ast_binaryoperation()->right);
+        }
+        break;
+    }
+
+    // A call somewhere below means there's nothing to record.
+    if (number != -1) {
+        available_expr entry = { slot, NULL };
+        available[number] = entry;
+    }
+}
+
+
+void ast_optimizer::eliminate_common(ast_statement *stmt)
+{
+    switch (stmt->tag) {
+    case AST_ASSIGN: {
+        ast_assign *assign = static_cast<ast_assign *>(stmt);
+        eliminate_common(&assign->rhs);
+        if (assign->lhs->tag == AST_INDEXED) {
+            ast_indexed *indexed = static_cast<ast_indexed *>(assign->lhs);
+            eliminate_common(&indexed->index);
+            forget_symbol(indexed->id->sym_p);
+        } else {
+            forget_symbol(static_cast<ast_id *>(assign->lhs)->sym_p);
+        }
+        break;
+    }
+    case AST_PROCEDURECALL: {
+        ast_expr_list *params =
+            static_cast<ast_procedurecall *>(stmt)->parameter_list;
+        if (params != NULL) {
+            for (long i = params->exprs.size() - 1; i >= 0; i--) {
+                eliminate_common(&params->exprs[i]);
+            }
+        }
+        forget_expressions();
+        break;
+    }
+    default:
+        // Control flow ends the basic block.
+        forget_expressions();
+        break;
+    }
+}
+
+
+/* The expressions reading the symbol keep their numbers, which nothing
+   new will get again. */
+void ast_optimizer::forget_symbol(sym_index sym)
+{
+    versions[sym]++;
+}
+
+
+void ast_optimizer::forget_expressions()
+{
+    available.clear();
+    value_numbers.clear();
+    numbered.clear();
+    versions.clear();
+}
+
+
+
 /* All the binary operations should already have been detected in their parent
    nodes, so we don't need to do anything at all here. */
 void ast_add::optimize()
@@ -392,7 +771,14 @@ void ast_real::optimize()
 /* Note: See the comment in fold_constants() about casts and folding. */
 void ast_cast::optimize()
 {
-    /* Your code here */
+    expr = optimizer->fold_constants(expr);
+}
+
+
+/* Common subexpressions are made after everything below them has been
+   optimized already. */
+void ast_common::optimize()
+{
 }
 
 
@@ -1,15 +1,27 @@
 #ifndef __OPTIMIZE_HH__
 #define __OPTIMIZE_HH__
 
+#include <map>
+#include <string>
+#include <unordered_map>
+
 #include "ast.hh"
 
 
-/*** This class performs AST optimisation. Currently it only implements a
-     very simple optimisation known as constant folding, which means that it
-     tries to evaluate a binary operation node such as 2 + 5 during compiling,
-     replacing it with a single integer node with value 7, or an expression
-     only involving constants, such as (assuming FOO = 2) 4 + FOO, replacing
-     the + node with an integer node with the value 6. ***/
+/*** This class performs AST optimisation. The main part is constant
+     folding, which means that it tries to evaluate a binary operation node
+     such as 2 + 5 during compiling, replacing it with a single integer node
+     with value 7, or an expression only involving constants, such as
+     (assuming FOO = 2) 4 + FOO, replacing the + node with an integer node
+     with the value 6. On top of that:
+     - Algebraic identities such as x * 1, x + 0 and x - x are simplified,
+       and integer constants are re-associated, so that (x + 1) + 2 becomes
+       x + 3.
+     - Common subexpressions are eliminated within basic blocks, ie, runs
+       of assignments and procedure calls. An expression that is computed
+       again while none of the variables it reads have been assigned to,
+       and no call has been made, reuses the temp of the first computation.
+       See ast_common in ast.hh. ***/
 
 
 class ast_optimizer;
@@ -20,10 +32,64 @@ extern ast_optimizer *optimizer;
 
 class ast_optimizer
 {
-/* You might want to add your own methods to this header file when
-   solving the optimization lab. */
+private:
+    // An expression available for reuse: where its first occurrence is,
+    // and the node that wraps it once it has been reused.
+    struct available_expr
+    {
+        ast_expression **slot;
+        ast_common *common;
+    };
+
+    // The expressions available for reuse, by their value number.
+    map<long, available_expr> available;
+
+    // Value numbers. Two expressions get the same one exactly when they
+    // compute the same thing from the same values, and those containing a
+    // call get -1. A number is looked up by the node's tag and the numbers
+    // of its operands, so each node is only looked at once, and is kept
+    // for the node. The leaves that are variables or arrays are numbered
+    // by their symbol and its version, which an assignment moves on, so
+    // the expressions reading it get new numbers afterwards.
+    map<string, long> value_numbers;
+    unordered_map<ast_expression *, long> numbered;
+    unordered_map<sym_index, long> versions;
+
+    // Number of ast_common nodes made, for the AST printout.
+    int common_nr;
+
+    // Get the value of an integer or real constant expression.
+    long int_value(ast_expression *);
+    double real_value(ast_expression *);
+
+    // True if the argument is an integer or real constant with the value.
+    bool is_int_value(ast_expression *, long);
+    bool is_real_value(ast_expression *, double);
+
+    // Apply algebraic identities and re-association to a binary operation
+    // whose operands have been folded already.
+    ast_expression *simplify(ast_binaryoperation *);
+
+    // The value number of an expression.
+    long value_number(ast_expression *);
+
+    // Reuse or record the expression in a slot, and its subexpressions.
+    void eliminate_common(ast_expression **);
+
+    // Forget the expressions reading a symbol, once it has been assigned.
+    void forget_symbol(sym_index);
 
 public:
+    ast_optimizer();
+
+    // Forget all expressions available for reuse. Called at the start of
+    // each basic block.
+    void forget_expressions();
+
+    // Common subexpression elimination for a statement of a statement
+    // list. Anything else than an assignment or procedure call ends the
+    // basic block.
+    void eliminate_common(ast_statement *);
 
     // This is the interface to parser.y. Sending in a function body as
     // arguments performs (destructive) optimization on it.
@@ -1,8 +1,9 @@
-/* A Bison parser, made by GNU Bison 3.0.2.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2013 Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
    This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
@@ -15,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -33,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -40,11 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "3.0.2"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -61,13 +66,19 @@
 
 
 
-/* Copy the first part of user declarations.  */
-#line 1 "parser.y" /* yacc.c:339  */
+/* First part of user prologue.  */
+#line 1 "parser.y"
 
 #include <iostream>
 #include "semantic.hh"
 #include "optimize.hh"
+#include "quadopt.hh"
+#include "flowgraph.hh"
+#include "inliner.hh"
 #include "codegen.hh"
+#include "pipeline.hh"
+#include "cache.hh"
+#include "stats.hh"
 
 /* Defined in parser.cc */
 extern char *yytext;
@@ -95,8 +106,11 @@ extern void yyerror(string);
    given to the 'diesel' script. */
 extern bool print_ast;
 extern bool print_quads;
+extern bool print_flow_graph;
 extern bool typecheck;
 extern bool optimize;
+extern bool optimize_quads;
+extern bool inline_calls;
 extern bool quads;
 extern bool assembler;
 
@@ -107,172 +121,217 @@ extern bool assembler;
    wish. Not mandatory. */
 /* #define YYERROR_VERBOSE */
 
-#line 111 "parser.cc" /* yacc.c:339  */
+#line 125 "parser.cc"
 
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
 # ifndef YY_NULLPTR
-#  if defined __cplusplus && 201103L <= __cplusplus
-#   define YY_NULLPTR nullptr
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
 #  else
-#   define YY_NULLPTR 0
+#   define YY_NULLPTR ((void*)0)
 #  endif
 # endif
 
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 0
-#endif
-
-/* In a future release of Bison, this section will be replaced
-   by #include "parser.hh".  */
-#ifndef YY_YY_PARSER_HH_INCLUDED
-# define YY_YY_PARSER_HH_INCLUDED
-/* Debug traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 0
-#endif
-#if YYDEBUG
-extern int yydebug;
-#endif
-
-/* Token type.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-  enum yytokentype
-  {
-    T_EOF = 258,
-    T_ERROR = 259,
-    T_DOT = 260,
-    T_SEMICOLON = 261,
-    T_EQ = 262,
-    T_COLON = 263,
-    T_LEFTBRACKET = 264,
-    T_RIGHTBRACKET = 265,
-    T_LEFTPAR = 266,
-    T_RIGHTPAR = 267,
-    T_COMMA = 268,
-    T_LESSTHAN = 269,
-    T_GREATERTHAN = 270,
-    T_ADD = 271,
-    T_SUB = 272,
-    T_MUL = 273,
-    T_RDIV = 274,
-    T_OF = 275,
-    T_IF = 276,
-    T_DO = 277,
-    T_ASSIGN = 278,
-    T_NOTEQ = 279,
-    T_OR = 280,
-    T_VAR = 281,
-    T_END = 282,
-    T_AND = 283,
-    T_IDIV = 284,
-    T_MOD = 285,
-    T_NOT = 286,
-    T_THEN = 287,
-    T_ELSE = 288,
-    T_CONST = 289,
-    T_ARRAY = 290,
-    T_BEGIN = 291,
-    T_WHILE = 292,
-    T_ELSIF = 293,
-    T_RETURN = 294,
-    T_STRINGCONST = 295,
-    T_IDENT = 296,
-    T_PROGRAM = 297,
-    T_PROCEDURE = 298,
-    T_FUNCTION = 299,
-    T_INTNUM = 300,
-    T_REALNUM = 301
-  };
-#endif
-
-/* Value type.  */
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE YYSTYPE;
-union YYSTYPE
-{
-#line 54 "parser.y" /* yacc.c:355  */
-
-    ast_node             *ast;
-    ast_id               *id;
-    ast_stmt_list        *statement_list;
-    ast_statement        *statement;
-    ast_expr_list        *expression_list;
-    ast_expression       *expression;
-    ast_elsif_list       *elsif_list;
-    ast_elsif            *elsif;
-    ast_lvalue           *lvalue;
-    ast_functioncall     *function_call;
-    ast_functionhead     *function_head;
-    ast_procedurehead    *procedure_head;
-    ast_integer          *integer;
-    ast_real             *real;
-
-    long                  ival;
-    double                rval;
-    pool_index            str;
-    pool_index            pool_p;
-
-#line 220 "parser.cc" /* yacc.c:355  */
-};
-# define YYSTYPE_IS_TRIVIAL 1
-# define YYSTYPE_IS_DECLARED 1
-#endif
-
-/* Location type.  */
-#if ! defined YYLTYPE && ! defined YYLTYPE_IS_DECLARED
-typedef struct YYLTYPE YYLTYPE;
-struct YYLTYPE
+#include "parser.hh"
+/* Symbol kind.  */
+enum yysymbol_kind_t
 {
-  int first_line;
-  int first_column;
-  int last_line;
-  int last_column;
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_T_EOF = 3,                      /* T_EOF  */
+  YYSYMBOL_T_ERROR = 4,                    /* T_ERROR  */
+  YYSYMBOL_T_DOT = 5,                      /* T_DOT  */
+  YYSYMBOL_T_SEMICOLON = 6,                /* T_SEMICOLON  */
+  YYSYMBOL_T_EQ = 7,                       /* T_EQ  */
+  YYSYMBOL_T_COLON = 8,                    /* T_COLON  */
+  YYSYMBOL_T_LEFTBRACKET = 9,              /* T_LEFTBRACKET  */
+  YYSYMBOL_T_RIGHTBRACKET = 10,            /* T_RIGHTBRACKET  */
+  YYSYMBOL_T_LEFTPAR = 11,                 /* T_LEFTPAR  */
+  YYSYMBOL_T_RIGHTPAR = 12,                /* T_RIGHTPAR  */
+  YYSYMBOL_T_COMMA = 13,                   /* T_COMMA  */
+  YYSYMBOL_T_LESSTHAN = 14,                /* T_LESSTHAN  */
+  YYSYMBOL_T_GREATERTHAN = 15,             /* T_GREATERTHAN  */
+  YYSYMBOL_T_ADD = 16,                     /* T_ADD  */
+  YYSYMBOL_T_SUB = 17,                     /* T_SUB  */
+  YYSYMBOL_T_MUL = 18,                     /* T_MUL  */
+  YYSYMBOL_T_RDIV = 19,                    /* T_RDIV  */
+  YYSYMBOL_T_OF = 20,                      /* T_OF  */
+  YYSYMBOL_T_IF = 21,                      /* T_IF  */
+  YYSYMBOL_T_DO = 22,                      /* T_DO  */
+  YYSYMBOL_T_ASSIGN = 23,                  /* T_ASSIGN  */
+  YYSYMBOL_T_NOTEQ = 24,                   /* T_NOTEQ  */
+  YYSYMBOL_T_OR = 25,                      /* T_OR  */
+  YYSYMBOL_T_VAR = 26,                     /* T_VAR  */
+  YYSYMBOL_T_END = 27,                     /* T_END  */
+  YYSYMBOL_T_AND = 28,                     /* T_AND  */
+  YYSYMBOL_T_IDIV = 29,                    /* T_IDIV  */
+  YYSYMBOL_T_MOD = 30,                     /* T_MOD  */
+  YYSYMBOL_T_NOT = 31,                     /* T_NOT  */
+  YYSYMBOL_T_THEN = 32,                    /* T_THEN  */
+  YYSYMBOL_T_ELSE = 33,                    /* T_ELSE  */
+  YYSYMBOL_T_CONST = 34,                   /* T_CONST  */
+  YYSYMBOL_T_ARRAY = 35,                   /* T_ARRAY  */
+  YYSYMBOL_T_BEGIN = 36,                   /* T_BEGIN  */
+  YYSYMBOL_T_WHILE = 37,                   /* T_WHILE  */
+  YYSYMBOL_T_ELSIF = 38,                   /* T_ELSIF  */
+  YYSYMBOL_T_RETURN = 39,                  /* T_RETURN  */
+  YYSYMBOL_T_STRINGCONST = 40,             /* T_STRINGCONST  */
+  YYSYMBOL_T_IDENT = 41,                   /* T_IDENT  */
+  YYSYMBOL_T_PROGRAM = 42,                 /* T_PROGRAM  */
+  YYSYMBOL_T_PROCEDURE = 43,               /* T_PROCEDURE  */
+  YYSYMBOL_T_FUNCTION = 44,                /* T_FUNCTION  */
+  YYSYMBOL_T_INTNUM = 45,                  /* T_INTNUM  */
+  YYSYMBOL_T_REALNUM = 46,                 /* T_REALNUM  */
+  YYSYMBOL_YYACCEPT = 47,                  /* $accept  */
+  YYSYMBOL_program = 48,                   /* program  */
+  YYSYMBOL_prog_decl = 49,                 /* prog_decl  */
+  YYSYMBOL_prog_head = 50,                 /* prog_head  */
+  YYSYMBOL_const_part = 51,                /* const_part  */
+  YYSYMBOL_const_decls = 52,               /* const_decls  */
+  YYSYMBOL_const_decl = 53,                /* const_decl  */
+  YYSYMBOL_variable_part = 54,             /* variable_part  */
+  YYSYMBOL_var_decls = 55,                 /* var_decls  */
+  YYSYMBOL_var_decl = 56,                  /* var_decl  */
+  YYSYMBOL_subprog_part = 57,              /* subprog_part  */
+  YYSYMBOL_subprog_decls = 58,             /* subprog_decls  */
+  YYSYMBOL_subprog_decl = 59,              /* subprog_decl  */
+  YYSYMBOL_proc_decl = 60,                 /* proc_decl  */
+  YYSYMBOL_func_decl = 61,                 /* func_decl  */
+  YYSYMBOL_proc_head = 62,                 /* proc_head  */
+  YYSYMBOL_func_head = 63,                 /* func_head  */
+  YYSYMBOL_opt_param_list = 64,            /* opt_param_list  */
+  YYSYMBOL_param_list = 65,                /* param_list  */
+  YYSYMBOL_param = 66,                     /* param  */
+  YYSYMBOL_comp_stmt = 67,                 /* comp_stmt  */
+  YYSYMBOL_stmt_list = 68,                 /* stmt_list  */
+  YYSYMBOL_stmt = 69,                      /* stmt  */
+  YYSYMBOL_lvariable = 70,                 /* lvariable  */
+  YYSYMBOL_rvariable = 71,                 /* rvariable  */
+  YYSYMBOL_elsif_list = 72,                /* elsif_list  */
+  YYSYMBOL_elsif = 73,                     /* elsif  */
+  YYSYMBOL_else_part = 74,                 /* else_part  */
+  YYSYMBOL_opt_expr_list = 75,             /* opt_expr_list  */
+  YYSYMBOL_expr_list = 76,                 /* expr_list  */
+  YYSYMBOL_expr = 77,                      /* expr  */
+  YYSYMBOL_simple_expr = 78,               /* simple_expr  */
+  YYSYMBOL_term = 79,                      /* term  */
+  YYSYMBOL_factor = 80,                    /* factor  */
+  YYSYMBOL_func_call = 81,                 /* func_call  */
+  YYSYMBOL_integer = 82,                   /* integer  */
+  YYSYMBOL_real = 83,                      /* real  */
+  YYSYMBOL_type_id = 84,                   /* type_id  */
+  YYSYMBOL_const_id = 85,                  /* const_id  */
+  YYSYMBOL_lvar_id = 86,                   /* lvar_id  */
+  YYSYMBOL_rvar_id = 87,                   /* rvar_id  */
+  YYSYMBOL_proc_id = 88,                   /* proc_id  */
+  YYSYMBOL_func_id = 89,                   /* func_id  */
+  YYSYMBOL_array_id = 90,                  /* array_id  */
+  YYSYMBOL_id = 91                         /* id  */
 };
-# define YYLTYPE_IS_DECLARED 1
-# define YYLTYPE_IS_TRIVIAL 1
-#endif
-
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-extern YYSTYPE yylval;
-extern YYLTYPE yylloc;
-int yyparse (void);
 
-#endif /* !YY_YY_PARSER_HH_INCLUDED  */
 
-/* Copy the second part of user declarations.  */
-
-#line 249 "parser.cc" /* yacc.c:358  */
 
 #ifdef short
 # undef short
 #endif
 
-#ifdef YYTYPE_UINT8
-typedef YYTYPE_UINT8 yytype_uint8;
-#else
-typedef unsigned char yytype_uint8;
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
 #endif
 
-#ifdef YYTYPE_INT8
-typedef YYTYPE_INT8 yytype_int8;
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
 #else
 typedef signed char yytype_int8;
 #endif
 
-#ifdef YYTYPE_UINT16
-typedef YYTYPE_UINT16 yytype_uint16;
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
+#else
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
 #else
-typedef unsigned short int yytype_uint16;
+typedef short yytype_uint8;
 #endif
 
-#ifdef YYTYPE_INT16
-typedef YYTYPE_INT16 yytype_int16;
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
 #else
-typedef short int yytype_int16;
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
 #endif
 
 #ifndef YYSIZE_T
@@ -280,15 +339,28 @@ typedef short int yytype_int16;
 #  define YYSIZE_T __SIZE_TYPE__
 # elif defined size_t
 #  define YYSIZE_T size_t
-# elif ! defined YYSIZE_T
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
 #  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
 #  define YYSIZE_T size_t
 # else
-#  define YYSIZE_T unsigned int
+#  define YYSIZE_T unsigned
 # endif
 #endif
 
-#define YYSIZE_MAXIMUM ((YYSIZE_T) -1)
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
 
 #ifndef YY_
 # if defined YYENABLE_NLS && YYENABLE_NLS
@@ -302,47 +374,43 @@ typedef short int yytype_int16;
 # endif
 #endif
 
-#ifndef YY_ATTRIBUTE
-# if (defined __GNUC__                                               \
-      && (2 < __GNUC__ || (__GNUC__ == 2 && 96 <= __GNUC_MINOR__)))  \
-     || defined __SUNPRO_C && 0x5110 <= __SUNPRO_C
-#  define YY_ATTRIBUTE(Spec) __attribute__(Spec)
-# else
-#  define YY_ATTRIBUTE(Spec) /* empty */
-# endif
-#endif
 
 #ifndef YY_ATTRIBUTE_PURE
-# define YY_ATTRIBUTE_PURE   YY_ATTRIBUTE ((__pure__))
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
 #endif
 
 #ifndef YY_ATTRIBUTE_UNUSED
-# define YY_ATTRIBUTE_UNUSED YY_ATTRIBUTE ((__unused__))
-#endif
-
-#if !defined _Noreturn \
-     && (!defined __STDC_VERSION__ || __STDC_VERSION__ < 201112)
-# if defined _MSC_VER && 1200 <= _MSC_VER
-#  define _Noreturn __declspec (noreturn)
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
 # else
-#  define _Noreturn YY_ATTRIBUTE ((__noreturn__))
+#  define YY_ATTRIBUTE_UNUSED
 # endif
 #endif
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(E) ((void) (E))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(E) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-#if defined __GNUC__ && 407 <= __GNUC__ * 100 + __GNUC_MINOR__
 /* Suppress an incorrect diagnostic about yylval being uninitialized.  */
-# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN \
-    _Pragma ("GCC diagnostic push") \
-    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")\
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
     _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
-# define YY_IGNORE_MAYBE_UNINITIALIZED_END \
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
     _Pragma ("GCC diagnostic pop")
 #else
 # define YY_INITIAL_VALUE(Value) Value
@@ -355,8 +423,22 @@ typedef short int yytype_int16;
 # define YY_INITIAL_VALUE(Value) /* Nothing. */
 #endif
 
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -421,8 +503,7 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* !defined yyoverflow */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
@@ -432,18 +513,19 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
-  yytype_int16 yyss_alloc;
+  yy_state_t yyss_alloc;
   YYSTYPE yyvs_alloc;
   YYLTYPE yyls_alloc;
 };
 
 /* The size of the maximum gap between one aligned stack and the next.  */
-# define YYSTACK_GAP_MAXIMUM (sizeof (union yyalloc) - 1)
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
 
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (sizeof (yytype_int16) + sizeof (YYSTYPE) + sizeof (YYLTYPE)) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE) \
+             + YYSIZEOF (YYLTYPE)) \
       + 2 * YYSTACK_GAP_MAXIMUM)
 
 # define YYCOPY_NEEDED 1
@@ -456,11 +538,11 @@ union yyalloc
 # define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
     do                                                                  \
       {                                                                 \
-        YYSIZE_T yynewbytes;                                            \
+        YYPTRDIFF_T yynewbytes;                                         \
         YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
         Stack = &yyptr->Stack_alloc;                                    \
-        yynewbytes = yystacksize * sizeof (*Stack) + YYSTACK_GAP_MAXIMUM; \
-        yyptr += yynewbytes / sizeof (*yyptr);                          \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
       }                                                                 \
     while (0)
 
@@ -472,12 +554,12 @@ union yyalloc
 # ifndef YYCOPY
 #  if defined __GNUC__ && 1 < __GNUC__
 #   define YYCOPY(Dst, Src, Count) \
-      __builtin_memcpy (Dst, Src, (Count) * sizeof (*(Src)))
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
 #  else
 #   define YYCOPY(Dst, Src, Count)              \
       do                                        \
         {                                       \
-          YYSIZE_T yyi;                         \
+          YYPTRDIFF_T yyi;                      \
           for (yyi = 0; yyi < (Count); yyi++)   \
             (Dst)[yyi] = (Src)[yyi];            \
         }                                       \
@@ -500,17 +582,20 @@ union yyalloc
 /* YYNSTATES -- Number of states.  */
 #define YYNSTATES  215
 
-/* YYTRANSLATE[YYX] -- Symbol number corresponding to YYX as returned
-   by yylex, with out-of-bounds checking.  */
-#define YYUNDEFTOK  2
+/* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   301
 
-#define YYTRANSLATE(YYX)                                                \
-  ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
+
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
 
 /* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
-   as returned by yylex, without out-of-bounds checking.  */
-static const yytype_uint8 yytranslate[] =
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
 {
        0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -546,72 +631,73 @@ static const yytype_uint8 yytranslate[] =
 };
 
 #if YYDEBUG
-  /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
-static const yytype_uint16 yyrline[] =
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
 {
-       0,   124,   124,   173,   180,   189,   190,   191,   195,   196,
-     200,   205,   210,   214,   239,   240,   244,   245,   249,   254,
-     259,   311,   312,   316,   317,   321,   369,   420,   427,   435,
-     455,   477,   481,   486,   492,   497,   503,   521,   528,   535,
-     543,   552,   557,   562,   567,   572,   577,   582,   587,   592,
-     597,   602,   607,   612,   617,   622,   629,   634,   638,   644,
-     651,   655,   659,   667,   673,   679,   687,   692,   698,   703,
-     709,   714,   722,   726,   731,   736,   741,   749,   753,   757,
-     762,   767,   772,   780,   784,   789,   794,   799,   804,   812,
-     816,   820,   824,   828,   833,   840,   848,   861,   874,   889,
-     903,   916,   933,   947,   961,   975
+       0,   133,   133,   215,   222,   232,   233,   234,   238,   239,
+     243,   248,   253,   257,   282,   283,   287,   288,   292,   297,
+     302,   354,   355,   359,   360,   364,   453,   545,   552,   560,
+     581,   604,   608,   613,   619,   624,   630,   648,   655,   662,
+     674,   683,   688,   693,   698,   703,   708,   713,   718,   723,
+     728,   733,   738,   743,   748,   753,   760,   765,   769,   775,
+     782,   786,   790,   798,   809,   815,   823,   828,   834,   839,
+     845,   850,   858,   862,   867,   872,   877,   885,   889,   893,
+     898,   903,   908,   916,   920,   925,   930,   935,   940,   948,
+     952,   956,   960,   964,   969,   976,   984,   997,  1010,  1025,
+    1039,  1052,  1069,  1083,  1097,  1111
 };
 #endif
 
-#if YYDEBUG || YYERROR_VERBOSE || 0
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "T_EOF", "T_ERROR", "T_DOT",
-  "T_SEMICOLON", "T_EQ", "T_COLON", "T_LEFTBRACKET", "T_RIGHTBRACKET",
-  "T_LEFTPAR", "T_RIGHTPAR", "T_COMMA", "T_LESSTHAN", "T_GREATERTHAN",
-  "T_ADD", "T_SUB", "T_MUL", "T_RDIV", "T_OF", "T_IF", "T_DO", "T_ASSIGN",
-  "T_NOTEQ", "T_OR", "T_VAR", "T_END", "T_AND", "T_IDIV", "T_MOD", "T_NOT",
-  "T_THEN", "T_ELSE", "T_CONST", "T_ARRAY", "T_BEGIN", "T_WHILE",
-  "T_ELSIF", "T_RETURN", "T_STRINGCONST", "T_IDENT", "T_PROGRAM",
-  "T_PROCEDURE", "T_FUNCTION", "T_INTNUM", "T_REALNUM", "$accept",
-  "program", "prog_decl", "prog_head", "const_part", "const_decls",
-  "const_decl", "variable_part", "var_decls", "var_decl", "subprog_part",
-  "subprog_decls", "subprog_decl", "proc_decl", "func_decl", "proc_head",
-  "func_head", "opt_param_list", "param_list", "param", "comp_stmt",
-  "stmt_list", "stmt", "lvariable", "rvariable", "elsif_list", "elsif",
-  "else_part", "opt_expr_list", "expr_list", "expr", "simple_expr", "term",
-  "factor", "func_call", "integer", "real", "type_id", "const_id",
-  "lvar_id", "rvar_id", "proc_id", "func_id", "array_id", "id", YY_NULLPTR
+  "\"end of file\"", "error", "\"invalid token\"", "T_EOF", "T_ERROR",
+  "T_DOT", "T_SEMICOLON", "T_EQ", "T_COLON", "T_LEFTBRACKET",
+  "T_RIGHTBRACKET", "T_LEFTPAR", "T_RIGHTPAR", "T_COMMA", "T_LESSTHAN",
+  "T_GREATERTHAN", "T_ADD", "T_SUB", "T_MUL", "T_RDIV", "T_OF", "T_IF",
+  "T_DO", "T_ASSIGN", "T_NOTEQ", "T_OR", "T_VAR", "T_END", "T_AND",
+  "T_IDIV", "T_MOD", "T_NOT", "T_THEN", "T_ELSE", "T_CONST", "T_ARRAY",
+  "T_BEGIN", "T_WHILE", "T_ELSIF", "T_RETURN", "T_STRINGCONST", "T_IDENT",
+  "T_PROGRAM", "T_PROCEDURE", "T_FUNCTION", "T_INTNUM", "T_REALNUM",
+  "$accept", "program", "prog_decl", "prog_head", "const_part",
+  "const_decls", "const_decl", "variable_part", "var_decls", "var_decl",
+  "subprog_part", "subprog_decls", "subprog_decl", "proc_decl",
+  "func_decl", "proc_head", "func_head", "opt_param_list", "param_list",
+  "param", "comp_stmt", "stmt_list", "stmt", "lvariable", "rvariable",
+  "elsif_list", "elsif", "else_part", "opt_expr_list", "expr_list", "expr",
+  "simple_expr", "term", "factor", "func_call", "integer", "real",
+  "type_id", "const_id", "lvar_id", "rvar_id", "proc_id", "func_id",
+  "array_id", "id", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[NUM] -- (External) token number corresponding to the
-   (internal) symbol number NUM (which must be that of a token).  */
-static const yytype_uint16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279,   280,   281,   282,   283,   284,
-     285,   286,   287,   288,   289,   290,   291,   292,   293,   294,
-     295,   296,   297,   298,   299,   300,   301
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
 
-#define YYPACT_NINF -100
+#define YYPACT_NINF (-100)
 
-#define yypact_value_is_default(Yystate) \
-  (!!((Yystate) == (-100)))
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
 
-#define YYTABLE_NINF -105
+#define YYTABLE_NINF (-105)
 
-#define yytable_value_is_error(Yytable_value) \
+#define yytable_value_is_error(Yyn) \
   0
 
-  /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
-     STATE-NUM.  */
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
 static const yytype_int16 yypact[] =
 {
      -21,    -8,    14,   -14,    40,  -100,  -100,    46,    56,    64,
@@ -638,10 +724,10 @@ static const yytype_int16 yypact[] =
      264,   318,   321,  -100,  -100
 };
 
-  /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
-     Performed when YYTABLE does not specify something else to do.  Zero
-     means the default is an error.  */
-static const yytype_uint8 yydefact[] =
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
 {
        0,     0,     0,    22,     0,     4,     1,     0,     0,     0,
       21,    23,    22,    22,    33,    33,     0,    29,    30,     0,
@@ -667,7 +753,7 @@ static const yytype_uint8 yydefact[] =
       65,     0,     0,    19,    20
 };
 
-  /* YYPGOTO[NTERM-NUM].  */
+/* YYPGOTO[NTERM-NUM].  */
 static const yytype_int16 yypgoto[] =
 {
     -100,  -100,  -100,  -100,   -37,   297,   203,   -84,  -100,   230,
@@ -677,19 +763,19 @@ static const yytype_int16 yypgoto[] =
     -100,  -100,  -100,   -16,   -19
 };
 
-  /* YYDEFGOTO[NTERM-NUM].  */
-static const yytype_int16 yydefgoto[] =
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_uint8 yydefgoto[] =
 {
-      -1,     2,     3,     4,    29,    52,    53,    56,    98,    99,
+       0,     2,     3,     4,    29,    52,    53,    56,    98,    99,
        9,    10,    11,    12,    13,    14,    15,    25,    47,    48,
       20,    35,    36,    37,    65,   180,   196,   197,   127,   128,
      129,    67,    68,    69,    70,    71,    72,    93,   139,    38,
       73,    39,    74,    75,    76
 };
 
-  /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
-     positive, shift that token.  If negative, reduce the rule whose
-     number is the opposite.  If YYTABLE_NINF, syntax error.  */
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int16 yytable[] =
 {
       41,   132,   144,    40,    66,    78,    80,    45,   134,    27,
@@ -768,9 +854,9 @@ static const yytype_int16 yycheck[] =
      192,    -1,    -1,    24
 };
 
-  /* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-     symbol of state STATE-NUM.  */
-static const yytype_uint8 yystos[] =
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
 {
        0,    42,    48,    49,    50,    41,     0,    43,    44,    57,
       58,    59,    60,    61,    62,    63,     6,    41,    41,    36,
@@ -796,8 +882,8 @@ static const yytype_uint8 yystos[] =
       68,    84,    84,     6,     6
 };
 
-  /* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_uint8 yyr1[] =
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
 {
        0,    47,    48,    49,    50,    51,    51,    51,    52,    52,
       53,    53,    53,    53,    54,    54,    55,    55,    56,    56,
@@ -812,8 +898,8 @@ static const yytype_uint8 yyr1[] =
       86,    87,    88,    89,    90,    91
 };
 
-  /* YYR2[YYN] -- Number of symbols on the right hand side of rule YYN.  */
-static const yytype_uint8 yyr2[] =
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
 {
        0,     2,     4,     4,     2,     2,     2,     0,     1,     2,
        4,     4,     4,     4,     2,     0,     1,     2,     4,     9,
@@ -829,39 +915,39 @@ static const yytype_uint8 yyr2[] =
 };
 
 
+enum { YYENOMEM = -2 };
+
 #define yyerrok         (yyerrstatus = 0)
 #define yyclearin       (yychar = YYEMPTY)
-#define YYEMPTY         (-2)
-#define YYEOF           0
 
 #define YYACCEPT        goto yyacceptlab
 #define YYABORT         goto yyabortlab
 #define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
 
 #define YYRECOVERING()  (!!yyerrstatus)
 
-#define YYBACKUP(Token, Value)                                  \
-do                                                              \
-  if (yychar == YYEMPTY)                                        \
-    {                                                           \
-      yychar = (Token);                                         \
-      yylval = (Value);                                         \
-      YYPOPSTACK (yylen);                                       \
-      yystate = *yyssp;                                         \
-      goto yybackup;                                            \
-    }                                                           \
-  else                                                          \
-    {                                                           \
-      yyerror (YY_("syntax error: cannot back up")); \
-      YYERROR;                                                  \
-    }                                                           \
-while (0)
-
-/* Error token number */
-#define YYTERROR        1
-#define YYERRCODE       256
-
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
 /* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
    If N is 0, then set CURRENT to the empty location which ends
@@ -905,20 +991,27 @@ do {                                            \
 } while (0)
 
 
-/* YY_LOCATION_PRINT -- Print the location on the stream.
+/* YYLOCATION_PRINT -- Print the location on the stream.
    This macro was not mandated originally: define only if we know
    we won't break user code: when these are the locations we know.  */
 
-#ifndef YY_LOCATION_PRINT
-# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+# ifndef YYLOCATION_PRINT
+
+#  if defined YY_LOCATION_PRINT
+
+   /* Temporary convenience wrapper in case some people defined the
+      undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YYLOCATION_PRINT(File, Loc)  YY_LOCATION_PRINT(File, *(Loc))
+
+#  elif defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
 
 /* Print *YYLOCP on YYO.  Private, do not rely on its existence. */
 
 YY_ATTRIBUTE_UNUSED
-static unsigned
+static int
 yy_location_print_ (FILE *yyo, YYLTYPE const * const yylocp)
 {
-  unsigned res = 0;
+  int res = 0;
   int end_col = 0 != yylocp->last_column ? yylocp->last_column - 1 : 0;
   if (0 <= yylocp->first_line)
     {
@@ -938,63 +1031,71 @@ yy_location_print_ (FILE *yyo, YYLTYPE const * const yylocp)
         res += YYFPRINTF (yyo, "-%d", end_col);
     }
   return res;
- }
+}
 
-#  define YY_LOCATION_PRINT(File, Loc)          \
-  yy_location_print_ (File, &(Loc))
+#   define YYLOCATION_PRINT  yy_location_print_
 
-# else
-#  define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-# endif
-#endif
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT(File, Loc)  YYLOCATION_PRINT(File, &(Loc))
+
+#  else
+
+#   define YYLOCATION_PRINT(File, Loc) ((void) 0)
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT  YYLOCATION_PRINT
+
+#  endif
+# endif /* !defined YYLOCATION_PRINT */
 
 
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)                    \
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
 do {                                                                      \
   if (yydebug)                                                            \
     {                                                                     \
       YYFPRINTF (stderr, "%s ", Title);                                   \
       yy_symbol_print (stderr,                                            \
-                  Type, Value, Location); \
+                  Kind, Value, Location); \
       YYFPRINTF (stderr, "\n");                                           \
     }                                                                     \
 } while (0)
 
 
-/*----------------------------------------.
-| Print this symbol's value on YYOUTPUT.  |
-`----------------------------------------*/
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
 
 static void
-yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp)
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp)
 {
-  FILE *yyo = yyoutput;
-  YYUSE (yyo);
-  YYUSE (yylocationp);
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (yylocationp);
   if (!yyvaluep)
     return;
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyoutput, yytoknum[yytype], *yyvaluep);
-# endif
-  YYUSE (yytype);
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
 
 static void
-yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp)
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp)
 {
-  YYFPRINTF (yyoutput, "%s %s (",
-             yytype < YYNTOKENS ? "token" : "nterm", yytname[yytype]);
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  YY_LOCATION_PRINT (yyoutput, *yylocationp);
-  YYFPRINTF (yyoutput, ": ");
-  yy_symbol_value_print (yyoutput, yytype, yyvaluep, yylocationp);
-  YYFPRINTF (yyoutput, ")");
+  YYLOCATION_PRINT (yyo, yylocationp);
+  YYFPRINTF (yyo, ": ");
+  yy_symbol_value_print (yyo, yykind, yyvaluep, yylocationp);
+  YYFPRINTF (yyo, ")");
 }
 
 /*------------------------------------------------------------------.
@@ -1003,7 +1104,7 @@ yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, YYL
 `------------------------------------------------------------------*/
 
 static void
-yy_stack_print (yytype_int16 *yybottom, yytype_int16 *yytop)
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
 {
   YYFPRINTF (stderr, "Stack now");
   for (; yybottom <= yytop; yybottom++)
@@ -1026,21 +1127,22 @@ do {                                                            \
 `------------------------------------------------*/
 
 static void
-yy_reduce_print (yytype_int16 *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp, int yyrule)
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp,
+                 int yyrule)
 {
-  unsigned long int yylno = yyrline[yyrule];
+  int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
   int yyi;
-  YYFPRINTF (stderr, "Reducing stack by rule %d (line %lu):\n",
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
              yyrule - 1, yylno);
   /* The symbols being reduced.  */
   for (yyi = 0; yyi < yynrhs; yyi++)
     {
       YYFPRINTF (stderr, "   $%d = ", yyi + 1);
       yy_symbol_print (stderr,
-                       yystos[yyssp[yyi + 1 - yynrhs]],
-                       &(yyvsp[(yyi + 1) - (yynrhs)])
-                       , &(yylsp[(yyi + 1) - (yynrhs)])                       );
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)],
+                       &(yylsp[(yyi + 1) - (yynrhs)]));
       YYFPRINTF (stderr, "\n");
     }
 }
@@ -1055,8 +1157,8 @@ do {                                    \
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
@@ -1079,250 +1181,31 @@ int yydebug;
 #endif
 
 
-#if YYERROR_VERBOSE
-
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen strlen
-#  else
-/* Return the length of YYSTR.  */
-static YYSIZE_T
-yystrlen (const char *yystr)
-{
-  YYSIZE_T yylen;
-  for (yylen = 0; yystr[yylen]; yylen++)
-    continue;
-  return yylen;
-}
-#  endif
-# endif
-
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
-/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
-   YYDEST.  */
-static char *
-yystpcpy (char *yydest, const char *yysrc)
-{
-  char *yyd = yydest;
-  const char *yys = yysrc;
-
-  while ((*yyd++ = *yys++) != '\0')
-    continue;
-
-  return yyd - 1;
-}
-#  endif
-# endif
 
-# ifndef yytnamerr
-/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
-   quotes and backslashes, so that it's suitable for yyerror.  The
-   heuristic is that double-quoting is unnecessary unless the string
-   contains an apostrophe, a comma, or backslash (other than
-   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
-   null, do not copy; instead, return the length of what the result
-   would have been.  */
-static YYSIZE_T
-yytnamerr (char *yyres, const char *yystr)
-{
-  if (*yystr == '"')
-    {
-      YYSIZE_T yyn = 0;
-      char const *yyp = yystr;
-
-      for (;;)
-        switch (*++yyp)
-          {
-          case '\'':
-          case ',':
-            goto do_not_strip_quotes;
-
-          case '\\':
-            if (*++yyp != '\\')
-              goto do_not_strip_quotes;
-            /* Fall through.  */
-          default:
-            if (yyres)
-              yyres[yyn] = *yyp;
-            yyn++;
-            break;
-
-          case '"':
-            if (yyres)
-              yyres[yyn] = '\0';
-            return yyn;
-          }
-    do_not_strip_quotes: ;
-    }
 
-  if (! yyres)
-    return yystrlen (yystr);
 
-  return yystpcpy (yyres, yystr) - yyres;
-}
-# endif
-
-/* Copy into *YYMSG, which is of size *YYMSG_ALLOC, an error message
-   about the unexpected token YYTOKEN for the state stack whose top is
-   YYSSP.
-
-   Return 0 if *YYMSG was successfully written.  Return 1 if *YYMSG is
-   not large enough to hold the message.  In that case, also set
-   *YYMSG_ALLOC to the required number of bytes.  Return 2 if the
-   required number of bytes is too large to store.  */
-static int
-yysyntax_error (YYSIZE_T *yymsg_alloc, char **yymsg,
-                yytype_int16 *yyssp, int yytoken)
-{
-  YYSIZE_T yysize0 = yytnamerr (YY_NULLPTR, yytname[yytoken]);
-  YYSIZE_T yysize = yysize0;
-  enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-  /* Internationalized format string. */
-  const char *yyformat = YY_NULLPTR;
-  /* Arguments of yyformat. */
-  char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-  /* Number of reported tokens (one for the "unexpected", one per
-     "expected"). */
-  int yycount = 0;
-
-  /* There are many possibilities here to consider:
-     - If this state is a consistent state with a default action, then
-       the only way this function was invoked is if the default action
-       is an error action.  In that case, don't check for expected
-       tokens because there are none.
-     - The only way there can be no lookahead present (in yychar) is if
-       this state is a consistent state with a default action.  Thus,
-       detecting the absence of a lookahead is sufficient to determine
-       that there is no unexpected or expected token to report.  In that
-       case, just report a simple "syntax error".
-     - Don't assume there isn't a lookahead just because this state is a
-       consistent state with a default action.  There might have been a
-       previous inconsistent state, consistent state with a non-default
-       action, or user semantic action that manipulated yychar.
-     - Of course, the expected token list depends on states to have
-       correct lookahead information, and it depends on the parser not
-       to perform extra reductions after fetching a lookahead from the
-       scanner and before detecting a syntax error.  Thus, state merging
-       (from LALR or IELR) and default reductions corrupt the expected
-       token list.  However, the list is correct for canonical LR with
-       one exception: it will still contain any token that will not be
-       accepted due to an error action in a later state.
-  */
-  if (yytoken != YYEMPTY)
-    {
-      int yyn = yypact[*yyssp];
-      yyarg[yycount++] = yytname[yytoken];
-      if (!yypact_value_is_default (yyn))
-        {
-          /* Start YYX at -YYN if negative to avoid negative indexes in
-             YYCHECK.  In other words, skip the first -YYN actions for
-             this state because they are default actions.  */
-          int yyxbegin = yyn < 0 ? -yyn : 0;
-          /* Stay within bounds of both yycheck and yytname.  */
-          int yychecklim = YYLAST - yyn + 1;
-          int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-          int yyx;
-
-          for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-            if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR
-                && !yytable_value_is_error (yytable[yyx + yyn]))
-              {
-                if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-                  {
-                    yycount = 1;
-                    yysize = yysize0;
-                    break;
-                  }
-                yyarg[yycount++] = yytname[yyx];
-                {
-                  YYSIZE_T yysize1 = yysize + yytnamerr (YY_NULLPTR, yytname[yyx]);
-                  if (! (yysize <= yysize1
-                         && yysize1 <= YYSTACK_ALLOC_MAXIMUM))
-                    return 2;
-                  yysize = yysize1;
-                }
-              }
-        }
-    }
-
-  switch (yycount)
-    {
-# define YYCASE_(N, S)                      \
-      case N:                               \
-        yyformat = S;                       \
-      break
-      YYCASE_(0, YY_("syntax error"));
-      YYCASE_(1, YY_("syntax error, unexpected %s"));
-      YYCASE_(2, YY_("syntax error, unexpected %s, expecting %s"));
-      YYCASE_(3, YY_("syntax error, unexpected %s, expecting %s or %s"));
-      YYCASE_(4, YY_("syntax error, unexpected %s, expecting %s or %s or %s"));
-      YYCASE_(5, YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s"));
-# undef YYCASE_
-    }
-
-  {
-    YYSIZE_T yysize1 = yysize + yystrlen (yyformat);
-    if (! (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM))
-      return 2;
-    yysize = yysize1;
-  }
-
-  if (*yymsg_alloc < yysize)
-    {
-      *yymsg_alloc = 2 * yysize;
-      if (! (yysize <= *yymsg_alloc
-             && *yymsg_alloc <= YYSTACK_ALLOC_MAXIMUM))
-        *yymsg_alloc = YYSTACK_ALLOC_MAXIMUM;
-      return 1;
-    }
-
-  /* Avoid sprintf, as that infringes on the user's name space.
-     Don't have undefined behavior even if the translation
-     produced a string with the wrong number of "%s"s.  */
-  {
-    char *yyp = *yymsg;
-    int yyi = 0;
-    while ((*yyp = *yyformat) != '\0')
-      if (*yyp == '%' && yyformat[1] == 's' && yyi < yycount)
-        {
-          yyp += yytnamerr (yyp, yyarg[yyi++]);
-          yyformat += 2;
-        }
-      else
-        {
-          yyp++;
-          yyformat++;
-        }
-  }
-  return 0;
-}
-#endif /* YYERROR_VERBOSE */
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, YYLTYPE *yylocationp)
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, YYLTYPE *yylocationp)
 {
-  YYUSE (yyvaluep);
-  YYUSE (yylocationp);
+  YY_USE (yyvaluep);
+  YY_USE (yylocationp);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
-  YYUSE (yytype);
+  YY_USE (yykind);
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-
-
-/* The lookahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
 /* The semantic value of the lookahead symbol.  */
@@ -1337,6 +1220,8 @@ YYLTYPE yylloc
 int yynerrs;
 
 
+
+
 /*----------.
 | yyparse.  |
 `----------*/
@@ -1344,53 +1229,45 @@ int yynerrs;
 int
 yyparse (void)
 {
-    int yystate;
+    yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
-    int yyerrstatus;
-
-    /* The stacks and their tools:
-       'yyss': related to states.
-       'yyvs': related to semantic values.
-       'yyls': related to locations.
+    int yyerrstatus = 0;
 
-       Refer to the stacks through separate pointers, to allow yyoverflow
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
        to reallocate them elsewhere.  */
 
-    /* The state stack.  */
-    yytype_int16 yyssa[YYINITDEPTH];
-    yytype_int16 *yyss;
-    yytype_int16 *yyssp;
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
-    /* The semantic value stack.  */
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
+
+    /* The semantic value stack: array, bottom, top.  */
     YYSTYPE yyvsa[YYINITDEPTH];
-    YYSTYPE *yyvs;
-    YYSTYPE *yyvsp;
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
-    /* The location stack.  */
+    /* The location stack: array, bottom, top.  */
     YYLTYPE yylsa[YYINITDEPTH];
-    YYLTYPE *yyls;
-    YYLTYPE *yylsp;
-
-    /* The locations where the error started and ended.  */
-    YYLTYPE yyerror_range[3];
-
-    YYSIZE_T yystacksize;
+    YYLTYPE *yyls = yylsa;
+    YYLTYPE *yylsp = yyls;
 
   int yyn;
+  /* The return value of yyparse.  */
   int yyresult;
-  /* Lookahead token as an internal (translated) token number.  */
-  int yytoken = 0;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
   YYLTYPE yyloc;
 
-#if YYERROR_VERBOSE
-  /* Buffer for error messages, and its allocated size.  */
-  char yymsgbuf[128];
-  char *yymsg = yymsgbuf;
-  YYSIZE_T yymsg_alloc = sizeof yymsgbuf;
-#endif
+  /* The locations where the error started and ended.  */
+  YYLTYPE yyerror_range[3];
+
+
 
 #define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N), yylsp -= (N))
 
@@ -1398,43 +1275,49 @@ yyparse (void)
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
-  yyssp = yyss = yyssa;
-  yyvsp = yyvs = yyvsa;
-  yylsp = yyls = yylsa;
-  yystacksize = YYINITDEPTH;
-
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
   yychar = YYEMPTY; /* Cause a token to be read.  */
+
   yylsp[0] = yylloc;
   goto yysetstate;
 
+
 /*------------------------------------------------------------.
-| yynewstate -- Push a new state, which is found in yystate.  |
+| yynewstate -- push a new state, which is found in yystate.  |
 `------------------------------------------------------------*/
- yynewstate:
+yynewstate:
   /* In all cases, when you get here, the value and location stacks
      have just been pushed.  So pushing a state here evens the stacks.  */
   yyssp++;
 
- yysetstate:
-  *yyssp = yystate;
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
     {
       /* Get the current used size of the three stacks, in elements.  */
-      YYSIZE_T yysize = yyssp - yyss + 1;
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
 
-#ifdef yyoverflow
+# if defined yyoverflow
       {
         /* Give user a chance to reallocate the stack.  Use copies of
            these so that the &'s don't force the real ones into
            memory.  */
+        yy_state_t *yyss1 = yyss;
         YYSTYPE *yyvs1 = yyvs;
-        yytype_int16 *yyss1 = yyss;
         YYLTYPE *yyls1 = yyls;
 
         /* Each stack pointer address is followed by the size of the
@@ -1442,32 +1325,29 @@ yyparse (void)
            conditional around just the two extra args, but that might
            be undefined if yyoverflow is a macro.  */
         yyoverflow (YY_("memory exhausted"),
-                    &yyss1, yysize * sizeof (*yyssp),
-                    &yyvs1, yysize * sizeof (*yyvsp),
-                    &yyls1, yysize * sizeof (*yylsp),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yyls1, yysize * YYSIZEOF (*yylsp),
                     &yystacksize);
-
-        yyls = yyls1;
         yyss = yyss1;
         yyvs = yyvs1;
+        yyls = yyls1;
       }
-#else /* no yyoverflow */
-# ifndef YYSTACK_RELOCATE
-      goto yyexhaustedlab;
-# else
+# else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-        goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
         yystacksize = YYMAXDEPTH;
 
       {
-        yytype_int16 *yyss1 = yyss;
+        yy_state_t *yyss1 = yyss;
         union yyalloc *yyptr =
-          (union yyalloc *) YYSTACK_ALLOC (YYSTACK_BYTES (yystacksize));
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
         if (! yyptr)
-          goto yyexhaustedlab;
+          YYNOMEM;
         YYSTACK_RELOCATE (yyss_alloc, yyss);
         YYSTACK_RELOCATE (yyvs_alloc, yyvs);
         YYSTACK_RELOCATE (yyls_alloc, yyls);
@@ -1476,31 +1356,32 @@ yyparse (void)
           YYSTACK_FREE (yyss1);
       }
 # endif
-#endif /* no yyoverflow */
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
       yylsp = yyls + yysize - 1;
 
-      YYDPRINTF ((stderr, "Stack size increased to %lu\n",
-                  (unsigned long int) yystacksize));
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
 
       if (yyss + yystacksize - 1 <= yyssp)
         YYABORT;
     }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
-  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
 
   if (yystate == YYFINAL)
     YYACCEPT;
 
   goto yybackup;
 
+
 /*-----------.
 | yybackup.  |
 `-----------*/
 yybackup:
-
   /* Do appropriate processing given the current state.  Read a
      lookahead token if we need one and don't already have one.  */
 
@@ -1511,18 +1392,30 @@ yybackup:
 
   /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid lookahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
+      YYDPRINTF ((stderr, "Reading a token\n"));
       yychar = yylex ();
     }
 
   if (yychar <= YYEOF)
     {
-      yychar = yytoken = YYEOF;
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      yyerror_range[1] = yylloc;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1550,15 +1443,14 @@ yybackup:
 
   /* Shift the lookahead token.  */
   YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
-
-  /* Discard the shifted token.  */
-  yychar = YYEMPTY;
-
   yystate = yyn;
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
   YY_IGNORE_MAYBE_UNINITIALIZED_END
   *++yylsp = yylloc;
+
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
   goto yynewstate;
 
 
@@ -1573,7 +1465,7 @@ yydefault:
 
 
 /*-----------------------------.
-| yyreduce -- Do a reduction.  |
+| yyreduce -- do a reduction.  |
 `-----------------------------*/
 yyreduce:
   /* yyn is the number of a rule to reduce with.  */
@@ -1589,21 +1481,24 @@ yyreduce:
      GCC warning that YYVAL may be used uninitialized.  */
   yyval = yyvsp[1-yylen];
 
-  /* Default location.  */
+  /* Default location. */
   YYLLOC_DEFAULT (yyloc, (yylsp - yylen), yylen);
+  yyerror_range[1] = yyloc;
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-        case 2:
-#line 125 "parser.y" /* yacc.c:1646  */
-    {
+  case 2: /* program: prog_decl subprog_part comp_stmt T_DOT  */
+#line 134 "parser.y"
+                {
 
                     symbol *env = sym_tab->get_symbol((yyvsp[-3].procedure_head)->sym_p);
+                    compile_stats->begin_block(env);
 
                     // The status variables here depend on what flags were
                     // passed to the compiler. See the 'diesel' script for
                     // more information.
                     if (typecheck) {
+                        compile_stats->enter_phase(PHASE_TYPECHECK);
                         type_checker->do_typecheck(env, (yyvsp[-1].statement_list));
                     }
 
@@ -1613,6 +1508,7 @@ yyreduce:
                     }
 
                     if (optimize) {
+                        compile_stats->enter_phase(PHASE_OPTIMIZE);
                         optimizer->do_optimize((yyvsp[-1].statement_list));
                         if(print_ast) {
                             cout << "\nOptimized AST for global level" << endl;
@@ -1620,17 +1516,45 @@ yyreduce:
                         }
                     }
                     if (error_count == 0) {
-                        if (quads) {
+                        if (quads && code_cache->replay((yyvsp[-3].procedure_head)->sym_p, (yyvsp[-1].statement_list))) {
+                            cout << "Reusing assembler, global level" << endl;
+                        } else if (quads) {
+                            compile_stats->enter_phase(PHASE_QUADS);
                             quad_list *q = (yyvsp[-3].procedure_head)->do_quads((yyvsp[-1].statement_list));
-                            if (print_quads) {
-                                cout << "\nQuad list for global level" << endl;
-                                cout << (quad_list *)q << endl;
-                            }
-
-                            if (assembler) {
+                            compile_stats->count_quads(q->size());
+                            if (pipeline->active()) {
                                 cout << "Generating assembler, global level"
                                      << endl;
-                                code_gen->generate_assembler(q, env);
+                                pipeline->submit((yyvsp[-3].procedure_head)->sym_p, q);
+                            } else {
+                                if (optimize_quads) {
+                                    compile_stats->enter_phase(PHASE_QUADOPT);
+                                    if (inline_calls) {
+                                        inliner->do_inline(q);
+                                    }
+                                    quad_opt->do_optimize(q);
+                                    compile_stats->count_optimized_quads(
+                                        q->size());
+                                    quad_opt->do_vectorize(q);
+                                }
+                                if (print_quads) {
+                                    cout << "\nQuad list for global level" << endl;
+                                    cout << (quad_list *)q << endl;
+                                }
+                                if (print_flow_graph) {
+                                    cout << "\nFlow graph for global level"
+                                         << endl;
+                                    flow_graph graph(q);
+                                    graph.print(cout);
+                                }
+
+                                if (assembler) {
+                                    cout << "Generating assembler, global level"
+                                         << endl;
+                                    compile_stats->enter_phase(PHASE_CODEGEN);
+                                    code_cache->generate_assembler((yyvsp[-3].procedure_head)->sym_p, q);
+                                }
+                                delete q;
                             }
                         }
                     } else {
@@ -1640,57 +1564,60 @@ yyreduce:
 
                     // We close the global scope.
                     sym_tab->close_scope();
+                    close_ast_arena();
+                    compile_stats->end_block();
                 }
-#line 1645 "parser.cc" /* yacc.c:1646  */
+#line 1571 "parser.cc"
     break;
 
-  case 3:
-#line 174 "parser.y" /* yacc.c:1646  */
-    {
+  case 3: /* prog_decl: prog_head T_SEMICOLON const_part variable_part  */
+#line 216 "parser.y"
+                {
                     (yyval.procedure_head) = (yyvsp[-3].procedure_head);
                 }
-#line 1653 "parser.cc" /* yacc.c:1646  */
+#line 1579 "parser.cc"
     break;
 
-  case 4:
-#line 181 "parser.y" /* yacc.c:1646  */
-    {
+  case 4: /* prog_head: T_PROGRAM T_IDENT  */
+#line 223 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-1]).first_line,(yylsp[-1]).first_column);
                     (yyval.procedure_head) = new ast_procedurehead(pos, sym_tab->enter_procedure(pos, (yyvsp[0].pool_p)));
                     sym_tab->open_scope();
+                    open_ast_arena();
                 }
-#line 1663 "parser.cc" /* yacc.c:1646  */
+#line 1590 "parser.cc"
     break;
 
-  case 10:
-#line 201 "parser.y" /* yacc.c:1646  */
-    {
+  case 10: /* const_decl: T_IDENT T_EQ integer T_SEMICOLON  */
+#line 244 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-3]).first_line,(yylsp[-3]).first_column);
                     sym_tab->enter_constant(pos, (yyvsp[-3].pool_p), integer_type, (yyvsp[-1].integer)->value);
                 }
-#line 1672 "parser.cc" /* yacc.c:1646  */
+#line 1599 "parser.cc"
     break;
 
-  case 11:
-#line 206 "parser.y" /* yacc.c:1646  */
-    {
+  case 11: /* const_decl: T_IDENT T_EQ real T_SEMICOLON  */
+#line 249 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-3]).first_line,(yylsp[-3]).first_column);
                     sym_tab->enter_constant(pos, (yyvsp[-3].pool_p), real_type, (yyvsp[-1].real)->value);
                 }
-#line 1681 "parser.cc" /* yacc.c:1646  */
+#line 1608 "parser.cc"
     break;
 
-  case 12:
-#line 211 "parser.y" /* yacc.c:1646  */
-    {
+  case 12: /* const_decl: T_IDENT T_EQ T_STRINGCONST T_SEMICOLON  */
+#line 254 "parser.y"
+                {
                     // This isn't implemented in Diesel... Do nothing.
                 }
-#line 1689 "parser.cc" /* yacc.c:1646  */
+#line 1616 "parser.cc"
     break;
 
-  case 13:
-#line 215 "parser.y" /* yacc.c:1646  */
-    {
+  case 13: /* const_decl: T_IDENT T_EQ const_id T_SEMICOLON  */
+#line 258 "parser.y"
+                {
 
                     // This part of code is a bit ugly, but it's needed to
                     // allow constructions like this:
@@ -1711,30 +1638,30 @@ yyreduce:
                         }
                     }
                 }
-#line 1715 "parser.cc" /* yacc.c:1646  */
+#line 1642 "parser.cc"
     break;
 
-  case 18:
-#line 250 "parser.y" /* yacc.c:1646  */
-    {
+  case 18: /* var_decl: T_IDENT T_COLON type_id T_SEMICOLON  */
+#line 293 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-3]).first_line,(yylsp[-3]).first_column);
                     sym_tab->enter_variable(pos, (yyvsp[-3].pool_p), (yyvsp[-1].id)->sym_p);
                 }
-#line 1724 "parser.cc" /* yacc.c:1646  */
+#line 1651 "parser.cc"
     break;
 
-  case 19:
-#line 255 "parser.y" /* yacc.c:1646  */
-    {
+  case 19: /* var_decl: T_IDENT T_COLON T_ARRAY T_LEFTBRACKET integer T_RIGHTBRACKET T_OF type_id T_SEMICOLON  */
+#line 298 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-8]).first_line,(yylsp[-8]).first_column);
                     sym_tab->enter_array(pos, (yyvsp[-8].pool_p), (yyvsp[-1].id)->sym_p, (yyvsp[-4].integer)->value);
                 }
-#line 1733 "parser.cc" /* yacc.c:1646  */
+#line 1660 "parser.cc"
     break;
 
-  case 20:
-#line 260 "parser.y" /* yacc.c:1646  */
-    {
+  case 20: /* var_decl: T_IDENT T_COLON T_ARRAY T_LEFTBRACKET const_id T_RIGHTBRACKET T_OF type_id T_SEMICOLON  */
+#line 303 "parser.y"
+                {
                     // We enter an array: pool_pointer, type pointer,
                     // the id type of the constant, and the value of the
                     // constant.
@@ -1781,16 +1708,18 @@ yyreduce:
                         }
                     }
                 }
-#line 1785 "parser.cc" /* yacc.c:1646  */
+#line 1712 "parser.cc"
     break;
 
-  case 25:
-#line 322 "parser.y" /* yacc.c:1646  */
-    {
+  case 25: /* subprog_decl: proc_decl subprog_part comp_stmt T_SEMICOLON  */
+#line 365 "parser.y"
+                {
 
                     symbol *env = sym_tab->get_symbol((yyvsp[-3].procedure_head)->sym_p);
+                    compile_stats->begin_block(env);
 
                     if (typecheck) {
+                        compile_stats->enter_phase(PHASE_TYPECHECK);
                         type_checker->do_typecheck(env, (yyvsp[-1].statement_list));
                     }
 
@@ -1802,6 +1731,7 @@ yyreduce:
                     }
 
                     if (optimize) {
+                        compile_stats->enter_phase(PHASE_OPTIMIZE);
                         optimizer->do_optimize((yyvsp[-1].statement_list));
                         if (print_ast) {
                             cout << "\nOptimized AST for \""
@@ -1812,37 +1742,77 @@ yyreduce:
                     }
 
                     if (error_count == 0) {
-                        if (quads) {
+                        if (quads && code_cache->replay((yyvsp[-3].procedure_head)->sym_p, (yyvsp[-1].statement_list))) {
+                            cout << "Reusing assembler for procedure \""
+                                 << sym_tab->pool_lookup(env->id) << "\""
+                                 << endl;
+                        } else if (quads) {
+                            compile_stats->enter_phase(PHASE_QUADS);
                             quad_list *q = (yyvsp[-3].procedure_head)->do_quads((yyvsp[-1].statement_list));
-                            if (print_quads) {
-                                cout << "\nQuad list for \""
-                                     << sym_tab->pool_lookup(env->id)
-                                     << "\"" << endl;
-                                cout << (quad_list *)q << endl;
-                            }
-
-                            if (assembler) {
+                            compile_stats->count_quads(q->size());
+                            if (pipeline->active()) {
                                 cout << "Generating assembler for procedure \""
                                      << sym_tab->pool_lookup(env->id)
                                      << "\"" << endl;
-                                code_gen->generate_assembler(q, env);
+                                pipeline->submit((yyvsp[-3].procedure_head)->sym_p, q);
+                            } else {
+                                if (optimize_quads) {
+                                    compile_stats->enter_phase(PHASE_QUADOPT);
+                                    if (inline_calls) {
+                                        inliner->do_inline(q);
+                                    }
+                                    quad_opt->do_optimize(q);
+                                    compile_stats->count_optimized_quads(
+                                        q->size());
+                                    if (inline_calls) {
+                                        inliner->keep_block((yyvsp[-3].procedure_head)->sym_p, q);
+                                    }
+                                    quad_opt->do_vectorize(q);
+                                }
+                                if (print_quads) {
+                                    cout << "\nQuad list for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    cout << (quad_list *)q << endl;
+                                }
+                                if (print_flow_graph) {
+                                    cout << "\nFlow graph for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    flow_graph graph(q);
+                                    graph.print(cout);
+                                }
+
+                                if (assembler) {
+                                    cout << "Generating assembler for procedure \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    compile_stats->enter_phase(PHASE_CODEGEN);
+                                    code_cache->generate_assembler((yyvsp[-3].procedure_head)->sym_p, q);
+                                }
+                                delete q;
                             }
                         }
                     }
 
-                    // Close the current scope.
+                    // Close the current scope. All AST nodes of the block
+                    // are freed along with it.
                     sym_tab->close_scope();
+                    close_ast_arena();
+                    compile_stats->end_block();
                 }
-#line 1837 "parser.cc" /* yacc.c:1646  */
+#line 1805 "parser.cc"
     break;
 
-  case 26:
-#line 370 "parser.y" /* yacc.c:1646  */
-    {
+  case 26: /* subprog_decl: func_decl subprog_part comp_stmt T_SEMICOLON  */
+#line 454 "parser.y"
+                {
 
                     symbol *env = sym_tab->get_symbol((yyvsp[-3].function_head)->sym_p);
+                    compile_stats->begin_block(env);
 
                     if (typecheck) {
+                        compile_stats->enter_phase(PHASE_TYPECHECK);
                         type_checker->do_typecheck(env, (yyvsp[-1].statement_list));
                     }
 
@@ -1854,6 +1824,7 @@ yyreduce:
                     }
 
                     if (optimize) {
+                        compile_stats->enter_phase(PHASE_OPTIMIZE);
                         optimizer->do_optimize((yyvsp[-1].statement_list));
                         if (print_ast) {
                             cout << "\nOptimized AST for \""
@@ -1864,50 +1835,88 @@ yyreduce:
                     }
 
                     if (error_count == 0) {
-                        if (quads) {
+                        if (quads && code_cache->replay((yyvsp[-3].function_head)->sym_p, (yyvsp[-1].statement_list))) {
+                            cout << "Reusing assembler for function \""
+                                 << sym_tab->pool_lookup(env->id) << "\""
+                                 << endl;
+                        } else if (quads) {
+                            compile_stats->enter_phase(PHASE_QUADS);
                             quad_list *q = (yyvsp[-3].function_head)->do_quads((yyvsp[-1].statement_list));
-                            if (print_quads) {
-                                cout << "\nQuad list for \""
-                                     << sym_tab->pool_lookup(env->id)
-                                     << "\"" << endl;
-                                cout << (quad_list *)q << endl;
-                            }
-
-                            if (assembler) {
+                            compile_stats->count_quads(q->size());
+                            if (pipeline->active()) {
                                 cout << "Generating assembler for function \""
                                      << sym_tab->pool_lookup(env->id) << "\""
                                      << endl;
-                                code_gen->generate_assembler(q, env);
+                                pipeline->submit((yyvsp[-3].function_head)->sym_p, q);
+                            } else {
+                                if (optimize_quads) {
+                                    compile_stats->enter_phase(PHASE_QUADOPT);
+                                    if (inline_calls) {
+                                        inliner->do_inline(q);
+                                    }
+                                    quad_opt->do_optimize(q);
+                                    compile_stats->count_optimized_quads(
+                                        q->size());
+                                    if (inline_calls) {
+                                        inliner->keep_block((yyvsp[-3].function_head)->sym_p, q);
+                                    }
+                                    quad_opt->do_vectorize(q);
+                                }
+                                if (print_quads) {
+                                    cout << "\nQuad list for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    cout << (quad_list *)q << endl;
+                                }
+                                if (print_flow_graph) {
+                                    cout << "\nFlow graph for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    flow_graph graph(q);
+                                    graph.print(cout);
+                                }
+
+                                if (assembler) {
+                                    cout << "Generating assembler for function \""
+                                         << sym_tab->pool_lookup(env->id) << "\""
+                                         << endl;
+                                    compile_stats->enter_phase(PHASE_CODEGEN);
+                                    code_cache->generate_assembler((yyvsp[-3].function_head)->sym_p, q);
+                                }
+                                delete q;
                             }
                         }
                     }
 
-                    // Close the current scope.
+                    // Close the current scope. All AST nodes of the block
+                    // are freed along with it.
                     sym_tab->close_scope();
+                    close_ast_arena();
+                    compile_stats->end_block();
                 }
-#line 1889 "parser.cc" /* yacc.c:1646  */
+#line 1898 "parser.cc"
     break;
 
-  case 27:
-#line 421 "parser.y" /* yacc.c:1646  */
-    {
+  case 27: /* proc_decl: proc_head opt_param_list T_SEMICOLON const_part variable_part  */
+#line 546 "parser.y"
+                {
                     (yyval.procedure_head) = (yyvsp[-4].procedure_head);
                 }
-#line 1897 "parser.cc" /* yacc.c:1646  */
+#line 1906 "parser.cc"
     break;
 
-  case 28:
-#line 428 "parser.y" /* yacc.c:1646  */
-    {
+  case 28: /* func_decl: func_head opt_param_list T_COLON type_id T_SEMICOLON const_part variable_part  */
+#line 553 "parser.y"
+                {
                     (yyval.function_head) = (yyvsp[-6].function_head);
                     sym_tab->set_symbol_type((yyvsp[-6].function_head)->sym_p, (yyvsp[-3].id)->sym_p);
                 }
-#line 1906 "parser.cc" /* yacc.c:1646  */
+#line 1915 "parser.cc"
     break;
 
-  case 29:
-#line 436 "parser.y" /* yacc.c:1646  */
-    {
+  case 29: /* proc_head: T_PROCEDURE T_IDENT  */
+#line 561 "parser.y"
+                {
                     position_information *pos =
                         new position_information((yylsp[-1]).first_line,
                                                  (yylsp[-1]).first_column);
@@ -1916,6 +1925,7 @@ yyreduce:
                                                                   (yyvsp[0].pool_p));
                     // Open a new scope.
                     sym_tab->open_scope();
+                    open_ast_arena();
                     // This AST node is just a temporary node which we create
                     // here in order to be able to provide the symbol table
                     // index for the procedure to the proc_decl production
@@ -1923,12 +1933,12 @@ yyreduce:
                     (yyval.procedure_head) = new ast_procedurehead(pos,
                                                proc_loc);
                 }
-#line 1927 "parser.cc" /* yacc.c:1646  */
+#line 1937 "parser.cc"
     break;
 
-  case 30:
-#line 456 "parser.y" /* yacc.c:1646  */
-    {
+  case 30: /* func_head: T_FUNCTION T_IDENT  */
+#line 582 "parser.y"
+                {
                     position_information *pos =
                         new position_information((yylsp[-1]).first_line,
                                                  (yylsp[-1]).first_column);
@@ -1937,6 +1947,7 @@ yyreduce:
                                                                  (yyvsp[0].pool_p));
                     // Open a new scope.
                     sym_tab->open_scope();
+                    open_ast_arena();
 
                     // This AST node is just a temporary node which we create
                     // here in order to be able to provide the symbol table
@@ -1946,52 +1957,52 @@ yyreduce:
                     (yyval.function_head) = new ast_functionhead(pos,
                                               func_loc);
                 }
-#line 1950 "parser.cc" /* yacc.c:1646  */
+#line 1961 "parser.cc"
     break;
 
-  case 31:
-#line 478 "parser.y" /* yacc.c:1646  */
-    {
+  case 31: /* opt_param_list: T_LEFTPAR param_list T_RIGHTPAR  */
+#line 605 "parser.y"
+                {
                     (yyval.expression_list) = (yyvsp[-1].expression_list);
                 }
-#line 1958 "parser.cc" /* yacc.c:1646  */
+#line 1969 "parser.cc"
     break;
 
-  case 32:
-#line 482 "parser.y" /* yacc.c:1646  */
-    {
+  case 32: /* opt_param_list: T_LEFTPAR error T_RIGHTPAR  */
+#line 609 "parser.y"
+                {
                     (yyval.expression_list) = NULL;
                 }
-#line 1966 "parser.cc" /* yacc.c:1646  */
+#line 1977 "parser.cc"
     break;
 
-  case 33:
-#line 486 "parser.y" /* yacc.c:1646  */
-    {
+  case 33: /* opt_param_list: %empty  */
+#line 613 "parser.y"
+                {
                     (yyval.expression_list) = NULL;
                 }
-#line 1974 "parser.cc" /* yacc.c:1646  */
+#line 1985 "parser.cc"
     break;
 
-  case 34:
-#line 493 "parser.y" /* yacc.c:1646  */
-    {
+  case 34: /* param_list: param  */
+#line 620 "parser.y"
+                {
                     /* Note that we use expr_lists for parameters. This
                        is thus simply a place-holder in the grammar. */
                 }
-#line 1983 "parser.cc" /* yacc.c:1646  */
+#line 1994 "parser.cc"
     break;
 
-  case 35:
-#line 498 "parser.y" /* yacc.c:1646  */
-    {
+  case 35: /* param_list: param_list T_SEMICOLON param  */
+#line 625 "parser.y"
+                {
                 }
-#line 1990 "parser.cc" /* yacc.c:1646  */
+#line 2001 "parser.cc"
     break;
 
-  case 36:
-#line 504 "parser.y" /* yacc.c:1646  */
-    {
+  case 36: /* param: T_IDENT T_COLON type_id  */
+#line 631 "parser.y"
+                {
                     position_information *pos =
                         new position_information((yylsp[-2]).first_line,
                                                  (yylsp[-2]).first_column);
@@ -2005,530 +2016,539 @@ yyreduce:
                                                  (yyvsp[-2].pool_p),
                                                  (yyvsp[0].id)->sym_p);
                 }
-#line 2009 "parser.cc" /* yacc.c:1646  */
+#line 2020 "parser.cc"
     break;
 
-  case 37:
-#line 522 "parser.y" /* yacc.c:1646  */
-    {
+  case 37: /* comp_stmt: T_BEGIN stmt_list T_END  */
+#line 649 "parser.y"
+                {
                     (yyval.statement_list) = (yyvsp[-1].statement_list);
                 }
-#line 2017 "parser.cc" /* yacc.c:1646  */
+#line 2028 "parser.cc"
     break;
 
-  case 38:
-#line 529 "parser.y" /* yacc.c:1646  */
-    {
+  case 38: /* stmt_list: stmt  */
+#line 656 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[0]).first_line,(yylsp[0]).first_column);
                     if ((yyvsp[0].statement) != NULL)
                         (yyval.statement_list) = new ast_stmt_list(pos, (yyvsp[0].statement));
                     else (yyval.statement_list) = NULL;
                 }
-#line 2028 "parser.cc" /* yacc.c:1646  */
+#line 2039 "parser.cc"
     break;
 
-  case 39:
-#line 536 "parser.y" /* yacc.c:1646  */
-    {
-                    position_information *pos =new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
-
-                    if ((yyvsp[0].statement) != NULL)
-                        (yyval.statement_list) = new ast_stmt_list(pos, (yyvsp[0].statement), (yyvsp[-2].statement_list));
-                    else (yyval.statement_list) = (yyvsp[-2].statement_list);
+  case 39: /* stmt_list: stmt_list T_SEMICOLON stmt  */
+#line 663 "parser.y"
+                {
+                    (yyval.statement_list) = (yyvsp[-2].statement_list);
+                    if ((yyvsp[0].statement) != NULL) {
+                        if ((yyvsp[-2].statement_list) == NULL) {
+                            position_information *pos =new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
+                            (yyval.statement_list) = new ast_stmt_list(pos, (yyvsp[0].statement));
+                        } else {
+                            (yyvsp[-2].statement_list)->append((yyvsp[0].statement));
+                        }
+                    }
                 }
-#line 2040 "parser.cc" /* yacc.c:1646  */
+#line 2055 "parser.cc"
     break;
 
-  case 40:
-#line 544 "parser.y" /* yacc.c:1646  */
-    {
+  case 40: /* stmt_list: error T_SEMICOLON stmt  */
+#line 675 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
                     if ((yyvsp[0].statement) != NULL) (yyval.statement_list) = new ast_stmt_list(pos, (yyvsp[0].statement));
                     else (yyval.statement_list) = NULL;
                 }
-#line 2050 "parser.cc" /* yacc.c:1646  */
+#line 2065 "parser.cc"
     break;
 
-  case 41:
-#line 553 "parser.y" /* yacc.c:1646  */
-    {
+  case 41: /* stmt: T_IF expr T_THEN stmt_list elsif_list else_part T_END  */
+#line 684 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-6]).first_line,(yylsp[-6]).first_column);
                     (yyval.statement) = new ast_if(pos, (yyvsp[-5].expression), (yyvsp[-3].statement_list), (yyvsp[-2].elsif_list), (yyvsp[-1].statement_list));
                 }
-#line 2059 "parser.cc" /* yacc.c:1646  */
+#line 2074 "parser.cc"
     break;
 
-  case 42:
-#line 558 "parser.y" /* yacc.c:1646  */
-    {
+  case 42: /* stmt: T_IF error T_THEN stmt_list elsif_list else_part T_END  */
+#line 689 "parser.y"
+                {
                      yyerror("error: if condition");
                      (yyval.statement) = NULL;
                 }
-#line 2068 "parser.cc" /* yacc.c:1646  */
+#line 2083 "parser.cc"
     break;
 
-  case 43:
-#line 563 "parser.y" /* yacc.c:1646  */
-    {
+  case 43: /* stmt: T_IF error T_THEN error T_END  */
+#line 694 "parser.y"
+                {
                      yyerror("error: if condition");
                      (yyval.statement) = NULL;
                 }
-#line 2077 "parser.cc" /* yacc.c:1646  */
+#line 2092 "parser.cc"
     break;
 
-  case 44:
-#line 568 "parser.y" /* yacc.c:1646  */
-    {
+  case 44: /* stmt: T_IF expr T_THEN error T_END  */
+#line 699 "parser.y"
+                {
                      yyerror("error: if condition");
                      (yyval.statement) = NULL;
                 }
-#line 2086 "parser.cc" /* yacc.c:1646  */
+#line 2101 "parser.cc"
     break;
 
-  case 45:
-#line 573 "parser.y" /* yacc.c:1646  */
-    {
+  case 45: /* stmt: T_WHILE expr T_DO stmt_list T_END  */
+#line 704 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-4]).first_line,(yylsp[-4]).first_column);
                     (yyval.statement) = new ast_while(pos, (yyvsp[-3].expression), (yyvsp[-1].statement_list));
                 }
-#line 2095 "parser.cc" /* yacc.c:1646  */
+#line 2110 "parser.cc"
     break;
 
-  case 46:
-#line 578 "parser.y" /* yacc.c:1646  */
-    {
+  case 46: /* stmt: T_WHILE error T_DO stmt_list T_END  */
+#line 709 "parser.y"
+                {
                     yyerror("error: while condition");
                     (yyval.statement) = NULL;
                 }
-#line 2104 "parser.cc" /* yacc.c:1646  */
+#line 2119 "parser.cc"
     break;
 
-  case 47:
-#line 583 "parser.y" /* yacc.c:1646  */
-    {
+  case 47: /* stmt: T_WHILE error T_DO error T_END  */
+#line 714 "parser.y"
+                {
                     yyerror("error: while condition");
                     (yyval.statement) = NULL;
                 }
-#line 2113 "parser.cc" /* yacc.c:1646  */
+#line 2128 "parser.cc"
     break;
 
-  case 48:
-#line 588 "parser.y" /* yacc.c:1646  */
-    {
+  case 48: /* stmt: T_WHILE expr T_DO error T_END  */
+#line 719 "parser.y"
+                {
                     yyerror("error: while condition");
                     (yyval.statement) = NULL;
                 }
-#line 2122 "parser.cc" /* yacc.c:1646  */
+#line 2137 "parser.cc"
     break;
 
-  case 49:
-#line 593 "parser.y" /* yacc.c:1646  */
-    {
+  case 49: /* stmt: proc_id T_LEFTPAR opt_expr_list T_RIGHTPAR  */
+#line 724 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-3]).first_line,(yylsp[-3]).first_column);
                     (yyval.statement) = new ast_procedurecall(pos, (yyvsp[-3].id), (yyvsp[-1].expression_list));
                 }
-#line 2131 "parser.cc" /* yacc.c:1646  */
+#line 2146 "parser.cc"
     break;
 
-  case 50:
-#line 598 "parser.y" /* yacc.c:1646  */
-    {
+  case 50: /* stmt: proc_id T_LEFTPAR error T_RIGHTPAR  */
+#line 729 "parser.y"
+                {
                     yyerror("error: procedure arguments");
                     (yyval.statement) = NULL;
                 }
-#line 2140 "parser.cc" /* yacc.c:1646  */
+#line 2155 "parser.cc"
     break;
 
-  case 51:
-#line 603 "parser.y" /* yacc.c:1646  */
-    {
+  case 51: /* stmt: lvariable T_ASSIGN expr  */
+#line 734 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
                     (yyval.statement) = new ast_assign(pos, (yyvsp[-2].lvalue), (yyvsp[0].expression));
                 }
-#line 2149 "parser.cc" /* yacc.c:1646  */
+#line 2164 "parser.cc"
     break;
 
-  case 52:
-#line 608 "parser.y" /* yacc.c:1646  */
-    {
+  case 52: /* stmt: lvariable T_ASSIGN error  */
+#line 739 "parser.y"
+                {
                     yyerror("error: assignement of variable");
                     (yyval.statement) = NULL;
                 }
-#line 2158 "parser.cc" /* yacc.c:1646  */
+#line 2173 "parser.cc"
     break;
 
-  case 53:
-#line 613 "parser.y" /* yacc.c:1646  */
-    {
+  case 53: /* stmt: T_RETURN expr  */
+#line 744 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-1]).first_line,(yylsp[-1]).first_column);
                     (yyval.statement) = new ast_return(pos, (yyvsp[0].expression));
                 }
-#line 2167 "parser.cc" /* yacc.c:1646  */
+#line 2182 "parser.cc"
     break;
 
-  case 54:
-#line 618 "parser.y" /* yacc.c:1646  */
-    {
+  case 54: /* stmt: T_RETURN error  */
+#line 749 "parser.y"
+                {
                     yyerror("error: return");
                     (yyval.statement) = NULL;
                 }
-#line 2176 "parser.cc" /* yacc.c:1646  */
+#line 2191 "parser.cc"
     break;
 
-  case 55:
-#line 623 "parser.y" /* yacc.c:1646  */
-    {
+  case 55: /* stmt: T_RETURN  */
+#line 754 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[0]).first_line,(yylsp[0]).first_column);
                     (yyval.statement) = new ast_return(pos);
                 }
-#line 2185 "parser.cc" /* yacc.c:1646  */
+#line 2200 "parser.cc"
     break;
 
-  case 56:
-#line 629 "parser.y" /* yacc.c:1646  */
-    {
+  case 56: /* stmt: %empty  */
+#line 760 "parser.y"
+                {
                     (yyval.statement) = NULL;
                 }
-#line 2193 "parser.cc" /* yacc.c:1646  */
+#line 2208 "parser.cc"
     break;
 
-  case 57:
-#line 635 "parser.y" /* yacc.c:1646  */
-    {
+  case 57: /* lvariable: lvar_id  */
+#line 766 "parser.y"
+                {
                     (yyval.lvalue) = (yyvsp[0].id);
                 }
-#line 2201 "parser.cc" /* yacc.c:1646  */
+#line 2216 "parser.cc"
     break;
 
-  case 58:
-#line 639 "parser.y" /* yacc.c:1646  */
-    {
+  case 58: /* lvariable: array_id T_LEFTBRACKET expr T_RIGHTBRACKET  */
+#line 770 "parser.y"
+                {
                     (yyval.lvalue) = new ast_indexed((yyvsp[-3].id)->pos,
                                          (yyvsp[-3].id),
                                          (yyvsp[-1].expression));
                 }
-#line 2211 "parser.cc" /* yacc.c:1646  */
+#line 2226 "parser.cc"
     break;
 
-  case 59:
-#line 645 "parser.y" /* yacc.c:1646  */
-    {
+  case 59: /* lvariable: array_id T_LEFTBRACKET error T_RIGHTBRACKET  */
+#line 776 "parser.y"
+                {
                     (yyval.lvalue) = NULL;
                 }
-#line 2219 "parser.cc" /* yacc.c:1646  */
+#line 2234 "parser.cc"
     break;
 
-  case 60:
-#line 652 "parser.y" /* yacc.c:1646  */
-    {
+  case 60: /* rvariable: rvar_id  */
+#line 783 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[0].id);
                 }
-#line 2227 "parser.cc" /* yacc.c:1646  */
+#line 2242 "parser.cc"
     break;
 
-  case 61:
-#line 656 "parser.y" /* yacc.c:1646  */
-    {
+  case 61: /* rvariable: array_id T_LEFTBRACKET expr T_RIGHTBRACKET  */
+#line 787 "parser.y"
+                {
                   (yyval.expression) = new ast_indexed((yyvsp[-3].id)->pos, (yyvsp[-3].id),(yyvsp[-1].expression));
                 }
-#line 2235 "parser.cc" /* yacc.c:1646  */
+#line 2250 "parser.cc"
     break;
 
-  case 62:
-#line 660 "parser.y" /* yacc.c:1646  */
-    {
+  case 62: /* rvariable: array_id T_LEFTBRACKET error T_RIGHTBRACKET  */
+#line 791 "parser.y"
+                {
                     yyerror("error: index of array");
                     (yyval.expression) = NULL;
                 }
-#line 2244 "parser.cc" /* yacc.c:1646  */
+#line 2259 "parser.cc"
     break;
 
-  case 63:
-#line 668 "parser.y" /* yacc.c:1646  */
-    {
-                    position_information *pos = new position_information((yylsp[-1]).first_line,(yylsp[-1]).first_column);
-                    (yyval.elsif_list) = new ast_elsif_list(pos, (yyvsp[0].elsif), (yyvsp[-1].elsif_list));
+  case 63: /* elsif_list: elsif_list elsif  */
+#line 799 "parser.y"
+                {
+                    if ((yyvsp[-1].elsif_list) == NULL) {
+                        position_information *pos = new position_information((yylsp[-1]).first_line,(yylsp[-1]).first_column);
+                        (yyval.elsif_list) = new ast_elsif_list(pos, (yyvsp[0].elsif));
+                    } else {
+                        (yyvsp[-1].elsif_list)->append((yyvsp[0].elsif));
+                        (yyval.elsif_list) = (yyvsp[-1].elsif_list);
+                    }
                 }
-#line 2253 "parser.cc" /* yacc.c:1646  */
+#line 2273 "parser.cc"
     break;
 
-  case 64:
-#line 673 "parser.y" /* yacc.c:1646  */
-    {
+  case 64: /* elsif_list: %empty  */
+#line 809 "parser.y"
+                {
                     (yyval.elsif_list) = NULL;
                 }
-#line 2261 "parser.cc" /* yacc.c:1646  */
+#line 2281 "parser.cc"
     break;
 
-  case 65:
-#line 680 "parser.y" /* yacc.c:1646  */
-    {
+  case 65: /* elsif: T_ELSIF expr T_THEN stmt_list  */
+#line 816 "parser.y"
+                {
                     position_information *pos =new position_information((yylsp[-3]).first_line, (yylsp[-3]).first_column);
                     (yyval.elsif) = new ast_elsif(pos, (yyvsp[-2].expression), (yyvsp[0].statement_list));
                 }
-#line 2270 "parser.cc" /* yacc.c:1646  */
+#line 2290 "parser.cc"
     break;
 
-  case 66:
-#line 688 "parser.y" /* yacc.c:1646  */
-    {
+  case 66: /* else_part: T_ELSE stmt_list  */
+#line 824 "parser.y"
+                {
                     (yyval.statement_list) = (yyvsp[0].statement_list);
                 }
-#line 2278 "parser.cc" /* yacc.c:1646  */
+#line 2298 "parser.cc"
     break;
 
-  case 67:
-#line 692 "parser.y" /* yacc.c:1646  */
-    {
+  case 67: /* else_part: %empty  */
+#line 828 "parser.y"
+                {
                     (yyval.statement_list) = NULL;
                 }
-#line 2286 "parser.cc" /* yacc.c:1646  */
+#line 2306 "parser.cc"
     break;
 
-  case 68:
-#line 699 "parser.y" /* yacc.c:1646  */
-    {
+  case 68: /* opt_expr_list: expr_list  */
+#line 835 "parser.y"
+                {
                     (yyval.expression_list) = (yyvsp[0].expression_list);
                 }
-#line 2294 "parser.cc" /* yacc.c:1646  */
+#line 2314 "parser.cc"
     break;
 
-  case 69:
-#line 703 "parser.y" /* yacc.c:1646  */
-    {
+  case 69: /* opt_expr_list: %empty  */
+#line 839 "parser.y"
+                {
                     (yyval.expression_list) = NULL;
                 }
-#line 2302 "parser.cc" /* yacc.c:1646  */
+#line 2322 "parser.cc"
     break;
 
-  case 70:
-#line 710 "parser.y" /* yacc.c:1646  */
-    {
+  case 70: /* expr_list: expr  */
+#line 846 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[0]).first_line,(yylsp[0]).first_column);
                     (yyval.expression_list) = new ast_expr_list(pos, (yyvsp[0].expression));
                 }
-#line 2311 "parser.cc" /* yacc.c:1646  */
+#line 2331 "parser.cc"
     break;
 
-  case 71:
-#line 715 "parser.y" /* yacc.c:1646  */
-    {
-                    position_information *pos =new position_information((yylsp[-2]).first_line, (yylsp[-2]).first_column);
-                    (yyval.expression_list) = new ast_expr_list(pos, (yyvsp[0].expression), (yyvsp[-2].expression_list));
+  case 71: /* expr_list: expr_list T_COMMA expr  */
+#line 851 "parser.y"
+                {
+                    (yyvsp[-2].expression_list)->append((yyvsp[0].expression));
+                    (yyval.expression_list) = (yyvsp[-2].expression_list);
                 }
-#line 2320 "parser.cc" /* yacc.c:1646  */
+#line 2340 "parser.cc"
     break;
 
-  case 72:
-#line 723 "parser.y" /* yacc.c:1646  */
-    {
+  case 72: /* expr: simple_expr  */
+#line 859 "parser.y"
+                {
                      (yyval.expression) = (yyvsp[0].expression);
                 }
-#line 2328 "parser.cc" /* yacc.c:1646  */
+#line 2348 "parser.cc"
     break;
 
-  case 73:
-#line 727 "parser.y" /* yacc.c:1646  */
-    {
+  case 73: /* expr: expr T_EQ simple_expr  */
+#line 863 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
                     (yyval.expression) = new ast_equal(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2337 "parser.cc" /* yacc.c:1646  */
+#line 2357 "parser.cc"
     break;
 
-  case 74:
-#line 732 "parser.y" /* yacc.c:1646  */
-    {
+  case 74: /* expr: expr T_NOTEQ simple_expr  */
+#line 868 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
                     (yyval.expression) = new ast_notequal(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2346 "parser.cc" /* yacc.c:1646  */
+#line 2366 "parser.cc"
     break;
 
-  case 75:
-#line 737 "parser.y" /* yacc.c:1646  */
-    {
+  case 75: /* expr: expr T_LESSTHAN simple_expr  */
+#line 873 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
                     (yyval.expression) = new ast_lessthan(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2355 "parser.cc" /* yacc.c:1646  */
+#line 2375 "parser.cc"
     break;
 
-  case 76:
-#line 742 "parser.y" /* yacc.c:1646  */
-    {
+  case 76: /* expr: expr T_GREATERTHAN simple_expr  */
+#line 878 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line, (yylsp[-2]).first_column);
                     (yyval.expression) = new ast_greaterthan(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2364 "parser.cc" /* yacc.c:1646  */
+#line 2384 "parser.cc"
     break;
 
-  case 77:
-#line 750 "parser.y" /* yacc.c:1646  */
-    {
+  case 77: /* simple_expr: term  */
+#line 886 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[0].expression);
                 }
-#line 2372 "parser.cc" /* yacc.c:1646  */
+#line 2392 "parser.cc"
     break;
 
-  case 78:
-#line 754 "parser.y" /* yacc.c:1646  */
-    {
+  case 78: /* simple_expr: T_ADD term  */
+#line 890 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[0].expression);
                 }
-#line 2380 "parser.cc" /* yacc.c:1646  */
+#line 2400 "parser.cc"
     break;
 
-  case 79:
-#line 758 "parser.y" /* yacc.c:1646  */
-    {
+  case 79: /* simple_expr: T_SUB term  */
+#line 894 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-1]).first_line,(yylsp[-1]).first_column);
       		  		    (yyval.expression) = new ast_uminus(pos, (yyvsp[0].expression));
                 }
-#line 2389 "parser.cc" /* yacc.c:1646  */
+#line 2409 "parser.cc"
     break;
 
-  case 80:
-#line 763 "parser.y" /* yacc.c:1646  */
-    {
+  case 80: /* simple_expr: simple_expr T_OR term  */
+#line 899 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
           					(yyval.expression) = new ast_or(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2398 "parser.cc" /* yacc.c:1646  */
+#line 2418 "parser.cc"
     break;
 
-  case 81:
-#line 768 "parser.y" /* yacc.c:1646  */
-    {
+  case 81: /* simple_expr: simple_expr T_ADD term  */
+#line 904 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
           					(yyval.expression) = new ast_add(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2407 "parser.cc" /* yacc.c:1646  */
+#line 2427 "parser.cc"
     break;
 
-  case 82:
-#line 773 "parser.y" /* yacc.c:1646  */
-    {
+  case 82: /* simple_expr: simple_expr T_SUB term  */
+#line 909 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line,(yylsp[-2]).first_column);
       					    (yyval.expression) = new ast_sub(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2416 "parser.cc" /* yacc.c:1646  */
+#line 2436 "parser.cc"
     break;
 
-  case 83:
-#line 781 "parser.y" /* yacc.c:1646  */
-    {
+  case 83: /* term: factor  */
+#line 917 "parser.y"
+                {
                      (yyval.expression) = (yyvsp[0].expression);
                 }
-#line 2424 "parser.cc" /* yacc.c:1646  */
+#line 2444 "parser.cc"
     break;
 
-  case 84:
-#line 785 "parser.y" /* yacc.c:1646  */
-    {
+  case 84: /* term: term T_AND factor  */
+#line 921 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line, (yylsp[-2]).first_column);
                     (yyval.expression) = new ast_and(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2433 "parser.cc" /* yacc.c:1646  */
+#line 2453 "parser.cc"
     break;
 
-  case 85:
-#line 790 "parser.y" /* yacc.c:1646  */
-    {
+  case 85: /* term: term T_MUL factor  */
+#line 926 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line, (yylsp[-2]).first_column);
                     (yyval.expression) = new ast_mult(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2442 "parser.cc" /* yacc.c:1646  */
+#line 2462 "parser.cc"
     break;
 
-  case 86:
-#line 795 "parser.y" /* yacc.c:1646  */
-    {
+  case 86: /* term: term T_RDIV factor  */
+#line 931 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line, (yylsp[-2]).first_column);
                     (yyval.expression) = new ast_divide(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2451 "parser.cc" /* yacc.c:1646  */
+#line 2471 "parser.cc"
     break;
 
-  case 87:
-#line 800 "parser.y" /* yacc.c:1646  */
-    {
+  case 87: /* term: term T_IDIV factor  */
+#line 936 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line, (yylsp[-2]).first_column);
                     (yyval.expression) = new ast_idiv(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2460 "parser.cc" /* yacc.c:1646  */
+#line 2480 "parser.cc"
     break;
 
-  case 88:
-#line 805 "parser.y" /* yacc.c:1646  */
-    {
+  case 88: /* term: term T_MOD factor  */
+#line 941 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-2]).first_line, (yylsp[-2]).first_column);
                     (yyval.expression) = new ast_mod(pos, (yyvsp[-2].expression), (yyvsp[0].expression));
                 }
-#line 2469 "parser.cc" /* yacc.c:1646  */
+#line 2489 "parser.cc"
     break;
 
-  case 89:
-#line 813 "parser.y" /* yacc.c:1646  */
-    {
+  case 89: /* factor: rvariable  */
+#line 949 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[0].expression);
                 }
-#line 2477 "parser.cc" /* yacc.c:1646  */
+#line 2497 "parser.cc"
     break;
 
-  case 90:
-#line 817 "parser.y" /* yacc.c:1646  */
-    {
+  case 90: /* factor: func_call  */
+#line 953 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[0].function_call);
                 }
-#line 2485 "parser.cc" /* yacc.c:1646  */
+#line 2505 "parser.cc"
     break;
 
-  case 91:
-#line 821 "parser.y" /* yacc.c:1646  */
-    {
+  case 91: /* factor: integer  */
+#line 957 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[0].integer);
                 }
-#line 2493 "parser.cc" /* yacc.c:1646  */
+#line 2513 "parser.cc"
     break;
 
-  case 92:
-#line 825 "parser.y" /* yacc.c:1646  */
-    {
+  case 92: /* factor: real  */
+#line 961 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[0].real);
                 }
-#line 2501 "parser.cc" /* yacc.c:1646  */
+#line 2521 "parser.cc"
     break;
 
-  case 93:
-#line 829 "parser.y" /* yacc.c:1646  */
-    {
+  case 93: /* factor: T_NOT factor  */
+#line 965 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-1]).first_line,(yylsp[-1]).first_column);
                     (yyval.expression) = new ast_not(pos, (yyvsp[0].expression));
                 }
-#line 2510 "parser.cc" /* yacc.c:1646  */
+#line 2530 "parser.cc"
     break;
 
-  case 94:
-#line 834 "parser.y" /* yacc.c:1646  */
-    {
+  case 94: /* factor: T_LEFTPAR expr T_RIGHTPAR  */
+#line 970 "parser.y"
+                {
                     (yyval.expression) = (yyvsp[-1].expression);
                 }
-#line 2518 "parser.cc" /* yacc.c:1646  */
+#line 2538 "parser.cc"
     break;
 
-  case 95:
-#line 841 "parser.y" /* yacc.c:1646  */
-    {
+  case 95: /* func_call: func_id T_LEFTPAR opt_expr_list T_RIGHTPAR  */
+#line 977 "parser.y"
+                {
                     position_information *pos = new position_information((yylsp[-3]).first_line,(yylsp[-3]).first_column);
                     (yyval.function_call) = new ast_functioncall(pos, (yyvsp[-3].id), (yyvsp[-1].expression_list));
                 }
-#line 2527 "parser.cc" /* yacc.c:1646  */
+#line 2547 "parser.cc"
     break;
 
-  case 96:
-#line 849 "parser.y" /* yacc.c:1646  */
-    {
+  case 96: /* integer: T_INTNUM  */
+#line 985 "parser.y"
+                {
                     position_information *pos =
                         new position_information((yylsp[0]).first_line,
                                                  (yylsp[0]).first_column);
@@ -2537,12 +2557,12 @@ yyreduce:
                     (yyval.integer) = new ast_integer(pos,
                                          (yyvsp[0].ival));
                 }
-#line 2541 "parser.cc" /* yacc.c:1646  */
+#line 2561 "parser.cc"
     break;
 
-  case 97:
-#line 862 "parser.y" /* yacc.c:1646  */
-    {
+  case 97: /* real: T_REALNUM  */
+#line 998 "parser.y"
+                {
                     position_information *pos =
                         new position_information((yylsp[0]).first_line,
                                                  (yylsp[0]).first_column);
@@ -2551,12 +2571,12 @@ yyreduce:
                     (yyval.real) = new ast_real(pos,
                                       (yyvsp[0].rval));
                 }
-#line 2555 "parser.cc" /* yacc.c:1646  */
+#line 2575 "parser.cc"
     break;
 
-  case 98:
-#line 875 "parser.y" /* yacc.c:1646  */
-    {
+  case 98: /* type_id: id  */
+#line 1011 "parser.y"
+                {
                     // Make sure this id is really declared as a type.
                     // debug() << "type_id -> id: "
                     //       << sym_tab->get_symbol($1->sym_p) << endl;
@@ -2567,12 +2587,12 @@ yyreduce:
                     }
                     (yyval.id) = (yyvsp[0].id);
                 }
-#line 2571 "parser.cc" /* yacc.c:1646  */
+#line 2591 "parser.cc"
     break;
 
-  case 99:
-#line 890 "parser.y" /* yacc.c:1646  */
-    {
+  case 99: /* const_id: id  */
+#line 1026 "parser.y"
+                {
                     // Make sure this id is really declared as a constant.
                     // debug() << "const_id -> id: " << $1->sym_p << endl;
                     if(sym_tab->get_symbol_tag((yyvsp[0].id)->sym_p) != SYM_CONST) {
@@ -2582,12 +2602,12 @@ yyreduce:
                     }
                     (yyval.id) = (yyvsp[0].id);
                 }
-#line 2586 "parser.cc" /* yacc.c:1646  */
+#line 2606 "parser.cc"
     break;
 
-  case 100:
-#line 904 "parser.y" /* yacc.c:1646  */
-    {
+  case 100: /* lvar_id: id  */
+#line 1040 "parser.y"
+                {
                     // Make sure this id is really declared as an lvariable.
                     // debug() << "lvar_id -> id: " << $1->sym_p << endl;
                     if (sym_tab->get_symbol_tag((yyvsp[0].id)->sym_p) != SYM_VAR &&
@@ -2598,12 +2618,12 @@ yyreduce:
                     }
                     (yyval.id) = (yyvsp[0].id);
                 }
-#line 2602 "parser.cc" /* yacc.c:1646  */
+#line 2622 "parser.cc"
     break;
 
-  case 101:
-#line 917 "parser.y" /* yacc.c:1646  */
-    {
+  case 101: /* rvar_id: id  */
+#line 1053 "parser.y"
+                {
                     // Make sure this id is really declared as an rvariable.
                     // debug() << "rvar_id -> id: " << $1->sym_p << endl;
                     if (sym_tab->get_symbol_tag((yyvsp[0].id)->sym_p) != SYM_VAR &&
@@ -2616,12 +2636,12 @@ yyreduce:
                     }
                     (yyval.id) = (yyvsp[0].id);
                 }
-#line 2620 "parser.cc" /* yacc.c:1646  */
+#line 2640 "parser.cc"
     break;
 
-  case 102:
-#line 934 "parser.y" /* yacc.c:1646  */
-    {
+  case 102: /* proc_id: id  */
+#line 1070 "parser.y"
+                {
                     // Make sure this id is really declared as a procedure.
                     // debug() << "proc_id -> id: " << $1->sym_p << endl;
                     if (sym_tab->get_symbol_tag((yyvsp[0].id)->sym_p) != SYM_PROC) {
@@ -2631,12 +2651,12 @@ yyreduce:
                     }
                     (yyval.id) = (yyvsp[0].id);
                 }
-#line 2635 "parser.cc" /* yacc.c:1646  */
+#line 2655 "parser.cc"
     break;
 
-  case 103:
-#line 948 "parser.y" /* yacc.c:1646  */
-    {
+  case 103: /* func_id: id  */
+#line 1084 "parser.y"
+                {
                     // Make sure this id is really declared as a function.
                     // debug() << "func_id -> id: " << $1->sym_p << endl;
                     if (sym_tab->get_symbol_tag((yyvsp[0].id)->sym_p) != SYM_FUNC) {
@@ -2646,12 +2666,12 @@ yyreduce:
                     }
                     (yyval.id) = (yyvsp[0].id);
                 }
-#line 2650 "parser.cc" /* yacc.c:1646  */
+#line 2670 "parser.cc"
     break;
 
-  case 104:
-#line 962 "parser.y" /* yacc.c:1646  */
-    {
+  case 104: /* array_id: id  */
+#line 1098 "parser.y"
+                {
                     // Make sure this id is really declared as an array.
                     // debug() << "array_id -> id: " << $1->sym_p << endl;
                     if (sym_tab->get_symbol_tag((yyvsp[0].id)->sym_p) != SYM_ARRAY) {
@@ -2661,12 +2681,12 @@ yyreduce:
                     }
                     (yyval.id) = (yyvsp[0].id);
                 }
-#line 2665 "parser.cc" /* yacc.c:1646  */
+#line 2685 "parser.cc"
     break;
 
-  case 105:
-#line 976 "parser.y" /* yacc.c:1646  */
-    {
+  case 105: /* id: T_IDENT  */
+#line 1112 "parser.y"
+                {
                     sym_index sym_p;    // Used to find previous use of symbol.
                     position_information *pos =
                         new position_information((yylsp[0]).first_line,
@@ -2685,11 +2705,12 @@ yyreduce:
                                     sym_p);
                     (yyval.id)->type = sym_tab->get_symbol_type(sym_p);
                 }
-#line 2689 "parser.cc" /* yacc.c:1646  */
+#line 2709 "parser.cc"
     break;
 
 
-#line 2693 "parser.cc" /* yacc.c:1646  */
+#line 2713 "parser.cc"
+
       default: break;
     }
   /* User semantic actions sometimes alter yychar, and that requires
@@ -2703,11 +2724,10 @@ yyreduce:
      case of YYERROR or YYBACKUP, subsequent parser actions might lead
      to an incorrect destructor call or verbose syntax error message
      before the lookahead is translated.  */
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
   *++yylsp = yyloc;
@@ -2715,14 +2735,13 @@ yyreduce:
   /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
      number reduced by.  */
-
-  yyn = yyr1[yyn];
-
-  yystate = yypgoto[yyn - YYNTOKENS] + *yyssp;
-  if (0 <= yystate && yystate <= YYLAST && yycheck[yystate] == *yyssp)
-    yystate = yytable[yystate];
-  else
-    yystate = yydefgoto[yyn - YYNTOKENS];
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
 
   goto yynewstate;
 
@@ -2733,50 +2752,15 @@ yyreduce:
 yyerrlab:
   /* Make sure we have latest lookahead translation.  See comments at
      user semantic actions for why this is necessary.  */
-  yytoken = yychar == YYEMPTY ? YYEMPTY : YYTRANSLATE (yychar);
-
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
       yyerror (YY_("syntax error"));
-#else
-# define YYSYNTAX_ERROR yysyntax_error (&yymsg_alloc, &yymsg, \
-                                        yyssp, yytoken)
-      {
-        char const *yymsgp = YY_("syntax error");
-        int yysyntax_error_status;
-        yysyntax_error_status = YYSYNTAX_ERROR;
-        if (yysyntax_error_status == 0)
-          yymsgp = yymsg;
-        else if (yysyntax_error_status == 1)
-          {
-            if (yymsg != yymsgbuf)
-              YYSTACK_FREE (yymsg);
-            yymsg = (char *) YYSTACK_ALLOC (yymsg_alloc);
-            if (!yymsg)
-              {
-                yymsg = yymsgbuf;
-                yymsg_alloc = sizeof yymsgbuf;
-                yysyntax_error_status = 2;
-              }
-            else
-              {
-                yysyntax_error_status = YYSYNTAX_ERROR;
-                yymsgp = yymsg;
-              }
-          }
-        yyerror (yymsgp);
-        if (yysyntax_error_status == 2)
-          goto yyexhaustedlab;
-      }
-# undef YYSYNTAX_ERROR
-#endif
     }
 
   yyerror_range[1] = yylloc;
-
   if (yyerrstatus == 3)
     {
       /* If just tried and failed to reuse lookahead token after an
@@ -2805,14 +2789,12 @@ yyerrlab:
 | yyerrorlab -- error raised explicitly by YYERROR.  |
 `---------------------------------------------------*/
 yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
 
-  /* Pacify compilers like GCC when the user code never invokes
-     YYERROR and the label yyerrorlab therefore never appears in user
-     code.  */
-  if (/*CONSTCOND*/ 0)
-     goto yyerrorlab;
-
-  yyerror_range[1] = yylsp[1-yylen];
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
   YYPOPSTACK (yylen);
@@ -2828,13 +2810,14 @@ yyerrorlab:
 yyerrlab1:
   yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
       if (!yypact_value_is_default (yyn))
         {
-          yyn += YYTERROR;
-          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
             {
               yyn = yytable[yyn];
               if (0 < yyn)
@@ -2848,7 +2831,7 @@ yyerrlab1:
 
       yyerror_range[1] = *yylsp;
       yydestruct ("Error: popping",
-                  yystos[yystate], yyvsp, yylsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, yylsp);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
@@ -2859,13 +2842,11 @@ yyerrlab1:
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 
   yyerror_range[2] = yylloc;
-  /* Using YYLLOC is tempting, but would change the location of
-     the lookahead.  YYLOC is available though.  */
-  YYLLOC_DEFAULT (yyloc, yyerror_range, 2);
-  *++yylsp = yyloc;
+  ++yylsp;
+  YYLLOC_DEFAULT (*yylsp, yyerror_range, 2);
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -2876,26 +2857,30 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
 /*-----------------------------------.
 | yyabortlab -- YYABORT comes here.  |
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
-#if !defined yyoverflow || YYERROR_VERBOSE
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
   yyerror (YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
+
 
-yyreturn:
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
   if (yychar != YYEMPTY)
     {
       /* Make sure we have latest lookahead translation.  See comments at
@@ -2911,18 +2896,16 @@ yyreturn:
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-                  yystos[*yyssp], yyvsp, yylsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, yylsp);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
-  if (yymsg != yymsgbuf)
-    YYSTACK_FREE (yymsg);
-#endif
+
   return yyresult;
 }
-#line 998 "parser.y" /* yacc.c:1906  */
+
+#line 1134 "parser.y"
 
@@ -1,8 +1,9 @@
-/* A Bison parser, made by GNU Bison 3.0.2.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2013 Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
    This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
@@ -15,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -30,6 +31,10 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 #ifndef YY_YY_PARSER_HH_INCLUDED
 # define YY_YY_PARSER_HH_INCLUDED
 /* Debug traces.  */
@@ -40,64 +45,68 @@
 extern int yydebug;
 #endif
 
-/* Token type.  */
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
   enum yytokentype
   {
-    T_EOF = 258,
-    T_ERROR = 259,
-    T_DOT = 260,
-    T_SEMICOLON = 261,
-    T_EQ = 262,
-    T_COLON = 263,
-    T_LEFTBRACKET = 264,
-    T_RIGHTBRACKET = 265,
-    T_LEFTPAR = 266,
-    T_RIGHTPAR = 267,
-    T_COMMA = 268,
-    T_LESSTHAN = 269,
-    T_GREATERTHAN = 270,
-    T_ADD = 271,
-    T_SUB = 272,
-    T_MUL = 273,
-    T_RDIV = 274,
-    T_OF = 275,
-    T_IF = 276,
-    T_DO = 277,
-    T_ASSIGN = 278,
-    T_NOTEQ = 279,
-    T_OR = 280,
-    T_VAR = 281,
-    T_END = 282,
-    T_AND = 283,
-    T_IDIV = 284,
-    T_MOD = 285,
-    T_NOT = 286,
-    T_THEN = 287,
-    T_ELSE = 288,
-    T_CONST = 289,
-    T_ARRAY = 290,
-    T_BEGIN = 291,
-    T_WHILE = 292,
-    T_ELSIF = 293,
-    T_RETURN = 294,
-    T_STRINGCONST = 295,
-    T_IDENT = 296,
-    T_PROGRAM = 297,
-    T_PROCEDURE = 298,
-    T_FUNCTION = 299,
-    T_INTNUM = 300,
-    T_REALNUM = 301
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    T_EOF = 258,                   /* T_EOF  */
+    T_ERROR = 259,                 /* T_ERROR  */
+    T_DOT = 260,                   /* T_DOT  */
+    T_SEMICOLON = 261,             /* T_SEMICOLON  */
+    T_EQ = 262,                    /* T_EQ  */
+    T_COLON = 263,                 /* T_COLON  */
+    T_LEFTBRACKET = 264,           /* T_LEFTBRACKET  */
+    T_RIGHTBRACKET = 265,          /* T_RIGHTBRACKET  */
+    T_LEFTPAR = 266,               /* T_LEFTPAR  */
+    T_RIGHTPAR = 267,              /* T_RIGHTPAR  */
+    T_COMMA = 268,                 /* T_COMMA  */
+    T_LESSTHAN = 269,              /* T_LESSTHAN  */
+    T_GREATERTHAN = 270,           /* T_GREATERTHAN  */
+    T_ADD = 271,                   /* T_ADD  */
+    T_SUB = 272,                   /* T_SUB  */
+    T_MUL = 273,                   /* T_MUL  */
+    T_RDIV = 274,                  /* T_RDIV  */
+    T_OF = 275,                    /* T_OF  */
+    T_IF = 276,                    /* T_IF  */
+    T_DO = 277,                    /* T_DO  */
+    T_ASSIGN = 278,                /* T_ASSIGN  */
+    T_NOTEQ = 279,                 /* T_NOTEQ  */
+    T_OR = 280,                    /* T_OR  */
+    T_VAR = 281,                   /* T_VAR  */
+    T_END = 282,                   /* T_END  */
+    T_AND = 283,                   /* T_AND  */
+    T_IDIV = 284,                  /* T_IDIV  */
+    T_MOD = 285,                   /* T_MOD  */
+    T_NOT = 286,                   /* T_NOT  */
+    T_THEN = 287,                  /* T_THEN  */
+    T_ELSE = 288,                  /* T_ELSE  */
+    T_CONST = 289,                 /* T_CONST  */
+    T_ARRAY = 290,                 /* T_ARRAY  */
+    T_BEGIN = 291,                 /* T_BEGIN  */
+    T_WHILE = 292,                 /* T_WHILE  */
+    T_ELSIF = 293,                 /* T_ELSIF  */
+    T_RETURN = 294,                /* T_RETURN  */
+    T_STRINGCONST = 295,           /* T_STRINGCONST  */
+    T_IDENT = 296,                 /* T_IDENT  */
+    T_PROGRAM = 297,               /* T_PROGRAM  */
+    T_PROCEDURE = 298,             /* T_PROCEDURE  */
+    T_FUNCTION = 299,              /* T_FUNCTION  */
+    T_INTNUM = 300,                /* T_INTNUM  */
+    T_REALNUM = 301                /* T_REALNUM  */
   };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
 
 /* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE YYSTYPE;
 union YYSTYPE
 {
-#line 54 "parser.y" /* yacc.c:1909  */
+#line 63 "parser.y"
 
     ast_node             *ast;
     ast_id               *id;
@@ -119,8 +128,10 @@ union YYSTYPE
     pool_index            str;
     pool_index            pool_p;
 
-#line 123 "parser.hh" /* yacc.c:1909  */
+#line 132 "parser.hh"
+
 };
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
 # define YYSTYPE_IS_DECLARED 1
 #endif
@@ -142,6 +153,8 @@ struct YYLTYPE
 
 extern YYSTYPE yylval;
 extern YYLTYPE yylloc;
+
 int yyparse (void);
 
+
 #endif /* !YY_YY_PARSER_HH_INCLUDED  */
@@ -2,7 +2,13 @@
 #include <iostream>
 #include "semantic.hh"
 #include "optimize.hh"
+#include "quadopt.hh"
+#include "flowgraph.hh"
+#include "inliner.hh"
 #include "codegen.hh"
+#include "pipeline.hh"
+#include "cache.hh"
+#include "stats.hh"
 
 /* Defined in parser.cc */
 extern char *yytext;
@@ -30,8 +36,11 @@ extern void yyerror(string);
    given to the 'diesel' script. */
 extern bool print_ast;
 extern bool print_quads;
+extern bool print_flow_graph;
 extern bool typecheck;
 extern bool optimize;
+extern bool optimize_quads;
+extern bool inline_calls;
 extern bool quads;
 extern bool assembler;
 
@@ -125,11 +134,13 @@ program         : prog_decl subprog_part comp_stmt T_DOT
                 {
 
                     symbol *env = sym_tab->get_symbol($1->sym_p);
+                    compile_stats->begin_block(env);
 
                     // The status variables here depend on what flags were
                     // passed to the compiler. See the 'diesel' script for
                     // more information.
                     if (typecheck) {
+                        compile_stats->enter_phase(PHASE_TYPECHECK);
                         type_checker->do_typecheck(env, $3);
                     }
 
@@ -139,6 +150,7 @@ program         : prog_decl subprog_part comp_stmt T_DOT
                     }
 
                     if (optimize) {
+                        compile_stats->enter_phase(PHASE_OPTIMIZE);
                         optimizer->do_optimize($3);
                         if(print_ast) {
                             cout << "\nOptimized AST for global level" << endl;
@@ -146,17 +158,45 @@ program         : prog_decl subprog_part comp_stmt T_DOT
                         }
                     }
                     if (error_count == 0) {
-                        if (quads) {
+                        if (quads && code_cache->replay($1->sym_p, $3)) {
+                            cout << "Reusing assembler, global level" << endl;
+                        } else if (quads) {
+                            compile_stats->enter_phase(PHASE_QUADS);
                             quad_list *q = $1->do_quads($3);
-                            if (print_quads) {
-                                cout << "\nQuad list for global level" << endl;
-                                cout << (quad_list *)q << endl;
-                            }
-
-                            if (assembler) {
+                            compile_stats->count_quads(q->size());
+                            if (pipeline->active()) {
                                 cout << "Generating assembler, global level"
                                      << endl;
-                                code_gen->generate_assembler(q, env);
+                                pipeline->submit($1->sym_p, q);
+                            } else {
+                                if (optimize_quads) {
+                                    compile_stats->enter_phase(PHASE_QUADOPT);
+                                    if (inline_calls) {
+                                        inliner->do_inline(q);
+                                    }
+                                    quad_opt->do_optimize(q);
+                                    compile_stats->count_optimized_quads(
+                                        q->size());
+                                    quad_opt->do_vectorize(q);
+                                }
+                                if (print_quads) {
+                                    cout << "\nQuad list for global level" << endl;
+                                    cout << (quad_list *)q << endl;
+                                }
+                                if (print_flow_graph) {
+                                    cout << "\nFlow graph for global level"
+                                         << endl;
+                                    flow_graph graph(q);
+                                    graph.print(cout);
+                                }
+
+                                if (assembler) {
+                                    cout << "Generating assembler, global level"
+                                         << endl;
+                                    compile_stats->enter_phase(PHASE_CODEGEN);
+                                    code_cache->generate_assembler($1->sym_p, q);
+                                }
+                                delete q;
                             }
                         }
                     } else {
@@ -166,6 +206,8 @@ program         : prog_decl subprog_part comp_stmt T_DOT
 
                     // We close the global scope.
                     sym_tab->close_scope();
+                    close_ast_arena();
+                    compile_stats->end_block();
                 }
                 ;
 
@@ -182,6 +224,7 @@ prog_head       : T_PROGRAM T_IDENT
                     position_information *pos = new position_information(@1.first_line,@1.first_column);
                     $$ = new ast_procedurehead(pos, sym_tab->enter_procedure(pos, $2));
                     sym_tab->open_scope();
+                    open_ast_arena();
                 }
                 ;
 
@@ -322,8 +365,10 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                 {
 
                     symbol *env = sym_tab->get_symbol($1->sym_p);
+                    compile_stats->begin_block(env);
 
                     if (typecheck) {
+                        compile_stats->enter_phase(PHASE_TYPECHECK);
                         type_checker->do_typecheck(env, $3);
                     }
 
@@ -335,6 +380,7 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                     }
 
                     if (optimize) {
+                        compile_stats->enter_phase(PHASE_OPTIMIZE);
                         optimizer->do_optimize($3);
                         if (print_ast) {
                             cout << "\nOptimized AST for \""
@@ -345,33 +391,73 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                     }
 
                     if (error_count == 0) {
-                        if (quads) {
+                        if (quads && code_cache->replay($1->sym_p, $3)) {
+                            cout << "Reusing assembler for procedure \""
+                                 << sym_tab->pool_lookup(env->id) << "\""
+                                 << endl;
+                        } else if (quads) {
+                            compile_stats->enter_phase(PHASE_QUADS);
                             quad_list *q = $1->do_quads($3);
-                            if (print_quads) {
-                                cout << "\nQuad list for \""
-                                     << sym_tab->pool_lookup(env->id)
-                                     << "\"" << endl;
-                                cout << (quad_list *)q << endl;
-                            }
-
-                            if (assembler) {
+                            compile_stats->count_quads(q->size());
+                            if (pipeline->active()) {
                                 cout << "Generating assembler for procedure \""
                                      << sym_tab->pool_lookup(env->id)
                                      << "\"" << endl;
-                                code_gen->generate_assembler(q, env);
+                                pipeline->submit($1->sym_p, q);
+                            } else {
+                                if (optimize_quads) {
+                                    compile_stats->enter_phase(PHASE_QUADOPT);
+                                    if (inline_calls) {
+                                        inliner->do_inline(q);
+                                    }
+                                    quad_opt->do_optimize(q);
+                                    compile_stats->count_optimized_quads(
+                                        q->size());
+                                    if (inline_calls) {
+                                        inliner->keep_block($1->sym_p, q);
+                                    }
+                                    quad_opt->do_vectorize(q);
+                                }
+                                if (print_quads) {
+                                    cout << "\nQuad list for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    cout << (quad_list *)q << endl;
+                                }
+                                if (print_flow_graph) {
+                                    cout << "\nFlow graph for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    flow_graph graph(q);
+                                    graph.print(cout);
+                                }
+
+                                if (assembler) {
+                                    cout << "Generating assembler for procedure \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    compile_stats->enter_phase(PHASE_CODEGEN);
+                                    code_cache->generate_assembler($1->sym_p, q);
+                                }
+                                delete q;
                             }
                         }
                     }
 
-                    // Close the current scope.
+                    // Close the current scope. All AST nodes of the block
+                    // are freed along with it.
                     sym_tab->close_scope();
+                    close_ast_arena();
+                    compile_stats->end_block();
                 }
                 | func_decl subprog_part comp_stmt T_SEMICOLON
                 {
 
                     symbol *env = sym_tab->get_symbol($1->sym_p);
+                    compile_stats->begin_block(env);
 
                     if (typecheck) {
+                        compile_stats->enter_phase(PHASE_TYPECHECK);
                         type_checker->do_typecheck(env, $3);
                     }
 
@@ -383,6 +469,7 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                     }
 
                     if (optimize) {
+                        compile_stats->enter_phase(PHASE_OPTIMIZE);
                         optimizer->do_optimize($3);
                         if (print_ast) {
                             cout << "\nOptimized AST for \""
@@ -393,26 +480,64 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                     }
 
                     if (error_count == 0) {
-                        if (quads) {
+                        if (quads && code_cache->replay($1->sym_p, $3)) {
+                            cout << "Reusing assembler for function \""
+                                 << sym_tab->pool_lookup(env->id) << "\""
+                                 << endl;
+                        } else if (quads) {
+                            compile_stats->enter_phase(PHASE_QUADS);
                             quad_list *q = $1->do_quads($3);
-                            if (print_quads) {
-                                cout << "\nQuad list for \""
-                                     << sym_tab->pool_lookup(env->id)
-                                     << "\"" << endl;
-                                cout << (quad_list *)q << endl;
-                            }
-
-                            if (assembler) {
+                            compile_stats->count_quads(q->size());
+                            if (pipeline->active()) {
                                 cout << "Generating assembler for function \""
                                      << sym_tab->pool_lookup(env->id) << "\""
                                      << endl;
-                                code_gen->generate_assembler(q, env);
+                                pipeline->submit($1->sym_p, q);
+                            } else {
+                                if (optimize_quads) {
+                                    compile_stats->enter_phase(PHASE_QUADOPT);
+                                    if (inline_calls) {
+                                        inliner->do_inline(q);
+                                    }
+                                    quad_opt->do_optimize(q);
+                                    compile_stats->count_optimized_quads(
+                                        q->size());
+                                    if (inline_calls) {
+                                        inliner->keep_block($1->sym_p, q);
+                                    }
+                                    quad_opt->do_vectorize(q);
+                                }
+                                if (print_quads) {
+                                    cout << "\nQuad list for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    cout << (quad_list *)q << endl;
+                                }
+                                if (print_flow_graph) {
+                                    cout << "\nFlow graph for \""
+                                         << sym_tab->pool_lookup(env->id)
+                                         << "\"" << endl;
+                                    flow_graph graph(q);
+                                    graph.print(cout);
+                                }
+
+                                if (assembler) {
+                                    cout << "Generating assembler for function \""
+                                         << sym_tab->pool_lookup(env->id) << "\""
+                                         << endl;
+                                    compile_stats->enter_phase(PHASE_CODEGEN);
+                                    code_cache->generate_assembler($1->sym_p, q);
+                                }
+                                delete q;
                             }
                         }
                     }
 
-                    // Close the current scope.
+                    // Close the current scope. All AST nodes of the block
+                    // are freed along with it.
                     sym_tab->close_scope();
+                    close_ast_arena();
+                    compile_stats->end_block();
                 }
                 ;
 
@@ -442,6 +567,7 @@ proc_head       : T_PROCEDURE T_IDENT
                                                                   $2);
                     // Open a new scope.
                     sym_tab->open_scope();
+                    open_ast_arena();
                     // This AST node is just a temporary node which we create
                     // here in order to be able to provide the symbol table
                     // index for the procedure to the proc_decl production
@@ -462,6 +588,7 @@ func_head       : T_FUNCTION T_IDENT
                                                                  $2);
                     // Open a new scope.
                     sym_tab->open_scope();
+                    open_ast_arena();
 
                     // This AST node is just a temporary node which we create
                     // here in order to be able to provide the symbol table
@@ -534,11 +661,15 @@ stmt_list       : stmt
                 }
                 | stmt_list T_SEMICOLON stmt
                 {
-                    position_information *pos =new position_information(@1.first_line,@1.first_column);
-
-                    if ($3 != NULL)
-                        $$ = new ast_stmt_list(pos, $3, $1);
-                    else $$ = $1;
+                    $$ = $1;
+                    if ($3 != NULL) {
+                        if ($1 == NULL) {
+                            position_information *pos =new position_information(@1.first_line,@1.first_column);
+                            $$ = new ast_stmt_list(pos, $3);
+                        } else {
+                            $1->append($3);
+                        }
+                    }
                 }
                 | error T_SEMICOLON stmt
                 {
@@ -666,8 +797,13 @@ rvariable       : rvar_id
 
 elsif_list      : elsif_list elsif
                 {
-                    position_information *pos = new position_information(@1.first_line,@1.first_column);
-                    $$ = new ast_elsif_list(pos, $2, $1);
+                    if ($1 == NULL) {
+                        position_information *pos = new position_information(@1.first_line,@1.first_column);
+                        $$ = new ast_elsif_list(pos, $2);
+                    } else {
+                        $1->append($2);
+                        $$ = $1;
+                    }
                 }
                 | /* empty */
                 {
@@ -713,8 +849,8 @@ expr_list       : expr
                 }
                 | expr_list T_COMMA expr
                 {
-                    position_information *pos =new position_information(@1.first_line, @1.first_column);
-                    $$ = new ast_expr_list(pos, $3, $1);
+                    $1->append($3);
+                    $$ = $1;
                 }
                 ;
 
@@ -0,0 +1,229 @@
+#include "pipeline.hh"
+#include "cache.hh"
+#include "codegen.hh"
+#include "inliner.hh"
+#include "quadopt.hh"
+
+/*** This file contains the -j worker threads. See pipeline.hh for an
+     overview. ***/
+
+// Defined in main.cc.
+extern int worker_threads;
+extern bool optimize_quads;
+extern bool inline_calls;
+extern bool assembler;
+extern bool print_ast;
+extern bool print_quads;
+extern bool print_flow_graph;
+extern bool phase_statistics;
+
+// Defined in codegen.cc.
+extern code_generator *code_gen;
+
+block_pipeline *pipeline = new block_pipeline();
+
+
+block_pipeline::block_pipeline()
+{
+    written = 0;
+    stopping = false;
+}
+
+
+bool block_pipeline::active()
+{
+    return worker_threads > 0 && assembler && !print_ast && !print_quads &&
+        !print_flow_graph && !phase_statistics;
+}
+
+
+/* Hand over the quads of a block. The workers are started with the first
+   block, since the options have been parsed by then. */
+void block_pipeline::submit(sym_index block, quad_list *q)
+{
+    if (workers.empty()) {
+        sym_tab->share();
+        for (int i = 0; i < worker_threads; i++) {
+            workers.push_back(thread(&block_pipeline::work, this));
+        }
+    }
+
+    block_job *job = new block_job;
+    job->block = block;
+    job->q = q;
+    job->kept = false;
+    job->done = false;
+    job->cached = false;
+    sym_tab->reserve_range(&job->range);
+
+    const string *code = code_cache->found_code(block);
+    if (code != NULL) {
+        job->cached = true;
+        job->code = *code;
+    }
+
+    unique_lock<mutex> lock(jobs_mutex);
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        if (quad.op_code != q_call) {
+            continue;
+        }
+        map<sym_index, block_job *>::iterator callee =
+            block_jobs.find(quad.sym1);
+        if (callee != block_jobs.end() &&
+                job->callee_syms.insert(quad.sym1).second) {
+            job->callees.push_back(callee->second);
+        }
+    }
+
+    jobs.push_back(job);
+    block_jobs[block] = job;
+    queue.push_back(job);
+    jobs_changed.notify_all();
+
+    // Write out whatever is done already, so the code doesn't pile up.
+    write_done(lock, false);
+}
+
+
+/* The job is done from the start, and the block isn't kept, since its
+   quads were never generated. */
+void block_pipeline::submit_code(sym_index block, const string &code)
+{
+    block_job *job = new block_job;
+    job->block = block;
+    job->q = NULL;
+    job->kept = true;
+    job->done = true;
+    job->cached = true;
+    job->code = code;
+
+    unique_lock<mutex> lock(jobs_mutex);
+    jobs.push_back(job);
+    block_jobs[block] = job;
+    write_done(lock, false);
+}
+
+
+void block_pipeline::work()
+{
+    quad_optimizer optimizer;
+    string sink;
+    code_generator generator(&sink);
+
+    unique_lock<mutex> lock(jobs_mutex);
+    for (;;) {
+        while (queue.empty() && !stopping) {
+            jobs_changed.wait(lock);
+        }
+        if (queue.empty()) {
+            return;
+        }
+        block_job *job = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+        run(job, &optimizer, &generator, &sink);
+        lock.lock();
+
+        job->done = true;
+        jobs_changed.notify_all();
+    }
+}
+
+
+/* The same steps as in parser.y, for one block. The main program is never
+   kept by the inliner. */
+void block_pipeline::run(block_job *job, quad_optimizer *optimizer,
+                         code_generator *generator, string *sink)
+{
+    symbol *env = sym_tab->get_symbol(job->block);
+    sym_tab->use_range(&job->range);
+
+    if (optimize_quads) {
+        if (inline_calls) {
+            unique_lock<mutex> lock(jobs_mutex);
+            for (unsigned int i = 0; i < job->callees.size(); i++) {
+                while (!job->callees[i]->kept) {
+                    jobs_changed.wait(lock);
+                }
+            }
+            lock.unlock();
+            inliner->do_inline(job->q, &job->callee_syms);
+        }
+        optimizer->do_optimize(job->q);
+        if (inline_calls && env->level > 0) {
+            inliner->keep_block(job->block, job->q);
+        }
+        optimizer->do_vectorize(job->q);
+    }
+
+    {
+        lock_guard<mutex> lock(jobs_mutex);
+        job->kept = true;
+        jobs_changed.notify_all();
+    }
+
+    if (!job->cached) {
+        generator->generate_assembler(job->q, env);
+        job->code.swap(*sink);
+        sink->clear();
+    }
+    delete job->q;
+    job->q = NULL;
+
+    sym_tab->use_range(NULL);
+}
+
+
+/* Called with the lock held, from the parser's thread only, since that is
+   the thread that owns code_gen. */
+void block_pipeline::write_done(unique_lock<mutex> &lock, bool wait)
+{
+    while (written < jobs.size()) {
+        block_job *job = jobs[written];
+        if (!job->done) {
+            if (!wait) {
+                return;
+            }
+            jobs_changed.wait(lock);
+            continue;
+        }
+        code_gen->write_assembler(job->code);
+        if (!job->cached) {
+            code_cache->store(job->block, job->code, job->range.end_label);
+        }
+        job->code.clear();
+        written++;
+    }
+}
+
+
+/* Wait for the workers to get through all the blocks, write out their code
+   and stop them. */
+void block_pipeline::finish()
+{
+    if (jobs.empty()) {
+        return;
+    }
+
+    unique_lock<mutex> lock(jobs_mutex);
+    write_done(lock, true);
+    stopping = true;
+    jobs_changed.notify_all();
+    lock.unlock();
+
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    workers.clear();
+
+    for (unsigned int i = 0; i < jobs.size(); i++) {
+        delete jobs[i];
+    }
+    jobs.clear();
+    block_jobs.clear();
+    written = 0;
+
+    code_gen->print_statistics();
+}
@@ -0,0 +1,123 @@
+#ifndef __PIPELINE_HH__
+#define __PIPELINE_HH__
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "quads.hh"
+#include "symtab.hh"
+
+
+/*** With -j N, the back end of each block, ie, inlining, quad optimization
+     and code generation, runs in one of N worker threads, while the parser
+     goes on with the next block. The front end stays in the parser's
+     thread, since the blocks are parsed and type checked in the scope they
+     are declared in.
+
+     When its quads have been generated, a block is handed over as a job.
+     It gets a range of labels of its own, and its temps are added to the
+     symbol table under a lock, so the code of a block comes out the same
+     whatever thread it runs in and whatever the other threads are doing.
+     Before inlining, a job waits for the jobs of the blocks it calls that
+     were handed over before it to be kept by the inliner, and it is only
+     allowed to expand calls to those, which are the blocks the inliner has
+     kept when it runs in the parser's thread. Since a job only waits for
+     jobs that were taken off the queue before it, that never deadlocks.
+
+     The code of each block is written to a string and then to the output
+     file in the order the blocks were handed over, which is the order they
+     were written in without -j. ***/
+
+
+class block_pipeline;
+class code_generator;
+class quad_optimizer;
+
+// Defined in pipeline.cc.
+extern block_pipeline *pipeline;
+
+
+class block_pipeline
+{
+private:
+    // The back end of a block.
+    struct block_job
+    {
+        // The block, its quads, and the labels and temps it may make.
+        sym_index block;
+        quad_list *q;
+        block_range range;
+
+        // The blocks it calls that were handed over before it.
+        vector<block_job *> callees;
+        set<sym_index> callee_syms;
+
+        // Set once the inliner has kept the block, if it will, and once its
+        // code has been generated.
+        bool kept;
+        bool done;
+
+        // Set if the code was taken from the -C cache, so it is not
+        // generated again.
+        bool cached;
+
+        // The code generated for the block.
+        string code;
+    };
+
+    // All jobs, in the order they were handed over, and the index of the
+    // first one whose code hasn't been written to the output file yet.
+    vector<block_job *> jobs;
+    unsigned long written;
+
+    // The jobs of the blocks handed over so far, by block.
+    map<sym_index, block_job *> block_jobs;
+
+    // The jobs waiting for a worker.
+    deque<block_job *> queue;
+
+    vector<thread> workers;
+    bool stopping;
+
+    // Guards everything above, and is signalled whenever a job is handed
+    // over or gets further.
+    mutex jobs_mutex;
+    condition_variable jobs_changed;
+
+    // What each worker does until it is stopped.
+    void work();
+
+    // Run the back end of a block.
+    void run(block_job *, quad_optimizer *, code_generator *, string *);
+
+    // Write out the code of the jobs that are done, in order. If wait is
+    // true, wait for all of them.
+    void write_done(unique_lock<mutex> &, bool wait);
+
+public:
+    block_pipeline();
+
+    // Returns true if the back end runs in worker threads. The threads are
+    // not used when the quads or the AST are printed, since the printouts
+    // would be mixed up, nor with -T, which times the phases one by one.
+    bool active();
+
+    // These are the interface to parser.y. Hand over the quads of a block
+    // instead of running the back end on them, and write out everything
+    // once the whole program has been parsed.
+    void submit(sym_index, quad_list *);
+    void finish();
+
+    // Hand over the code of a block that was taken from the -C cache, so
+    // that it is written out in its turn.
+    void submit_code(sym_index, const string &);
+};
+
+
+#endif
@@ -0,0 +1,755 @@
+#include <algorithm>
+#include <iostream>
+#include "symtab.hh"
+#include "quadopt.hh"
+#include "flowgraph.hh"
+
+/*** This file contains the quad optimizer. See quadopt.hh for an overview of
+     what the passes do. Quads that are removed are first turned into q_nop,
+     so that indices stay put while a pass runs, and are squeezed out of the
+     list at the end. ***/
+
+// Defined in main.cc.
+extern bool print_quads;
+extern bool vectorize_loops;
+
+quad_optimizer *quad_opt = new quad_optimizer();
+
+
+/* Upper limit on the number of rounds over the passes. One change often
+   makes another possible, but a few rounds catch nearly everything. */
+static const int MAX_ROUNDS = 4;
+
+
+/* The compare-and-branch quad that jumps when a relational quad's result
+   is false, or q_nop if the quad isn't relational. The real versions are
+   chosen so that an unordered compare behaves as it did before fusion. */
+static quad_op_type inverted_branch(quad_op_type op)
+{
+    switch (op) {
+    case q_ieq:
+        return q_ijne;
+    case q_ine:
+        return q_ijeq;
+    case q_ilt:
+        return q_ijge;
+    case q_igt:
+        return q_ijle;
+    case q_req:
+        return q_rjne;
+    case q_rne:
+        return q_rjeq;
+    case q_rlt:
+        return q_rjge;
+    case q_rgt:
+        return q_rjle;
+    default:
+        return q_nop;
+    }
+}
+
+
+/* Returns true for the quads that compute a value from their arguments
+   and nothing else, without any way to fault. Array reads could fault on
+   an index that is only valid once the loop has started, and divisions on
+   zero. */
+static bool can_hoist(quad_op_type op)
+{
+    switch (op) {
+    case q_rload:
+    case q_iload:
+    case q_inot:
+    case q_ruminus:
+    case q_iuminus:
+    case q_rplus:
+    case q_iplus:
+    case q_rminus:
+    case q_iminus:
+    case q_ior:
+    case q_iand:
+    case q_rmult:
+    case q_imult:
+    case q_rdivide:
+    case q_req:
+    case q_ieq:
+    case q_rne:
+    case q_ine:
+    case q_rlt:
+    case q_ilt:
+    case q_rgt:
+    case q_igt:
+    case q_rassign:
+    case q_iassign:
+    case q_lindex:
+    case q_itor:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/* Returns true if an integer compare-and-branch quad jumps for the given
+   arguments, and sets taken. */
+static bool branch_taken(quad_op_type op, long left, long right, bool *taken)
+{
+    switch (op) {
+    case q_ijeq:
+        *taken = left == right;
+        return true;
+    case q_ijne:
+        *taken = left != right;
+        return true;
+    case q_ijlt:
+        *taken = left < right;
+        return true;
+    case q_ijle:
+        *taken = left <= right;
+        return true;
+    case q_ijgt:
+        *taken = left > right;
+        return true;
+    case q_ijge:
+        *taken = left >= right;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/* Returns true if a symbol is an integer constant, or has a known value in
+   const_of, and sets the value. */
+static bool known_constant(map<sym_index, long> &const_of, sym_index sym_p,
+                           long *value)
+{
+    map<sym_index, long>::iterator c = const_of.find(sym_p);
+    if (c != const_of.end()) {
+        *value = c->second;
+        return true;
+    }
+    symbol *sym = sym_tab->get_symbol(sym_p);
+    if (sym->tag == SYM_CONST && sym->type == integer_type) {
+        *value = sym->get_constant_symbol()->const_value.ival;
+        return true;
+    }
+    return false;
+}
+
+
+static void make_nop(quadruple &q)
+{
+    q = quadruple(q_nop, NULL_SYM, NULL_SYM, NULL_SYM);
+}
+
+
+quad_optimizer::quad_optimizer()
+{
+    total_before = 0;
+    total_after = 0;
+}
+
+
+/* The optimizer's interface method. The loop passes get the list after the
+   other passes have cleaned it up, which makes the loops easier to see, and
+   leave new copies and dead temps for them to clean up again. */
+void quad_optimizer::do_optimize(quad_list *q)
+{
+    long before = q->size();
+
+    run_passes(q);
+    if (optimize_loops(q)) {
+        run_passes(q);
+    }
+    q->remove_nops();
+
+    total_before += before;
+    total_after += q->size();
+    if (print_quads) {
+        cout << "\nQuad optimizer: " << before << " -> " << q->size()
+             << " quads (" << total_before << " -> " << total_after
+             << " so far)" << endl;
+    }
+}
+
+
+void quad_optimizer::do_vectorize(quad_list *q)
+{
+    if (vectorize_loops) {
+        vectorizer.do_vectorize(q);
+    }
+}
+
+
+/* The code that can't be reached is removed first, so that nothing it
+   reads counts as used. It takes the flow graph, so it is left out of the
+   rounds, which rarely make any more of it. */
+void quad_optimizer::run_passes(quad_list *q)
+{
+    remove_unreachable_code(q);
+    for (int round = 0; round < MAX_ROUNDS; round++) {
+        bool changed = false;
+        count_uses(q);
+        changed |= retarget_temps(q);
+        changed |= propagate_copies(q);
+        count_uses(q);
+        changed |= remove_dead_temps(q);
+        count_uses(q);
+        changed |= fuse_branches(q);
+        changed |= q->layout_branches();
+        if (!changed) {
+            break;
+        }
+    }
+}
+
+
+void quad_optimizer::count_uses(quad_list *q)
+{
+    uses.clear();
+    for (long i = 0; i < q->size(); i++) {
+        sym_index *slots[2];
+        int n = (*q)[i].use_slots(slots);
+        for (int k = 0; k < n; k++) {
+            if (sym_tab->is_temp_var(*slots[k])) {
+                uses[*slots[k]]++;
+            }
+        }
+    }
+}
+
+
+void quad_optimizer::count_defs(quad_list *q)
+{
+    defs.clear();
+    literals.clear();
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        sym_index d = quad.defined_sym();
+        if (!sym_tab->is_temp_var(d)) {
+            continue;
+        }
+        if (++defs[d] == 1 && quad.op_code == q_iload) {
+            literals[d] = quad.int1;
+        } else {
+            literals.erase(d);
+        }
+    }
+}
+
+
+long quad_optimizer::next_quad(quad_list *q, long i)
+{
+    for (i++; i < q->size(); i++) {
+        if ((*q)[i].op_code != q_nop) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/* A temp t computed by one quad and used only by an assignment x := t in
+   the next quad is replaced by x. Every quad reads its arguments before it
+   stores the result, so this is safe even if the quad also reads x. */
+bool quad_optimizer::retarget_temps(quad_list *q)
+{
+    bool changed = false;
+
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &def = (*q)[i];
+        sym_index t = def.defined_sym();
+        if (!sym_tab->is_temp_var(t) || uses[t] != 1) {
+            continue;
+        }
+        long j = next_quad(q, i);
+        if (j == -1) {
+            continue;
+        }
+        quadruple &assign = (*q)[j];
+        if ((assign.op_code != q_iassign && assign.op_code != q_rassign) ||
+                assign.sym1 != t) {
+            continue;
+        }
+        def.sym3 = assign.sym3;
+        make_nop(assign);
+        uses[t] = 0;
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+/* Copy and constant propagation, one basic block at a time. copy_of maps a
+   symbol to the one it was last assigned from, const_of to the constant it
+   was last loaded with. Both are forgotten as soon as either side changes.
+   A call may change any variable that isn't a temp, so only facts about
+   temps and constant symbols survive one. */
+bool quad_optimizer::propagate_copies(quad_list *q)
+{
+    bool changed = false;
+    map<sym_index, sym_index> copy_of;
+    map<sym_index, long> const_of;
+
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+
+        if (quad.op_code == q_labl) {
+            copy_of.clear();
+            const_of.clear();
+            continue;
+        }
+
+        // Replace uses of copies with the originals. q_itor reads its
+        // argument straight from memory, so it can't take a constant.
+        sym_index *slots[2];
+        int n = quad.use_slots(slots);
+        for (int k = 0; k < n; k++) {
+            map<sym_index, sym_index>::iterator c = copy_of.find(*slots[k]);
+            if (c == copy_of.end()) {
+                continue;
+            }
+            if (quad.op_code == q_itor &&
+                    sym_tab->get_symbol_tag(c->second) == SYM_CONST) {
+                continue;
+            }
+            *slots[k] = c->second;
+            changed = true;
+        }
+
+        // An assignment from a known constant becomes a load.
+        if (quad.op_code == q_iassign || quad.op_code == q_rassign) {
+            map<sym_index, long>::iterator c = const_of.find(quad.sym1);
+            if (c != const_of.end()) {
+                quad = quadruple(quad.op_code == q_iassign ? q_iload : q_rload,
+                                 c->second, NULL_SYM, quad.sym3);
+                changed = true;
+            }
+        }
+
+        // A test of a known constant is either always or never taken.
+        if (quad.op_code == q_jmpf) {
+            map<sym_index, long>::iterator c = const_of.find(quad.sym2);
+            if (c != const_of.end()) {
+                if (c->second == 0) {
+                    quad = quadruple(q_jmp, quad.int1, NULL_SYM, NULL_SYM);
+                } else {
+                    make_nop(quad);
+                }
+                changed = true;
+            }
+        }
+
+        // So is a compare of two known integers, such as the test in
+        // front of a rotated loop whose variable starts at a constant.
+        long left, right;
+        bool taken;
+        if (quad.op_code >= q_ijeq && quad.op_code <= q_ijge &&
+                known_constant(const_of, quad.sym2, &left) &&
+                known_constant(const_of, quad.sym3, &right) &&
+                branch_taken(quad.op_code, left, right, &taken)) {
+            if (taken) {
+                quad = quadruple(q_jmp, quad.int1, NULL_SYM, NULL_SYM);
+            } else {
+                make_nop(quad);
+            }
+            changed = true;
+        }
+
+        if (quad.ends_block()) {
+            copy_of.clear();
+            const_of.clear();
+            continue;
+        }
+
+        if (quad.op_code == q_call) {
+            map<sym_index, sym_index>::iterator c = copy_of.begin();
+            while (c != copy_of.end()) {
+                if (!sym_tab->is_temp_var(c->first) ||
+                        (!sym_tab->is_temp_var(c->second) &&
+                         sym_tab->get_symbol_tag(c->second) != SYM_CONST)) {
+                    copy_of.erase(c++);
+                } else {
+                    ++c;
+                }
+            }
+            map<sym_index, long>::iterator k = const_of.begin();
+            while (k != const_of.end()) {
+                if (!sym_tab->is_temp_var(k->first)) {
+                    const_of.erase(k++);
+                } else {
+                    ++k;
+                }
+            }
+        }
+
+        sym_index d = quad.defined_sym();
+        if (d == NULL_SYM) {
+            continue;
+        }
+
+        // d changes, so everything we knew about it is gone.
+        copy_of.erase(d);
+        const_of.erase(d);
+        map<sym_index, sym_index>::iterator c = copy_of.begin();
+        while (c != copy_of.end()) {
+            if (c->second == d) {
+                copy_of.erase(c++);
+            } else {
+                ++c;
+            }
+        }
+
+        if ((quad.op_code == q_iassign || quad.op_code == q_rassign) &&
+                quad.sym1 != d) {
+            copy_of[d] = quad.sym1;
+        } else if (quad.op_code == q_iload || quad.op_code == q_rload) {
+            const_of[d] = quad.int1;
+        }
+    }
+
+    return changed;
+}
+
+
+/* Remove quads computing temps nobody reads. Calls are kept for their side
+   effects even if their result is unused. */
+bool quad_optimizer::remove_dead_temps(quad_list *q)
+{
+    bool changed = false;
+
+    // Go backwards, so that removing a quad can make the ones computing its
+    // arguments dead in the same sweep.
+    for (long i = q->size() - 1; i >= 0; i--) {
+        quadruple &quad = (*q)[i];
+        sym_index d = quad.defined_sym();
+        if (quad.op_code == q_call || !sym_tab->is_temp_var(d) ||
+                uses[d] != 0) {
+            continue;
+        }
+        sym_index *slots[2];
+        int n = quad.use_slots(slots);
+        for (int k = 0; k < n; k++) {
+            if (sym_tab->is_temp_var(*slots[k])) {
+                uses[*slots[k]]--;
+            }
+        }
+        make_nop(quad);
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+/* Turn a relational quad followed by a q_jmpf on its result into one
+   compare-and-branch quad, if nothing else needs the result. */
+bool quad_optimizer::fuse_branches(quad_list *q)
+{
+    bool changed = false;
+
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &rel = (*q)[i];
+        quad_op_type branch = inverted_branch(rel.op_code);
+        if (branch == q_nop || uses[rel.sym3] != 1) {
+            continue;
+        }
+        long j = next_quad(q, i);
+        if (j == -1 || (*q)[j].op_code != q_jmpf ||
+                (*q)[j].sym2 != rel.sym3) {
+            continue;
+        }
+        uses[rel.sym3] = 0;
+        rel = quadruple(branch, (*q)[j].int1, rel.sym1, rel.sym2);
+        make_nop((*q)[j]);
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+/* Remove the basic blocks that can't be reached from the first one. Their
+   labels go with them, since the only jumps to them are in blocks that
+   can't be reached either. */
+bool quad_optimizer::remove_unreachable_code(quad_list *q)
+{
+    bool changed = false;
+    flow_graph graph(q);
+
+    for (unsigned long b = 0; b < graph.blocks.size(); b++) {
+        if (graph.reachable(b)) {
+            continue;
+        }
+        for (long i = graph.blocks[b].first; i <= graph.blocks[b].last; i++) {
+            if ((*q)[i].op_code != q_nop) {
+                make_nop((*q)[i]);
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+
+bool quad_optimizer::known_value(sym_index sym_p, long *value)
+{
+    map<sym_index, long>::iterator l = literals.find(sym_p);
+    if (l != literals.end()) {
+        *value = l->second;
+        return true;
+    }
+    symbol *sym = sym_tab->get_symbol(sym_p);
+    if (sym->tag == SYM_CONST && sym->type == integer_type) {
+        *value = sym->get_constant_symbol()->const_value.ival;
+        return true;
+    }
+    return false;
+}
+
+
+/* A symbol is invariant in the loop being optimized if it is a constant,
+   computed by a quad that has been moved out of the loop, or not assigned
+   in the loop at all. A call may change any variable that isn't a temp,
+   so only temps count as unassigned in a loop that calls something. */
+bool quad_optimizer::invariant(sym_index sym_p)
+{
+    if (sym_tab->get_symbol_tag(sym_p) == SYM_CONST ||
+            loop_invariants.find(sym_p) != loop_invariants.end()) {
+        return true;
+    }
+    if (loop_defs.find(sym_p) != loop_defs.end()) {
+        return false;
+    }
+    return !loop_calls || sym_tab->is_temp_var(sym_p);
+}
+
+
+/* A loop is a label with jumps back to it from further down, which ends
+   at the last of them. Only loops that can't be entered other than at the
+   top are of any use, so none of the labels in it may be jumped to from
+   outside it. Those loops nest properly, since a loop starting inside
+   another one and ending outside it would jump into it. */
+void quad_optimizer::find_loops(quad_list *q, vector<quad_loop> &loops)
+{
+    loops.clear();
+
+    // The first and last quad jumping to each label.
+    map<long, pair<long, long> > jumps;
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        if (!quad.ends_block()) {
+            continue;
+        }
+        map<long, pair<long, long> >::iterator j = jumps.find(quad.int1);
+        if (j == jumps.end()) {
+            jumps[quad.int1] = make_pair(i, i);
+        } else {
+            j->second.second = i;
+        }
+    }
+
+    // The loops that contain the current quad, innermost last.
+    vector<quad_loop> open;
+    for (long i = 0; i < q->size(); i++) {
+        while (!open.empty() && open.back().bottom < i) {
+            open.pop_back();
+        }
+        if ((*q)[i].op_code != q_labl) {
+            continue;
+        }
+        map<long, pair<long, long> >::iterator j = jumps.find((*q)[i].int1);
+        if (j == jumps.end() || j->second.first <= i) {
+            continue;
+        }
+
+        quad_loop loop;
+        loop.top = i;
+        loop.bottom = j->second.second;
+        loop.depth = open.size();
+
+        bool entered = false;
+        for (long k = i + 1; k <= loop.bottom && !entered; k++) {
+            if ((*q)[k].op_code != q_labl) {
+                continue;
+            }
+            map<long, pair<long, long> >::iterator l = jumps.find((*q)[k].int1);
+            entered = l != jumps.end() &&
+                (l->second.first < i || l->second.second > loop.bottom);
+        }
+        if (entered) {
+            continue;
+        }
+
+        loops.push_back(loop);
+        open.push_back(loop);
+    }
+}
+
+
+/* Run the loop passes, on the innermost loops first. Quads moved out of
+   one loop may then be moved further out of the loops around it. Loops at
+   the same depth don't overlap, so they are all done in one go, and the
+   list is only rebuilt once for each depth. */
+bool quad_optimizer::optimize_loops(quad_list *q)
+{
+    bool changed = false;
+    vector<quad_loop> loops;
+
+    find_loops(q, loops);
+    int max_depth = -1;
+    for (unsigned int i = 0; i < loops.size(); i++) {
+        max_depth = max(max_depth, loops[i].depth);
+    }
+
+    for (int depth = max_depth; depth >= 0; depth--) {
+        map<long, vector<quadruple> > inserts;
+        count_defs(q);
+        for (unsigned int i = 0; i < loops.size(); i++) {
+            if (loops[i].depth == depth) {
+                optimize_loop(q, loops[i], inserts);
+            }
+        }
+        if (!inserts.empty()) {
+            q->insert_quads(inserts);
+            find_loops(q, loops);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+
+void quad_optimizer::optimize_loop(quad_list *q, const quad_loop &loop,
+                                   map<long, vector<quadruple> > &inserts)
+{
+    loop_defs.clear();
+    loop_invariants.clear();
+    loop_calls = false;
+    for (long i = loop.top + 1; i < loop.bottom; i++) {
+        quadruple &quad = (*q)[i];
+        if (quad.op_code == q_call) {
+            loop_calls = true;
+        }
+        sym_index d = quad.defined_sym();
+        if (d != NULL_SYM) {
+            loop_defs[d]++;
+        }
+    }
+
+    // Code motion. A temp is computed before all of its uses, so one pass
+    // finds everything that can be moved. Temps assigned more than once,
+    // like the result of an and or an or, stay where they are.
+    vector<quadruple> preheader;
+    for (long i = loop.top + 1; i < loop.bottom; i++) {
+        quadruple &quad = (*q)[i];
+        sym_index d = quad.defined_sym();
+        if (!can_hoist(quad.op_code) || !sym_tab->is_temp_var(d) ||
+                defs[d] != 1) {
+            continue;
+        }
+        sym_index *slots[2];
+        int n = quad.use_slots(slots);
+        bool moved = true;
+        for (int k = 0; k < n; k++) {
+            moved = moved && invariant(*slots[k]);
+        }
+        if (moved) {
+            preheader.push_back(quad);
+            loop_invariants.insert(d);
+            make_nop(quad);
+        }
+    }
+
+    // The induction variables: every assignment to one in the loop adds an
+    // invariant to it or subtracts one from it.
+    map<sym_index, bool> induction;
+    for (long i = loop.top + 1; i < loop.bottom; i++) {
+        quadruple &quad = (*q)[i];
+        sym_index d = quad.defined_sym();
+        if (d == NULL_SYM) {
+            continue;
+        }
+        bool step =
+            (quad.op_code == q_iplus && quad.sym1 == d && invariant(quad.sym2)) ||
+            (quad.op_code == q_iplus && quad.sym2 == d && invariant(quad.sym1)) ||
+            (quad.op_code == q_iminus && quad.sym1 == d && invariant(quad.sym2));
+        if (loop_calls && !sym_tab->is_temp_var(d)) {
+            step = false;
+        }
+        map<sym_index, bool>::iterator v = induction.find(d);
+        if (v == induction.end()) {
+            induction[d] = step;
+        } else {
+            v->second = v->second && step;
+        }
+    }
+
+    // Strength reduction. Each product of an induction variable and an
+    // invariant gets a temp that always holds its value: it is computed
+    // before the loop, and stepped along every time the variable is.
+    map<pair<sym_index, sym_index>, sym_index> reduced;
+    for (long i = loop.top + 1; i < loop.bottom; i++) {
+        quadruple &quad = (*q)[i];
+        if (quad.op_code != q_imult) {
+            continue;
+        }
+        sym_index var = quad.sym1;
+        sym_index factor = quad.sym2;
+        if (!induction[var] || !invariant(factor)) {
+            var = quad.sym2;
+            factor = quad.sym1;
+            if (!induction[var] || !invariant(factor)) {
+                continue;
+            }
+        }
+        pair<sym_index, sym_index> key = make_pair(var, factor);
+        map<pair<sym_index, sym_index>, sym_index>::iterator r =
+            reduced.find(key);
+        if (r == reduced.end()) {
+            sym_index product = sym_tab->gen_temp_var(integer_type);
+            preheader.push_back(quadruple(q_imult, var, factor, product));
+            r = reduced.insert(make_pair(key, product)).first;
+        }
+        quad = quadruple(q_iassign, r->second, NULL_SYM, quad.sym3);
+    }
+
+    map<pair<sym_index, sym_index>, sym_index> steps;
+    for (long i = loop.top + 1; i < loop.bottom && !reduced.empty(); i++) {
+        quadruple &quad = (*q)[i];
+        sym_index d = quad.defined_sym();
+        if (d == NULL_SYM || !induction[d]) {
+            continue;
+        }
+        sym_index increment = quad.sym1 == d ? quad.sym2 : quad.sym1;
+        map<pair<sym_index, sym_index>, sym_index>::iterator r;
+        for (r = reduced.lower_bound(make_pair(d, (sym_index) NULL_SYM));
+                r != reduced.end() && r->first.first == d; r++) {
+            sym_index factor = r->first.second;
+            pair<sym_index, sym_index> key = make_pair(increment, factor);
+            map<pair<sym_index, sym_index>, sym_index>::iterator s =
+                steps.find(key);
+            if (s == steps.end()) {
+                sym_index step = sym_tab->gen_temp_var(integer_type);
+                long a, b;
+                if (known_value(increment, &a) && known_value(factor, &b)) {
+                    preheader.push_back(quadruple(q_iload, a * b, NULL_SYM,
+                                                  step));
+                } else {
+                    preheader.push_back(quadruple(q_imult, increment, factor,
+                                                  step));
+                }
+                s = steps.insert(make_pair(key, step)).first;
+            }
+            inserts[i + 1].push_back(quadruple(quad.op_code, r->second,
+                                               s->second, r->second));
+        }
+    }
+
+    if (!preheader.empty()) {
+        inserts[loop.top] = preheader;
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef __QUADOPT_HH__
+#define __QUADOPT_HH__
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "quads.hh"
+#include "vectorize.hh"
+
+
+/*** This class performs optimization on the quad list of a block, after it
+     has been generated by do_quads() and before it is expanded to assembler.
+     do_quads() makes a new temp for every subexpression and then copies it
+     into the variable it belongs to, which is what most of these passes
+     clean up:
+     - Retargeting: a temp that is only computed to be assigned to a
+       variable right away is replaced by the variable itself.
+     - Copy and constant propagation within basic blocks: uses of a variable
+       that was just copied from another one are replaced by the original,
+       and an assignment from a variable with a known constant value becomes
+       a load of that constant. Tests and compares of known constants become
+       jumps, or go away.
+     - Dead temp elimination: quads computing temps that are never used are
+       removed.
+     - Branch fusion: a relational quad whose result is only tested by the
+       q_jmpf that follows it becomes a single compare-and-branch quad.
+     - Branch layout: quad_list::layout_branches() is run again, since the
+       other passes turn up more jumps to the next label and dead labels.
+     - Unreachable code: the basic blocks the flow graph can't reach from
+       the start, such as the code after a return, are removed.
+     After those come the loop passes, for loops that are only entered at
+     the top, ie, the ones made by while statements:
+     - Loop-invariant code motion: quads computing temps from operands that
+       don't change in the loop are moved in front of its top label. Only
+       quads that can't fault are moved, since the loop may not run at all.
+     - Strength reduction: a multiplication of an induction variable, one
+       that the loop only changes by adding or subtracting an invariant, by
+       an invariant becomes a temp that is set before the loop and stepped
+       along with the variable.
+     Then the first passes run again, to clean up after the loop passes.
+     Last comes the loop vectorizer, see vectorize.hh, unless -l is given.
+     It is run by itself, after the inliner has kept a copy of the block,
+     so that the copies that are inlined are the smaller scalar loops. ***/
+
+
+/* A loop in a quad list: the index of the q_labl at its top, the index of
+   the last jump back to it, and the number of loops it is nested in. */
+struct quad_loop
+{
+    long top;
+    long bottom;
+    int depth;
+};
+
+
+class quad_optimizer;
+
+// Defined in quadopt.cc.
+extern quad_optimizer *quad_opt;
+
+
+class quad_optimizer
+{
+private:
+    // Number of times each temp is used in the list being optimized.
+    map<sym_index, int> uses;
+
+    // Number of quads assigning each temp, and the value of the temps that
+    // are only assigned by a q_iload, in the list being optimized.
+    map<sym_index, int> defs;
+    map<sym_index, long> literals;
+
+    // For the loop being optimized: the number of quads in it assigning
+    // each symbol, the temps computed by the quads moved out of it, and
+    // whether it calls anything.
+    map<sym_index, int> loop_defs;
+    set<sym_index> loop_invariants;
+    bool loop_calls;
+
+    loop_vectorizer vectorizer;
+
+    // Recount the uses of all temps.
+    void count_uses(quad_list *);
+
+    // Recount the quads assigning each temp, and find the literal temps.
+    void count_defs(quad_list *);
+
+    // Return the index of the first quad after i that isn't a q_nop.
+    long next_quad(quad_list *, long);
+
+    // Returns true if a symbol is an integer constant or a literal temp,
+    // and sets the value.
+    bool known_value(sym_index, long *);
+
+    // Returns true if a symbol has the same value all through the loop
+    // being optimized.
+    bool invariant(sym_index);
+
+    // Find the loops that are only entered at the top, inner ones after
+    // the ones they are nested in.
+    void find_loops(quad_list *, vector<quad_loop> &);
+
+    // Run the passes other than the loop passes in rounds, until nothing
+    // changes or MAX_ROUNDS is reached.
+    void run_passes(quad_list *);
+
+    // The passes. Each returns true if it changed anything.
+    bool retarget_temps(quad_list *);
+    bool propagate_copies(quad_list *);
+    bool remove_dead_temps(quad_list *);
+    bool fuse_branches(quad_list *);
+    bool remove_unreachable_code(quad_list *);
+    bool optimize_loops(quad_list *);
+
+    // The loop passes for one loop. Quads to add are put in a map from the
+    // index of the quad they go in front of.
+    void optimize_loop(quad_list *, const quad_loop &,
+                       map<long, vector<quadruple> > &);
+
+public:
+    // Quad counts before and after optimization, summed over all blocks.
+    long total_before;
+    long total_after;
+
+    quad_optimizer();
+
+    // This is the interface to parser.y. Optimizes a quad list in place.
+    void do_optimize(quad_list *);
+
+    // Vectorize the loops of an optimized quad list in place, without -l.
+    void do_vectorize(quad_list *);
+};
+
+
+#endif
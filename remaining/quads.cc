@@ -1,6 +1,7 @@
 #include <iostream>
 #include <iomanip>
 #include <stdio.h>
+#include <unordered_map>
 #include "symtab.hh"
 #include "ast.hh"
 #include "quads.hh"
@@ -10,30 +11,165 @@ using namespace std;
    not using the quad_list given to it as a parameter. */
 #define USE_Q { quad_list *foo = &q; foo = foo; }
 
+// Defined in main.cc.
+extern bool profile;
 
-/* Constructors for quadruples. The order of assigning the member fields might
-   looks strange, but it's arranged in the same order as they are declared
-   in quads.hh to avoid compiler rearrangements. */
+
+/* Constructors for quadruples. Each argument slot is a union, so setting
+   symN also sets intN. */
 quadruple::quadruple(quad_op_type op, long a1, long a2, long a3) :
     op_code(op),
     sym1(a1),
     sym2(a2),
-    sym3(a3),
-    int1(a1),
-    int2(a2),
-    int3(a3)
+    sym3(a3)
 {
 }
 
 
 
+/* Fill in pointers to the argument slots of a quad that are read as values,
+   and return how many there are. Array bases and labels are not values. */
+int quadruple::use_slots(sym_index *slots[2])
+{
+    switch (op_code) {
+    case q_inot:
+    case q_ruminus:
+    case q_iuminus:
+    case q_itor:
+    case q_rassign:
+    case q_iassign:
+    case q_param:
+    case q_vsplat:
+        slots[0] = &sym1;
+        return 1;
+    case q_rplus:
+    case q_iplus:
+    case q_rminus:
+    case q_iminus:
+    case q_ior:
+    case q_iand:
+    case q_rmult:
+    case q_imult:
+    case q_rdivide:
+    case q_idivide:
+    case q_imod:
+    case q_req:
+    case q_ieq:
+    case q_rne:
+    case q_ine:
+    case q_rlt:
+    case q_ilt:
+    case q_rgt:
+    case q_igt:
+        slots[0] = &sym1;
+        slots[1] = &sym2;
+        return 2;
+    case q_rstore:
+    case q_istore:
+        slots[0] = &sym1;
+        slots[1] = &sym3;
+        return 2;
+    case q_rreturn:
+    case q_ireturn:
+    case q_lindex:
+    case q_rrindex:
+    case q_irindex:
+    case q_jmpf:
+    case q_valign:
+    case q_vload:
+    case q_vstore:
+        slots[0] = &sym2;
+        return 1;
+    case q_ijeq:
+    case q_ijne:
+    case q_ijlt:
+    case q_ijle:
+    case q_ijgt:
+    case q_ijge:
+    case q_rjeq:
+    case q_rjne:
+    case q_rjlt:
+    case q_rjle:
+    case q_rjgt:
+    case q_rjge:
+        slots[0] = &sym2;
+        slots[1] = &sym3;
+        return 2;
+    default:
+        return 0;
+    }
+}
 
-/* The quad_list_element constructor. Not very exciting really. This class
-   is never used outside the quad_list class. */
-quad_list_element::quad_list_element(quadruple *q, quad_list_element *n) :
-    data(q),
-    next(n)
+
+/* Return the symbol a quad assigns a value to, or NULL_SYM if none. Array
+   stores write to memory, not to a symbol. */
+sym_index quadruple::defined_sym()
 {
+    switch (op_code) {
+    case q_rstore:
+    case q_istore:
+    case q_rreturn:
+    case q_ireturn:
+    case q_jmp:
+    case q_jmpf:
+    case q_param:
+    case q_labl:
+    case q_nop:
+    case q_ijeq:
+    case q_ijne:
+    case q_ijlt:
+    case q_ijle:
+    case q_ijgt:
+    case q_ijge:
+    case q_rjeq:
+    case q_rjne:
+    case q_rjlt:
+    case q_rjle:
+    case q_rjgt:
+    case q_rjge:
+    case q_profcall:
+    case q_profloop:
+    case q_vload:
+    case q_vstore:
+    case q_vsplat:
+    case q_viplus:
+    case q_viminus:
+    case q_vrplus:
+    case q_vrminus:
+    case q_vrmult:
+    case q_vrdivide:
+        return NULL_SYM;
+    default:
+        return sym3;
+    }
+}
+
+
+/* Returns true if control may leave the quad other than by falling through
+   to the next one, ie, it ends a basic block. */
+bool quadruple::ends_block()
+{
+    switch (op_code) {
+    case q_jmp:
+    case q_jmpf:
+    case q_rreturn:
+    case q_ireturn:
+    case q_ijeq:
+    case q_ijne:
+    case q_ijlt:
+    case q_ijle:
+    case q_ijgt:
+    case q_ijge:
+    case q_rjeq:
+    case q_rjne:
+    case q_rjlt:
+    case q_rjle:
+    case q_rjgt:
+    case q_rjge:
+        return true;
+    default:
+        return false;
+    }
 }
 
 
@@ -41,7 +177,8 @@ quad_list_element::quad_list_element(quadruple *q, quad_list_element *n) :
 /* The quad_list_iterator constructor. It initializes the iterator to point
    to the first element of the quad list passed to it as an argument. */
 quad_list_iterator::quad_list_iterator(quad_list *q_list) :
-    current(q_list->head)
+    list(q_list),
+    current(0)
 {
 }
 
@@ -49,31 +186,29 @@ quad_list_iterator::quad_list_iterator(quad_list *q_list) :
    we've reached the end of the list. */
 quadruple *quad_list_iterator::get_current()
 {
-    if (current == NULL) {
+    if (current < 0 || current >= list->size()) {
         return NULL;
     }
 
-    return current->data;
+    return &list->quads[current];
 }
 
 /* Return the next quadruple on the quad list we're iterating over, or NULL if
    there are no more. */
 quadruple *quad_list_iterator::get_next()
 {
-    if (current->next == NULL) {
+    if (current + 1 >= list->size()) {
         return NULL;
     }
 
-    current = current->next;
-    return current->data;
+    current++;
+    return &list->quads[current];
 }
 
 
 
 /* The quad_list class. */
-quad_list::quad_list(int ll) :
-    head(NULL),
-    tail(NULL),
+quad_list::quad_list(long ll) :
     last_label(ll)
 {
     quad_nr = 1;
@@ -81,20 +216,244 @@ quad_list::quad_list(int ll) :
 
 
 /* Operator for adding on a new quadruple to the list. */
-quad_list &quad_list::operator+=(quadruple *q)
+quad_list &quad_list::operator+=(const quadruple &q)
 {
-    if (head == NULL) {
-        head = new quad_list_element(q, NULL);
-        tail = head;
-    } else {
-        tail->next = new quad_list_element(q, NULL);
-        tail = tail->next;
-    }
+    quads.push_back(q);
 
     return *this;
 }
 
 
+/* The loops of a block are generated before anything knows which block
+   they are in, so with -P, do_quads() tells their q_profloop quads after. */
+void quad_list::claim_loops(sym_index block)
+{
+    for (unsigned int i = 0; i < quads.size(); i++) {
+        if (quads[i].op_code == q_profloop) {
+            quads[i].sym2 = block;
+        }
+    }
+}
+
+
+/* Optimization passes replace the quads they get rid of with q_nop, which
+   keeps indices stable while they work. This squeezes them out afterwards. */
+void quad_list::remove_nops()
+{
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < quads.size(); i++) {
+        if (quads[i].op_code != q_nop) {
+            quads[j++] = quads[i];
+        }
+    }
+    quads.erase(quads.begin() + j, quads.end());
+}
+
+
+/* Upper limit on the rounds of layout_branches(). Each round may turn up
+   a little more to do, and two nearly always finish it. */
+static const int MAX_LAYOUT_ROUNDS = 4;
+
+
+/* The compare-and-branch quad that jumps exactly when the given one
+   doesn't, or q_nop if it isn't one. The real ones are tested on the flags
+   as compares of unsigned integers, so they are each other's complements
+   for unordered compares too. */
+static quad_op_type inverse_branch(quad_op_type op)
+{
+    switch (op) {
+    case q_ijeq:
+        return q_ijne;
+    case q_ijne:
+        return q_ijeq;
+    case q_ijlt:
+        return q_ijge;
+    case q_ijge:
+        return q_ijlt;
+    case q_ijgt:
+        return q_ijle;
+    case q_ijle:
+        return q_ijgt;
+    case q_rjeq:
+        return q_rjne;
+    case q_rjne:
+        return q_rjeq;
+    case q_rjlt:
+        return q_rjge;
+    case q_rjge:
+        return q_rjlt;
+    case q_rjgt:
+        return q_rjle;
+    case q_rjle:
+        return q_rjgt;
+    default:
+        return q_nop;
+    }
+}
+
+
+long quad_list::next_quad(long i)
+{
+    for (i++; i < (long)quads.size(); i++) {
+        if (quads[i].op_code != q_nop) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/* Returns true if the label is among the ones right after quad i. */
+bool quad_list::label_follows(long i, long label)
+{
+    for (long j = next_quad(i); j != -1 && quads[j].op_code == q_labl;
+            j = next_quad(j)) {
+        if (quads[j].int1 == label) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* The branch layout. Each round does, in order:
+   - Jump threading: a jump to a label that is followed by a q_jmp goes
+     where that one goes instead.
+   - A compare-and-branch jumping over a q_jmp right after it is inverted
+     to jump where the q_jmp went.
+   - Jumps and branches to a label that directly follows them are removed.
+     None of them have side effects.
+   - The quads after a q_jmp or a return, up to the next label, are
+     removed, since nothing can get to them.
+   - Labels that nothing jumps to are removed, which makes the basic blocks
+     longer for the passes that work on them.
+   Returns are left alone, since the code generator sees a call followed
+   by one as a tail call. */
+bool quad_list::layout_branches()
+{
+    bool changed = false;
+
+    for (int round = 0; round < MAX_LAYOUT_ROUNDS; round++) {
+        bool round_changed = false;
+
+        unordered_map<long, long> label_quad;
+        for (long i = 0; i < (long)quads.size(); i++) {
+            if (quads[i].op_code == q_labl) {
+                label_quad[quads[i].int1] = i;
+            }
+        }
+
+        for (long i = 0; i < (long)quads.size(); i++) {
+            quadruple &quad = quads[i];
+            if (!quad.ends_block() || quad.op_code == q_ireturn ||
+                    quad.op_code == q_rreturn) {
+                continue;
+            }
+
+            // A chain of jumps can only be as long as there are labels,
+            // unless it goes round in a circle.
+            long target = quad.int1;
+            for (unsigned long steps = 0; steps < label_quad.size(); steps++) {
+                unordered_map<long, long>::iterator l =
+                    label_quad.find(target);
+                if (l == label_quad.end()) {
+                    break;
+                }
+                long j = l->second;
+                while (j != -1 && quads[j].op_code == q_labl) {
+                    j = next_quad(j);
+                }
+                if (j == -1 || quads[j].op_code != q_jmp ||
+                        quads[j].int1 == target) {
+                    break;
+                }
+                target = quads[j].int1;
+            }
+            if (target != quad.int1) {
+                quad.int1 = target;
+                round_changed = true;
+            }
+
+            long j = next_quad(i);
+            quad_op_type inverse = inverse_branch(quad.op_code);
+            if (inverse != q_nop && j != -1 && quads[j].op_code == q_jmp &&
+                    label_follows(j, quad.int1)) {
+                quad = quadruple(inverse, quads[j].int1, quad.sym2, quad.sym3);
+                quads[j] = quadruple(q_nop, NULL_SYM, NULL_SYM, NULL_SYM);
+                round_changed = true;
+            }
+
+            if (label_follows(i, quad.int1)) {
+                quad = quadruple(q_nop, NULL_SYM, NULL_SYM, NULL_SYM);
+                round_changed = true;
+            }
+        }
+
+        // Count the jumps to each label, and remove the dead code.
+        unordered_map<long, long> jumps;
+        for (long i = 0; i < (long)quads.size(); i++) {
+            quadruple &quad = quads[i];
+            if (quad.ends_block()) {
+                jumps[quad.int1]++;
+            }
+            if (quad.op_code != q_jmp && quad.op_code != q_ireturn &&
+                    quad.op_code != q_rreturn) {
+                continue;
+            }
+            for (long j = next_quad(i);
+                    j != -1 && quads[j].op_code != q_labl; j = next_quad(j)) {
+                quads[j] = quadruple(q_nop, NULL_SYM, NULL_SYM, NULL_SYM);
+                round_changed = true;
+            }
+        }
+
+        for (long i = 0; i < (long)quads.size(); i++) {
+            if (quads[i].op_code == q_labl &&
+                    jumps.find(quads[i].int1) == jumps.end()) {
+                quads[i] = quadruple(q_nop, NULL_SYM, NULL_SYM, NULL_SYM);
+                round_changed = true;
+            }
+        }
+
+        if (!round_changed) {
+            break;
+        }
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+/* Insert new quads in front of existing ones, all in one pass over the
+   list. Each key is the index, before any insertions, of the quad that the
+   new ones go in front of, or the size of the list to add them at its
+   end. */
+void quad_list::insert_quads(map<long, vector<quadruple> > &inserts)
+{
+    long added = 0;
+    map<long, vector<quadruple> >::iterator it;
+    for (it = inserts.begin(); it != inserts.end(); it++) {
+        added += it->second.size();
+    }
+
+    vector<quadruple> result;
+    result.reserve(quads.size() + added);
+    it = inserts.begin();
+    for (long i = 0; i < (long) quads.size(); i++) {
+        if (it != inserts.end() && it->first == i) {
+            result.insert(result.end(), it->second.begin(), it->second.end());
+            it++;
+        }
+        result.push_back(quads[i]);
+    }
+    if (it != inserts.end()) {
+        result.insert(result.end(), it->second.begin(), it->second.end());
+    }
+    quads.swap(result);
+}
+
+
 
 /**************************************************************
  *** THE AST NODE METHODS FOR GENERATING QUADS FOLLOW HERE. ***
@@ -144,7 +503,7 @@ sym_index ast_integer::generate_quads(quad_list &q)
 {
     USE_Q;
     sym_index new_index = sym_tab->gen_temp_var(integer_type);
-    q += new quadruple(q_iload, value, NULL_SYM, new_index);
+    q += quadruple(q_iload, value, NULL_SYM, new_index);
     return new_index;
 }
 
@@ -153,7 +512,7 @@ sym_index ast_real::generate_quads(quad_list &q)
 {
     USE_Q;
     sym_index new_index = sym_tab->gen_temp_var(real_type);
-    q += new quadruple(q_rload, value, NULL_SYM, new_index);
+    q += quadruple(q_rload, sym_tab->ieee(value), NULL_SYM, new_index);
     return new_index;
 }
 
@@ -173,7 +532,7 @@ sym_index ast_not::generate_quads(quad_list &q)
     sym_index expr_value = expr->generate_quads(q);
     if(expr->type == integer_type){
       new_index = sym_tab->gen_temp_var(integer_type);
-      q += new quadruple(q_inot, expr_value, NULL_SYM, new_index);
+      q += quadruple(q_inot, expr_value, NULL_SYM, new_index);
     }
 
     return new_index;
@@ -187,11 +546,11 @@ sym_index ast_uminus::generate_quads(quad_list &q)
     sym_index new_index;
     if(expr->type == integer_type){
         new_index = sym_tab->gen_temp_var(integer_type);
-        q += new quadruple(q_iuminus, expr_value, NULL_SYM, new_index);
+        q += quadruple(q_iuminus, expr_value, NULL_SYM, new_index);
     }
     else if(expr->type == real_type){
         new_index = sym_tab->gen_temp_var(real_type);
-        q += new quadruple(q_ruminus, expr_value, NULL_SYM, new_index);
+        q += quadruple(q_ruminus, expr_value, NULL_SYM, new_index);
     }
     else fatal("Illegal type in ast_uminus::generate_assignment()");
     return new_index;
@@ -205,22 +564,35 @@ sym_index ast_cast::generate_quads(quad_list &q)
     sym_index new_index;
     if (type == real_type){
         new_index = sym_tab->gen_temp_var(integer_type);
-        q += new quadruple(q_itor, expr_value, NULL_SYM, new_index);
+        q += quadruple(q_itor, expr_value, NULL_SYM, new_index);
     }
     else fatal("Illegal type in ast_cast::generate_assignment()");
     return new_index;
 }
 
 
+/* The first occurrence of a common subexpression computes it, the others
+   reuse the temp it was left in. */
+sym_index ast_common::generate_quads(quad_list &q)
+{
+    USE_Q;
+    if (first != NULL) {
+        return first->temp;
+    }
+    temp = expr->generate_quads(q);
+    return temp;
+}
+
+
 sym_index genrerate_quads_bin_op(quad_list & q, ast_binaryoperation * bin_op,quad_op_type int_op, quad_op_type real_op){
     sym_index left = bin_op->left->generate_quads(q);
     sym_index right = bin_op->right->generate_quads(q);
     sym_index new_index = sym_tab->gen_temp_var(bin_op->type);
     if (bin_op->left->type == integer_type && bin_op->right->type == integer_type){
-        q += new quadruple(int_op, left, right, new_index);
+        q += quadruple(int_op, left, right, new_index);
     }
     else if (bin_op->left->type == real_type && bin_op->right->type == real_type){
-        q += new quadruple(real_op, left, right, new_index);
+        q += quadruple(real_op, left, right, new_index);
     }
     else fatal("Can't apply the operation on the given type");
     return new_index;
@@ -272,10 +644,10 @@ sym_index genrerate_quads_bin_rel(quad_list & q, ast_binaryrelation * bin_rel,qu
     sym_index right = bin_rel->right->generate_quads(q);
     sym_index new_index = sym_tab->gen_temp_var(bin_rel->type);
     if (bin_rel->left->type == integer_type && bin_rel->right->type == integer_type){
-        q += new quadruple(int_op, left, right, new_index);
+        q += quadruple(int_op, left, right, new_index);
     }
     else if (bin_rel->left->type == real_type && bin_rel->right->type == real_type){
-        q += new quadruple(real_op, left, right, new_index);
+        q += quadruple(real_op, left, right, new_index);
     }
     else fatal("Can't apply the operation on the given type");
     return new_index;
@@ -301,6 +673,99 @@ sym_index ast_greaterthan::generate_quads(quad_list &q){
     return genrerate_quads_bin_rel(q,this,q_igt,q_rgt);
 }
 
+/* Jumping code for conditions. Instead of computing a 0/1 value and then
+   testing it with q_jmpf, relations branch with a compare-and-branch quad,
+   and and/or/not just pass the labels on to their operands. The right
+   operand of and/or is thus only evaluated when it decides the outcome. */
+void ast_expression::generate_jumps(quad_list &q, long label, bool when)
+{
+    sym_index value = generate_quads(q);
+    if (!when) {
+        q += quadruple(q_jmpf, label, value, NULL_SYM);
+        return;
+    }
+    sym_index zero = sym_tab->gen_temp_var(integer_type);
+    q += quadruple(q_iload, 0, NULL_SYM, zero);
+    q += quadruple(q_ijne, label, value, zero);
+}
+
+void ast_not::generate_jumps(quad_list &q, long label, bool when)
+{
+    expr->generate_jumps(q, label, !when);
+}
+
+void ast_and::generate_jumps(quad_list &q, long label, bool when)
+{
+    if (!when) {
+        left->generate_jumps(q, label, false);
+        right->generate_jumps(q, label, false);
+        return;
+    }
+    long skip = sym_tab->get_next_label();
+    left->generate_jumps(q, skip, false);
+    right->generate_jumps(q, label, true);
+    q += quadruple(q_labl, skip, NULL_SYM, NULL_SYM);
+}
+
+void ast_or::generate_jumps(quad_list &q, long label, bool when)
+{
+    if (when) {
+        left->generate_jumps(q, label, true);
+        right->generate_jumps(q, label, true);
+        return;
+    }
+    long skip = sym_tab->get_next_label();
+    left->generate_jumps(q, skip, true);
+    right->generate_jumps(q, label, false);
+    q += quadruple(q_labl, skip, NULL_SYM, NULL_SYM);
+}
+
+/* The branch quads are given for when the relation holds and when it
+   doesn't. The real versions of the latter are the ones the quad optimizer
+   uses when it fuses a relation with a q_jmpf, so that an unordered
+   compare still goes the same way as it did with the 0/1 value. */
+static void generate_relation_jumps(quad_list &q, ast_binaryrelation *bin_rel,
+                                    long label, bool when,
+                                    quad_op_type int_true,
+                                    quad_op_type int_false,
+                                    quad_op_type real_true,
+                                    quad_op_type real_false)
+{
+    sym_index left = bin_rel->left->generate_quads(q);
+    sym_index right = bin_rel->right->generate_quads(q);
+    if (bin_rel->left->type == integer_type && bin_rel->right->type == integer_type) {
+        q += quadruple(when ? int_true : int_false, label, left, right);
+    }
+    else if (bin_rel->left->type == real_type && bin_rel->right->type == real_type) {
+        q += quadruple(when ? real_true : real_false, label, left, right);
+    }
+    else fatal("Can't apply the operation on the given type");
+}
+
+void ast_equal::generate_jumps(quad_list &q, long label, bool when)
+{
+    generate_relation_jumps(q, this, label, when,
+                            q_ijeq, q_ijne, q_rjeq, q_rjne);
+}
+
+void ast_notequal::generate_jumps(quad_list &q, long label, bool when)
+{
+    generate_relation_jumps(q, this, label, when,
+                            q_ijne, q_ijeq, q_rjne, q_rjeq);
+}
+
+void ast_lessthan::generate_jumps(quad_list &q, long label, bool when)
+{
+    generate_relation_jumps(q, this, label, when,
+                            q_ijlt, q_ijge, q_rjlt, q_rjge);
+}
+
+void ast_greaterthan::generate_jumps(quad_list &q, long label, bool when)
+{
+    generate_relation_jumps(q, this, label, when,
+                            q_ijgt, q_ijle, q_rjgt, q_rjle);
+}
+
 /* Since an lvalue can be either an id or an array reference, we can't solve
    this the usual way since there's no instanceof operator in C++ to find out
    which class an object belongs to. So we define the method
@@ -309,9 +774,9 @@ sym_index ast_greaterthan::generate_quads(quad_list &q){
 void ast_id::generate_assignment(quad_list &q, sym_index rhs)
 {
     if (type == integer_type) {
-        q += new quadruple(q_iassign, rhs, NULL_SYM, sym_p);
+        q += quadruple(q_iassign, rhs, NULL_SYM, sym_p);
     } else if (type == real_type) {
-        q += new quadruple(q_rassign, rhs, NULL_SYM, sym_p);
+        q += quadruple(q_rassign, rhs, NULL_SYM, sym_p);
     } else {
         fatal("Illegal type in ast_id::generate_assignment()");
     }
@@ -322,12 +787,12 @@ void ast_indexed::generate_assignment(quad_list &q, sym_index rhs)
     sym_index index_pos = index->generate_quads(q);
     sym_index address = sym_tab->gen_temp_var(integer_type);
 
-    q += new quadruple(q_lindex, id->sym_p, index_pos, address);
+    q += quadruple(q_lindex, id->sym_p, index_pos, address);
 
     if (type == integer_type) {
-        q += new quadruple(q_istore, rhs, NULL_SYM, address);
+        q += quadruple(q_istore, rhs, NULL_SYM, address);
     } else if (type == real_type) {
-        q += new quadruple(q_rstore, rhs, NULL_SYM, address);
+        q += quadruple(q_rstore, rhs, NULL_SYM, address);
     } else {
         fatal("Illegal type in ast_indexed::generate_assignment()");
     }
@@ -344,23 +809,21 @@ sym_index ast_assign::generate_quads(quad_list &q)
 
 
 /* Parameters need to be treated specially as well. What we do here is
-   to recurse from the last parameter forward. In this process we use the
-   nr_param pointer (which is incremented by one for each recursive call)
-   to get the total number of parameters so we can generate a correct q_call
-   quad for the new function/procedure that the parameters belong to.
+   to go from the last parameter forward, since that is the order they are
+   pushed in. In this process we use the nr_param pointer (which is
+   incremented by one for each parameter) to get the total number of
+   parameters so we can generate a correct q_call quad for the new
+   function/procedure that the parameters belong to.
     */
 void ast_expr_list::generate_parameter_list(quad_list &q,
         parameter_symbol *last_param,
         int *nr_params)
 {
     USE_Q;
-    if (last_expr != NULL){
+    for (long i = exprs.size() - 1; i >= 0; i--) {
       *nr_params += 1;
-      sym_index param_index = last_expr->generate_quads(q);
-      q += new quadruple(q_param, param_index, NULL_SYM, NULL_SYM);
-    }
-    if (preceding != NULL){
-      preceding->generate_parameter_list(q,last_param->preceding,nr_params);
+      sym_index param_index = exprs[i]->generate_quads(q);
+      q += quadruple(q_param, param_index, NULL_SYM, NULL_SYM);
     }
 }
 
@@ -375,7 +838,7 @@ sym_index ast_procedurecall::generate_quads(quad_list &q)
       parameter_list->generate_parameter_list(q,last_param,&param_size);
     }
 
-    q += new quadruple(q_call,id->sym_p,param_size,NULL_SYM);
+    q += quadruple(q_call,id->sym_p,param_size,NULL_SYM);
     return NULL_SYM;
 }
 
@@ -394,36 +857,42 @@ sym_index ast_functioncall::generate_quads(quad_list &q)
         parameter_symbol * params = sym_tab->get_symbol(this->id->sym_p)->get_function_symbol()->last_parameter;
         parameter_list->generate_parameter_list(q, params, &nb_param);
     }
-    q += new quadruple(q_call, id->sym_p, nb_param, new_index);
+    q += quadruple(q_call, id->sym_p, nb_param, new_index);
     return new_index;
 }
 
 
-/* Generate quads for a while statement.
+/* Generate quads for a while statement. The loop is rotated: the condition
+   is tested once in front of it, and then again after the body, jumping
+   back to the top while it holds. That way each round of the loop only
+   takes the one branch at the bottom, instead of a test at the top and a
+   jump back to it.
     */
 sym_index ast_while::generate_quads(quad_list &q)
 {
     // We get two labels for jumps.
-    int top = sym_tab->get_next_label();
-    int bottom = sym_tab->get_next_label();
-
-    // Here's the label for the top of the while body.
-    q += new quadruple(q_labl, top, NULL_SYM, NULL_SYM);
-
-    // Generate quads for the condition. After this code is being run, we
-    // check if the result in the variable stored in 'pos' is 0. If it is,
-    // we want to exit the loop, which is done via a conditional jump to the
-    // 'bottom' label.
-    sym_index pos = condition->generate_quads(q);
-    q += new quadruple(q_jmpf, bottom, pos, NULL_SYM);
+    long top = sym_tab->get_next_label();
+    long bottom = sym_tab->get_next_label();
+
+    // Generate quads for the condition, which jump to the 'bottom' label
+    // to skip the loop as soon as it is known to be false.
+    condition->generate_jumps(q, bottom, false);
+
+    // Here's the label for the top of the while body. With -P, each round
+    // is counted right after it. do_quads() fills in the block.
+    q += quadruple(q_labl, top, NULL_SYM, NULL_SYM);
+    if (profile) {
+        q += quadruple(q_profloop, sym_tab->get_next_label(), NULL_SYM,
+                       pos->get_line());
+    }
 
-    // Generate quads for the body. Following these come an unconditional
-    // jump to the 'top' label, ie, run the condition etc again.
-    pos = body->generate_quads(q);
-    q += new quadruple(q_jmp, top,  NULL_SYM, NULL_SYM);
+    // Generate quads for the body. Following these comes the condition
+    // again, jumping back to the 'top' label if it is true.
+    body->generate_quads(q);
+    condition->generate_jumps(q, top, true);
 
-    // This is where we jump to if the while condition evaluates to false.
-    q += new quadruple(q_labl, bottom, NULL_SYM, NULL_SYM);
+    // This is where we get to when the while condition evaluates to false.
+    q += quadruple(q_labl, bottom, NULL_SYM, NULL_SYM);
 
     return NULL_SYM;
 }
@@ -431,27 +900,25 @@ sym_index ast_while::generate_quads(quad_list &q)
 
 /* Generate quads for an individual elsif statement, including an ending
    jump to an end label. See ast_if::generate_quads for more information. */
-void ast_elsif::generate_quads_and_jump(quad_list &q, int label)
+void ast_elsif::generate_quads_and_jump(quad_list &q, long label)
 {
     USE_Q;
     sym_index end_block = sym_tab->get_next_label();
-    sym_index cond = condition->generate_quads(q);
-    q += new quadruple(q_jmpf, end_block, cond, NULL_SYM);
+    condition->generate_jumps(q, end_block, false);
     if(body != NULL) body->generate_quads(q);
-    q += new quadruple(q_jmp, label, NULL_SYM, NULL_SYM);
-    q += new quadruple(q_labl, end_block, NULL_SYM, NULL_SYM);
+    q += quadruple(q_jmp, label, NULL_SYM, NULL_SYM);
+    q += quadruple(q_labl, end_block, NULL_SYM, NULL_SYM);
 }
 
 
 /* Generate quads (with an ending jump to an end label) for an elsif list.
    See generate_quads for ast_if for more information. */
-void ast_elsif_list::generate_quads_and_jump(quad_list &q, int label)
+void ast_elsif_list::generate_quads_and_jump(quad_list &q, long label)
 {
     USE_Q;
-    if(preceding != NULL)
-      preceding->generate_quads_and_jump(q, label);
-    if(last_elsif != NULL)
-      last_elsif->generate_quads_and_jump(q, label);
+    for (long i = 0; i < elsifs.size(); i++) {
+      elsifs[i]->generate_quads_and_jump(q, label);
+    }
 }
 
 
@@ -461,20 +928,19 @@ sym_index ast_if::generate_quads(quad_list &q)
     USE_Q;
     sym_index end_if = sym_tab->get_next_label();
     sym_index end_block = sym_tab->get_next_label();
-    sym_index cond = condition->generate_quads(q);
-    q += new quadruple(q_jmpf, end_if, cond, NULL_SYM);
+    condition->generate_jumps(q, end_if, false);
     if (body != NULL) {
         body->generate_quads(q);
         if (elsif_list != NULL || else_body != NULL)
-            q += new quadruple(q_jmp,end_block,NULL_SYM,NULL_SYM);
+            q += quadruple(q_jmp,end_block,NULL_SYM,NULL_SYM);
     }
-    q += new quadruple(q_labl,end_if,NULL_SYM, NULL_SYM);
+    q += quadruple(q_labl,end_if,NULL_SYM, NULL_SYM);
     if(elsif_list != NULL){
         elsif_list->generate_quads_and_jump(q, end_block);
     }
     if(else_body != NULL)
         else_body->generate_quads(q);
-    q += new quadruple(q_labl,end_block,NULL_SYM, NULL_SYM);
+    q += quadruple(q_labl,end_block,NULL_SYM, NULL_SYM);
     return NULL_SYM;
 }
 
@@ -486,12 +952,12 @@ sym_index ast_return::generate_quads(quad_list &q)
     if(value != NULL){
       sym_index return_value = value->generate_quads(q);
       if (value->type == integer_type)
-        q += new quadruple(q_ireturn, q.last_label, return_value, NULL_SYM);
+        q += quadruple(q_ireturn, q.last_label, return_value, NULL_SYM);
       else if (value->type == real_type)
-        q += new quadruple(q_rreturn, q.last_label, return_value, NULL_SYM);
+        q += quadruple(q_rreturn, q.last_label, return_value, NULL_SYM);
     }
     else
-      q += new quadruple(q_jmp, q.last_label, NULL_SYM, NULL_SYM);
+      q += quadruple(q_jmp, q.last_label, NULL_SYM, NULL_SYM);
     return NULL_SYM;
 }
 
@@ -504,26 +970,22 @@ sym_index ast_indexed::generate_quads(quad_list &q)
     sym_index new_index;
     if(type == integer_type){
       new_index = sym_tab->gen_temp_var(integer_type);
-      q += new quadruple(q_irindex,id->sym_p,pos,new_index);
+      q += quadruple(q_irindex,id->sym_p,pos,new_index);
     }
     else if(type == real_type){
       new_index = sym_tab->gen_temp_var(real_type);
-      q += new quadruple(q_rrindex,id->sym_p,pos,new_index);
+      q += quadruple(q_rrindex,id->sym_p,pos,new_index);
     }
     else fatal ("Illegal type in ast_indexed::generate_quads()");
     return new_index;
 }
 
 
-/* Generate quads for a list of statements. Note that this is not necessarily
-   the most efficient way to do it... Why not? */
+/* Generate quads for a list of statements. */
 sym_index ast_stmt_list::generate_quads(quad_list &q)
 {
-    if (preceding != NULL) {
-        preceding->generate_quads(q);
-    }
-    if (last_stmt != NULL) {
-        last_stmt->generate_quads(q);
+    for (long i = 0; i < stmts.size(); i++) {
+        stmts[i]->generate_quads(q);
     }
     return NULL_SYM;
 }
@@ -549,31 +1011,50 @@ sym_index ast_functionhead::generate_quads(quad_list &q)
 
 
 /* These two methods actually start off the quad generation, also taking
-   care of adding a last_label. The code is identical for the two methods. */
+   care of adding a last_label and laying out the branches. The code is
+   identical for the two methods. */
 quad_list *ast_procedurehead::do_quads(ast_stmt_list *s)
 {
-    int last_label = sym_tab->get_next_label();
+    long last_label = sym_tab->get_next_label();
     quad_list *q = new quad_list(last_label);
 
+    if (profile) {
+        (*q) += quadruple(q_profcall, sym_tab->get_next_label(), sym_p,
+                          pos->get_line());
+    }
     if (s != NULL) {
         s->generate_quads(*q);
     }
+    if (profile) {
+        q->claim_loops(sym_p);
+    }
 
-    (*q) += new quadruple(q_labl, last_label, NULL_SYM, NULL_SYM);
+    (*q) += quadruple(q_labl, last_label, NULL_SYM, NULL_SYM);
+    q->layout_branches();
+    q->remove_nops();
 
     return q;
 }
 
 quad_list *ast_functionhead::do_quads(ast_stmt_list *s)
 {
-    int last_label = sym_tab->get_next_label();
+    long last_label = sym_tab->get_next_label();
     quad_list *q = new quad_list(last_label);
 
+    if (profile) {
+        (*q) += quadruple(q_profcall, sym_tab->get_next_label(), sym_p,
+                          pos->get_line());
+    }
     if (s != NULL) {
         s->generate_quads(*q);
     }
+    if (profile) {
+        q->claim_loops(sym_p);
+    }
 
-    (*q) += new quadruple(q_labl, last_label, NULL_SYM, NULL_SYM);
+    (*q) += quadruple(q_labl, last_label, NULL_SYM, NULL_SYM);
+    q->layout_branches();
+    q->remove_nops();
 
     return q;
 }
@@ -829,6 +1310,156 @@ void quadruple::print(ostream &o)
           << setw(11) << "-"
           << setw(11) << "-";
         break;
+    case q_ijeq:
+        o << setw(11) << "q_ijeq"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_ijne:
+        o << setw(11) << "q_ijne"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_ijlt:
+        o << setw(11) << "q_ijlt"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_ijle:
+        o << setw(11) << "q_ijle"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_ijgt:
+        o << setw(11) << "q_ijgt"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_ijge:
+        o << setw(11) << "q_ijge"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_rjeq:
+        o << setw(11) << "q_rjeq"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_rjne:
+        o << setw(11) << "q_rjne"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_rjlt:
+        o << setw(11) << "q_rjlt"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_rjle:
+        o << setw(11) << "q_rjle"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_rjgt:
+        o << setw(11) << "q_rjgt"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_rjge:
+        o << setw(11) << "q_rjge"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_profcall:
+        o << setw(11) << "q_profcall"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << int3;
+        break;
+    case q_profloop:
+        o << setw(11) << "q_profloop"
+          << setw(11) << int1
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << int3;
+        break;
+    case q_valign:
+        o << setw(11) << "q_valign"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_vload:
+        o << setw(11) << "q_vload"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << int3;
+        break;
+    case q_vstore:
+        o << setw(11) << "q_vstore"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << sym_tab->get_symbol(sym2)
+          << setw(11) << int3;
+        break;
+    case q_vsplat:
+        o << setw(11) << "q_vsplat"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << "-"
+          << setw(11) << int3;
+        break;
+    case q_viplus:
+        o << setw(11) << "q_viplus"
+          << setw(11) << int1
+          << setw(11) << int2
+          << setw(11) << int3;
+        break;
+    case q_viminus:
+        o << setw(11) << "q_viminus"
+          << setw(11) << int1
+          << setw(11) << int2
+          << setw(11) << int3;
+        break;
+    case q_vrplus:
+        o << setw(11) << "q_vrplus"
+          << setw(11) << int1
+          << setw(11) << int2
+          << setw(11) << int3;
+        break;
+    case q_vrminus:
+        o << setw(11) << "q_vrminus"
+          << setw(11) << int1
+          << setw(11) << int2
+          << setw(11) << int3;
+        break;
+    case q_vrmult:
+        o << setw(11) << "q_vrmult"
+          << setw(11) << int1
+          << setw(11) << int2
+          << setw(11) << int3;
+        break;
+    case q_vrdivide:
+        o << setw(11) << "q_vrdivide"
+          << setw(11) << int1
+          << setw(11) << int2
+          << setw(11) << int3;
+        break;
+    case q_visum:
+        o << setw(11) << "q_visum"
+          << setw(11) << int1
+          << setw(11) << "-"
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
     default:
         o << "unknown (" << (int)op_code << ")";
     }
@@ -838,15 +1469,11 @@ void quadruple::print(ostream &o)
 
 void quad_list::print(ostream &o)
 {
-    quad_list_element *e;
-
     o << short_symbols;
 
     quad_nr = 1;
-    e = head;
-    while (e != NULL) {
-        o << setw(5) << quad_nr << e->data << endl;
-        e = e->next;
+    for (unsigned int i = 0; i < quads.size(); i++) {
+        o << setw(5) << quad_nr << &quads[i] << endl;
         quad_nr++;
     }
 
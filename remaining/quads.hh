@@ -1,6 +1,8 @@
 #ifndef __QUADS_HH__
 #define __QUADS_HH__
 
+#include <map>
+#include <vector>
 #include "ast.hh"
 
 /* Credits to David Byers for the design of this class. /Jonas */
@@ -50,7 +52,48 @@ typedef enum {
     q_jmpf,        // int, sym, -
     q_param,       // sym, -, -
     q_labl,        // int, -, -
-    q_nop          // -, -, -
+    q_nop,         // -, -, -
+
+    // Compare-and-branch quads. These are never made by do_quads(), only by
+    // the quad optimizer when it fuses a relational quad with the q_jmpf
+    // that tests its result. They jump to the label if sym2 <op> sym3.
+    q_ijeq,        // int, sym, sym
+    q_ijne,        // int, sym, sym
+    q_ijlt,        // int, sym, sym
+    q_ijle,        // int, sym, sym
+    q_ijgt,        // int, sym, sym
+    q_ijge,        // int, sym, sym
+    q_rjeq,        // int, sym, sym
+    q_rjne,        // int, sym, sym
+    q_rjlt,        // int, sym, sym
+    q_rjle,        // int, sym, sym
+    q_rjgt,        // int, sym, sym
+    q_rjge,        // int, sym, sym
+
+    // Profiling quads, only made with -P. Each adds one to the counter of a
+    // record at the label, which belongs to the block sym2 and is about
+    // the source line int3: q_profcall counts the calls of the block,
+    // and q_profloop the rounds of a while loop in it.
+    q_profcall,    // int, sym, int
+    q_profloop,    // int, sym, int
+
+    // Vector quads, only made by the loop vectorizer, see vectorize.hh.
+    // The ints are xmm registers, holding two rounds of a loop. q_valign
+    // computes how far the pair of elements at the index sym2 of the array
+    // sym1 is from being 16 byte aligned, 0 or 8. The pair is loaded and
+    // stored by q_vload and q_vstore. q_vsplat loads both halves with the
+    // same value, and q_visum adds them up.
+    q_valign,      // sym, sym, sym
+    q_vload,       // sym, sym, int
+    q_vstore,      // sym, sym, int
+    q_vsplat,      // sym, -, int
+    q_viplus,      // int, int, int
+    q_viminus,     // int, int, int
+    q_vrplus,      // int, int, int
+    q_vrminus,     // int, int, int
+    q_vrmult,      // int, int, int
+    q_vrdivide,    // int, int, int
+    q_visum        // int, -, sym
 } quad_op_type;
 
 
@@ -59,7 +102,8 @@ class quad_list;
 /* The quadruple class. A quadruple is a pseudo-assembler op-code with three
    arguments (more correctly, two arguments and one result), which depend on
    the op_code of the quad. To create a quad with a '-' argument (ie, not used),
-   set the sym_index value to NULL_SYM for that quad. See above. */
+   set the sym_index value to NULL_SYM for that quad. See above.
+   Quads are stored by value in the quad_list, so keep this small. */
 class quadruple
 {
 private:
@@ -67,47 +111,55 @@ private:
 
 public:
     quad_op_type op_code;
-    // NOTE: Get rid of the ones we won't need later... int3?
-    sym_index sym1;
-    sym_index sym2;
-    sym_index sym3;
 
-    long int1;
-    long int2;
-    long int3;
+    // Each argument is either a sym_index or an integer, depending on the
+    // op_code, never both. symN and intN are two names for the same slot;
+    // use the one that matches the table above.
+    union {
+        sym_index sym1;
+        long      int1;
+    };
+    union {
+        sym_index sym2;
+        long      int2;
+    };
+    union {
+        sym_index sym3;
+        long      int3;
+    };
 
     // As sym_index has type long, and we need integers of type long
     // we abuse the weak type system. This should be changed back to
     // separate overloaded constructors once C++ supports
     // strong typedefs (or the datatype of either changes).
-    // This also means that for now we're setting both intN and symN
-    // to maintain the API.
     quadruple(quad_op_type, sym_index, sym_index, sym_index);
     //quadruple(quad_op_type, long, sym_index, sym_index);
     //quadruple(quad_op_type, sym_index, long, sym_index);
 
-    friend ostream &operator<<(ostream &, quadruple *);
-};
+    // Fill in pointers to the arguments that are read as values, and return
+    // how many there are.
+    int use_slots(sym_index *slots[2]);
 
+    // Return the symbol this quad assigns a value to, or NULL_SYM.
+    sym_index defined_sym();
 
-/* This class is simply an abstraction to prevent quads from having to
-   contain a link to the next quad, which is a representation issue having
-   nothing to do with the program it represents. */
-class quad_list_element
-{
-public:
-    quadruple         *data;
-    quad_list_element *next;
+    // Returns true if this quad may jump somewhere.
+    bool ends_block();
 
-    quad_list_element(quadruple *, quad_list_element *);
+    friend ostream &operator<<(ostream &, quadruple *);
 };
 
 
 
-/* This class lets us iterate over a quad_list in a convenient fashion. */
+/* This class lets us iterate over a quad_list in a convenient fashion. The
+   position is just an index into the list, so it can be moved around freely
+   with set_index(). Pointers returned by the iterator stay valid until more
+   quads are added to the list. */
 class quad_list_iterator
 {
-    quad_list_element *current;
+    quad_list *list;
+
+    long current;
 
 public:
     quad_list_iterator(quad_list *q_list);
@@ -117,6 +169,12 @@ public:
 
     // Return the next quad if any.
     quadruple *get_next();
+
+    // The index of the current quad in the list.
+    long get_index() { return current; }
+
+    // Move to the quad at the given index.
+    void set_index(long i) { current = i; }
 };
 
 
@@ -124,15 +182,13 @@ public:
 /* A list of quads. This list will eventually contain the entire program in
    quad operations. Or at least entire blocks at a time. Had we represented
    the entire program as an AST, the list would have contained the whole
-   program, but since we don't, it doesn't. :-) */
+   program, but since we don't, it doesn't. :-)
+   The quads are kept in one contiguous buffer, in order. */
 class quad_list
 {
 private:
-    // Pointer to the first list element.
-    quad_list_element *head;
-
-    // Pointer to the rest of the elements.
-    quad_list_element *tail;
+    // The quads themselves.
+    vector<quadruple> quads;
 
     // Used to get nice printouts.
     int quad_nr;
@@ -140,15 +196,42 @@ private:
      // Used to get nice printouts.
     void print(ostream &);
 
+    // For layout_branches(). The index of the first quad after i that
+    // isn't a q_nop, or -1, and whether a label is among the ones
+    // directly after quad i.
+    long next_quad(long);
+    bool label_follows(long, long);
+
 public:
     // Label marking the end of a quad list.
-    int last_label;
+    long last_label;
 
     // Constructor. Arg == last_label.
-    quad_list(int);
+    quad_list(long);
 
     // Add on a new quad last on the list.
-    quad_list &operator+=(quadruple *q);
+    quad_list &operator+=(const quadruple &q);
+
+    // Remove all q_nop quads, keeping the order of the rest.
+    void remove_nops();
+
+    // Make the q_profloop quads generated for a block belong to it.
+    void claim_loops(sym_index block);
+
+    // Thread jumps to jumps, and remove jumps to the next label, dead code
+    // and labels nothing jumps to. The quads removed become q_nop. Returns
+    // true if anything changed.
+    bool layout_branches();
+
+    // Insert quads in front of the quads at the given indices, or at the
+    // end for the size of the list.
+    void insert_quads(map<long, vector<quadruple> > &);
+
+    // Number of quads in the list.
+    long size() { return quads.size(); }
+
+    // Random access to the quads.
+    quadruple &operator[](long i) { return quads[i]; }
 
     // Allow the iterator access to private data fields in this class.
     friend class quad_list_iterator;
@@ -601,11 +601,15 @@ char *yytext;
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 
 //#include "scanner.hh"
 #include "ast.hh"
 #include "parser.hh"
+#include "stats.hh"
 // This is where you put #include directives as needed for later labs.
 // include "ast.hh", parser.hh" in that order
 
@@ -613,6 +617,13 @@ int column = 0;
 
 extern YYLTYPE yylloc; // Used for position information, see below.
 
+// Every rule starts out by recording where its text starts and moving the
+// column past it, so the actions only deal with newlines.
+#define YY_USER_ACTION                  \
+    yylloc.first_line = yylineno;       \
+    yylloc.first_column = column;       \
+    column += yyleng;
+
 /* If you want to include any flex declarations, this is where to do it. */
 
 
@@ -623,7 +634,7 @@ extern YYLTYPE yylloc; // Used for position information, see below.
 /* Your code should be entered below the %%. Expressions to handle the
    following: Diesel comments, Diesel string constants, Diesel
    identifiers, integers, reals, and whitespace. */
-#line 627 "scanner.cc"
+#line 638 "scanner.cc"
 
 #define INITIAL 0
 #define c_comment 1
@@ -812,10 +823,10 @@ YY_DECL
 	register char *yy_cp, *yy_bp;
 	register int yy_act;
     
-#line 41 "scanner.l"
+#line 52 "scanner.l"
 
 
-#line 819 "scanner.cc"
+#line 830 "scanner.cc"
 
 	if ( !(yy_init) )
 		{
@@ -910,421 +921,226 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 43 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_DOT;
-                         }
+#line 54 "scanner.l"
+return T_DOT;
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 49 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_SEMICOLON;
-                         }
+#line 55 "scanner.l"
+return T_SEMICOLON;
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 55 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_EQ;
-                         }
+#line 56 "scanner.l"
+return T_EQ;
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 61 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_COLON;
-                         }
+#line 57 "scanner.l"
+return T_COLON;
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 67 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_LEFTPAR;
-                         }
+#line 58 "scanner.l"
+return T_LEFTPAR;
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 73 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_RIGHTPAR;
-                         }
+#line 59 "scanner.l"
+return T_RIGHTPAR;
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 79 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_LEFTBRACKET;
-                         }
+#line 60 "scanner.l"
+return T_LEFTBRACKET;
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 85 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_RIGHTBRACKET;
-                         }
+#line 61 "scanner.l"
+return T_RIGHTBRACKET;
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 91 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_COMMA;
-                         }
+#line 62 "scanner.l"
+return T_COMMA;
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 97 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_LESSTHAN;
-                         }
+#line 63 "scanner.l"
+return T_LESSTHAN;
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 103 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_GREATERTHAN;
-                         }
+#line 64 "scanner.l"
+return T_GREATERTHAN;
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 109 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_ADD;
-                         }
+#line 65 "scanner.l"
+return T_ADD;
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 115 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_SUB;
-                         }
+#line 66 "scanner.l"
+return T_SUB;
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 122 "scanner.l"
+#line 68 "scanner.l"
 {
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
                             return T_MUL;
                          }
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 128 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_RDIV;
-                         }
+#line 71 "scanner.l"
+return T_RDIV;
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 134 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_ASSIGN;
-                         }
+#line 72 "scanner.l"
+return T_ASSIGN;
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 140 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_NOTEQ;
-                         }
+#line 73 "scanner.l"
+return T_NOTEQ;
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 148 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_OF;
-                         }
+#line 76 "scanner.l"
+return T_OF;
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 154 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_IF;
-                         }
+#line 77 "scanner.l"
+return T_IF;
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 161 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_DO;
-                         }
+#line 79 "scanner.l"
+return T_DO;
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 168 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_OR;
-                         }
+#line 81 "scanner.l"
+return T_OR;
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 175 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_VAR;
-                         }
+#line 83 "scanner.l"
+return T_VAR;
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 182 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_END;
-                         }
+#line 85 "scanner.l"
+return T_END;
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 189 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_AND;
-                         }
+#line 87 "scanner.l"
+return T_AND;
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 196 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_IDIV;
-                         }
+#line 89 "scanner.l"
+return T_IDIV;
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 203 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_MOD;
-                         }
+#line 91 "scanner.l"
+return T_MOD;
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 210 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_NOT;
-                         }
+#line 93 "scanner.l"
+return T_NOT;
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 217 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_THEN;
-                         }
+#line 95 "scanner.l"
+return T_THEN;
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 224 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_ELSE;
-                         }
+#line 97 "scanner.l"
+return T_ELSE;
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 231 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_CONST;
-                         }
+#line 99 "scanner.l"
+return T_CONST;
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 238 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_ARRAY;
-                         }
+#line 101 "scanner.l"
+return T_ARRAY;
 	YY_BREAK
 case 32:
 YY_RULE_SETUP
-#line 245 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_BEGIN;
-                         }
+#line 103 "scanner.l"
+return T_BEGIN;
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 252 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_WHILE;
-                         }
+#line 105 "scanner.l"
+return T_WHILE;
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 259 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_ELSIF;
-                         }
+#line 107 "scanner.l"
+return T_ELSIF;
 	YY_BREAK
 case 35:
 YY_RULE_SETUP
-#line 266 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_RETURN;
-                         }
+#line 109 "scanner.l"
+return T_RETURN;
 	YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 273 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_PROGRAM;
-                         }
+#line 111 "scanner.l"
+return T_PROGRAM;
 	YY_BREAK
 case 37:
 YY_RULE_SETUP
-#line 280 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_FUNCTION;
-                         }
+#line 113 "scanner.l"
+return T_FUNCTION;
 	YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 287 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            return T_PROCEDURE;
-                         }
+#line 115 "scanner.l"
+return T_PROCEDURE;
 	YY_BREAK
 case 39:
 YY_RULE_SETUP
-#line 294 "scanner.l"
+#line 117 "scanner.l"
 {
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
                             yylval.rval = atof(yytext);
                             return T_REALNUM;
                          }
 	YY_BREAK
 case 40:
 YY_RULE_SETUP
-#line 302 "scanner.l"
+#line 122 "scanner.l"
 {
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
                             yylval.ival = atoi(yytext);
                             return T_INTNUM;
                          }
 	YY_BREAK
 case 41:
 YY_RULE_SETUP
-#line 310 "scanner.l"
+#line 127 "scanner.l"
 {
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            yylval.str = sym_tab->pool_install(sym_tab->fix_string(yytext));
+                            char *fixed = sym_tab->fix_string(yytext);
+                            yylval.str = sym_tab->pool_install(fixed);
+                            delete[] fixed;
                             return T_STRINGCONST;
                           }
 	YY_BREAK
 case 42:
 /* rule 42 can match eol */
 YY_RULE_SETUP
-#line 318 "scanner.l"
+#line 134 "scanner.l"
 {
                             column = 0;
                             yyerror("Newline in string");
@@ -1332,12 +1148,18 @@ YY_RULE_SETUP
 	YY_BREAK
 case 43:
 YY_RULE_SETUP
-#line 323 "scanner.l"
-{
-                            yylloc.first_line = yylineno;
-                            yylloc.first_column = column;
-                            column += yyleng;
-                            yylval.pool_p = sym_tab->pool_install(sym_tab->capitalize(yytext));
+#line 139 "scanner.l"
+{
+                            // Identifiers are case insensitive. They are
+                            // folded to upper case in place, in the input
+                            // buffer.
+                            for (int i = 0; i < yyleng; i++) {
+                                if (yytext[i] >= 'a' && yytext[i] <= 'z') {
+                                    yytext[i] -= 'a' - 'A';
+                                }
+                            }
+                            yylval.pool_p = sym_tab->pool_install(yytext,
+                                                                  yyleng);
                             return T_IDENT;
                          }
 	YY_BREAK
@@ -1346,48 +1168,39 @@ case 44:
 (yy_c_buf_p) = yy_cp -= 1;
 YY_DO_BEFORE_ACTION; /* set up yytext again */
 YY_RULE_SETUP
-#line 331 "scanner.l"
+#line 153 "scanner.l"
 column = 0; /* Skip single-line comment */
 	YY_BREAK
 case 45:
 YY_RULE_SETUP
-#line 332 "scanner.l"
-{
-                            column += yyleng;
-                            BEGIN(c_comment);
-                         }
+#line 154 "scanner.l"
+BEGIN(c_comment);
 	YY_BREAK
 
 
 case 46:
 YY_RULE_SETUP
-#line 339 "scanner.l"
-{
-                            column += 2;
-                            BEGIN(INITIAL);
-                         }
+#line 158 "scanner.l"
+BEGIN(INITIAL);
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 343 "scanner.l"
-{
-                            column += 2;
-                            yyerror("Suspicious comment");
-                         }
+#line 159 "scanner.l"
+yyerror("Suspicious comment");
 	YY_BREAK
 case 48:
 YY_RULE_SETUP
-#line 347 "scanner.l"
-column++; /* Skip stuff in comments */
+#line 160 "scanner.l"
+; /* Skip stuff in comments */
 	YY_BREAK
 case 49:
 /* rule 49 can match eol */
 YY_RULE_SETUP
-#line 348 "scanner.l"
+#line 161 "scanner.l"
 column = 0;
 	YY_BREAK
 case YY_STATE_EOF(c_comment):
-#line 349 "scanner.l"
+#line 162 "scanner.l"
 {
                             yyerror("Unterminated comment");
                             yyterminate();
@@ -1396,43 +1209,34 @@ case YY_STATE_EOF(c_comment):
 
 case 50:
 YY_RULE_SETUP
-#line 355 "scanner.l"
-{
-                            column += yyleng;
-                            BEGIN(d_comment);
-                         }
+#line 168 "scanner.l"
+BEGIN(d_comment);
 	YY_BREAK
 
 
 case 51:
 YY_RULE_SETUP
-#line 362 "scanner.l"
-{
-                            column += 1;
-                            yyerror("Suspicious comment");
-                       }
+#line 172 "scanner.l"
+yyerror("Suspicious comment");
 	YY_BREAK
 case 52:
 YY_RULE_SETUP
-#line 366 "scanner.l"
-{
-                            column += 1;
-                            BEGIN(INITIAL);
-                         }
+#line 173 "scanner.l"
+BEGIN(INITIAL);
 	YY_BREAK
 case 53:
 YY_RULE_SETUP
-#line 370 "scanner.l"
-column++; /* Skip stuff in comments */
+#line 174 "scanner.l"
+; /* Skip stuff in comments */
 	YY_BREAK
 case 54:
 /* rule 54 can match eol */
 YY_RULE_SETUP
-#line 371 "scanner.l"
+#line 175 "scanner.l"
 column = 0;
 	YY_BREAK
 case YY_STATE_EOF(d_comment):
-#line 372 "scanner.l"
+#line 176 "scanner.l"
 {
                             yyerror("Unterminated comment");
                             yyterminate();
@@ -1441,36 +1245,30 @@ case YY_STATE_EOF(d_comment):
 
 case 55:
 YY_RULE_SETUP
-#line 378 "scanner.l"
-{
-			                     yylloc.first_column = column;
-			                     column += yyleng;
-			                   }
+#line 182 "scanner.l"
+; /* Skip whitespace */
 	YY_BREAK
 case 56:
 /* rule 56 can match eol */
 YY_RULE_SETUP
-#line 383 "scanner.l"
-{
-                    			  yylloc.first_column = column;
-                    			  column = 0;
-                         }
+#line 184 "scanner.l"
+column = 0;
 	YY_BREAK
 case YY_STATE_EOF(INITIAL):
-#line 390 "scanner.l"
+#line 188 "scanner.l"
 yyterminate();
 	YY_BREAK
 case 57:
 YY_RULE_SETUP
-#line 391 "scanner.l"
+#line 189 "scanner.l"
 yyerror("Illegal character");
 	YY_BREAK
 case 58:
 YY_RULE_SETUP
-#line 392 "scanner.l"
+#line 191 "scanner.l"
 ECHO;
 	YY_BREAK
-#line 1474 "scanner.cc"
+#line 1272 "scanner.cc"
 
 	case YY_END_OF_BUFFER:
 		{
@@ -2478,4 +2276,48 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 392 "scanner.l"
+#line 192 "scanner.l"
+/* The whole input is read in one go and scanned where it is, instead of
+   being copied through stdio in small pieces. This is also what lets the
+   identifier rule fold the case of the token text in place. */
+void scan_input(FILE *input)
+{
+    int fd = fileno(input);
+    struct stat st;
+    long size = 0;
+    long room = 64 * 1024;
+
+    // A regular file fits at once, with a byte to spare to see the end.
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        room = st.st_size + 1;
+    }
+
+    // flex wants two NULs after the text of a buffer.
+    char *buffer = (char *) malloc(room + 2);
+    for (;;) {
+        if (size == room) {
+            room *= 2;
+            buffer = (char *) realloc(buffer, room + 2);
+        }
+        if (buffer == NULL) {
+            fatal("Out of memory reading the input");
+        }
+        ssize_t done = read(fd, buffer + size, room - size);
+        if (done == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fatal("Could not read the input");
+        }
+        if (done == 0) {
+            break;
+        }
+        size += done;
+    }
+    buffer[size] = YY_END_OF_BUFFER_CHAR;
+    buffer[size + 1] = YY_END_OF_BUFFER_CHAR;
+
+    compile_stats->count_input(size);
+    yy_scan_buffer(buffer, size + 2);
+}
+
@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "semantic.hh"
 
 
@@ -37,29 +39,29 @@ void semantic::do_typecheck(symbol *env, ast_stmt_list *body)
 }
 
 
-/* Compare formal vs. actual parameters recursively. */
+/* Compare formal vs. actual parameters, from the first one on. The formals
+   are linked backwards from the last one, so they are collected first. */
 bool semantic::chk_param(ast_id *env,
                         parameter_symbol *formals,
                         ast_expr_list *actuals)
 {
-    if (actuals == NULL && formals == NULL){
-        return true;
-    }
-    else if(actuals == NULL && formals != NULL){
-          return false;
+    vector<parameter_symbol *> params;
+    for (; formals != NULL; formals = formals->preceding) {
+        params.push_back(formals);
     }
-    else if(formals == NULL && actuals != NULL){
-          return false;
+    long count = actuals == NULL ? 0 : actuals->exprs.size();
+    if ((long) params.size() != count) {
+        return false;
     }
 
-    if (!chk_param(env, formals->preceding, actuals->preceding))
-      return false;
-
-
-    if (actuals->last_expr->type != formals->type){
-      if (formals->type == real_type)
-        actuals->last_expr = new ast_cast(actuals->last_expr->pos,actuals->last_expr);
-      else return false;
+    for (long i = 0; i < count; i++) {
+        parameter_symbol *formal = params[count - 1 - i];
+        ast_expression *&actual = actuals->exprs[i];
+        if (actual->type != formal->type) {
+            if (formal->type == real_type)
+                actual = new ast_cast(actual->pos, actual);
+            else return false;
+        }
     }
     return true;
 }
@@ -132,11 +134,8 @@ sym_index ast_binaryrelation::type_check()
 /* Type check a list of statements. */
 sym_index ast_stmt_list::type_check()
 {
-    if (preceding != NULL) {
-        preceding->type_check();
-    }
-    if (last_stmt != NULL) {
-        last_stmt->type_check();
+    for (long i = 0; i < stmts.size(); i++) {
+        stmts[i]->type_check();
     }
     return void_type;
 }
@@ -145,11 +144,8 @@ sym_index ast_stmt_list::type_check()
 /* Type check a list of expressions. */
 sym_index ast_expr_list::type_check()
 {
-    if (preceding != NULL) {
-        preceding->type_check();
-    }
-    if (last_expr != NULL) {
-        last_expr->type_check();
+    for (long i = 0; i < exprs.size(); i++) {
+        exprs[i]->type_check();
     }
     return void_type;
 }
@@ -159,11 +155,8 @@ sym_index ast_expr_list::type_check()
 /* Type check an elsif list. */
 sym_index ast_elsif_list::type_check()
 {
-    if (preceding != NULL) {
-        preceding->type_check();
-    }
-    if (last_elsif != NULL) {
-        last_elsif->type_check();
+    for (long i = 0; i < elsifs.size(); i++) {
+        elsifs[i]->type_check();
     }
     return void_type;
 }
@@ -267,7 +260,7 @@ sym_index semantic::check_binop2(ast_binaryoperation *node, string s)
 
 sym_index ast_or::type_check()
 {
-    return type_checker->check_binop2(this, "OR");
+    return type = type_checker->check_binop2(this, "OR");
 }
 
 sym_index ast_and::type_check()
@@ -0,0 +1,306 @@
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "arena.hh"
+#include "codegen.hh"
+#include "stats.hh"
+
+// Defined in main.cc.
+extern bool phase_statistics;
+
+// Defined in codegen.cc.
+extern code_generator *code_gen;
+
+compile_statistics *compile_stats = new compile_statistics();
+
+
+/* All heap allocations go through these, so that they can be counted.
+   They are only counted with -T, so that the threads of -j don't share the
+   atomic counters all the time. The flag is set before any thread starts,
+   and what was allocated before that isn't in any phase anyway. */
+static atomic<long> heap_allocations(0);
+static atomic<long> heap_bytes(0);
+
+void *operator new(size_t size)
+{
+    if (phase_statistics) {
+        heap_allocations++;
+        heap_bytes += size;
+    }
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+
+static const char *phase_names[NR_PHASES] = {
+    "parse", "typecheck", "optimize", "quads", "quadopt", "codegen"
+};
+
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+/* Allocations from the heap and from all arenas, counted together. */
+static long allocations()
+{
+    return heap_allocations + arena::total_allocations;
+}
+
+static long allocated_bytes()
+{
+    return heap_bytes + arena::total_bytes;
+}
+
+
+compile_statistics::compile_statistics()
+{
+    phase = PHASE_PARSE;
+    phase_start = 0;
+    phase_allocations = 0;
+    phase_allocated_bytes = 0;
+    last_instructions = 0;
+    last_bytes = 0;
+    max_sym_pos = 0;
+    max_pool_pos = 0;
+    max_temp_nr = 0;
+    max_label_nr = 0;
+    input_bytes = 0;
+    compile_start = 0;
+    clear_current();
+}
+
+
+void compile_statistics::clear_current()
+{
+    current.name = "";
+    current.level = 0;
+    for (int i = 0; i < NR_PHASES; i++) {
+        current.phases[i].seconds = 0;
+        current.phases[i].allocations = 0;
+        current.phases[i].allocated_bytes = 0;
+    }
+    current.quads = 0;
+    current.optimized_quads = 0;
+    current.instructions = 0;
+    current.bytes = 0;
+}
+
+
+void compile_statistics::charge_phase()
+{
+    double t = now();
+    long a = allocations();
+    long b = allocated_bytes();
+
+    current.phases[phase].seconds += t - phase_start;
+    current.phases[phase].allocations += a - phase_allocations;
+    current.phases[phase].allocated_bytes += b - phase_allocated_bytes;
+
+    phase_start = t;
+    phase_allocations = a;
+    phase_allocated_bytes = b;
+}
+
+
+void compile_statistics::update_high_water()
+{
+    if (sym_tab->get_sym_pos() > max_sym_pos) {
+        max_sym_pos = sym_tab->get_sym_pos();
+    }
+    if (sym_tab->get_pool_pos() > max_pool_pos) {
+        max_pool_pos = sym_tab->get_pool_pos();
+    }
+    if (sym_tab->get_temp_nr() > max_temp_nr) {
+        max_temp_nr = sym_tab->get_temp_nr();
+    }
+    if (sym_tab->get_label_nr() > max_label_nr) {
+        max_label_nr = sym_tab->get_label_nr();
+    }
+}
+
+
+void compile_statistics::start()
+{
+    if (!phase_statistics) {
+        return;
+    }
+    compile_start = now();
+    phase = PHASE_PARSE;
+    phase_start = compile_start;
+    phase_allocations = allocations();
+    phase_allocated_bytes = allocated_bytes();
+}
+
+
+void compile_statistics::enter_phase(phase_type p)
+{
+    if (!phase_statistics) {
+        return;
+    }
+    charge_phase();
+    phase = p;
+}
+
+
+void compile_statistics::begin_block(symbol *env)
+{
+    if (!phase_statistics) {
+        return;
+    }
+    ostringstream name;
+    name << sym_tab->pool_lookup(env->id);
+    current.name = name.str();
+    current.level = env->level;
+}
+
+
+void compile_statistics::count_quads(long n)
+{
+    if (!phase_statistics) {
+        return;
+    }
+    current.quads = n;
+    current.optimized_quads = n;
+}
+
+
+void compile_statistics::count_optimized_quads(long n)
+{
+    if (!phase_statistics) {
+        return;
+    }
+    current.optimized_quads = n;
+}
+
+
+void compile_statistics::end_block()
+{
+    if (!phase_statistics) {
+        return;
+    }
+    charge_phase();
+    phase = PHASE_PARSE;
+
+    current.instructions = code_gen->get_instructions() - last_instructions;
+    current.bytes = code_gen->get_bytes_written() - last_bytes;
+    last_instructions = code_gen->get_instructions();
+    last_bytes = code_gen->get_bytes_written();
+    update_high_water();
+
+    blocks.push_back(current);
+    clear_current();
+}
+
+
+void compile_statistics::print_cost(ostream &o, const phase_cost &c)
+{
+    o << "{\"seconds\": " << c.seconds
+      << ", \"allocations\": " << c.allocations
+      << ", \"allocated_bytes\": " << c.allocated_bytes << "}";
+}
+
+
+/* The input is read once, so this is counted even without -T. */
+void compile_statistics::count_input(long n)
+{
+    input_bytes = n;
+}
+
+
+/* Print everything as one JSON object on stderr. Whatever happened after
+   the last block, such as parsing the final "end.", has no block of its
+   own but is included in the totals. */
+void compile_statistics::finish()
+{
+    if (!phase_statistics) {
+        return;
+    }
+    charge_phase();
+    update_high_water();
+
+    block_record total = current;
+    for (unsigned i = 0; i < blocks.size(); i++) {
+        for (int p = 0; p < NR_PHASES; p++) {
+            total.phases[p].seconds += blocks[i].phases[p].seconds;
+            total.phases[p].allocations += blocks[i].phases[p].allocations;
+            total.phases[p].allocated_bytes +=
+                blocks[i].phases[p].allocated_bytes;
+        }
+        total.quads += blocks[i].quads;
+        total.optimized_quads += blocks[i].optimized_quads;
+        total.instructions += blocks[i].instructions;
+        total.bytes += blocks[i].bytes;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    ostringstream o;
+    o << fixed << setprecision(6);
+    o << "{\"seconds\": " << now() - compile_start
+      << ", \"peak_rss_kb\": " << usage.ru_maxrss
+      << ", \"input_bytes\": " << input_bytes
+      << ",\n \"phases\": {";
+    for (int p = 0; p < NR_PHASES; p++) {
+        o << (p == 0 ? "" : ", ") << "\"" << phase_names[p] << "\": ";
+        print_cost(o, total.phases[p]);
+    }
+    o << "},\n \"symtab\": {\"sym_pos\": " << max_sym_pos
+      << ", \"pool_pos\": " << max_pool_pos
+      << ", \"temp_nr\": " << max_temp_nr
+      << ", \"label_nr\": " << max_label_nr << "},\n"
+      << " \"quads\": " << total.quads
+      << ", \"optimized_quads\": " << total.optimized_quads
+      << ", \"instructions\": " << total.instructions
+      << ", \"bytes\": " << total.bytes
+      << ",\n \"blocks\": [";
+
+    // Identifiers are letters, digits and underscores only, so the names
+    // need no escaping.
+    for (unsigned i = 0; i < blocks.size(); i++) {
+        const block_record &b = blocks[i];
+        o << (i == 0 ? "\n  " : ",\n  ")
+          << "{\"name\": \"" << b.name << "\", \"level\": " << b.level
+          << ", \"phases\": {";
+        for (int p = 0; p < NR_PHASES; p++) {
+            o << (p == 0 ? "" : ", ") << "\"" << phase_names[p] << "\": ";
+            print_cost(o, b.phases[p]);
+        }
+        o << "}, \"quads\": " << b.quads
+          << ", \"optimized_quads\": " << b.optimized_quads
+          << ", \"instructions\": " << b.instructions
+          << ", \"bytes\": " << b.bytes << "}";
+    }
+    o << "]}" << endl;
+
+    cerr << o.str() << flush;
+}
@@ -0,0 +1,128 @@
+#ifndef __STATS_HH__
+#define __STATS_HH__
+
+#include <string>
+#include <vector>
+
+#include "symtab.hh"
+
+using namespace std;
+
+
+/*** This class collects the statistics printed by the -T flag: wall time
+     and allocations per compiler phase and per block, how far the symbol
+     table and string pool grew, and how many quads and instructions each
+     block turned into. They are printed as one JSON object on stderr when
+     compilation is done.
+
+     Time is accounted by phase switches: the parser actions call
+     enter_phase() before each pass over a block and go back to
+     PHASE_PARSE when the block is done, and whatever passed since the last
+     switch is charged to the phase that was running. Scanning and parsing
+     thus get everything that isn't one of the passes. A block is charged
+     with all that happened since the previous block was finished, which
+     includes parsing its own declarations and statements. ***/
+
+
+enum phase_type {
+    PHASE_PARSE,
+    PHASE_TYPECHECK,
+    PHASE_OPTIMIZE,
+    PHASE_QUADS,
+    PHASE_QUADOPT,
+    PHASE_CODEGEN,
+    NR_PHASES
+};
+
+
+class compile_statistics;
+
+// Defined in stats.cc.
+extern compile_statistics *compile_stats;
+
+
+class compile_statistics
+{
+private:
+    // What was spent in each phase.
+    struct phase_cost
+    {
+        double seconds;
+        long allocations;
+        long allocated_bytes;
+    };
+
+    // Everything recorded for one block.
+    struct block_record
+    {
+        string name;
+        int level;
+        phase_cost phases[NR_PHASES];
+        long quads;
+        long optimized_quads;
+        long instructions;
+        long bytes;
+    };
+
+    // The finished blocks, in the order they were compiled.
+    vector<block_record> blocks;
+
+    // The block currently being worked on. Becomes the next entry in
+    // blocks when end_block() is called.
+    block_record current;
+
+    // The phase the compiler is in, and when it got there.
+    phase_type phase;
+    double phase_start;
+    long phase_allocations;
+    long phase_allocated_bytes;
+
+    // Output counters of the code generator when the last block was done.
+    long last_instructions;
+    long last_bytes;
+
+    // High-water marks of the symbol table.
+    long max_sym_pos;
+    long max_pool_pos;
+    long max_temp_nr;
+    long max_label_nr;
+
+    double compile_start;
+
+    // Size of the source, for the scanning speed.
+    long input_bytes;
+
+    // Charge what was spent since the last phase switch to the phase
+    // that was running.
+    void charge_phase();
+
+    // Start over with an empty record in current.
+    void clear_current();
+
+    // Remember the symbol table sizes if they are larger than before.
+    void update_high_water();
+
+    // Write a phase_cost as JSON.
+    void print_cost(ostream &, const phase_cost &);
+
+public:
+    compile_statistics();
+
+    // Called from main.cc around yyparse().
+    void start();
+    void finish();
+
+    // Called from the parser actions. These return at once unless -T was
+    // given, so that they don't cost anything otherwise.
+    void enter_phase(phase_type);
+    void begin_block(symbol *env);
+    void count_quads(long);
+    void count_optimized_quads(long);
+    void end_block();
+
+    // Called from the scanner once it has read the input.
+    void count_input(long);
+};
+
+
+#endif
@@ -36,6 +36,7 @@ constant_symbol::constant_symbol(const pool_index pool_p) :
 variable_symbol::variable_symbol(const pool_index pool_p) :
     symbol(pool_p)
 {
+    temp = false;
 }
 
 
@@ -55,6 +56,8 @@ parameter_symbol::parameter_symbol(const pool_index pool_p) :
 {
     size = 0;
     preceding = NULL;
+    arg_reg = -1;
+    sym_p = NULL_SYM;
 }
 
 
@@ -266,6 +269,7 @@ void parameter_symbol::print(ostream &o)
     case LONG_FORMAT:
         o << "  class:     parameter_symbol" << endl;
         o << "  size:      " << size << endl;
+        o << "  arg_reg:   " << arg_reg << endl;
         if (preceding == NULL) {
             o << "  preceding: NULL" << endl;
         } else
@@ -8,15 +8,26 @@
 #include <string.h>
 #include "symtab.hh"
 
+// Defined in main.cc.
+extern bool register_parameters;
+
 using namespace std;
 
 /*** Global variables ***/
 
+// Size of the length header in front of each string in the pool.
+static const long POOL_HEADER = sizeof(long);
+
 // The symbol table is a table of pointers to symbol (which can be of various types)
 symbol_table *sym_tab = new symbol_table();
 sym_index void_type;
 sym_index integer_type;
 sym_index real_type;
+sym_index trunc_function;
+
+// The range the labels and temps of the calling thread come out of, with
+// -j. NULL in the parser's thread.
+static thread_local block_range *current_range = NULL;
 
 
 
@@ -44,32 +55,39 @@ symbol_table::symbol_table()
     string_pool = new char[pool_length];
     string_pool[0] = '\0';
 
+    intern_size = BASE_INTERN_SIZE;
+    intern_count = 0;
+    intern_table = new intern_entry[intern_size];
+    for (long i = 0; i < intern_size; i++) {
+        intern_table[i].hash = 0;
+        intern_table[i].id = NULL_POOL;
+    }
+
     // --- Initialize hash table. ---
-    hash_table = new sym_index[MAX_HASH];
-    for (int i = 0; i < MAX_HASH; i++) {
-        hash_table[i] = NULL_SYM;
+    hash_size = BASE_HASH_SIZE;
+    hash_used = 0;
+    hash_table = new hash_entry[hash_size];
+    for (int i = 0; i < hash_size; i++) {
+        hash_table[i].hash = 0;
+        hash_table[i].id = NULL_POOL;
+        hash_table[i].sym = NULL_SYM;
     }
 
     // --- Initialize display. ---
     // The block_table will keep track of the current lexical level
     // global level is 0
     current_level = 0;
-    block_table = new sym_index[MAX_BLOCK];
-    for (int i = 0; i < MAX_BLOCK; i++) {
-        block_table[i] = 0;
-    }
+    block_table.ensure(current_level);
 
     // --- Initialize symbol table. ---
-    // Weird syntax, gives us a table of pointers to symbols.
-    sym_table = new symbol*[MAX_SYM];
-    for (int i = 0; i < MAX_SYM; i++) {
-        sym_table[i] = NULL;
-    }
+    // The sym_table grows as symbols are installed, see install_symbol().
 
     label_nr = -1;
     temp_nr = 0;
+    shared = false;
     // sym_pos will point to the last entry in symbol table
     sym_pos = -1;
+    last_installed = -1;
 
     // --- Install predefined symbols. ---
     // If the scanner works the TEST_SCANNER must be set to 0.
@@ -83,7 +101,7 @@ symbol_table::symbol_table()
     position_information *dummy_pos = new position_information();
 
     // This "empty" symbol represents the global level.
-    enter_procedure(dummy_pos, pool_install(capitalize("global.")));
+    enter_procedure(dummy_pos, pool_install("GLOBAL."));
     // Needed since there have been no types installed yet.
     sym_table[0]->type = void_type;
 
@@ -91,16 +109,16 @@ symbol_table::symbol_table()
     // is used, since currently Diesel's grammar doesn't handle used-defined
     // types.
 
-    void_type = enter_nametype(dummy_pos, pool_install(capitalize("void")));
+    void_type = enter_nametype(dummy_pos, pool_install("VOID"));
     sym_table[void_type]->type = void_type; // Needed since it's the first one.
 
-    integer_type = enter_nametype(dummy_pos, pool_install(capitalize("integer")));
+    integer_type = enter_nametype(dummy_pos, pool_install("INTEGER"));
 
-    real_type = enter_nametype(dummy_pos, pool_install(capitalize("real")));
+    real_type = enter_nametype(dummy_pos, pool_install("REAL"));
 
     {
         // Add the read() function. It returns an integer and takes no arguments.
-        sym_index read_sym = enter_function(dummy_pos, pool_install(capitalize("read")));
+        sym_index read_sym = enter_function(dummy_pos, pool_install("READ"));
         sym_table[read_sym]->type = integer_type;
     }
     {
@@ -109,9 +127,9 @@ symbol_table::symbol_table()
         // environment doesn't work exactly like a normal scope. To do this
         // we're forced to do some safe downcasting (the get_foo_symbol() calls).
         // We do that to get hold of the correct subclass of symbol.
-        sym_index write_sym = enter_procedure(dummy_pos, pool_install(capitalize("write")));
+        sym_index write_sym = enter_procedure(dummy_pos, pool_install("WRITE"));
         sym_index int_arg = enter_parameter(dummy_pos,
-                                            pool_install(capitalize("int-arg")),
+                                            pool_install("INT-ARG"),
                                             integer_type);
         procedure_symbol *proc = sym_table[write_sym]->get_procedure_symbol();
         proc->last_parameter = sym_table[int_arg]->get_parameter_symbol();
@@ -119,15 +137,15 @@ symbol_table::symbol_table()
 
     // Add the trunc(real-arg) function. It returns an integer and takes
     // a real argument.
-    sym_index trunc_sym = enter_function(dummy_pos, pool_install(capitalize("trunc")));
-    symbol *truc = sym_table[trunc_sym];
+    trunc_function = enter_function(dummy_pos, pool_install("TRUNC"));
+    symbol *truc = sym_table[trunc_function];
     truc->type = integer_type;
 
     // Get rid of int-arg, which is linked together with real-arg by
     // enter_parameter. This is very handy everywhere in this compiler except
     // just here. So this workaround is unfortunately needed.
     sym_index real_arg = enter_parameter(dummy_pos,
-                           pool_install(capitalize("real-arg")),
+                           pool_install("REAL-ARG"),
                            real_type);
 
     parameter_symbol *par = sym_table[real_arg]->get_parameter_symbol();
@@ -161,6 +179,12 @@ long symbol_table::get_next_label()
 {
     // Labels start on -1 (which is the global level, meaning that all labels
     // generated for user-defined functions etc start with 0).
+    if (current_range != NULL) {
+        if (current_range->next_label == current_range->end_label) {
+            fatal("Exceeded the number of labels reserved for a block");
+        }
+        return current_range->next_label++;
+    }
     return label_nr++;
 }
 
@@ -175,13 +199,102 @@ sym_index symbol_table::gen_temp_var(sym_index type)
     if(type == void_type){
       fatal("Void type not allowed: symbol_table::gen_temp_var");
     }
+    if (current_range != NULL) {
+        return gen_range_temp(type);
+    }
     if(temp_nr > MAX_TEMP_VARS){
       fatal("Exceeded the max number of variable: 1 000 000");
     }
     temp_nr++;
     name = "$" + to_string(temp_nr);
-    pool_index p_index = pool_install(&name[0]);
-    return enter_variable(p_index, type);
+    pool_index p_index = pool_install(name.c_str(), name.length());
+    sym_index sym_p = enter_variable(p_index, type);
+    sym_table[sym_p]->get_variable_symbol()->temp = true;
+    return sym_p;
+}
+
+
+/* Make a temp for the block of the current range, in a thread of its own.
+   The temp is not entered in the hash table, since it is never looked up
+   by name, and the parser may have moved on to other scopes meanwhile. */
+sym_index symbol_table::gen_range_temp(sym_index type)
+{
+    unique_lock<recursive_mutex> lock = lock_table();
+    if (current_range->temp_nr > MAX_TEMP_VARS) {
+        fatal("Exceeded the max number of variable: 1 000 000");
+    }
+    current_range->temp_nr++;
+    string name = "$" + to_string(current_range->temp_nr);
+    variable_symbol *var = new (sym_arena)
+        variable_symbol(pool_install(name.c_str(), name.length()));
+    var->tag = SYM_VAR;
+    var->type = type;
+    var->temp = true;
+    var->hash_link = NULL_SYM;
+    var->back_link = NULL_SYM;
+
+    symbol *env = sym_table[current_range->env];
+    var->level = env->level + 1;
+    int *ar_size;
+    if (env->tag == SYM_FUNC) {
+        ar_size = &env->get_function_symbol()->ar_size;
+    } else {
+        ar_size = &env->get_procedure_symbol()->ar_size;
+    }
+    var->offset = *ar_size;
+    *ar_size += get_size(type);
+
+    sym_pos++;
+    sym_table.ensure(sym_pos);
+    sym_table[sym_pos] = var;
+    return sym_pos;
+}
+
+
+/* Take the table lock, if the table is shared between threads. */
+unique_lock<recursive_mutex> symbol_table::lock_table()
+{
+    unique_lock<recursive_mutex> lock(table_mutex, defer_lock);
+    if (shared) {
+        lock.lock();
+    }
+    return lock;
+}
+
+
+/* Called before the first -j thread is started. */
+void symbol_table::share()
+{
+    shared = true;
+}
+
+
+/* Reserve BLOCK_LABELS labels for the back end of the current block, which
+   is about to be handed over to another thread. */
+void symbol_table::reserve_range(block_range *range)
+{
+    range->env = current_environment();
+    range->next_label = label_nr;
+    label_nr += BLOCK_LABELS;
+    range->end_label = label_nr;
+    range->temp_nr = temp_nr;
+}
+
+
+void symbol_table::use_range(block_range *range)
+{
+    current_range = range;
+}
+
+
+/* Temp vars are the only symbols whose names start with a '$', since the
+   scanner never lets one through in an identifier. */
+bool symbol_table::is_temp_var(const sym_index sym_p)
+{
+    if (sym_p == NULL_SYM || sym_table[sym_p]->tag != SYM_VAR) {
+        return false;
+    }
+    return sym_table[sym_p]->get_variable_symbol()->temp;
 }
 
 
@@ -221,14 +334,11 @@ void symbol_table::print(int detail)
 {
     if (detail == 2) {
         if (pool_pos > 0) {
-            unsigned int pos = 0;
-            while (pos < strlen(string_pool)) {
-                unsigned int len = (int) string_pool[pos];
-                cout << len;
-                for (unsigned int k = pos + 1; k < pos + len + 1; k++) {
-                    cout << string_pool[k];
-                }
-                pos += len + 1;
+            pool_index pos = 0;
+            while (pos < pool_pos) {
+                pool_view v = pool_lookup(pos);
+                cout << v.len << v;
+                pos += POOL_HEADER + v.len + 1;
             }
             cout << endl;
 
@@ -244,10 +354,11 @@ void symbol_table::print(int detail)
     }
 
     if (detail == 3) {
-        cout << "Hash table:\n";
-        for (int j = 0; j < MAX_HASH; j++) {
-            if (hash_table[j]) {
-                cout << j << ": " << hash_table[j] << endl;
+        cout << "Hash table (size = " << hash_size << ", used = "
+             << hash_used << "):\n";
+        for (int j = 0; j < hash_size; j++) {
+            if (hash_table[j].sym != NULL_SYM) {
+                cout << j << ": " << hash_table[j].sym << endl;
             }
         }
         return;
@@ -372,78 +483,94 @@ char *symbol_table::capitalize(const char *s)
 }
 
 /* Install a string into the pool table and return its index.
-   The table is on the form <string1 length>string1<string2 length>string2...
-   Note that the null char denotes the end of the entire pool,
-   NOT the separator of two strings. It is appended in pool_lookup, though.
+   Each entry is a length header followed by the characters and a null byte:
+   <length>string1\0<length>string2\0...
+   The pool index of a string is the position of its header. A string that
+   is already in the pool is found through the intern table and is not
+   installed again, so two identifiers are equal iff their indices are.
    Snapshot:
-   7INTEGER4REAL4READ5WRITE4PROG1A\0
-                  ^
-                  pool_pos
+   7INTEGER\04REAL\04READ\05WRITE\04PROG\01A\0
+                                         ^
+                                         pool_pos
 */
 
-pool_index symbol_table::pool_install(char *s)
+pool_index symbol_table::pool_install(const char *s)
 {
-    // Make sure pool is not full. If it is, double pool size.
-    if (pool_pos + (int) strlen(s) >= pool_length) {
-        char *tmp_pool = new char[2 * pool_length];
-
-        // Double pool size.
-        pool_length *= 2;
-        strcpy(tmp_pool, string_pool);
-        delete[] string_pool;
-        string_pool = tmp_pool;
-    }
+    return pool_install(s, strlen(s));
+}
 
-    // The return value, ie, the start of the string.
-    long old_pos = pool_pos;
+pool_index symbol_table::pool_install(const char *s, const long len)
+{
+    unique_lock<recursive_mutex> lock = lock_table();
+    unsigned long h = hash_chars(s, len);
+    long slot = intern_probe(s, len, h);
+    if (intern_table[slot].id != NULL_POOL) {
+        return intern_table[slot].id;
+    }
 
-    // This is not really a pretty solution but it works for now. Some sort
-    // struct with length/char * would be a more general solution, since this
-    // way we're limited to strings that fit within 255 bytes.
-    if (strlen(s) >= 255) {
-        fatal("symbol_table::pool_install: Too long string");
-        return 0;
+    // Make sure pool is not full. If it is, double pool size until the new
+    // entry fits. Only the used part of the pool needs to be copied.
+    long needed = pool_pos + POOL_HEADER + len + 1;
+    if (needed > pool_length) {
+        while (needed > pool_length) {
+            pool_length *= 2;
+        }
+        char *tmp_pool = new char[pool_length];
+        memcpy(tmp_pool, string_pool, pool_pos);
+        if (shared) {
+            old_pools.push_back(string_pool);
+        } else {
+            delete[] string_pool;
+        }
+        string_pool = tmp_pool;
     }
 
-    // First install the length of the string.
-    string_pool[pool_pos++] = (unsigned char) strlen(s);
-    string_pool[pool_pos] = '\0';
+    // The return value, ie, the start of the entry.
+    pool_index old_pos = pool_pos;
 
-    // Add the string itself to the end of the pool.
-    strcat(string_pool, s);
+    memcpy(&string_pool[pool_pos], &len, POOL_HEADER);
+    memcpy(&string_pool[pool_pos + POOL_HEADER], s, len);
+    string_pool[pool_pos + POOL_HEADER + len] = '\0';
+    pool_pos = needed;
 
-    // Move pool_pos to the end of the new entry.
-    pool_pos += strlen(s);
+    intern_table[slot].hash = h;
+    intern_table[slot].id = old_pos;
+    // Keep the intern table at most half full.
+    if (++intern_count * 2 > intern_size) {
+        intern_grow();
+    }
 
     return old_pos;
 }
 
 
-/* Allocate memory for and return a string given a pool_index. */
+/* Return a view of the string given a pool_index. */
 
-char *symbol_table::pool_lookup(const pool_index p)
+pool_view symbol_table::pool_lookup(const pool_index p)
 {
+    unique_lock<recursive_mutex> lock = lock_table();
+
     // Catch references to beyond last string.
-    assert(p < pool_pos);
+    assert(p >= 0 && p < pool_pos);
 
-    // Start points to first char of the sought string.
-    // We just use it to index the pool, it is never assigned to.
-    char *start = &string_pool[p + 1];
+    pool_view v;
+    memcpy(&v.len, &string_pool[p], POOL_HEADER);
+    v.str = &string_pool[p + POOL_HEADER];
+    return v;
+}
 
-    // p points to the char holding the length of the sought string.
-    int length = (int) string_pool[p];
 
-    // We only want to return a string of length chars, plus
-    // one extra for the null terminator.
-    char *s = new char[length + 1];
-    strncpy(s, start, length);
-    s[length] = '\0';
+/* Output a pool string. The view is null terminated, so stream formatting
+   such as setw() works as for plain C strings. */
 
-    return s;
+ostream &operator<<(ostream &o, const pool_view &v)
+{
+    return o << v.str;
 }
 
 
-/* Compare two strings. */
+/* Compare two strings. All strings in the pool are distinct, so this is
+   just a comparison of their indices. */
 
 bool symbol_table::pool_compare(const pool_index pool_p1,
                                 const pool_index pool_p2)
@@ -451,7 +578,7 @@ bool symbol_table::pool_compare(const pool_index pool_p1,
     // Catch too large pos.
     assert(pool_p1 < pool_pos && pool_p2 < pool_pos);
 
-    return strcmp(pool_lookup(pool_p1), pool_lookup(pool_p2)) == 0;
+    return pool_p1 == pool_p2;
 }
 
 
@@ -459,10 +586,35 @@ bool symbol_table::pool_compare(const pool_index pool_p1,
 
 pool_index symbol_table::pool_forget(const pool_index pool_p)
 {
-    char *last_entry = pool_lookup(pool_p);
+    unique_lock<recursive_mutex> lock = lock_table();
+    pool_view last_entry = pool_lookup(pool_p);
 
     // Make sure that this really is the last entry.
-    assert((pool_p + (int) strlen(last_entry)) == pool_pos - 1);
+    assert(pool_p + POOL_HEADER + last_entry.len + 1 == pool_pos);
+
+    // Take it out of the intern table. Later entries in the same probe
+    // sequence are moved back so that no lookup stops short of them.
+    long mask = intern_size - 1;
+    long i = intern_probe(last_entry.str, last_entry.len,
+                          hash_chars(last_entry.str, last_entry.len));
+    long j = i;
+    while (true) {
+        intern_table[i].id = NULL_POOL;
+        long k;
+        do {
+            j = (j + 1) & mask;
+            if (intern_table[j].id == NULL_POOL) {
+                break;
+            }
+            k = intern_table[j].hash & mask;
+        } while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+        if (intern_table[j].id == NULL_POOL) {
+            break;
+        }
+        intern_table[i] = intern_table[j];
+        i = j;
+    }
+    intern_count--;
 
     // Back up pool_pos one entry.
     pool_pos = pool_p;
@@ -473,6 +625,60 @@ pool_index symbol_table::pool_forget(const pool_index pool_p)
 }
 
 
+/* Linear probing in the intern table. The cached hash value is compared
+   first, so the characters are seldom looked at. */
+
+long symbol_table::intern_probe(const char *s,
+                                const long len,
+                                const unsigned long h)
+{
+    long mask = intern_size - 1;
+    long i = h & mask;
+
+    while (intern_table[i].id != NULL_POOL) {
+        if (intern_table[i].hash == h) {
+            pool_view v = pool_lookup(intern_table[i].id);
+            if (v.len == len && memcmp(v.str, s, len) == 0) {
+                return i;
+            }
+        }
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+
+/* Double the size of the intern table and reinsert all strings. */
+
+void symbol_table::intern_grow()
+{
+    intern_entry *old_table = intern_table;
+    long old_size = intern_size;
+
+    intern_size *= 2;
+    intern_table = new intern_entry[intern_size];
+    for (long i = 0; i < intern_size; i++) {
+        intern_table[i].hash = 0;
+        intern_table[i].id = NULL_POOL;
+    }
+
+    long mask = intern_size - 1;
+    for (long i = 0; i < old_size; i++) {
+        if (old_table[i].id == NULL_POOL) {
+            continue;
+        }
+        long j = old_table[i].hash & mask;
+        while (intern_table[j].id != NULL_POOL) {
+            j = (j + 1) & mask;
+        }
+        intern_table[j] = old_table[i];
+    }
+
+    delete[] old_table;
+}
+
+
 /* Convert a scanned string into a better format: Strip the leading and
    trailing quotes, and convert any internal double quotes to single ones.
    The first arg will be filled in with the fixed string, the second arg is
@@ -508,22 +714,98 @@ char *symbol_table::fix_string(const char *old_str)
 
 /*** Hash table methods. ***/
 
-/* Uses the hash_x33 algorithm. Returns an index into the symbol table
-   given a string. The string is probably attained using pool_lookup(). */
-hash_index symbol_table::hash(const pool_index p)
+/* Uses the hash_x33 algorithm. Returns the full hash value of a string in
+   the pool. It is reduced to a slot index by hash_probe(). */
+unsigned long symbol_table::hash(const pool_index p)
+{
+    pool_view v = pool_lookup(p);
+    return hash_chars(v.str, v.len);
+}
+
+unsigned long symbol_table::hash_chars(const char *s, long len)
 {
-    char *s = pool_lookup(p);
-    int len = (int) strlen(s);
     // Magical hash value variable.
-    unsigned int h = 0;
+    unsigned long h = 0;
     // Calculate the hash value.
     while (len > 0) {
-        h = (h << 5) + h + *s++;
+        h = (h << 5) + h + (unsigned char) *s++;
         len--;
     }
-    // Memory leak since s is still allocated. However, since we've
-    // changed it, delete[] s is not a good idea at all.
-    return h % MAX_HASH;
+    return h;
+}
+
+
+/* Linear probing. We stop at the slot holding the identifier, or at the
+   first never-used slot. In the latter case the identifier is not in the
+   table, and we return the first tombstone we passed (if any) so that it
+   gets reused. */
+hash_index symbol_table::hash_probe(const pool_index pool_p,
+                                    const unsigned long h)
+{
+    hash_index mask = hash_size - 1;
+    hash_index i = h & mask;
+    hash_index tombstone = -1;
+
+    while (hash_table[i].id != NULL_POOL) {
+        if (hash_table[i].sym == NULL_SYM) {
+            if (tombstone == -1) {
+                tombstone = i;
+            }
+        } else if (hash_table[i].id == pool_p) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return tombstone != -1 ? tombstone : i;
+}
+
+
+/* Rehash all live slots, dropping the tombstones. If most of the used slots
+   were tombstones the size stays the same, otherwise it is doubled. The
+   back_link of every symbol reachable from a slot is updated. */
+void symbol_table::hash_grow()
+{
+    hash_entry *old_table = hash_table;
+    hash_index old_size = hash_size;
+
+    hash_index live = 0;
+    for (hash_index i = 0; i < old_size; i++) {
+        if (old_table[i].sym != NULL_SYM) {
+            live++;
+        }
+    }
+    if (live * 4 >= old_size) {
+        hash_size *= 2;
+    }
+
+    hash_table = new hash_entry[hash_size];
+    for (hash_index i = 0; i < hash_size; i++) {
+        hash_table[i].hash = 0;
+        hash_table[i].id = NULL_POOL;
+        hash_table[i].sym = NULL_SYM;
+    }
+
+    hash_index mask = hash_size - 1;
+    for (hash_index i = 0; i < old_size; i++) {
+        if (old_table[i].sym == NULL_SYM) {
+            continue;
+        }
+        // All names in the old table are distinct, so we only need to find
+        // an empty slot.
+        hash_index j = old_table[i].hash & mask;
+        while (hash_table[j].id != NULL_POOL) {
+            j = (j + 1) & mask;
+        }
+        hash_table[j] = old_table[i];
+        for (sym_index s = old_table[i].sym; s != NULL_SYM;
+                s = sym_table[s]->hash_link) {
+            sym_table[s]->back_link = j;
+        }
+    }
+
+    hash_used = live;
+    delete[] old_table;
 }
 
 
@@ -540,22 +822,30 @@ sym_index symbol_table::current_environment()
 /* Increase the current_level by one. */
 void symbol_table::open_scope()
 {
-  if (current_level == MAX_BLOCK)
-   fatal ("Reached the maximum depth of blocks (8)");
   current_level++;
-  block_table[current_level] = sym_pos;
+  block_table.ensure(current_level);
+  block_table[current_level] = last_installed;
 }
 
 
 /* Decrease the current_level by one. Return sym_index to new environment. */
 sym_index symbol_table::close_scope()
 {
+  unique_lock<recursive_mutex> lock = lock_table();
   sym_index curr_env = current_environment();
-  for(int i = sym_pos; i > curr_env; i--){
+  for(sym_index i = sym_pos; i > curr_env; i--){
  	    hash_index hash_i = sym_table[i]->back_link;
 
- 	    if(hash_table[hash_i] == i){
- 	      hash_table[hash_i] = sym_table[i]->hash_link;
+ 	    // The temps of blocks compiled in other threads, which are added
+ 	    // after whatever the parser has installed, are never in the hash
+ 	    // table.
+ 	    if(hash_i == NULL_SYM)
+ 	      continue;
+
+ 	    // Uncover the shadowed symbol, if any. Otherwise the slot becomes a
+ 	    // tombstone, which keeps probe chains through it intact.
+ 	    if(hash_table[hash_i].sym == i){
+ 	      hash_table[hash_i].sym = sym_table[i]->hash_link;
  	      sym_table[i]->hash_link = NULL_SYM;
       }
   }
@@ -571,14 +861,9 @@ sym_index symbol_table::close_scope()
    follows hash links outwards. */
 sym_index symbol_table::lookup_symbol(const pool_index pool_p)
 {
-  sym_index sym = hash_table[hash(pool_p)];
-  while(sym != NULL_SYM){
-    if(pool_compare(get_symbol_id(sym), pool_p)){
-      break;
-    }
-    sym = sym_table[sym]->hash_link;
-  }
-  return sym;
+  // The slot always holds the innermost visible symbol with this name.
+  // A free slot or a tombstone has sym == NULL_SYM.
+  return hash_table[hash_probe(pool_p, hash(pool_p))].sym;
 }
 
 
@@ -667,6 +952,7 @@ void symbol_table::set_symbol_type(const sym_index sym_p,
 sym_index symbol_table::install_symbol(const pool_index pool_p,
                                        const sym_type tag)
 {
+  unique_lock<recursive_mutex> lock = lock_table();
   sym_index index = lookup_symbol(pool_p);
   if(index != NULL_SYM && sym_table[index]->level == current_level)
     return index;
@@ -674,41 +960,52 @@ sym_index symbol_table::install_symbol(const pool_index pool_p,
   symbol *new_sym = NULL;
   switch(tag){
     case SYM_ARRAY:
-      new_sym = new array_symbol(pool_p);
+      new_sym = new (sym_arena) array_symbol(pool_p);
       break;
     case SYM_FUNC:
-      new_sym = new function_symbol(pool_p);
+      new_sym = new (sym_arena) function_symbol(pool_p);
       break;
     case SYM_PROC:
-      new_sym = new procedure_symbol(pool_p);
+      new_sym = new (sym_arena) procedure_symbol(pool_p);
       break;
     case SYM_VAR:
-      new_sym = new variable_symbol(pool_p);
+      new_sym = new (sym_arena) variable_symbol(pool_p);
       break;
     case SYM_PARAM:
-      new_sym = new parameter_symbol(pool_p);
+      new_sym = new (sym_arena) parameter_symbol(pool_p);
       break;
     case SYM_CONST:
-      new_sym = new constant_symbol(pool_p);
+      new_sym = new (sym_arena) constant_symbol(pool_p);
       break;
     case SYM_NAMETYPE:
-      new_sym = new nametype_symbol(pool_p);
+      new_sym = new (sym_arena) nametype_symbol(pool_p);
       break;
     default:
       fatal("Unknown type");
       break;
   }
   new_sym->level = current_level;
-  hash_index hash_p = hash(pool_p);
+
+  // Keep at least half of the slots free so probe chains stay short.
+  if((hash_used + 1) * 2 > hash_size)
+    hash_grow();
+
+  unsigned long h = hash(pool_p);
+  hash_index hash_p = hash_probe(pool_p, h);
   new_sym->back_link = hash_p;
-  new_sym->hash_link = NULL_SYM;
+  // Shadow the outer symbol with the same name, if there is one.
+  new_sym->hash_link = hash_table[hash_p].sym;
 
-  if(hash_table[hash_p] != NULL_SYM)
-    new_sym->hash_link = hash_table[hash_p];
+  if(hash_table[hash_p].id == NULL_POOL)
+    hash_used++;
 
   sym_pos++;
+  sym_table.ensure(sym_pos);
   sym_table[sym_pos] = new_sym;
-  hash_table[hash_p] = sym_pos;
+  last_installed = sym_pos;
+  hash_table[hash_p].hash = h;
+  hash_table[hash_p].id = pool_p;
+  hash_table[hash_p].sym = sym_pos;
   return sym_pos;
 }
 
@@ -1007,15 +1304,18 @@ sym_index symbol_table::enter_parameter(position_information *pos,
     symbol *tmp = sym_table[current_environment()];
 
     parameter_symbol *tmp_param;
+    int *ar_size;
 
     if (tmp->tag == SYM_FUNC) {
         function_symbol *func = tmp->get_function_symbol();
         tmp_param = func->last_parameter; // This is the old last parameter.
         func->last_parameter = par;       // Make 'par' the new last parameter.
+        ar_size = &func->ar_size;
     } else if (tmp->tag == SYM_PROC) {
         procedure_symbol *proc = tmp->get_procedure_symbol();
         tmp_param = proc->last_parameter; // This is the old last parameter.
         proc->last_parameter = par;       // Make 'par' the new last parameter.
+        ar_size = &proc->ar_size;
     } else {
         fatal("Compiler confused about scope, aborting.");
         return 0;
@@ -1026,19 +1326,40 @@ sym_index symbol_table::enter_parameter(position_information *pos,
     par->preceding = tmp_param;
 
     // We loop through the parameters starting with the last and working our
-    // way forward.
+    // way forward. Only the ones passed on the stack count for the offset.
     int param_offset = 0;
+    int position = 0;
+    int same_type = 0;
     while (tmp_param != NULL) {
-        param_offset += tmp_param->size;
+        if (tmp_param->arg_reg == -1) {
+            param_offset += tmp_param->size;
+        }
+        if (tmp_param->type == type) {
+            same_type++;
+        }
+        position++;
         tmp_param = tmp_param->preceding;
     }
 
     // Set up the parameter-specific fields.
-    par->offset = param_offset;
+    par->sym_p = sym_p;
     par->tag = SYM_PARAM;
     par->size = get_size(type);
     par->type = type;
 
+    // With -R, the first parameters of a procedure or function are passed
+    // in registers, and stored in its activation record by its prologue.
+    // The predefined procedures and functions, which are entered at the
+    // global level, always take their parameters on the stack.
+    if (register_parameters && tmp->level > 0 &&
+            position < REGISTER_PARAMETERS) {
+        par->arg_reg = same_type;
+        par->offset = *ar_size;
+        *ar_size += par->size;
+    } else {
+        par->offset = param_offset;
+    }
+
     sym_table[sym_p] = par;
 
     return sym_p;
@@ -1,7 +1,11 @@
 #ifndef __SYMTAB_HH__
 #define __SYMTAB_HH__
 
+#include <mutex>
+#include <vector>
+
 #include "error.hh"
+#include "arena.hh"
 
 // Set this #define to 0 after the scanner works.
 #define TEST_SCANNER 0
@@ -36,30 +40,102 @@ typedef enum symbol_types sym_type;
 
 /* Some numerical constants we use in the symbol table. */
 
-// Max allowed nesting levels.
-const block_level MAX_BLOCK = 8;
-
-// Max size of hash table.
-const hash_index MAX_HASH = 512;
+// Initial size of the hash table. Must be a power of two, since the table
+// is indexed by masking the hash value. It is doubled as it fills up.
+const hash_index BASE_HASH_SIZE = 512;
 
-// Base size of string pool.
+// Base size of string pool. It is doubled as it fills up.
 const pool_index BASE_POOL_SIZE = 1024;
 
-// Max size of symbol table.
-const sym_index MAX_SYM = 1024;
+// Initial size of the string pool's intern table. Must be a power of two.
+const long BASE_INTERN_SIZE = 256;
+
+// Number of entries in each segment of the symbol and block tables, as a
+// power of two.
+const int SEGMENT_BITS = 10;
 
 // Signifies 'no symbol'.
 const sym_index NULL_SYM = -1;
 
+// Signifies 'no string', ie, an unused hash table slot.
+const pool_index NULL_POOL = -1;
+
 // Signifies a non-int array size.
 const int ILLEGAL_ARRAY_CARD = -1;
 
+/* Number of parameters that are passed in registers with -R. The rest of
+   the parameters of a procedure or function go on the stack. */
+const int REGISTER_PARAMETERS = 4;
+
+/* Number of labels reserved for the back end of each block with -j. */
+const long BLOCK_LABELS = 1L << 20;
+
 /* Sets a limit for max nr of temporary variables. Should never be reached
    unless someone really, really starts to dig writing huge programs in
    Diesel. See quads.cc. */
 const int MAX_TEMP_VARS = 999999;
 const int MAX_TEMP_VAR_LENGTH = 8;
 
+/* A non-owning view of a string in the string pool, as returned by
+   symbol_table::pool_lookup(). The characters are always followed by a null
+   byte, so str can be used as an ordinary C string too. Installing a new
+   string may move the pool, so don't hold on to a view across a call to
+   pool_install(). */
+struct pool_view
+{
+    const char *str;
+    long        len;
+};
+
+ostream &operator<<(ostream &, const pool_view &);
+
+/* A growable table made of fixed-size segments. Growing it only adds new
+   segments and never moves the existing ones, so an entry stays where it is
+   once it has been made valid by ensure(). The table of segments has room
+   for MAX_SEGMENTS from the start, so that the entries can be read by other
+   threads while more are added. New entries are value initialized, ie,
+   NULL for pointers and 0 for numbers. */
+template <class T>
+class segmented_table
+{
+private:
+    // Table of pointers to the segments.
+    T **segments;
+
+    // Number of allocated segments.
+    long segment_count;
+
+public:
+    static const long SEGMENT_SIZE = 1L << SEGMENT_BITS;
+    static const long MAX_SEGMENTS = 1L << 16;
+
+    segmented_table() {
+        segment_count = 0;
+        segments = new T*[MAX_SEGMENTS]();
+    }
+
+    ~segmented_table() {
+        for (long i = 0; i < segment_count; i++) {
+            delete[] segments[i];
+        }
+        delete[] segments;
+    }
+
+    // Make sure that index i can be used.
+    void ensure(const long i) {
+        while ((i >> SEGMENT_BITS) >= segment_count) {
+            if (segment_count == MAX_SEGMENTS) {
+                fatal("segmented_table: too many entries");
+            }
+            segments[segment_count++] = new T[SEGMENT_SIZE]();
+        }
+    }
+
+    T &operator[](const long i) {
+        return segments[i >> SEGMENT_BITS][i & (SEGMENT_SIZE - 1)];
+    }
+};
+
 /* The various symbol classes, predefined. */
 class constant_symbol;
 class variable_symbol;
@@ -83,6 +159,10 @@ extern sym_index void_type;
 extern sym_index integer_type;
 extern sym_index real_type;
 
+// The predefined trunc() function, which the code generator may expand
+// inline.
+extern sym_index trunc_function;
+
 
 
 
@@ -125,10 +205,10 @@ public:
     // Type: integer_type, real_type, or void_type.
     sym_index type;
 
-    // Link to other symbols with same hash key.
+    // Link to the symbol with the same name that this one shadows, if any.
     sym_index hash_link;
 
-    // Link back to the hash table.
+    // Link back to this symbol's slot in the hash table.
     sym_index back_link;
 
     // Current block level, ie, nesting depth.
@@ -212,6 +292,9 @@ protected:
     virtual void print(ostream &);
 
 public:
+    // True for the temps made by gen_temp_var().
+    bool temp;
+
     // Constructor. Args: identifier.
     variable_symbol(const pool_index);
 
@@ -258,6 +341,16 @@ public:
     // Link to preceding parameter, if any.
     parameter_symbol *preceding;
 
+    // The index of the parameter itself, so that the parameters of a block
+    // can be found from its symbol also after its scope has been closed.
+    sym_index sym_p;
+
+    // With -R, the number of the register the parameter is passed in,
+    // counting integer and real registers separately. -1 for a parameter
+    // passed on the stack. A parameter passed in a register has its offset
+    // in the activation record, like a local variable.
+    int arg_reg;
+
     // Constructor. Args: identifier.
     parameter_symbol(const pool_index);
 
@@ -279,7 +372,7 @@ public:
     int ar_size;
 
     // Assembler label number.
-    int label_nr;
+    long label_nr;
 
     // List of parameters. We store them in reverse order to make type
     // checking easier later on.
@@ -306,7 +399,7 @@ public:
     int ar_size;
 
     // Assembler label number.
-    int label_nr;
+    long label_nr;
 
     // List of parameters. We store them in reverse order to make type
     // checking easier later on.
@@ -363,6 +456,31 @@ ostream &operator<<(ostream &, symbol *);
  ******************************/
 
 
+/* One slot in the open-addressed hash table. A slot is keyed on an
+   identifier, and sym points at the innermost visible symbol with that name.
+   Symbols it shadows are reached through symbol::hash_link. Since strings
+   are interned, slots are matched on id alone; the full hash value is kept
+   so that growing the table doesn't need to go back to the string pool.
+   A slot with id == NULL_POOL has never been used. A slot with a valid id
+   but sym == NULL_SYM is a tombstone left behind by close_scope(). */
+struct hash_entry
+{
+    unsigned long hash;
+    pool_index    id;
+    sym_index     sym;
+};
+
+
+/* One slot in the string pool's intern table, which maps the contents of a
+   string to the pool_index it was installed at. A slot with
+   id == NULL_POOL is empty. */
+struct intern_entry
+{
+    unsigned long hash;
+    pool_index    id;
+};
+
+
 /* The symbol table. Presents an interfaced used by parser.y.
    The idea is that in parser.y, the code will look something like this:
    NOTE: Fix this comment.
@@ -378,6 +496,25 @@ ostream &operator<<(ostream &, symbol *);
             }
             ;
 */
+/* The labels and temps the back end of a block may make when it runs in a
+   thread of its own, with -j. Each block gets a range of labels when it is
+   handed over, so that the labels come out the same whatever order the
+   threads get through the blocks in. */
+struct block_range
+{
+    // The block. Its temps are added to its activation record.
+    sym_index env;
+
+    // The next label to hand out, and the end of the range.
+    long next_label;
+    long end_label;
+
+    // The temps of the block are numbered on from the temps made when it
+    // was handed over. The numbers only show in printouts.
+    long temp_nr;
+};
+
+
 class symbol_table
 {
 private:
@@ -392,10 +529,43 @@ private:
     // Points to end of string pool
     long pool_pos;
 
+    // Open-addressed table of every string in the pool, so that each
+    // distinct string is only installed once.
+    intern_entry *intern_table;
+
+    // Current number of intern slots. Always a power of two.
+    long intern_size;
+
+    // Number of strings in the intern table.
+    long intern_count;
+
+    // Find the intern slot for a string. Returns the slot holding it, or the
+    // empty slot where it should be inserted.
+    long intern_probe(const char *, const long, const unsigned long);
+
+    // Double the size of the intern table.
+    void intern_grow();
+
+    // The hash function used both for strings and identifiers.
+    static unsigned long hash_chars(const char *, long);
+
     // --- Hash table variables. ---
 
     // The actual hash table.
-    sym_index *hash_table;
+    hash_entry *hash_table;
+
+    // Current number of slots. Always a power of two.
+    hash_index hash_size;
+
+    // Number of slots that are either in use or tombstones.
+    hash_index hash_used;
+
+    // Find the slot for an identifier given its hash value. Returns the
+    // slot holding it, or the slot where it should be inserted if absent.
+    hash_index hash_probe(const pool_index, const unsigned long);
+
+    // Rehash into a larger table when too few slots are left.
+    void hash_grow();
 
     // --- Display variables. ---
 
@@ -404,22 +574,46 @@ private:
 
     // Table of level sym_index pointers. They point at
     // the start of a new scope/block.
-    sym_index *block_table;
+    segmented_table<sym_index> block_table;
 
     // --- Symbol table variables. ---
 
     // The actual symbol table.
-    symbol **sym_table;
+    segmented_table<symbol *> sym_table;
+
+    // All symbols are allocated here. They live as long as the table.
+    arena sym_arena;
 
     // Points to last symbol entered in the table.
     sym_index sym_pos;
 
+    // The last symbol installed by the parser. With -j, the temps of other
+    // blocks may have been entered after it.
+    sym_index last_installed;
+
     // Assembler label counter.
-    int label_nr;
+    long label_nr;
 
     // Temp variable counter.
     long temp_nr;
 
+    // With -j, the table is changed and the string pool read under this
+    // lock, since the back end of a block may run in another thread than
+    // the parser. The threads only read the symbols the parser has handed
+    // over to them, and add temps of their own.
+    recursive_mutex table_mutex;
+    bool shared;
+
+    // Take the lock, if the table is shared.
+    unique_lock<recursive_mutex> lock_table();
+
+    // The string pools that have been outgrown. Strings seen by other
+    // threads may still be in them, so they are kept.
+    vector<char *> old_pools;
+
+    // gen_temp_var() for a block in a range.
+    sym_index gen_range_temp(sym_index);
+
 public:
     // NOTE: Some of these methods should be made private.
 
@@ -435,12 +629,15 @@ public:
 
     // --- String pool methods. ---
 
-    // Install a string in the pool.
-    pool_index pool_install(char *);
+    // Install a string in the pool. Installing the same string twice
+    // returns the same pool_index.
+    pool_index pool_install(const char *);
+    pool_index pool_install(const char *, const long);
 
-    char *pool_lookup(const pool_index);
+    // Return a view of an installed string. No copy is made.
+    pool_view pool_lookup(const pool_index);
 
-     // Compare strings
+    // Compare strings. Since strings are interned, this is an index compare.
     bool pool_compare(const pool_index, const pool_index);
 
     // Remove last entry from  string pool.
@@ -455,7 +652,7 @@ public:
     // --- Hash table methods. ---
 
     // Get hash value for a string.
-    hash_index hash(const pool_index);
+    unsigned long hash(const pool_index);
 
     // --- Display methods. ---
 
@@ -497,6 +694,31 @@ public:
     // Generate, install and return sym_index to next temp var.
     sym_index gen_temp_var(sym_index);
 
+    // Returns true if the symbol is a temp var made by gen_temp_var().
+    bool is_temp_var(const sym_index);
+
+    // --- Methods for the -j threads. ---
+
+    // Make the table safe to use from other threads than the parser's.
+    void share();
+
+    // Reserve a range of labels and temps for the current block.
+    void reserve_range(block_range *);
+
+    // Make the labels and temps of the calling thread come out of a
+    // range, or out of the table again if NULL.
+    void use_range(block_range *);
+
+    // Sizes of the tables so far, for the -T statistics.
+    long get_sym_pos() { return sym_pos; }
+    long get_pool_pos() { return pool_pos; }
+    long get_temp_nr() { return temp_nr; }
+    long get_label_nr() { return label_nr; }
+
+    // Move the label counter on past the labels of a block whose code was
+    // taken from the -C cache.
+    void set_label_nr(long nr) { label_nr = nr; }
+
     // These functions are used to enter identifiers into the symbol table,
     // depending on their context (function, constant, etc).
 
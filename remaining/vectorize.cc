@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <iostream>
+#include "symtab.hh"
+#include "vectorize.hh"
+
+/*** This file contains the loop vectorizer. See vectorize.hh for an
+     overview. ***/
+
+// Defined in main.cc.
+extern bool print_quads;
+
+
+loop_vectorizer::loop_vectorizer()
+{
+    total_vectorized = 0;
+}
+
+
+/* The vector quad doing what an arithmetic quad of a loop body does, or
+   q_nop if there is none. */
+static quad_op_type vector_op(quad_op_type op)
+{
+    switch (op) {
+    case q_iplus:
+        return q_viplus;
+    case q_iminus:
+        return q_viminus;
+    case q_rplus:
+        return q_vrplus;
+    case q_rminus:
+        return q_vrminus;
+    case q_rmult:
+        return q_vrmult;
+    case q_rdivide:
+        return q_vrdivide;
+    default:
+        return q_nop;
+    }
+}
+
+
+bool loop_vectorizer::is_literal(sym_index sym_p, long value)
+{
+    map<sym_index, long>::iterator l = literals.find(sym_p);
+    if (l != literals.end()) {
+        return l->second == value;
+    }
+    symbol *sym = sym_tab->get_symbol(sym_p);
+    return sym->tag == SYM_CONST && sym->type == integer_type &&
+        sym->get_constant_symbol()->const_value.ival == value;
+}
+
+
+sym_index loop_vectorizer::literal(long value, vector<quadruple> &code)
+{
+    sym_index temp = sym_tab->gen_temp_var(integer_type);
+    code.push_back(quadruple(q_iload, value, NULL_SYM, temp));
+    return temp;
+}
+
+
+int loop_vectorizer::new_register(bool fresh)
+{
+    if (!fresh && !free_regs.empty()) {
+        int reg = free_regs.back();
+        free_regs.pop_back();
+        return reg;
+    }
+    if (next_register > LAST_VECTOR_REGISTER) {
+        return -1;
+    }
+    return next_register++;
+}
+
+
+/* An argument is either computed by a quad of the body that has been
+   translated already, or invariant, ie, not assigned in the loop at all,
+   since nothing is called there. The invariants get a register of their
+   own for the whole vector loop, one that no quad of the body before has
+   used. */
+int loop_vectorizer::argument_register(sym_index sym_p, sym_index type)
+{
+    if (sym_tab->get_symbol(sym_p)->type != type) {
+        return -1;
+    }
+    map<sym_index, int>::iterator r = vector_reg.find(sym_p);
+    if (r != vector_reg.end()) {
+        return r->second;
+    }
+    sym_type tag = sym_tab->get_symbol_tag(sym_p);
+    if (loop_defs.find(sym_p) != loop_defs.end() ||
+            (tag != SYM_CONST && tag != SYM_VAR && tag != SYM_PARAM)) {
+        return -1;
+    }
+    int reg = new_register(true);
+    if (reg != -1) {
+        setup.push_back(quadruple(q_vsplat, sym_p, NULL_SYM, reg));
+        vector_reg[sym_p] = reg;
+    }
+    return reg;
+}
+
+
+/* The element reads and writes of the body are at the counter, and the
+   address a q_lindex computes is only used by the store after it. The
+   registers of the values computed in the body are handed out again after
+   their last use. */
+bool loop_vectorizer::translate(long i)
+{
+    quadruple &quad = (*q)[i];
+    switch (quad.op_code) {
+    case q_irindex:
+    case q_rrindex: {
+        int reg;
+        if (quad.sym2 != counter || loop_defs[quad.sym3] != 1 ||
+                (reg = new_register(false)) == -1) {
+            return false;
+        }
+        body.push_back(quadruple(q_vload, quad.sym1, counter, reg));
+        vector_reg[quad.sym3] = reg;
+        if (find(arrays.begin(), arrays.end(), quad.sym1) == arrays.end()) {
+            arrays.push_back(quad.sym1);
+        }
+        break;
+    }
+    case q_lindex:
+        if (quad.sym2 != counter || !sym_tab->is_temp_var(quad.sym3) ||
+                loop_defs[quad.sym3] != 1 || loop_uses[quad.sym3] != 1) {
+            return false;
+        }
+        element_of[quad.sym3] = quad.sym1;
+        break;
+    case q_istore:
+    case q_rstore: {
+        map<sym_index, sym_index>::iterator a = element_of.find(quad.sym3);
+        if (a == element_of.end()) {
+            return false;
+        }
+        int reg = argument_register(quad.sym1, quad.op_code == q_istore ?
+                                    integer_type : real_type);
+        if (reg == -1) {
+            return false;
+        }
+        body.push_back(quadruple(q_vstore, a->second, counter, reg));
+        if (find(arrays.begin(), arrays.end(), a->second) == arrays.end()) {
+            arrays.push_back(a->second);
+        }
+        break;
+    }
+    default: {
+        quad_op_type op = vector_op(quad.op_code);
+        if (op == q_nop) {
+            return false;
+        }
+        sym_index type = op == q_viplus || op == q_viminus ? integer_type :
+            real_type;
+        sym_index d = quad.sym3;
+        if (loop_defs[d] != 1 || sym_tab->get_symbol(d)->type != type) {
+            return false;
+        }
+
+        // A sum. Its register holds two sums, of every other round each.
+        if (type == integer_type && d != counter &&
+                (d == quad.sym1 || (op == q_viplus && d == quad.sym2))) {
+            sym_index x = d == quad.sym1 ? quad.sym2 : quad.sym1;
+            map<sym_index, int>::iterator r = vector_reg.find(x);
+            int reg;
+            if (x == d || r == vector_reg.end() || loop_uses[d] != 1 ||
+                    (reg = new_register(true)) == -1) {
+                return false;
+            }
+            body.push_back(quadruple(op, reg, r->second, reg));
+            sum_regs.push_back(make_pair(d, reg));
+            break;
+        }
+
+        if (loop_defs.find(quad.sym1) == loop_defs.end() &&
+                loop_defs.find(quad.sym2) == loop_defs.end()) {
+            return false;
+        }
+        int left = argument_register(quad.sym1, type);
+        int right = argument_register(quad.sym2, type);
+        int reg;
+        if (left == -1 || right == -1) {
+            return false;
+        }
+
+        // The result goes where the left argument was, if that was its
+        // last use, which saves copying it there first.
+        if (loop_defs.find(quad.sym1) != loop_defs.end() &&
+                last_use[quad.sym1] == i && quad.sym1 != quad.sym2) {
+            reg = left;
+            vector_reg.erase(quad.sym1);
+        } else if ((reg = new_register(false)) == -1) {
+            return false;
+        }
+        body.push_back(quadruple(op, left, right, reg));
+        vector_reg[d] = reg;
+        break;
+    }
+    }
+
+    sym_index *slots[2];
+    int n = quad.use_slots(slots);
+    for (int k = 0; k < n; k++) {
+        map<sym_index, int>::iterator r = vector_reg.find(*slots[k]);
+        if (r != vector_reg.end() && last_use[*slots[k]] == i &&
+                loop_defs.find(*slots[k]) != loop_defs.end()) {
+            free_regs.push_back(r->second);
+            vector_reg.erase(r);
+        }
+    }
+    return true;
+}
+
+
+/* See vectorize.hh for what the loops look like, and what is put in front
+   of them. */
+bool loop_vectorizer::vectorize(long b, map<long, vector<quadruple> > &inserts)
+{
+    basic_block &block = graph->blocks[b];
+    quadruple &top = (*q)[block.first];
+    quadruple &branch = (*q)[block.last];
+    if (top.op_code != q_labl || block.last - block.first < 3 ||
+            (branch.op_code != q_ijlt && branch.op_code != q_ijle) ||
+            branch.int1 != top.int1) {
+        return false;
+    }
+
+    // The loop is only entered at the top, by falling into it.
+    for (unsigned long p = 0; p < block.predecessors.size(); p++) {
+        long from = block.predecessors[p];
+        if (from == b) {
+            continue;
+        }
+        quadruple &last = (*q)[graph->blocks[from].last];
+        if (from != b - 1 || (last.ends_block() && last.int1 == top.int1)) {
+            return false;
+        }
+    }
+
+    counter = branch.sym2;
+    sym_index limit = branch.sym3;
+    quadruple &step = (*q)[block.last - 1];
+    if (step.op_code != q_iplus || step.sym3 != counter ||
+            !((step.sym1 == counter && is_literal(step.sym2, 1)) ||
+              (step.sym2 == counter && is_literal(step.sym1, 1)))) {
+        return false;
+    }
+
+    loop_defs.clear();
+    loop_uses.clear();
+    last_use.clear();
+    for (long i = block.first + 1; i < block.last; i++) {
+        quadruple &quad = (*q)[i];
+        if (quad.op_code == q_labl) {
+            return false;
+        }
+        sym_index *slots[2];
+        int n = quad.use_slots(slots);
+        for (int k = 0; k < n; k++) {
+            loop_uses[*slots[k]]++;
+            last_use[*slots[k]] = i;
+        }
+        sym_index d = quad.defined_sym();
+        if (d != NULL_SYM) {
+            loop_defs[d]++;
+        }
+    }
+    if (loop_defs[counter] != 1 || loop_defs.find(limit) != loop_defs.end()) {
+        return false;
+    }
+
+    vector_reg.clear();
+    element_of.clear();
+    free_regs.clear();
+    next_register = FIRST_VECTOR_REGISTER;
+    arrays.clear();
+    sum_regs.clear();
+    setup.clear();
+    body.clear();
+    for (long i = block.first + 1; i < block.last - 1; i++) {
+        if (!translate(i)) {
+            return false;
+        }
+    }
+
+    // Nothing computed in one round may be needed in the next or after the
+    // loop, but the counter and the sums.
+    bool stores = false;
+    for (unsigned long i = 0; i < body.size(); i++) {
+        stores = stores || body[i].op_code == q_vstore;
+    }
+    if (!stores && sum_regs.empty()) {
+        return false;
+    }
+    map<sym_index, int>::iterator d;
+    for (d = loop_defs.begin(); d != loop_defs.end(); d++) {
+        bool summed = false;
+        for (unsigned long k = 0; k < sum_regs.size(); k++) {
+            summed = summed || sum_regs[k].first == d->first;
+        }
+        if (d->first != counter && !summed && live->live_after(d->first, b)) {
+            return false;
+        }
+    }
+
+    // With i <= n, there is one round more left than n - i.
+    long extra = branch.op_code == q_ijle ? 1 : 0;
+    vector<quadruple> code;
+    sym_index zero = literal(0, code);
+    sym_index two = literal(2, code);
+    sym_index two_left = extra == 0 ? two : literal(2 - extra, code);
+    sym_index three_left = literal(3 - extra, code);
+    sym_index left = sym_tab->gen_temp_var(integer_type);
+    sym_index offset = sym_tab->gen_temp_var(integer_type);
+    long ready = sym_tab->get_next_label();
+    long vector_top = sym_tab->get_next_label();
+    long done = sym_tab->get_next_label();
+
+    code.push_back(quadruple(q_iminus, limit, counter, left));
+    code.push_back(quadruple(q_ijlt, top.int1, left, two_left));
+    code.push_back(quadruple(q_valign, arrays[0], counter, offset));
+    code.push_back(quadruple(q_ijeq, ready, offset, zero));
+    code.push_back(quadruple(q_ijlt, top.int1, left, three_left));
+    for (long i = block.first + 1; i < block.last; i++) {
+        code.push_back((*q)[i]);
+    }
+    code.push_back(quadruple(q_labl, ready, NULL_SYM, NULL_SYM));
+    for (unsigned long k = 1; k < arrays.size(); k++) {
+        code.push_back(quadruple(q_valign, arrays[k], counter, offset));
+        code.push_back(quadruple(q_ijne, top.int1, offset, zero));
+    }
+    code.insert(code.end(), setup.begin(), setup.end());
+    for (unsigned long k = 0; k < sum_regs.size(); k++) {
+        code.push_back(quadruple(q_vsplat, zero, NULL_SYM,
+                                 sum_regs[k].second));
+    }
+
+    code.push_back(quadruple(q_labl, vector_top, NULL_SYM, NULL_SYM));
+    code.insert(code.end(), body.begin(), body.end());
+    code.push_back(quadruple(q_iplus, counter, two, counter));
+    code.push_back(quadruple(q_iminus, limit, counter, left));
+    code.push_back(quadruple(q_ijge, vector_top, left, two_left));
+
+    for (unsigned long k = 0; k < sum_regs.size(); k++) {
+        sym_index total = sym_tab->gen_temp_var(integer_type);
+        sym_index sum = sum_regs[k].first;
+        code.push_back(quadruple(q_visum, sum_regs[k].second, NULL_SYM,
+                                 total));
+        code.push_back(quadruple(q_iplus, sum, total, sum));
+    }
+    code.push_back(quadruple(extra == 0 ? q_ijge : q_ijgt, done, counter,
+                             limit));
+
+    vector<quadruple> &before = inserts[block.first];
+    before.insert(before.end(), code.begin(), code.end());
+    inserts[block.last + 1].push_back(quadruple(q_labl, done, NULL_SYM,
+                                                NULL_SYM));
+    return true;
+}
+
+
+/* The vectorizer's interface method. The loops are all found on the list
+   as it was, and their vector loops put in at the end. */
+void loop_vectorizer::do_vectorize(quad_list *q_list)
+{
+    q = q_list;
+
+    // Only lists with arrays have anything to vectorize.
+    bool elements = false;
+    literals.clear();
+    map<sym_index, int> defs;
+    for (long i = 0; i < q->size(); i++) {
+        quadruple &quad = (*q)[i];
+        elements = elements || quad.op_code == q_irindex ||
+            quad.op_code == q_rrindex || quad.op_code == q_lindex;
+        sym_index d = quad.defined_sym();
+        if (!sym_tab->is_temp_var(d)) {
+            continue;
+        }
+        if (++defs[d] == 1 && quad.op_code == q_iload) {
+            literals[d] = quad.int1;
+        } else {
+            literals.erase(d);
+        }
+    }
+    if (!elements) {
+        return;
+    }
+
+    flow_graph g(q);
+    live_variables l(&g);
+    graph = &g;
+    live = &l;
+    map<long, vector<quadruple> > inserts;
+    long vectorized = 0;
+    for (long b = 0; b < (long)g.blocks.size(); b++) {
+        if (g.reachable(b) && vectorize(b, inserts)) {
+            vectorized++;
+        }
+    }
+    if (!inserts.empty()) {
+        q->insert_quads(inserts);
+    }
+
+    total_vectorized += vectorized;
+    if (print_quads && vectorized > 0) {
+        cout << "\nLoop vectorizer: " << vectorized << " loops ("
+             << total_vectorized << " so far)" << endl;
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef __VECTORIZE_HH__
+#define __VECTORIZE_HH__
+
+#include <map>
+#include <vector>
+
+#include "flowgraph.hh"
+#include "quads.hh"
+
+using namespace std;
+
+
+/*** The loop vectorizer is the last of the quad optimizer's passes. It finds
+     the counted loops over arrays that work on one element at a time, and
+     runs two rounds of them at once in SSE2 code, which has room for two
+     integers or two reals in each xmm register.
+
+     A loop it takes is a single basic block, entered only at its top,
+     which ends with
+         i := i + 1
+         if i < n goto top         (or i <= n)
+     with n not changed in it, and which does nothing but read and write
+     the elements of arrays at index i, add or subtract integers, and add,
+     subtract, multiply or divide reals. The values it computes may not be
+     live at the top of the loop or after it, so no round depends on the
+     one before it. The one exception are sums: an integer variable only
+     ever seen in the loop as s := s + x, or s := s - x, gets a register of
+     two sums of its own, which are added to it after the vector loop.
+
+     Arrays grow downward, so the element after the one at i is 8 bytes
+     below it, and an xmm register loaded from that one holds round i + 1
+     in its low half and round i in its high half. That pair has to be on
+     a 16 byte boundary for the aligned loads and stores, which only holds
+     for every other index, on a frame that is only 8 byte aligned. So the
+     vector loop is put in front of the top of the old loop, which is left
+     as it was, and checks at run time that at least two rounds are left,
+     runs one round by itself first if the first array isn't aligned at i,
+     and gives up if any of the others still isn't. After the vector loop,
+     the old one does the last round, if there is one:
+
+           r := n - i
+           if r < 2 goto top
+           if the pair of the first array at i is aligned goto ready
+           if r < 3 goto top
+           <one round of the body>
+         ready:
+           if the pair of any other array at i isn't aligned goto top
+           <splat the invariants and clear the sums>
+         vector:
+           <the body, two rounds at once>
+           i := i + 2
+           r := n - i
+           if r >= 2 goto vector
+           <add up the sums>
+           if i >= n goto done
+         top:
+           <the old loop>
+         done:
+
+     SSE2 has no 64-bit integer multiply or compare, so products and
+     maxima of integers aren't taken. Sums of reals aren't either, since
+     adding them up in another order rounds them differently. x87 code
+     rounds each result to a double when it is stored, toward zero, so it
+     gets the same reals as the vector code. ***/
+
+
+// The xmm registers the vector quads may use. The SSE2 code of -S uses
+// xmm0 and xmm1 for one quad at a time, and there are no calls in the
+// vector loops, so the ones parameters are passed in with -R are free.
+const int FIRST_VECTOR_REGISTER = 2;
+const int LAST_VECTOR_REGISTER = 15;
+
+
+class loop_vectorizer
+{
+private:
+    quad_list *q;
+    flow_graph *graph;
+    live_variables *live;
+
+    // The temps only assigned by a q_iload, and their values.
+    map<sym_index, long> literals;
+
+    // For the loop being vectorized: its counter, the number of quads in
+    // its body assigning and reading each symbol and the index of the last
+    // one reading it, the xmm register holding each value and invariant,
+    // the ones that are free again, the first one not handed out yet, the
+    // array each element address is in, the arrays it touches, in order,
+    // and the sums with their registers. The quads splatting the
+    // invariants, and the vector loop's body.
+    sym_index counter;
+    map<sym_index, int> loop_defs;
+    map<sym_index, int> loop_uses;
+    map<sym_index, long> last_use;
+    map<sym_index, int> vector_reg;
+    vector<int> free_regs;
+    int next_register;
+    map<sym_index, sym_index> element_of;
+    vector<sym_index> arrays;
+    vector<pair<sym_index, int> > sum_regs;
+    vector<quadruple> setup;
+    vector<quadruple> body;
+
+    // Returns true if a symbol is the literal temp of value, or an integer
+    // constant with it.
+    bool is_literal(sym_index, long value);
+
+    // A new literal temp, loaded by a quad added to code.
+    sym_index literal(long value, vector<quadruple> &code);
+
+    // Hand out an xmm register, or return -1 if there are none left. A
+    // fresh one has not been used in the body before.
+    int new_register(bool fresh);
+
+    // The register holding an argument of the body, splatting it if it is
+    // invariant, or -1 if it is of the wrong type or neither.
+    int argument_register(sym_index, sym_index type);
+
+    // Translate the quad of the body at the index. Returns false if it
+    // can't be done two rounds at a time.
+    bool translate(long);
+
+    // Vectorize the loop of a basic block, if it is one. The quads to add
+    // are put in a map from the index of the quad they go in front of.
+    bool vectorize(long block, map<long, vector<quadruple> > &);
+
+public:
+    // The number of loops vectorized, summed over all blocks.
+    long total_vectorized;
+
+    loop_vectorizer();
+
+    // This is the interface to the quad optimizer. Vectorizes the loops of
+    // an optimized quad list in place.
+    void do_vectorize(quad_list *);
+};
+
+
+#endif